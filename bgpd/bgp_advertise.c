@@ -12,6 +12,7 @@
 #include "frrevent.h"
 #include "queue.h"
 #include "filter.h"
+#include "jhash.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -21,10 +22,103 @@
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_reclaim.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_updgrp.h"
 
+/*
+ * Side table of compact adj-outs (see struct bgp_adj_out) that currently
+ * have labels or a pending advertisement.  Only touched from the main
+ * pthread.
+ */
+static int bgp_adj_out_ext_cmp(const struct bgp_adj_out_ext *a,
+			       const struct bgp_adj_out_ext *b)
+{
+	return numcmp((uintptr_t)a->adj, (uintptr_t)b->adj);
+}
+
+static uint32_t bgp_adj_out_ext_hash(const struct bgp_adj_out_ext *e)
+{
+	uintptr_t p = (uintptr_t)e->adj;
+
+	return jhash_2words((uint32_t)p, (uint32_t)((uint64_t)p >> 32), 0);
+}
+
+DECLARE_HASH(bgp_adj_out_ext, struct bgp_adj_out_ext, item,
+	     bgp_adj_out_ext_cmp, bgp_adj_out_ext_hash);
+
+static struct bgp_adj_out_ext_head adj_out_ext_table[1] = { INIT_HASH(adj_out_ext_table[0]) };
+
+struct bgp_adj_out_ext *bgp_adj_out_ext_lookup(const struct bgp_adj_out *adj)
+{
+	struct bgp_adj_out_ext ref = { .adj = adj };
+
+	return bgp_adj_out_ext_find(adj_out_ext_table, &ref);
+}
+
+static struct bgp_adj_out_ext *bgp_adj_out_ext_get(struct bgp_adj_out *adj)
+{
+	struct bgp_adj_out_ext *ext;
+
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT))
+		return bgp_adj_out_ext_lookup(adj);
+
+	ext = XCALLOC(MTYPE_BGP_ADJ_OUT_EXT, sizeof(*ext));
+	ext->adj = adj;
+	bgp_adj_out_ext_add(adj_out_ext_table, ext);
+	SET_FLAG(adj->flags, BGP_ADJ_OUT_EXT);
+	return ext;
+}
+
+static void bgp_adj_out_ext_put(struct bgp_adj_out *adj,
+				struct bgp_adj_out_ext *ext)
+{
+	if (ext->labels || ext->adv)
+		return;
+
+	bgp_adj_out_ext_del(adj_out_ext_table, ext);
+	XFREE(MTYPE_BGP_ADJ_OUT_EXT, ext);
+	UNSET_FLAG(adj->flags, BGP_ADJ_OUT_EXT);
+}
+
+void bgp_adj_out_set_adv(struct bgp_adj_out *adj, struct bgp_advertise *adv)
+{
+	struct bgp_adj_out_ext *ext;
+
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL)) {
+		container_of(adj, struct bgp_adj_out_full, adj)->adv = adv;
+		return;
+	}
+	if (!adv && !CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT))
+		return;
+
+	ext = bgp_adj_out_ext_get(adj);
+	ext->adv = adv;
+	bgp_adj_out_ext_put(adj, ext);
+}
+
+void bgp_adj_out_set_labels(struct bgp_adj_out *adj, struct bgp_labels *labels)
+{
+	struct bgp_adj_out_ext *ext;
+
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL)) {
+		container_of(adj, struct bgp_adj_out_full, adj)->labels = labels;
+		return;
+	}
+	if (!labels && !CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT))
+		return;
+
+	ext = bgp_adj_out_ext_get(adj);
+	ext->labels = labels;
+	bgp_adj_out_ext_put(adj, ext);
+}
+
+unsigned long bgp_adj_out_ext_total(void)
+{
+	return bgp_adj_out_ext_count(adj_out_ext_table);
+}
+
 /* BGP advertise attribute is used for pack same attribute update into
    one packet.  To do that we maintain attribute hash in struct
    peer.  */
@@ -134,6 +228,7 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 			uint32_t addpath_tx_id)
 {
 	struct bgp_adj_out *adj;
+	struct bgp_advertise *adv;
 	struct peer_af *paf;
 	afi_t afi;
 	safi_t safi;
@@ -155,9 +250,9 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 				    && adj->addpath_tx_id != addpath_tx_id)
 					continue;
 
-				return (adj->adv
-						? (adj->adv->baa ? true : false)
-						: (adj->attr ? true : false));
+				adv = bgp_adj_out_adv(adj);
+				return (adv ? (adv->baa ? true : false)
+					    : (adj->attr ? true : false));
 			}
 
 	return false;
@@ -196,12 +291,18 @@ void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
 
 void bgp_adj_in_remove(struct bgp_dest **dest, struct bgp_adj_in *bai)
 {
-	bgp_attr_unintern(&bai->attr);
-	bgp_labels_unintern(&bai->labels);
 	if (bai->peer)
 		bai->peer->stat_pfx_adj_rib_in--;
 	BGP_ADJ_IN_DEL(*dest, bai);
 	*dest = bgp_dest_unlock_node(*dest);
+
+	if (CHECK_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM)) {
+		bgp_reclaim_adj_in(bai);
+		return;
+	}
+
+	bgp_attr_unintern(&bai->attr);
+	bgp_labels_unintern(&bai->labels);
 	peer_unlock(bai->peer); /* adj_in peer reference */
 	XFREE(MTYPE_BGP_ADJ_IN, bai);
 }
@@ -6,6 +6,7 @@
 #ifndef _QUAGGA_BGP_ADVERTISE_H
 #define _QUAGGA_BGP_ADVERTISE_H
 
+#include "lib/frrcu.h"
 #include "lib/typesafe.h"
 
 PREDECL_DLIST(bgp_adv_fifo);
@@ -36,6 +37,11 @@ struct bgp_advertise {
 
 	/* BGP info.  */
 	struct bgp_path_info *pathi;
+
+	/* Already in a packet built by a format worker, adj-out not synced
+	 * yet (see bgp_updgrp_build.c)
+	 */
+	bool formatted;
 };
 
 DECLARE_DLIST(bgp_advertise_attr_fifo, struct bgp_advertise, item);
@@ -53,7 +59,18 @@ struct bgp_advertise_attr {
 	struct attr *attr;
 };
 
-/* BGP adjacency out.  */
+/*
+ * BGP adjacency out.
+ *
+ * There are two representations, chosen when the entry is created (see
+ * "bgp adj-rib-out compact"):
+ *  - full entries are a struct bgp_adj_out_full, threaded on the subgroup's
+ *    adjq and carrying the labels and pending advertisement inline;
+ *  - compact entries are just this structure.  They are found through the
+ *    RIB when walking a subgroup, and keep labels and pending advertisement,
+ *    which most entries do not have most of the time, in a side table.
+ * Use the accessors below for the labels and the advertisement.
+ */
 struct bgp_adj_out {
 	/* RB Tree of adjacency entries */
 	RB_ENTRY(bgp_adj_out) adj_entry;
@@ -61,17 +78,25 @@ struct bgp_adj_out {
 	/* Advertised subgroup.  */
 	struct update_subgroup *subgroup;
 
-	/* Threading that makes the adj part of subgroup's adj queue */
-	TAILQ_ENTRY(bgp_adj_out) subgrp_adj_train;
-
 	/* Prefix information.  */
 	struct bgp_dest *dest;
 
-	uint32_t addpath_tx_id;
-
 	/* Advertised attribute.  */
 	struct attr *attr;
 
+	uint32_t addpath_tx_id;
+
+	uint8_t flags;
+#define BGP_ADJ_OUT_FULL (1 << 0)
+#define BGP_ADJ_OUT_EXT	 (1 << 1)
+};
+
+struct bgp_adj_out_full {
+	struct bgp_adj_out adj;
+
+	/* Threading that makes the adj part of subgroup's adj queue */
+	TAILQ_ENTRY(bgp_adj_out_full) subgrp_adj_train;
+
 	/* VPN label information */
 	struct bgp_labels *labels;
 
@@ -79,15 +104,60 @@ struct bgp_adj_out {
 	struct bgp_advertise *adv;
 };
 
+PREDECL_HASH(bgp_adj_out_ext);
+
+/* Side table entry for a compact adj-out, only while it has any data. */
+struct bgp_adj_out_ext {
+	struct bgp_adj_out_ext_item item;
+
+	const struct bgp_adj_out *adj;
+	struct bgp_labels *labels;
+	struct bgp_advertise *adv;
+};
+
+extern struct bgp_adj_out_ext *
+bgp_adj_out_ext_lookup(const struct bgp_adj_out *adj);
+
+static inline struct bgp_advertise *bgp_adj_out_adv(const struct bgp_adj_out *adj)
+{
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL))
+		return container_of(adj, struct bgp_adj_out_full, adj)->adv;
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT))
+		return bgp_adj_out_ext_lookup(adj)->adv;
+	return NULL;
+}
+
+static inline struct bgp_labels *bgp_adj_out_labels(const struct bgp_adj_out *adj)
+{
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL))
+		return container_of(adj, struct bgp_adj_out_full, adj)->labels;
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT))
+		return bgp_adj_out_ext_lookup(adj)->labels;
+	return NULL;
+}
+
+/* Replace the pending advertisement/labels; the old ones are not freed. */
+extern void bgp_adj_out_set_adv(struct bgp_adj_out *adj,
+				struct bgp_advertise *adv);
+extern void bgp_adj_out_set_labels(struct bgp_adj_out *adj,
+				   struct bgp_labels *labels);
+
+extern unsigned long bgp_adj_out_ext_total(void);
+
 RB_HEAD(bgp_adj_out_rb, bgp_adj_out);
 RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
 	     bgp_adj_out_compare);
 
 /* BGP adjacency in. */
 struct bgp_adj_in {
-	/* Linked list pointer.  */
-	struct bgp_adj_in *next;
-	struct bgp_adj_in *prev;
+	/* Linked list pointer, and RCU once released (see bgp_reclaim.c) */
+	union {
+		struct {
+			struct bgp_adj_in *next;
+			struct bgp_adj_in *prev;
+		};
+		struct rcu_head rcu_head;
+	};
 
 	/* Received peer.  */
 	struct peer *peer;
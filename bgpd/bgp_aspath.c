@@ -23,6 +23,7 @@
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_filter.h"
+#include "bgpd/bgp_intern.h"
 
 /* Attr. Flags and Attr. Type Code. */
 #define AS_HEADER_SIZE 2
@@ -71,8 +72,8 @@ struct assegment_header {
 	uint8_t length;
 };
 
-/* Hash for aspath.  This is the top level structure of AS path. */
-static struct hash *ashash;
+/* Intern table for aspath.  This is the top level structure of AS path. */
+static struct bgp_intern_table *ashash;
 
 /* Stream for SNMP. See aspath_snmp_pathseg */
 static struct stream *snmp_stream;
@@ -313,7 +314,7 @@ void aspath_free(struct aspath *aspath)
 {
 	if (!aspath)
 		return;
-	if (aspath->segments)
+	if (aspath->segments && !aspath->flat)
 		assegment_free_all(aspath->segments);
 	XFREE(MTYPE_AS_STR, aspath->str);
 
@@ -328,7 +329,6 @@ void aspath_free(struct aspath *aspath)
 /* Unintern aspath from AS path bucket. */
 void aspath_unintern(struct aspath **aspath)
 {
-	struct aspath *ret;
 	struct aspath *asp;
 
 	if (!*aspath)
@@ -336,13 +336,7 @@ void aspath_unintern(struct aspath **aspath)
 
 	asp = *aspath;
 
-	if (asp->refcnt)
-		asp->refcnt--;
-
-	if (asp->refcnt == 0) {
-		/* This aspath must exist in aspath hash table. */
-		ret = hash_release(ashash, asp);
-		assert(ret != NULL);
+	if (bgp_intern_put(ashash, asp)) {
 		aspath_free(asp);
 		*aspath = NULL;
 	}
@@ -549,6 +543,7 @@ static void aspath_make_str_count(struct aspath *as, bool make_json)
 		as->str = XMALLOC(MTYPE_AS_STR, 1);
 		as->str[0] = '\0';
 		as->str_len = 0;
+		as->key = jhash(as->str, as->str_len, 2334325);
 		return;
 	}
 
@@ -588,6 +583,7 @@ static void aspath_make_str_count(struct aspath *as, bool make_json)
 			XFREE(MTYPE_AS_STR, str_buf);
 			as->str = NULL;
 			as->str_len = 0;
+			as->key = 0;
 			json_object_free(as->json);
 			as->json = NULL;
 			json_object_free(jaspath_segments);
@@ -657,6 +653,7 @@ static void aspath_make_str_count(struct aspath *as, bool make_json)
 	str_buf[len] = '\0';
 	as->str = str_buf;
 	as->str_len = len;
+	as->key = jhash(as->str, as->str_len, 2334325);
 
 	if (make_json) {
 		json_object_string_add(as->json, "string", str_buf);
@@ -679,6 +676,78 @@ void aspath_str_update(struct aspath *as, bool make_json)
 	aspath_make_str_count(as, make_json);
 }
 
+static as_t aspath_last_as_internal(const struct aspath *aspath)
+{
+	const struct assegment *seg;
+	as_t last_as = 0;
+
+	for (seg = aspath->segments; seg; seg = seg->next)
+		if (seg->length && (seg->type == AS_SEQUENCE ||
+				    seg->type == AS_CONFED_SEQUENCE))
+			last_as = seg->as[seg->length - 1];
+
+	return last_as;
+}
+
+/* Copy of aspath in a single allocation, the structure followed by the
+ * segments followed by all the ASNs, to be inserted in the intern table.
+ * The string and JSON representations are taken over.
+ */
+static void *aspath_hash_alloc(void *arg)
+{
+	struct aspath *aspath = arg;
+	const struct assegment *seg;
+	struct assegment *fseg, **prev;
+	struct aspath *new;
+	unsigned int nsegs = 0, nasns = 0;
+	as_t *asns;
+
+	/* Malformed AS path value. */
+	assert(aspath->str);
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		nsegs++;
+		nasns += seg->length;
+	}
+
+	new = XCALLOC(MTYPE_AS_PATH, sizeof(struct aspath) +
+					     nsegs * sizeof(struct assegment) +
+					     ASSEGMENT_DATA_SIZE(nasns, 1));
+	fseg = (struct assegment *)(new + 1);
+	asns = (as_t *)(fseg + nsegs);
+	prev = &new->segments;
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		fseg->type = seg->type;
+		fseg->length = seg->length;
+		if (seg->length) {
+			fseg->as = asns;
+			memcpy(asns, seg->as, ASSEGMENT_DATA_SIZE(seg->length, 1));
+			asns += seg->length;
+		}
+
+		*prev = fseg;
+		prev = &fseg->next;
+		fseg++;
+	}
+	new->flat = true;
+
+	new->str = aspath->str;
+	new->str_len = aspath->str_len;
+	new->json = aspath->json;
+	new->asnotation = aspath->asnotation;
+	new->count = aspath->count;
+	new->key = aspath->key;
+	aspath->str = NULL;
+	aspath->json = NULL;
+
+	if (new->segments && new->segments->length)
+		new->first_as = new->segments->as[0];
+	new->last_as = aspath_last_as_internal(new);
+
+	return new;
+}
+
 /* Intern allocated AS path. */
 struct aspath *aspath_intern(struct aspath *aspath)
 {
@@ -689,12 +758,11 @@ struct aspath *aspath_intern(struct aspath *aspath)
 	assert(aspath->refcnt == 0);
 	assert(aspath->str);
 
-	/* Check AS path hash. */
-	find = hash_get(ashash, aspath, hash_alloc_intern);
-	if (find != aspath)
-		aspath_free(aspath);
-
-	find->refcnt++;
+	/* Check AS path hash.  Either way what is left of aspath is freed,
+	 * a new entry is a flattened copy.
+	 */
+	find = bgp_intern_get(ashash, aspath, aspath_hash_alloc, NULL);
+	aspath_free(aspath);
 
 	return find;
 }
@@ -726,29 +794,7 @@ struct aspath *aspath_dup(struct aspath *aspath)
 		new->str[0] = '\0';
 
 	new->count = aspath->count;
-	return new;
-}
-
-static void *aspath_hash_alloc(void *arg)
-{
-	const struct aspath *aspath = arg;
-	struct aspath *new;
-
-	/* Malformed AS path value. */
-	assert(aspath->str);
-
-	/* New aspath structure is needed. */
-	new = XMALLOC(MTYPE_AS_PATH, sizeof(struct aspath));
-
-	/* Reuse segments and string representation */
-	new->refcnt = 0;
-	new->segments = aspath->segments;
-	new->str = aspath->str;
-	new->str_len = aspath->str_len;
-	new->json = aspath->json;
-	new->asnotation = aspath->asnotation;
-	new->count = aspath->count;
-
+	new->key = aspath->key;
 	return new;
 }
 
@@ -878,20 +924,17 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit,
 	as.count = aspath_count_hops_internal(&as);
 
 	/* If already same aspath exist then return it. */
-	find = hash_get(ashash, &as, aspath_hash_alloc);
-
-	/* if the aspath was already hashed free temporary memory. */
-	if (find->refcnt) {
-		assegment_free_all(as.segments);
-		/* aspath_key_make() always updates the string */
-		XFREE(MTYPE_AS_STR, as.str);
-		if (as.json) {
-			json_object_free(as.json);
-			as.json = NULL;
-		}
-	}
+	find = bgp_intern_get(ashash, &as, aspath_hash_alloc, NULL);
 
-	find->refcnt++;
+	/* Free temporary memory, a new entry is a flattened copy.
+	 * aspath_key_make() always updates the string.
+	 */
+	assegment_free_all(as.segments);
+	XFREE(MTYPE_AS_STR, as.str);
+	if (as.json) {
+		json_object_free(as.json);
+		as.json = NULL;
+	}
 
 	return find;
 }
@@ -1172,28 +1215,21 @@ unsigned int aspath_get_first_as(struct aspath *aspath)
 	if (aspath == NULL || aspath->segments == NULL)
 		return 0;
 
+	if (aspath->flat)
+		return aspath->first_as;
+
 	return aspath->segments->as[0];
 }
 
 unsigned int aspath_get_last_as(struct aspath *aspath)
 {
-	int i;
-	unsigned int last_as = 0;
-	const struct assegment *seg;
-
 	if (aspath == NULL || aspath->segments == NULL)
-		return last_as;
+		return 0;
 
-	seg = aspath->segments;
+	if (aspath->flat)
+		return aspath->last_as;
 
-	while (seg) {
-		if (seg->type == AS_SEQUENCE || seg->type == AS_CONFED_SEQUENCE)
-			for (i = 0; i < seg->length; i++)
-				last_as = seg->as[i];
-		seg = seg->next;
-	}
-
-	return last_as;
+	return aspath_last_as_internal(aspath);
 }
 
 /* AS path loop check.  If aspath contains asno then return >= 1. */
@@ -2134,7 +2170,7 @@ struct aspath *aspath_empty_get(void)
 
 unsigned long aspath_count(void)
 {
-	return ashash->count;
+	return bgp_intern_count(ashash);
 }
 
 /*
@@ -2278,14 +2314,11 @@ struct aspath *aspath_str2aspath(const char *str,
 unsigned int aspath_key_make(const void *p)
 {
 	const struct aspath *aspath = p;
-	unsigned int key = 0;
 
 	if (!aspath->str)
 		aspath_str_update((struct aspath *)aspath, false);
 
-	key = jhash(aspath->str, aspath->str_len, 2334325);
-
-	return key;
+	return aspath->key;
 }
 
 /* If two aspath have same value then return 1 else return 0 */
@@ -2298,6 +2331,11 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 	    ((const struct aspath *)arg2)->asnotation)
 		return false;
 
+	/* Interned paths are unique */
+	if (((const struct aspath *)arg1)->flat &&
+	    ((const struct aspath *)arg2)->flat)
+		return arg1 == arg2;
+
 	while (seg1 || seg2) {
 		int i;
 		if ((!seg1 && seg2) || (seg1 && !seg2))
@@ -2318,8 +2356,8 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 /* AS path hash initialize. */
 void aspath_init(void)
 {
-	ashash = hash_create_size(32768, aspath_key_make, aspath_cmp,
-				  "BGP AS Path");
+	ashash = bgp_intern_table_new("BGP AS Path", 32768, aspath_key_make,
+				      aspath_cmp, struct aspath, refcnt);
 
 	as_list_list_init(&as_exclude_list_orphan);
 }
@@ -2328,7 +2366,7 @@ void aspath_finish(void)
 {
 	struct aspath_exclude *ase;
 
-	hash_clean_and_free(&ashash, (void (*)(void *))aspath_free);
+	bgp_intern_table_free(&ashash, (void (*)(void *))aspath_free);
 
 	if (snmp_stream)
 		stream_free(snmp_stream);
@@ -2372,9 +2410,9 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
    `show [ip] bgp paths' command. */
 void aspath_print_all_vty(struct vty *vty)
 {
-	hash_iterate(ashash, (void (*)(struct hash_bucket *,
-				       void *))aspath_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(ashash, (void (*)(struct hash_bucket *,
+					     void *))aspath_show_all_iterator,
+			   vty);
 }
 
 static struct aspath *bgp_aggr_aspath_lookup(struct bgp_aggregate *aggregate,
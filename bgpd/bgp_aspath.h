@@ -9,6 +9,7 @@
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_filter.h"
+#include "bgpd/bgp_regex.h"
 #include <typesafe.h>
 
 /* AS path segment type.  */
@@ -47,10 +48,13 @@ struct assegment {
 /* AS path may be include some AsSegments.  */
 struct aspath {
 	/* Reference count to this aspath.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 
-	/* segment data */
+	/* segment data.  For interned paths, the segments and their ASNs
+	 * follow this structure in the same allocation and are read-only.
+	 */
 	struct assegment *segments;
+	bool flat;
 
 	/* AS path as a json object */
 	json_object *json;
@@ -61,8 +65,18 @@ struct aspath {
 	unsigned short str_len;
 	uint32_t count;
 
+	/* Hash of the string expression, computed along with it */
+	uint32_t key;
+
+	/* First and last AS, only kept up to date for interned paths */
+	as_t first_as;
+	as_t last_as;
+
 	/* AS notation used by string expression of AS path */
 	enum asnotation_mode asnotation;
+
+	/* AS path regular expression results, when interned */
+	struct bgp_regex_cache recache;
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
@@ -36,6 +36,7 @@
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_encap_types.h"
 #include "bgpd/bgp_nhc.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_trace.h"
 #ifdef ENABLE_BGP_VNC
@@ -1489,6 +1490,35 @@ struct attr *bgp_attr_intern(struct attr *attr)
 	return find;
 }
 
+/*
+ * Whether everything @attr points to is interned already: a copy of @attr
+ * can then be interned without taking anything over from @attr.
+ */
+bool bgp_attr_subs_interned(const struct attr *attr)
+{
+#define INTERNED(sub) (!(sub) || (sub)->refcnt)
+	if (!INTERNED(attr->aspath) ||
+	    !INTERNED(bgp_attr_get_community(attr)) ||
+	    !INTERNED(bgp_attr_get_ecommunity(attr)) ||
+	    !INTERNED(bgp_attr_get_ipv6_ecommunity(attr)) ||
+	    !INTERNED(bgp_attr_get_lcommunity(attr)) ||
+	    !INTERNED(bgp_attr_get_cluster(attr)) ||
+	    !INTERNED(bgp_attr_get_transit(attr)) ||
+	    !INTERNED(attr->encap_subtlvs) ||
+	    !INTERNED(bgp_attr_get_evpn_overlay(attr)) ||
+	    !INTERNED(bgp_attr_get_srv6_l3service(attr)) ||
+	    !INTERNED(bgp_attr_get_srv6_vpn(attr)) ||
+#ifdef ENABLE_BGP_VNC
+	    !INTERNED(bgp_attr_get_vnc_subtlvs(attr)) ||
+#endif
+	    !INTERNED(bgp_attr_get_nhc(attr)) ||
+	    !INTERNED(bgp_attr_get_ls_attr(attr)))
+		return false;
+#undef INTERNED
+
+	return true;
+}
+
 /* Make network statement's attribute. */
 struct attr *bgp_attr_default_set(struct attr *attr, struct bgp *bgp,
 				  uint8_t origin)
@@ -2153,16 +2183,25 @@ static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
 	struct peer *const peer = connection->peer;
 	const bgp_size_t length = args->length;
 	enum asnotation_mode asnotation;
+	bool use32bit;
 
 	asnotation = bgp_get_asnotation(peer->bgp);
 	/*
 	 * peer with AS4 => will get 4Byte ASnums
 	 * otherwise, will get 16 Bit
 	 */
-	attr->aspath = aspath_parse(connection->curr, length,
-				    CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
-					    CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV),
-				    asnotation);
+	use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
+		   CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	/* a parse worker may have decoded it already */
+	attr->aspath = bgp_parse_job_aspath(connection->curr_job, args->type,
+					    stream_pnt(connection->curr), length,
+					    use32bit, asnotation);
+	if (attr->aspath)
+		stream_forward_getp(connection->curr, length);
+	else
+		attr->aspath = aspath_parse(connection->curr, length, use32bit,
+					    asnotation);
 
 	/* In case of IBGP, length will be zero. */
 	if (!attr->aspath) {
@@ -2271,7 +2310,13 @@ static int bgp_attr_as4_path(struct bgp_attr_parser_args *args,
 
 	asnotation = bgp_get_asnotation(peer->bgp);
 
-	*as4_path = aspath_parse(connection->curr, length, 1, asnotation);
+	*as4_path = bgp_parse_job_aspath(connection->curr_job, args->type,
+					 stream_pnt(connection->curr), length,
+					 true, asnotation);
+	if (*as4_path)
+		stream_forward_getp(connection->curr, length);
+	else
+		*as4_path = aspath_parse(connection->curr, length, 1, asnotation);
 
 	/* In case of IBGP, length will be zero. */
 	if (!*as4_path) {
@@ -2661,6 +2706,7 @@ bgp_attr_community(struct bgp_attr_parser_args *args)
 	struct peer *const peer = connection->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct community *com;
 
 	if (length == 0) {
 		bgp_attr_set_community(attr, NULL);
@@ -2671,8 +2717,12 @@ bgp_attr_community(struct bgp_attr_parser_args *args)
 	if (peer->discard_attrs[args->type] || peer->withdraw_attrs[args->type])
 		goto community_ignore;
 
-	bgp_attr_set_community(attr,
-			       community_parse((uint32_t *)stream_pnt(connection->curr), length));
+	com = bgp_parse_job_community(connection->curr_job,
+				      stream_pnt(connection->curr), length);
+	if (!com)
+		com = community_parse((uint32_t *)stream_pnt(connection->curr),
+				      length);
+	bgp_attr_set_community(attr, com);
 
 	/* XXX: fix community_parse to use stream API and remove this */
 	stream_forward_getp(connection->curr, length);
@@ -3092,6 +3142,7 @@ bgp_attr_large_community(struct bgp_attr_parser_args *args)
 	struct peer *const peer = connection->peer;
 	struct attr *const attr = args->attr;
 	const bgp_size_t length = args->length;
+	struct lcommunity *lcom;
 
 	/*
 	 * Large community follows new attribute format.
@@ -3106,7 +3157,11 @@ bgp_attr_large_community(struct bgp_attr_parser_args *args)
 	if (peer->discard_attrs[args->type] || peer->withdraw_attrs[args->type])
 		goto large_community_ignore;
 
-	bgp_attr_set_lcommunity(attr, lcommunity_parse(stream_pnt(connection->curr), length));
+	lcom = bgp_parse_job_lcommunity(connection->curr_job,
+					stream_pnt(connection->curr), length);
+	if (!lcom)
+		lcom = lcommunity_parse(stream_pnt(connection->curr), length);
+	bgp_attr_set_lcommunity(attr, lcom);
 	/* XXX: fix ecommunity_parse to use stream API */
 	stream_forward_getp(connection->curr, length);
 
@@ -5588,7 +5643,11 @@ bgp_size_t bgp_packet_attribute(struct bgp *bgp, struct peer *peer, struct strea
 		bgp_packet_mpattr_end(s, mpattrlen_pos);
 	}
 
-	(void)peer_sort(peer);
+	/* BMP sorts the peer when it queues the message, and may be encoding
+	 * it on another pthread, see bmp_monitor()
+	 */
+	if (!for_bmp)
+		(void)peer_sort(peer);
 
 	/* Origin attribute. */
 	stream_putc(s, BGP_ATTR_FLAG_TRANS);
@@ -6219,7 +6278,7 @@ void bgp_attr_finish(void)
 }
 
 /* Make attribute packet. */
-void bgp_dump_routes_attr(struct stream *s, struct bgp_path_info *bpi,
+void bgp_dump_routes_attr(struct stream *s, const struct attr *attr,
 			  const struct prefix *prefix)
 {
 	unsigned long cp;
@@ -6228,7 +6287,6 @@ void bgp_dump_routes_attr(struct stream *s, struct bgp_path_info *bpi,
 	struct aspath *aspath;
 	bool addpath_capable = false;
 	uint32_t addpath_tx_id = 0;
-	struct attr *attr = bpi->attr;
 
 	/* Remember current pointer. */
 	cp = stream_get_endp(s);
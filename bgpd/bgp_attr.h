@@ -410,6 +410,7 @@ extern enum bgp_attr_parse_ret bgp_attr_parse(struct peer_connection *connection
 					      bgp_size_t size, struct bgp_nlri *mp_update,
 					      struct bgp_nlri *mp_withdraw, bool has_nlri);
 extern struct attr *bgp_attr_intern(struct attr *attr);
+extern bool bgp_attr_subs_interned(const struct attr *attr);
 extern struct bgp_attr_srv6_l3service *
 bgp_attr_srv6_l3service_intern(struct bgp_attr_srv6_l3service *vpn);
 extern void bgp_attr_srv6_l3service_free(struct bgp_attr_srv6_l3service *vpn);
@@ -431,7 +432,7 @@ bgp_packet_attribute(struct bgp *bgp, struct peer *peer, struct stream *s, struc
 		     uint8_t num_labels, struct bgp_attr_srv6_l3service *srv6_unicast,
 		     bool addpath_capable, uint32_t addpath_tx_id, struct bgp_path_info *bpi,
 		     struct bgp_ls_nlri *ls_nlri, bool for_bmp);
-extern void bgp_dump_routes_attr(struct stream *s, struct bgp_path_info *bpi,
+extern void bgp_dump_routes_attr(struct stream *s, const struct attr *attr,
 				 const struct prefix *p);
 extern bool attrhash_cmp(const void *arg1, const void *arg2);
 extern unsigned int attrhash_key_make(const void *p);
@@ -24,6 +24,7 @@
 #include "lib/version.h"
 #include "jhash.h"
 #include "termtable.h"
+#include "frr_pthread.h"
 
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgpd.h"
@@ -57,6 +58,7 @@ static void bmp_send_all_bgp(struct peer *peer, bool down);
 static struct bmp_imported_bgp *bmp_imported_bgp_find(struct bmp_targets *bt, char *name);
 static void bmp_stats_per_instance(struct bgp *bgp, struct bmp_targets *bt);
 static void bmp_bgp_peer_vrf(struct bmp_bgp_peer *bbpeer, struct bgp *bgp);
+static void bmp_encode(struct event *event);
 
 DEFINE_MGROUP(BMP, "BMP (BGP Monitoring Protocol)");
 
@@ -72,6 +74,7 @@ DEFINE_MTYPE_STATIC(BMP, BMP_MIRRORQ,	"BMP route mirroring buffer");
 DEFINE_MTYPE_STATIC(BMP, BMP_PEER,	"BMP per BGP peer data");
 DEFINE_MTYPE_STATIC(BMP, BMP_OPEN,	"BMP stored BGP OPEN message");
 DEFINE_MTYPE_STATIC(BMP, BMP_IMPORTED_BGP, "BMP imported BGP instance");
+DEFINE_MTYPE_STATIC(BMP, BMP_ENCJOB,	"BMP message encoding job");
 
 DEFINE_QOBJ_TYPE(bmp_targets);
 
@@ -216,6 +219,62 @@ static int bmp_active_cmp(const struct bmp_active *a,
 
 DECLARE_SORTLIST_UNIQ(bmp_actives, struct bmp_active, bai, bmp_active_cmp);
 
+/* What encoding a Route Monitoring message reads of the peer and of its
+ * instance, copied when the job is queued.  The encoder pthread works on a
+ * stand-in peer made up from this, never on the peer itself, which the main
+ * pthread keeps changing.
+ */
+struct bmp_encpeer {
+	enum bgp_peer_sort sort;
+	enum bgp_peer_sub_sort sub_sort;
+	uint64_t flags;
+	uint64_t cap;
+	struct in_addr remote_id;
+	/* for the link-local nexthop choice of the MP_REACH_NLRI */
+	struct in6_addr v6_local;
+	/* for the error log, a copy freed with the job */
+	char *host;
+	/* for the job's AFI/SAFI, and for BGP-LS */
+	uint64_t af_flags;
+	uint64_t ls_af_flags;
+	uint32_t af_cap;
+
+	/* of peer->bgp */
+	uint16_t config;
+	uint8_t maxmed_active;
+	uint32_t maxmed_value;
+	struct in_addr router_id;
+	struct in_addr cluster_id;
+};
+
+/* encoding queue job, see bgp_bmp.h */
+struct bmp_encjob {
+	struct bmp_encq_item itm;
+
+	/* the message is ready to be written out */
+	bool done;
+
+	/* common and per-peer header, and the BGP UPDATE, for Route
+	 * Monitoring; other messages only have msg
+	 */
+	struct stream *hdr, *msg;
+
+	/* Route Monitoring to encode, with a reference on peer and attr */
+	struct peer *peer;
+	struct bmp_encpeer enc;
+	struct attr *attr;
+	struct prefix p;
+	struct prefix_rd rd;
+	bool has_rd;
+	afi_t afi;
+	safi_t safi;
+	mpls_label_t label[BGP_MAX_LABELS];
+	uint8_t num_labels;
+};
+
+DECLARE_LIST(bmp_encq, struct bmp_encjob, itm);
+DECLARE_LIST(bmp_encs, struct bmp, enc_itm);
+
 static struct bmp *bmp_new(struct bmp_targets *bt, int bmp_sock)
 {
 	struct bmp *new = XCALLOC(MTYPE_BMP_CONN, sizeof(struct bmp));
@@ -227,6 +286,7 @@ static struct bmp *bmp_new(struct bmp_targets *bt, int bmp_sock)
 	new->socket = bmp_sock;
 	new->syncafi = AFI_MAX;
 	new->sync_bgp = NULL;
+	bmp_encq_init(&new->encq);
 
 	FOREACH_AFI_SAFI (afi, safi) {
 		new->afistate[afi][safi] = bt->afimon[afi][safi]
@@ -240,9 +300,199 @@ static struct bmp *bmp_new(struct bmp_targets *bt, int bmp_sock)
 static void bmp_free(struct bmp *bmp)
 {
 	bmp_session_del(&bmp->targets->sessions, bmp);
+	bmp_encq_fini(&bmp->encq);
 	XFREE(MTYPE_BMP_CONN, bmp);
 }
 
+/*
+ * Encoding queue, see bgp_bmp.h
+ */
+
+/* how many jobs the encoder does before the main pthread is told */
+#define BMP_ENC_BATCH 64
+
+static struct {
+	struct frr_pthread *fpt;
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	/* sessions with jobs to encode */
+	struct bmp_encs_head sessions;
+	struct event *t_encode;
+
+	/* only used by the encoder pthread, see bmp_encpeer */
+	struct peer standin_peer;
+	struct bgp standin_bgp;
+} bmp_enc = {
+	.mtx = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void bmp_enc_start(void)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+
+	if (bmp_enc.fpt)
+		return;
+
+	bmp_enc.fpt = frr_pthread_new(&attr, "BMP encoder", "bgpd_bmp");
+	frr_pthread_run(bmp_enc.fpt, NULL);
+	frr_pthread_wait_running(bmp_enc.fpt);
+}
+
+static void bmp_enc_stop(void)
+{
+	if (!bmp_enc.fpt)
+		return;
+
+	frr_pthread_stop(bmp_enc.fpt, NULL);
+	frr_pthread_destroy(bmp_enc.fpt);
+	bmp_enc.fpt = NULL;
+}
+
+static inline bool bmp_encq_room(struct bmp *bmp)
+{
+	/* a table sync step queues up to 3 messages */
+	return bmp->encq_rm + 3 <= BMP_ENCQ_MAX;
+}
+
+static void bmp_encjob_free(struct bmp *bmp, struct bmp_encjob *job)
+{
+	if (job->peer) {
+		bmp->encq_rm--;
+		peer_unlock(job->peer);
+	}
+	if (job->attr)
+		bgp_attr_unintern(&job->attr);
+	stream_free(job->hdr);
+	stream_free(job->msg);
+	XFREE(MTYPE_BMP_ENCJOB, job->enc.host);
+	XFREE(MTYPE_BMP_ENCJOB, job);
+}
+
+static void bmp_encq_push(struct bmp *bmp, struct bmp_encjob *job)
+{
+	bool kick = false;
+
+	if (job->peer) {
+		bmp->encq_rm++;
+		bmp->encq_rm_max = MAX(bmp->encq_rm_max, bmp->encq_rm);
+	}
+
+	frr_with_mutex (&bmp_enc.mtx) {
+		bmp_encq_add_tail(&bmp->encq, job);
+
+		if (!job->done) {
+			if (!bmp->enc_next)
+				bmp->enc_next = job;
+			if (!bmp->enc_queued && !bmp->enc_busy) {
+				bmp_encs_add_tail(&bmp_enc.sessions, bmp);
+				bmp->enc_queued = true;
+				kick = true;
+			}
+		}
+	}
+
+	if (kick)
+		event_add_event(bmp_enc.fpt->master, bmp_encode, NULL, 0,
+				&bmp_enc.t_encode);
+}
+
+/* write out what is ready at the front of the encoding queue */
+static bool bmp_wrencoded(struct bmp *bmp, struct pullwr *pullwr)
+{
+	struct bmp_encjob *job;
+	bool written = false;
+
+	while (true) {
+		frr_with_mutex (&bmp_enc.mtx) {
+			job = bmp_encq_first(&bmp->encq);
+			if (job && !job->done)
+				job = NULL;
+			if (job) {
+				bmp_encq_del(&bmp->encq, job);
+				if (bmp->enc_next == job)
+					bmp->enc_next = bmp_encq_first(&bmp->encq);
+			}
+		}
+		if (!job)
+			break;
+
+		if (job->msg) {
+			if (job->hdr) {
+				bmp->cnt_update++;
+				pullwr_write_stream(pullwr, job->hdr);
+			}
+			pullwr_write_stream(pullwr, job->msg);
+			written = true;
+		} else
+			bmp->cnt_enc_dropped++;
+
+		bmp_encjob_free(bmp, job);
+	}
+
+	if (bmp_encq_room(bmp))
+		bmp->backpressured = false;
+	return written;
+}
+
+/* the encoder made progress on @bmp */
+static void bmp_encoded(struct event *event)
+{
+	struct bmp *bmp = EVENT_ARG(event);
+
+	pullwr_bump(bmp->pullwr);
+}
+
+/* drop the encoding queue of a session that is going away */
+static void bmp_encq_flush(struct bmp *bmp)
+{
+	struct bmp_encjob *job;
+	size_t dropped = 0;
+
+	frr_with_mutex (&bmp_enc.mtx) {
+		if (bmp->enc_queued) {
+			bmp_encs_del(&bmp_enc.sessions, bmp);
+			bmp->enc_queued = false;
+		}
+		while (bmp->enc_busy)
+			pthread_cond_wait(&bmp_enc.cond, &bmp_enc.mtx);
+		bmp->enc_next = NULL;
+	}
+	event_cancel(&bmp->t_encoded);
+
+	while ((job = bmp_encq_pop(&bmp->encq))) {
+		if (job->peer)
+			dropped++;
+		bmp_encjob_free(bmp, job);
+	}
+
+	bmp->cnt_enc_dropped += dropped;
+	if (dropped)
+		zlog_info("bmp[%s] %zu route monitoring messages not sent",
+			  bmp->remote, dropped);
+}
+
+/* send a complete message, after what is already queued for encoding */
+static void bmp_send(struct bmp *bmp, struct stream *s)
+{
+	struct bmp_encjob *job;
+
+	if (!bmp_encq_count(&bmp->encq)) {
+		pullwr_write_stream(bmp->pullwr, s);
+		return;
+	}
+
+	job = XCALLOC(MTYPE_BMP_ENCJOB, sizeof(*job));
+	job->msg = stream_dup(s);
+	job->done = true;
+	bmp_encq_push(bmp, job);
+	pullwr_bump(bmp->pullwr);
+}
+
 #define BMP_PEER_TYPE_GLOBAL_INSTANCE 0
 #define BMP_PEER_TYPE_RD_INSTANCE 1
 #define BMP_PEER_TYPE_LOCAL_INSTANCE 2
@@ -685,7 +935,7 @@ static void bmp_send_bt(struct bmp_targets *bt, struct stream *s)
 	struct bmp *bmp;
 
 	frr_each (bmp_session, &bt->sessions, bmp)
-		pullwr_write_stream(bmp->pullwr, s);
+		bmp_send(bmp, s);
 }
 
 static void bmp_send_bt_safe(struct bmp_targets *bt, struct stream *s)
@@ -1212,8 +1462,8 @@ static void bmp_eor(struct bmp *bmp, afi_t afi, safi_t safi, uint8_t flags, uint
 				stream_get_endp(s) + stream_get_endp(s2));
 
 		bmp->cnt_update++;
-		pullwr_write_stream(bmp->pullwr, s2);
-		pullwr_write_stream(bmp->pullwr, s);
+		bmp_send(bmp, s2);
+		bmp_send(bmp, s);
 		stream_free(s2);
 	}
 	stream_free(s);
@@ -1335,6 +1585,124 @@ static struct stream *bmp_withdraw(const struct prefix *p,
 	return s;
 }
 
+static void bmp_encpeer_snap(struct bmp_encpeer *enc, struct peer *peer,
+			     afi_t afi, safi_t safi)
+{
+	struct bgp *bgp = peer->bgp;
+
+	enc->sort = peer_sort(peer);
+	enc->sub_sort = peer->sub_sort;
+	enc->flags = peer->flags;
+	enc->cap = peer->cap;
+	enc->remote_id = peer->remote_id;
+	enc->v6_local = peer->nexthop.v6_local;
+	enc->host = XSTRDUP(MTYPE_BMP_ENCJOB, peer->host);
+	enc->af_flags = peer->af_flags[afi][safi];
+	enc->ls_af_flags = peer->af_flags[AFI_BGP_LS][SAFI_BGP_LS];
+	enc->af_cap = peer->af_cap[afi][safi];
+
+	enc->config = bgp->config;
+	enc->maxmed_active = bgp->maxmed_active;
+	enc->maxmed_value = bgp->maxmed_value;
+	enc->router_id = bgp->router_id;
+	enc->cluster_id = bgp->cluster_id;
+}
+
+/* Encoder pthread only: the peer bmp_update() is to look at for @job */
+static struct peer *bmp_encpeer_standin(struct bmp_encjob *job)
+{
+	const struct bmp_encpeer *enc = &job->enc;
+	struct peer *peer = &bmp_enc.standin_peer;
+	struct bgp *bgp = &bmp_enc.standin_bgp;
+
+	bgp->config = enc->config;
+	bgp->maxmed_active = enc->maxmed_active;
+	bgp->maxmed_value = enc->maxmed_value;
+	bgp->router_id = enc->router_id;
+	bgp->cluster_id = enc->cluster_id;
+
+	peer->bgp = bgp;
+	peer->sort = enc->sort;
+	peer->sub_sort = enc->sub_sort;
+	peer->flags = enc->flags;
+	peer->cap = enc->cap;
+	peer->remote_id = enc->remote_id;
+	peer->nexthop.v6_local = enc->v6_local;
+	peer->host = enc->host;
+	peer->af_flags[AFI_BGP_LS][SAFI_BGP_LS] = enc->ls_af_flags;
+	peer->af_flags[job->afi][job->safi] = enc->af_flags;
+	peer->af_cap[job->afi][job->safi] = enc->af_cap;
+
+	return peer;
+}
+
+static void bmp_encjob_encode(struct bmp_encjob *job, struct peer *peer,
+			      struct bgp_path_info *path)
+{
+	struct prefix_rd *prd = job->has_rd ? &job->rd : NULL;
+
+	if (job->attr)
+		job->msg = bmp_update(&job->p, prd, peer, job->attr, path, job->afi,
+				      job->safi, job->num_labels ? job->label : NULL,
+				      job->num_labels);
+	else
+		job->msg = bmp_withdraw(&job->p, prd, job->afi, job->safi);
+
+	if (job->msg)
+		stream_putl_at(job->hdr, BMP_LENGTH_POS,
+			       stream_get_endp(job->hdr) + stream_get_endp(job->msg));
+}
+
+/*
+ * Encoder pthread.  It only reads the jobs' interned attributes and what
+ * was copied of the peers into them; everything else stays with the main
+ * pthread.
+ */
+static void bmp_encode(struct event *event)
+{
+	struct bmp_encjob *job;
+	struct bmp *bmp;
+	unsigned int n;
+
+	while (true) {
+		frr_with_mutex (&bmp_enc.mtx) {
+			bmp = bmp_encs_pop(&bmp_enc.sessions);
+			if (bmp) {
+				bmp->enc_queued = false;
+				bmp->enc_busy = true;
+			}
+		}
+		if (!bmp)
+			return;
+
+		for (n = 1;; n++) {
+			frr_with_mutex (&bmp_enc.mtx) {
+				job = bmp->enc_next;
+				while (job && job->done)
+					job = bmp_encq_next(&bmp->encq, job);
+				bmp->enc_next = job ? bmp_encq_next(&bmp->encq, job) : NULL;
+
+				if (!job || n % BMP_ENC_BATCH == 0)
+					event_add_event(bm->master, bmp_encoded, bmp, 0,
+							&bmp->t_encoded);
+				if (!job) {
+					/* bmp_encq_flush() may free it now */
+					bmp->enc_busy = false;
+					pthread_cond_broadcast(&bmp_enc.cond);
+				}
+			}
+			if (!job)
+				break;
+
+			bmp_encjob_encode(job, bmp_encpeer_standin(job), NULL);
+
+			frr_with_mutex (&bmp_enc.mtx) {
+				job->done = true;
+			}
+		}
+	}
+}
+
 static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 			uint8_t peer_type_flag, const struct prefix *p,
 			struct prefix_rd *prd, struct attr *attr,
@@ -1342,7 +1710,7 @@ static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 			safi_t safi, time_t uptime, mpls_label_t *label,
 			uint32_t num_labels)
 {
-	struct stream *hdr, *msg;
+	struct bmp_encjob *job;
 	struct timeval tv = { .tv_sec = uptime, .tv_usec = 0 };
 	struct timeval uptime_real;
 
@@ -1355,28 +1723,38 @@ static void bmp_monitor(struct bmp *bmp, struct peer *peer, uint8_t flags,
 	}
 
 	monotime_to_realtime(&tv, &uptime_real);
-	if (attr)
-		msg = bmp_update(p, prd, peer, attr, path, afi, safi, label,
-				 num_labels);
-	else
-		msg = bmp_withdraw(p, prd, afi, safi);
-
-	if (!msg)
-		return;
 
-	hdr = stream_new(BGP_MAX_PACKET_SIZE);
-	bmp_common_hdr(hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
-	bmp_per_peer_hdr(hdr, peer->bgp, peer, flags, peer_type_flag, peer_distinguisher,
+	job = XCALLOC(MTYPE_BMP_ENCJOB, sizeof(*job));
+	/* common (6) and per-peer (42) headers, these wait in the queue */
+	job->hdr = stream_new_expandable(64);
+	bmp_common_hdr(job->hdr, BMP_VERSION_3, BMP_TYPE_ROUTE_MONITORING);
+	bmp_per_peer_hdr(job->hdr, peer->bgp, peer, flags, peer_type_flag, peer_distinguisher,
 			 uptime == (time_t)(-1L) ? NULL : &uptime_real);
 
-	stream_putl_at(hdr, BMP_LENGTH_POS,
-			stream_get_endp(hdr) + stream_get_endp(msg));
+	job->peer = peer_lock(peer);
+	bmp_encpeer_snap(&job->enc, peer, afi, safi);
+	if (attr)
+		job->attr = bgp_attr_intern(attr);
+	prefix_copy(&job->p, p);
+	if (prd) {
+		job->rd = *prd;
+		job->has_rd = true;
+	}
+	job->afi = afi;
+	job->safi = safi;
+	job->num_labels = MIN(num_labels, BGP_MAX_LABELS);
+	if (label)
+		memcpy(job->label, label, job->num_labels * sizeof(*label));
+
+	/* the encoder only looks at attributes, while the unreachability
+	 * TLVs come from the path
+	 */
+	if (!bmp_enc.fpt || safi == SAFI_UNREACH) {
+		bmp_encjob_encode(job, peer, path);
+		job->done = true;
+	}
 
-	bmp->cnt_update++;
-	pullwr_write_stream(bmp->pullwr, hdr);
-	pullwr_write_stream(bmp->pullwr, msg);
-	stream_free(hdr);
-	stream_free(msg);
+	bmp_encq_push(bmp, job);
 }
 
 static struct bgp *bmp_get_next_bgp(struct bmp_targets *bt, struct bgp *bgp, afi_t afi, safi_t safi)
@@ -1720,7 +2098,6 @@ static bool bmp_wrqueue_locrib(struct bmp *bmp, struct pullwr *pullwr)
 	struct bmp_queue_entry *bqe;
 	struct peer *peer;
 	struct bgp_dest *bn = NULL;
-	bool written = false;
 	uint8_t bpi_num_labels;
 
 	bqe = bmp_pull_locrib(bmp);
@@ -1788,7 +2165,6 @@ static bool bmp_wrqueue_locrib(struct bmp *bmp, struct pullwr *pullwr)
 				      : (time_t)(-1L),
 		    bpi_num_labels ? bpi->extra->labels->label : NULL,
 		    bpi_num_labels);
-	written = true;
 
 out:
 	if (!bqe->refcount)
@@ -1797,10 +2173,7 @@ out:
 	if (bn)
 		bgp_dest_unlock_node(bn);
 
-	if (!written && bmp->locrib_queuepos)
-		pullwr_bump(bmp->pullwr);
-
-	return written;
+	return true;
 }
 
 static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
@@ -1808,7 +2181,6 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 	struct bmp_queue_entry *bqe;
 	struct peer *peer;
 	struct bgp_dest *bn = NULL;
-	bool written = false;
 	uint8_t bpi_num_labels, adjin_num_labels;
 	uint8_t peer_type_flag;
 
@@ -1869,7 +2241,6 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 			    bpi ? bpi->attr : NULL, bpi, afi, safi,
 			    bpi ? bpi->uptime : monotime(NULL),
 			    bpi_num_labels ? bpi->extra->labels->label : NULL, bpi_num_labels);
-		written = true;
 	}
 
 	if (CHECK_FLAG(bmp->targets->afimon[afi][safi], BMP_MON_PREPOLICY) &&
@@ -1885,7 +2256,6 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 		bmp_monitor(bmp, peer, 0, peer_type_flag, &bqe->p, prd, adjin ? adjin->attr : NULL,
 			    NULL, afi, safi, adjin ? adjin->uptime : monotime(NULL),
 			    adjin_num_labels ? &adjin->labels->label[0] : NULL, adjin_num_labels);
-		written = true;
 	}
 
 out:
@@ -1895,10 +2265,37 @@ out:
 	if (bn)
 		bgp_dest_unlock_node(bn);
 
-	if (!written && bmp->queuepos)
-		pullwr_bump(bmp->pullwr);
+	return true;
+}
 
-	return written;
+/* Pick Route Monitoring messages to send, from the update queues and then
+ * the table sync, until the encoding queue is full.  Queued items that turn
+ * out to have nothing to send count as a step too, so this is bounded.
+ */
+static void bmp_wrmonitor(struct bmp *bmp, struct pullwr *pullwr)
+{
+	unsigned int i;
+
+	for (i = 0; i < BMP_ENCQ_MAX; i++) {
+		if (!bmp_encq_room(bmp)) {
+			if (!bmp->backpressured) {
+				bmp->backpressured = true;
+				bmp->cnt_backpressure++;
+			}
+			return;
+		}
+
+		if (bmp_wrqueue(bmp, pullwr))
+			continue;
+		if (bmp_wrqueue_locrib(bmp, pullwr))
+			continue;
+		if (bmp_wrsync(bmp, pullwr))
+			continue;
+		return;
+	}
+
+	/* more to do, come back after writing out */
+	pullwr_bump(pullwr);
 }
 
 static void bmp_wrfill(struct bmp *bmp, struct pullwr *pullwr)
@@ -1918,12 +2315,8 @@ static void bmp_wrfill(struct bmp *bmp, struct pullwr *pullwr)
 	case BMP_Run:
 		if (bmp_wrmirror(bmp, pullwr))
 			break;
-		if (bmp_wrqueue(bmp, pullwr))
-			break;
-		if (bmp_wrqueue_locrib(bmp, pullwr))
-			break;
-		if (bmp_wrsync(bmp, pullwr))
-			break;
+		bmp_wrmonitor(bmp, pullwr);
+		bmp_wrencoded(bmp, pullwr);
 		break;
 	}
 }
@@ -2244,6 +2637,8 @@ static struct bmp *bmp_open(struct bmp_targets *bt, int bmp_sock)
 	bmp = bmp_new(bt, bmp_sock);
 	strlcpy(bmp->remote, buf, sizeof(bmp->remote));
 
+	bmp_enc_start();
+
 	bmp->state = BMP_PeerUp;
 	bmp->pullwr = pullwr_new(bm->master, bmp_sock, bmp, bmp_wrfill,
 			bmp_wrerr);
@@ -2294,6 +2689,8 @@ static void bmp_close(struct bmp *bmp)
 		if (!bqe->refcount)
 			XFREE(MTYPE_BMP_QUEUE, bqe);
 
+	bmp_encq_flush(bmp);
+
 	event_cancel(&bmp->t_read);
 	pullwr_del(bmp->pullwr);
 	close(bmp->socket);
@@ -3481,7 +3878,7 @@ DEFPY(show_bmp,
 			vty_out(vty, "\n    %zu connected clients:\n",
 					bmp_session_count(&bt->sessions));
 			tt = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
-			ttable_add_row(tt, "remote|uptime|MonSent|MirrSent|MirrLost|ByteSent|ByteQ|ByteQKernel");
+			ttable_add_row(tt, "remote|uptime|MonSent|MirrSent|MirrLost|ByteSent|ByteQ|ByteQKernel|EncQ|EncQMax|Backpressure|EncDropped");
 			ttable_rowseps(tt, 0, BOTTOM, true, '-');
 
 			frr_each (bmp_session, &bt->sessions, bmp) {
@@ -3495,10 +3892,11 @@ DEFPY(show_bmp,
 
 				ttable_add_row(tt,
 					       "%s|%s|%" PRIu64 "|%" PRIu64 "|%" PRIu64 "|%" PRIu64
-					       "|%zu|%zu",
+					       "|%zu|%zu|%zu|%zu|%" PRIu64 "|%" PRIu64,
 					       bmp->remote, uptime, bmp->cnt_update,
 					       bmp->cnt_mirror, bmp->cnt_mirror_overruns, total, q,
-					       kq);
+					       kq, bmp->encq_rm, bmp->encq_rm_max,
+					       bmp->cnt_backpressure, bmp->cnt_enc_dropped);
 			}
 			out = ttable_dump(tt, "\n");
 			vty_out(vty, "%s", out);
@@ -3609,6 +4007,7 @@ static int bgp_bmp_init(struct event_loop *tm)
 
 	install_element(VIEW_NODE, &show_bmp_cmd);
 
+	bmp_encs_init(&bmp_enc.sessions);
 	resolver_init(tm);
 	return 0;
 }
@@ -3692,6 +4091,7 @@ static int bmp_route_update_bgpbmp(struct bmp_targets *bt, afi_t afi, safi_t saf
 static int bgp_bmp_early_fini(void)
 {
 	resolver_terminate();
+	bmp_enc_stop();
 
 	return 0;
 }
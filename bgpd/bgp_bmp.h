@@ -99,6 +99,22 @@ enum bmp_afi_state {
 	BMP_AFI_LIVE,
 };
 
+/* Route Monitoring messages are encoded on a separate pthread.  The main
+ * pthread picks what to send (from the queues above and the table sync) and
+ * appends a job for it to the session's encoding queue; the encoder fills in
+ * the BGP UPDATE and the main pthread then writes the queue out in order.
+ * Other messages for the session go through the same queue when it isn't
+ * empty, so they are not reordered with Route Monitoring.
+ *
+ * At most BMP_ENCQ_MAX Route Monitoring jobs are queued per session.  When
+ * the queue is full nothing more is picked, and updates keep accumulating
+ * (deduplicated) in the targets' queue until the collector catches up.
+ */
+#define BMP_ENCQ_MAX 1024
+
+PREDECL_LIST(bmp_encq);
+PREDECL_LIST(bmp_encs);
+
 PREDECL_LIST(bmp_session);
 
 struct bmp_active;
@@ -138,8 +154,24 @@ struct bmp {
 	 * mirror queue
 	 */
 	uint64_t cnt_mirror_overruns;
+	/* number of times the encoding queue filled up, and Route Monitoring
+	 * messages that could not be encoded or were still queued on close
+	 */
+	uint64_t cnt_backpressure, cnt_enc_dropped;
 	struct timeval t_up;
 
+	/* encoding queue, see above.  The list and enc_* are shared with the
+	 * encoder pthread and protected by its mutex.
+	 */
+	struct bmp_encq_head encq;
+	struct bmp_encjob *enc_next;
+	struct bmp_encs_item enc_itm;
+	bool enc_queued, enc_busy;
+	struct event *t_encoded;
+	/* Route Monitoring jobs in the queue, and the most there ever were */
+	size_t encq_rm, encq_rm_max;
+	bool backpressured;
+
 	/* synchronization / startup works by repeatedly finding the next
 	 * table entry, the sync* fields note down what we sent last
 	 */
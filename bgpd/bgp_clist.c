@@ -541,6 +541,9 @@ static bool community_regexp_match(struct community *com, struct frregex *reg)
 	if (com == NULL || com->size == 0)
 		return false;
 
+	if (!translate_alias)
+		return bgp_regexec_community(reg, com) == 0;
+
 	str = community_str(com, false, translate_alias);
 
 	/* If at least one community alias is configured, then let's
@@ -14,9 +14,10 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_community.h"
 #include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_intern.h"
 
 /* Hash of community attribute. */
-static struct hash *comhash;
+static struct bgp_intern_table *comhash;
 
 /* Allocate a new communities value.  */
 struct community *community_new(void)
@@ -452,6 +453,17 @@ static void set_community_string(struct community *com, bool make_json,
 	com->str = str;
 }
 
+/* Make the string before the community becomes visible to other users. */
+static void *community_intern_alloc(void *arg)
+{
+	struct community *com = arg;
+
+	if (!com->str)
+		set_community_string(com, false, true);
+
+	return com;
+}
+
 /* Intern communities attribute.  */
 struct community *community_intern(struct community *com)
 {
@@ -460,43 +472,26 @@ struct community *community_intern(struct community *com)
 	/* Assert this community structure is not interned. */
 	assert(com->refcnt == 0);
 
-	/* Lookup community hash. */
-	find = (struct community *)hash_get(comhash, com, hash_alloc_intern);
+	/* Lookup community hash, taking a reference. */
+	find = bgp_intern_get(comhash, com, community_intern_alloc, NULL);
 
 	/* Argument com is allocated temporary.  So when it is not used in
 	   hash, it should be freed.  */
 	if (find != com)
 		community_free(&com);
 
-	/* Increment reference counter.  */
-	find->refcnt++;
-
-	/* Make string.  */
-	if (!find->str)
-		set_community_string(find, false, true);
-
 	return find;
 }
 
 /* Free community attribute. */
 void community_unintern(struct community **com)
 {
-	struct community *ret;
-
 	if (!*com)
 		return;
 
-	if ((*com)->refcnt)
-		(*com)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*com)->refcnt == 0) {
-		/* Community value com must exist in hash. */
-		ret = (struct community *)hash_release(comhash, *com);
-		assert(ret != NULL);
-
+	/* Pull off from hash when the last reference is gone.  */
+	if (bgp_intern_put(comhash, *com))
 		community_free(com);
-	}
 }
 
 /* Create new community attribute. */
@@ -873,11 +868,11 @@ struct community *community_str2com(const char *str)
 /* Return communities hash entry count.  */
 unsigned long community_count(void)
 {
-	return comhash->count;
+	return bgp_intern_count(comhash);
 }
 
-/* Return communities hash.  */
-struct hash *community_hash(void)
+/* Return communities intern table.  */
+struct bgp_intern_table *community_hash(void)
 {
 	return comhash;
 }
@@ -885,10 +880,11 @@ struct hash *community_hash(void)
 /* Initialize community related hash. */
 void community_init(void)
 {
-	comhash =
-		hash_create((unsigned int (*)(const void *))community_hash_make,
-			    (bool (*)(const void *, const void *))community_cmp,
-			    "BGP Community Hash");
+	comhash = bgp_intern_table_new(
+		"BGP Community Hash", 0,
+		(unsigned int (*)(const void *))community_hash_make,
+		(bool (*)(const void *, const void *))community_cmp,
+		struct community, refcnt);
 }
 
 static void community_hash_free(void *data)
@@ -900,7 +896,7 @@ static void community_hash_free(void *data)
 
 void community_finish(void)
 {
-	hash_clean_and_free(&comhash, community_hash_free);
+	bgp_intern_table_free(&comhash, community_hash_free);
 }
 
 static struct community *bgp_aggr_community_lookup(
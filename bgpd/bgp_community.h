@@ -9,11 +9,12 @@
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_regex.h"
 
 /* Communities attribute.  */
 struct community {
 	/* Reference count of communities value.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 
 	/* Communities value size.  */
 	int size;
@@ -27,6 +28,9 @@ struct community {
 	/* String of community attribute.  This string is used by vty output
 	   and expanded community-list for regular expression match.  */
 	char *str;
+
+	/* Expanded community-list regular expression results, when interned */
+	struct bgp_regex_cache recache;
 };
 
 /* Well-known communities value.  */
@@ -79,7 +83,7 @@ extern bool community_include(struct community *com, uint32_t val);
 extern void community_add_val(struct community *com, uint32_t val);
 extern void community_del_val(struct community *com, uint32_t *val);
 extern unsigned long community_count(void);
-extern struct hash *community_hash(void);
+extern struct bgp_intern_table *community_hash(void);
 extern uint32_t community_val_get(struct community *com, int i);
 extern void bgp_compute_aggregate_community(struct bgp_aggregate *aggregate,
 					    struct community *community);
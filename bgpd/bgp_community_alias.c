@@ -12,6 +12,7 @@
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_rmap_cache.h"
 
 struct hash *bgp_ca_alias_hash;
 static struct hash *bgp_ca_community_hash;
@@ -103,6 +104,7 @@ void bgp_ca_community_insert(struct community_alias *ca)
 void bgp_ca_alias_insert(struct community_alias *ca)
 {
 	(void)hash_get(bgp_ca_alias_hash, ca, bgp_community_alias_alloc);
+	bgp_rmap_cache_invalidate();
 }
 
 void bgp_ca_community_delete(struct community_alias *ca)
@@ -117,6 +119,7 @@ void bgp_ca_alias_delete(struct community_alias *ca)
 	struct community_alias *data = hash_release(bgp_ca_alias_hash, ca);
 
 	XFREE(MTYPE_COMMUNITY_ALIAS, data);
+	bgp_rmap_cache_invalidate();
 }
 
 struct community_alias *bgp_ca_community_lookup(struct community_alias *ca)
@@ -7,50 +7,247 @@
 
 #include <zebra.h>
 
+#include "jhash.h"
+#include "plist.h"
+#include "typesafe.h"
+
 #include "bgpd/bgp_conditional_adv.h"
 #include "bgpd/bgp_vty.h"
 
-static route_map_result_t
-bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
-				     struct route_map *rmap)
+DEFINE_MTYPE_STATIC(BGPD, BGP_COND_ADV, "BGP conditional advertisement");
+
+/* Most prefix-lists the condition-maps of a table are tracked for */
+#define BGP_COND_ADV_PLISTS 16
+
+/* Delay of a check triggered by a change, so a burst is handled at once */
+#define BGP_COND_ADV_TRIGGER_MSEC 200
+
+/*
+ * What the condition-maps of the peers using a table look at.  When they
+ * can only match prefixes of a few prefix-lists, the dests of the table
+ * within these lists are tracked as they are processed, and the conditions
+ * are checked against these dests only, shortly after one of them changed.
+ * Otherwise the whole table is walked from the periodic timer, after
+ * anything changed in it.  The periodic timer also catches up on anything
+ * the tracking could have missed.
+ */
+PREDECL_HASH(bgp_cond_dests);
+
+struct bgp_cond_dest {
+	struct bgp_cond_dests_item itm;
+	struct bgp_dest *dest;
+};
+
+static int bgp_cond_dest_cmp(const struct bgp_cond_dest *a,
+			     const struct bgp_cond_dest *b)
 {
-	struct attr dummy_attr = {0};
+	return numcmp((uintptr_t)a->dest, (uintptr_t)b->dest);
+}
+
+static uint32_t bgp_cond_dest_hash(const struct bgp_cond_dest *e)
+{
+	return jhash(&e->dest, sizeof(e->dest), 0x434f4e44);
+}
+
+DECLARE_HASH(bgp_cond_dests, struct bgp_cond_dest, itm, bgp_cond_dest_cmp,
+	     bgp_cond_dest_hash);
+
+struct bgp_cond_adv_table {
+	/* route-map generation the lists below were collected for */
+	uint32_t gen;
+	bool valid;
+
+	/* some condition-map may match any prefix */
+	bool any;
+	struct prefix_list *plists[BGP_COND_ADV_PLISTS];
+	unsigned int nplists;
+
+	/* dests within the lists, locked; built by walking the table once */
+	struct bgp_cond_dests_head dests;
+	bool built;
+
+	/* a route the condition-maps may match changed */
+	bool changed;
+};
+
+/* labeled-unicast routes are in the unicast table */
+static inline safi_t bgp_cond_adv_table_safi(safi_t safi)
+{
+	return safi == SAFI_LABELED_UNICAST ? SAFI_UNICAST : safi;
+}
+
+static void bgp_cond_adv_dests_flush(struct bgp_cond_adv_table *cat)
+{
+	struct bgp_cond_dest *cd;
+
+	while ((cd = bgp_cond_dests_pop(&cat->dests))) {
+		bgp_dest_unlock_node(cd->dest);
+		XFREE(MTYPE_BGP_COND_ADV, cd);
+	}
+	cat->built = false;
+}
+
+static bool bgp_cond_adv_wants(const struct bgp_cond_adv_table *cat,
+			       const struct prefix *p)
+{
+	unsigned int i;
+
+	for (i = 0; i < cat->nplists; i++)
+		if (prefix_list_apply_nohit(cat->plists[i], p) == PREFIX_PERMIT)
+			return true;
+	return false;
+}
+
+/*
+ * Collect what the condition-maps for the table look at, again if the
+ * route-maps or prefix-lists changed since, or if @recheck.  The dests are
+ * only forgotten if that is different from before.
+ */
+static void bgp_cond_adv_interest(struct bgp *bgp, afi_t afi, safi_t safi,
+				  struct bgp_cond_adv_table *cat, bool recheck)
+{
+	struct prefix_list *plists[BGP_COND_ADV_PLISTS];
+	unsigned int nplists = 0;
+	uint32_t gen = route_map_generation();
+	struct bgp_filter *filter;
+	struct listnode *node;
+	struct peer *peer;
+	bool any = false;
+
+	if (cat->valid && cat->gen == gen && !recheck)
+		return;
+
+	/* other tables hold RDs, EVPN or flowspec prefixes */
+	if (safi != SAFI_UNICAST && safi != SAFI_MULTICAST)
+		any = true;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer)) {
+		if (any)
+			break;
+
+		filter = &peer->filter[afi][safi];
+		if (filter->advmap.cmap &&
+		    !bgp_route_map_prefix_lists(filter->advmap.cmap, plists,
+						&nplists, BGP_COND_ADV_PLISTS))
+			any = true;
+
+		if (safi != SAFI_UNICAST)
+			continue;
+		filter = &peer->filter[afi][SAFI_LABELED_UNICAST];
+		if (filter->advmap.cmap &&
+		    !bgp_route_map_prefix_lists(filter->advmap.cmap, plists,
+						&nplists, BGP_COND_ADV_PLISTS))
+			any = true;
+	}
+	if (any)
+		nplists = 0;
+
+	if (!cat->valid || cat->any != any || cat->nplists != nplists ||
+	    memcmp(cat->plists, plists, nplists * sizeof(plists[0]))) {
+		bgp_cond_adv_debug("%s: %s %s condition-maps match %s", __func__,
+				   bgp->name_pretty,
+				   get_afi_safi_str(afi, safi, false),
+				   any ? "any prefix" : "within prefix-lists");
+
+		bgp_cond_adv_dests_flush(cat);
+		cat->any = any;
+		cat->nplists = nplists;
+		memcpy(cat->plists, plists, nplists * sizeof(plists[0]));
+		cat->changed = true;
+	}
+
+	cat->valid = true;
+	cat->gen = gen;
+}
+
+static void bgp_cond_adv_dests_build(struct bgp_cond_adv_table *cat,
+				     struct bgp_table *table)
+{
+	struct bgp_cond_dest *cd;
 	struct bgp_dest *dest;
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		if (!bgp_dest_has_bgp_path_info_data(dest) ||
+		    !bgp_cond_adv_wants(cat, bgp_dest_get_prefix(dest)))
+			continue;
+
+		cd = XCALLOC(MTYPE_BGP_COND_ADV, sizeof(*cd));
+		cd->dest = bgp_dest_lock_node(dest);
+		bgp_cond_dests_add(&cat->dests, cd);
+	}
+	cat->built = true;
+}
+
+static route_map_result_t bgp_check_rmap_prefixes_in_dest(struct bgp_dest *dest,
+							  struct route_map *rmap)
+{
+	struct attr dummy_attr = {0};
 	struct bgp_path_info *pi;
 	struct bgp_path_info path = {0};
 	struct bgp_path_info_extra path_extra;
 	const struct prefix *dest_p;
 	route_map_result_t ret = RMAP_DENYMATCH;
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		dest_p = bgp_dest_get_prefix(dest);
-		assert(dest_p);
+	dest_p = bgp_dest_get_prefix(dest);
+	assert(dest_p);
 
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
-			bgp_attr_dup_into(&dummy_attr, pi->attr);
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		bgp_attr_dup_into(&dummy_attr, pi->attr);
 
-			/* Fill temp path_info */
-			prep_for_rmap_apply(&path, &path_extra, dest, pi, pi->peer, NULL,
-					    &dummy_attr);
+		/* Fill temp path_info */
+		prep_for_rmap_apply(&path, &path_extra, dest, pi, pi->peer, NULL,
+				    &dummy_attr);
 
-			RESET_FLAG(dummy_attr.rmap_change_flags);
+		RESET_FLAG(dummy_attr.rmap_change_flags);
 
-			ret = route_map_apply(rmap, dest_p, &path);
-			bgp_attr_flush(&dummy_attr);
+		ret = route_map_apply(rmap, dest_p, &path);
+		bgp_attr_flush(&dummy_attr);
+
+		if (ret == RMAP_PERMITMATCH)
+			break;
+	}
+
+	return ret;
+}
 
+static route_map_result_t
+bgp_check_rmap_prefixes_in_bgp_table(struct bgp_table *table,
+				     struct route_map *rmap,
+				     struct bgp_cond_adv_table *cat)
+{
+	struct bgp_cond_dest *cd;
+	struct bgp_dest *dest;
+	route_map_result_t ret = RMAP_DENYMATCH;
+
+	if (cat && !cat->any) {
+		if (!cat->built)
+			bgp_cond_adv_dests_build(cat, table);
+
+		frr_each_safe (bgp_cond_dests, &cat->dests, cd) {
+			if (!bgp_dest_has_bgp_path_info_data(cd->dest)) {
+				bgp_cond_dests_del(&cat->dests, cd);
+				bgp_dest_unlock_node(cd->dest);
+				XFREE(MTYPE_BGP_COND_ADV, cd);
+				continue;
+			}
+
+			ret = bgp_check_rmap_prefixes_in_dest(cd->dest, rmap);
+			if (ret == RMAP_PERMITMATCH)
+				break;
+		}
+	} else {
+		for (dest = bgp_table_top(table); dest;
+		     dest = bgp_route_next(dest)) {
+			ret = bgp_check_rmap_prefixes_in_dest(dest, rmap);
 			if (ret == RMAP_PERMITMATCH) {
 				bgp_dest_unlock_node(dest);
-				bgp_cond_adv_debug(
-					"%s: Condition map routes present in BGP table",
-					__func__);
-
-				return ret;
+				break;
 			}
 		}
 	}
 
-	bgp_cond_adv_debug("%s: Condition map routes not present in BGP table",
-			   __func__);
+	bgp_cond_adv_debug("%s: Condition map routes %spresent in BGP table",
+			   __func__, ret == RMAP_PERMITMATCH ? "" : "not ");
 
 	return ret;
 }
@@ -152,29 +349,33 @@ static void bgp_conditional_adv_routes(struct peer *peer, afi_t afi,
 	UNSET_FLAG(subgrp->sflags, SUBGRP_STATUS_TABLE_REPARSING);
 }
 
-/* Handler of conditional advertisement timer event.
- * Each route in the condition-map is evaluated.
+/* Evaluate the condition-maps.  From the periodic timer, every table which
+ * changed is checked; when triggered by a change, only the tables whose
+ * dests are tracked, and routes are only re-announced if the outcome of the
+ * condition changed.
  */
-static void bgp_conditional_adv_timer(struct event *t)
+static void bgp_conditional_adv_check(struct bgp *bgp, bool periodic)
 {
 	afi_t afi;
 	safi_t safi;
 	int pfx_rcd_safi;
-	struct bgp *bgp = NULL;
 	struct peer *peer = NULL;
 	struct peer_af *paf = NULL;
 	struct bgp_table *table = NULL;
 	struct bgp_filter *filter = NULL;
+	struct bgp_cond_adv_table *cat;
 	struct listnode *node, *nnode = NULL;
 	struct update_subgroup *subgrp = NULL;
+	enum update_type update_type;
 	route_map_result_t ret;
 	bool advmap_table_changed = false;
+	bool table_changed;
 
-	bgp = EVENT_ARG(t);
-	assert(bgp);
-
-	event_add_timer(bm->master, bgp_conditional_adv_timer, bgp,
-			bgp->condition_check_period, &bgp->t_condition_check);
+	FOREACH_AFI_SAFI (afi, safi) {
+		cat = bgp->cond_adv[afi][safi];
+		if (cat)
+			bgp_cond_adv_interest(bgp, afi, safi, cat, periodic);
+	}
 
 	/* loop through each peer and check if we have peers with
 	 * advmap_table_change attribute set, to make sure we send
@@ -226,12 +427,18 @@ static void bgp_conditional_adv_timer(struct event *t)
 
 			SET_FLAG(peer->sflags, PEER_STATUS_COND_ADV_PENDING);
 
+			cat = bgp->cond_adv[afi][pfx_rcd_safi];
+			if (!periodic && (!cat || cat->any))
+				continue;
+			table_changed = cat ? cat->changed
+					    : advmap_table_changed;
+
 			if (!peer->advmap_config_change[afi][safi] &&
-			    !advmap_table_changed)
+			    !table_changed)
 				continue;
 
 			if (BGP_DEBUG(cond_adv, COND_ADV)) {
-				if (peer->advmap_table_change)
+				if (table_changed)
 					zlog_debug(
 						"%s: %s - routes changed in BGP table.",
 						__func__, peer->host);
@@ -247,7 +454,8 @@ static void bgp_conditional_adv_timer(struct event *t)
 			 * non-exist-map) map validation
 			 */
 			ret = bgp_check_rmap_prefixes_in_bgp_table(
-				table, filter->advmap.cmap);
+				table, filter->advmap.cmap, cat);
+			update_type = filter->advmap.update_type;
 
 			/* Derive conditional advertisement status from
 			 * condition and return value of condition-map
@@ -301,14 +509,119 @@ static void bgp_conditional_adv_timer(struct event *t)
 							paf->subgroup, NULL);
 				}
 				peer->advmap_config_change[afi][safi] = false;
-			}
+			} else if (!periodic &&
+				   update_type == filter->advmap.update_type)
+				/* updates already follow the outcome */
+				continue;
 
 			/* Send update as per the conditional advertisement */
 			bgp_conditional_adv_routes(peer, afi, safi, table,
 						   filter->advmap.amap,
 						   filter->advmap.update_type);
 		}
-		peer->advmap_table_change = false;
+		if (periodic)
+			peer->advmap_table_change = false;
+	}
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		cat = bgp->cond_adv[afi][safi];
+		if (cat && (periodic || !cat->any))
+			cat->changed = false;
+	}
+}
+
+/* Handler of conditional advertisement timer event.
+ * Each route in the condition-map is evaluated.
+ */
+static void bgp_conditional_adv_timer(struct event *t)
+{
+	struct bgp *bgp = EVENT_ARG(t);
+
+	assert(bgp);
+
+	event_add_timer(bm->master, bgp_conditional_adv_timer, bgp,
+			bgp->condition_check_period, &bgp->t_condition_check);
+
+	bgp_conditional_adv_check(bgp, true);
+}
+
+static void bgp_conditional_adv_trigger(struct event *t)
+{
+	struct bgp *bgp = EVENT_ARG(t);
+
+	bgp_conditional_adv_check(bgp, false);
+}
+
+/* A dest was processed: note it if a condition-map may match it. */
+void bgp_conditional_adv_dest_changed(struct bgp *bgp, struct bgp_dest *dest,
+				      afi_t afi, safi_t safi)
+{
+	struct bgp_cond_adv_table *cat;
+	struct bgp_cond_dest *cd, ref;
+
+	safi = bgp_cond_adv_table_safi(safi);
+	cat = bgp->cond_adv[afi][safi];
+	if (!cat)
+		return;
+
+	bgp_cond_adv_interest(bgp, afi, safi, cat, false);
+
+	/* checked from the timer, walking the whole table */
+	if (cat->any) {
+		cat->changed = true;
+		return;
+	}
+
+	if (!bgp_cond_adv_wants(cat, bgp_dest_get_prefix(dest)))
+		return;
+
+	if (cat->built) {
+		ref.dest = dest;
+		if (!bgp_cond_dests_find(&cat->dests, &ref)) {
+			cd = XCALLOC(MTYPE_BGP_COND_ADV, sizeof(*cd));
+			cd->dest = bgp_dest_lock_node(dest);
+			bgp_cond_dests_add(&cat->dests, cd);
+		}
+	}
+
+	cat->changed = true;
+	if (!event_is_scheduled(bgp->t_condition_trigger))
+		event_add_timer_msec(bm->master, bgp_conditional_adv_trigger,
+				     bgp, BGP_COND_ADV_TRIGGER_MSEC,
+				     &bgp->t_condition_trigger);
+}
+
+/* advertise-map configuration changed for the table */
+static void bgp_cond_adv_invalidate(struct bgp *bgp, afi_t afi, safi_t safi)
+{
+	struct bgp_cond_adv_table *cat;
+
+	safi = bgp_cond_adv_table_safi(safi);
+	cat = bgp->cond_adv[afi][safi];
+	if (!cat) {
+		cat = XCALLOC(MTYPE_BGP_COND_ADV, sizeof(*cat));
+		bgp_cond_dests_init(&cat->dests);
+		bgp->cond_adv[afi][safi] = cat;
+	}
+	cat->valid = false;
+}
+
+void bgp_conditional_adv_finish(struct bgp *bgp)
+{
+	struct bgp_cond_adv_table *cat;
+	afi_t afi;
+	safi_t safi;
+
+	event_cancel(&bgp->t_condition_trigger);
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		cat = bgp->cond_adv[afi][safi];
+		if (!cat)
+			continue;
+
+		bgp_cond_adv_dests_flush(cat);
+		bgp_cond_dests_fini(&cat->dests);
+		XFREE(MTYPE_BGP_COND_ADV, bgp->cond_adv[afi][safi]);
 	}
 }
 
@@ -323,6 +636,7 @@ void bgp_conditional_adv_enable(struct peer *peer, afi_t afi, safi_t safi)
 	 * table w.r.t conditional routes
 	 */
 	peer->advmap_config_change[afi][safi] = true;
+	bgp_cond_adv_invalidate(bgp, afi, safi);
 
 	/* advertise-map is already configured on at least one of its
 	 * neighbors (AFI/SAFI). So just increment the counter.
@@ -346,6 +660,8 @@ void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
 
 	assert(bgp);
 
+	bgp_cond_adv_invalidate(bgp, afi, safi);
+
 	/* advertise-map is not configured on any of its neighbors or
 	 * it is configured on more than one neighbor(AFI/SAFI).
 	 * So there's nothing to do except decrementing the counter.
@@ -359,6 +675,7 @@ void bgp_conditional_adv_disable(struct peer *peer, afi_t afi, safi_t safi)
 
 	/* Last filter removed. So cancel conditional routes polling thread. */
 	event_cancel(&bgp->t_condition_check);
+	bgp_conditional_adv_finish(bgp);
 }
 
 static void peer_advertise_map_filter_update(struct peer *peer, afi_t afi,
@@ -406,6 +723,7 @@ static void peer_advertise_map_filter_update(struct peer *peer, afi_t afi,
 	filter->advmap.condition = condition;
 	route_map_counter_increment(filter->advmap.amap);
 	peer->advmap_config_change[afi][safi] = true;
+	bgp_cond_adv_invalidate(peer->bgp, afi, safi);
 
 	/* Increment condition_filter_count and/or create timer. */
 	if (!filter_exists) {
@@ -11,7 +11,6 @@
 #include "command.h"
 #include "log.h"
 #include "frrevent.h"
-#include "queue.h"
 #include "filter.h"
 
 #include "bgpd/bgpd.h"
@@ -23,37 +22,36 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
 
-static void bgp_reuselist_add(struct reuselist *list, struct bgp_damp_info *info)
-{
-	assert(info);
-	SLIST_INSERT_HEAD(list, info, entry);
-}
-
-static void bgp_reuselist_del(struct reuselist *list, struct bgp_damp_info *info)
-{
-	assert(info);
-	SLIST_REMOVE(list, info, bgp_damp_info, entry);
-}
+/*
+ * Suppressed routes wait on a wheel of reuse lists, one for every
+ * DELTA_REUSE seconds, for the time their penalty decays below the reuse
+ * limit.  That time is computed once when a route goes on the wheel, so the
+ * penalty is only decayed again when the route is due, and a route due
+ * beyond a turn of the wheel waits on its last list, to be placed again.
+ * Due routes are then reused BGP_DAMP_REUSE_BATCH at a time, so that a
+ * flapping incident does not stall the event loop.
+ */
+#define BGP_DAMP_REUSE_BATCH 1000
 
-static void bgp_reuselist_switch(struct reuselist *source,
-				 struct bgp_damp_info *info,
-				 struct reuselist *target)
+/* List holding @bdi, which belongs to bdi->config */
+static struct bgp_damp_list_head *bgp_damp_info_list(struct bgp_damp_info *bdi)
 {
-	assert(source && target && info);
-	SLIST_REMOVE(source, info, bgp_damp_info, entry);
-	SLIST_INSERT_HEAD(target, info, entry);
+	struct bgp_damp_config *bdc = bdi->config;
+
+	switch (bdi->index) {
+	case BGP_DAMP_NO_REUSE_LIST_INDEX:
+		return &bdc->no_reuse_list;
+	case BGP_DAMP_REUSE_READY_INDEX:
+		return &bdc->reuse_ready;
+	default:
+		return &bdc->reuse_list[bdi->index];
+	}
 }
 
-static void bgp_damp_info_unclaim(struct bgp_damp_info *bdi,
-				  struct reuselist *list)
+static void bgp_damp_info_unclaim(struct bgp_damp_info *bdi)
 {
 	assert(bdi && bdi->config);
-	if (bdi->index == BGP_DAMP_NO_REUSE_LIST_INDEX)
-		bgp_reuselist_del(&bdi->config->no_reuse_list, bdi);
-	else
-		bgp_reuselist_del(list ? list
-				       : &bdi->config->reuse_list[bdi->index],
-				  bdi);
+	bgp_damp_list_del(bgp_damp_info_list(bdi), bdi);
 	bdi->config = NULL;
 }
 
@@ -65,7 +63,7 @@ static void bgp_damp_info_claim(struct bgp_damp_info *bdi,
 		bdi->config = bdc;
 		return;
 	}
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 	bdi->config = bdc;
 	bdi->afi = bdc->afi;
 	bdi->safi = bdc->safi;
@@ -85,42 +83,53 @@ struct bgp_damp_config *get_active_bdc_from_pi(struct bgp_path_info *pi,
 	return NULL;
 }
 
-/* Calculate reuse list index by penalty value.  */
-static int bgp_reuse_index(int penalty, struct bgp_damp_config *bdc)
+/* Time the penalty of @bdi, as of t_updated, decays below the reuse limit */
+static time_t bgp_reuse_time(struct bgp_damp_info *bdi,
+			     struct bgp_damp_config *bdc)
 {
 	unsigned int i;
-	unsigned int index;
 
-	/*
-	 * reuse_limit can't be zero, this is for Coverity
-	 * to bypass division by zero test.
-	 */
-	assert(bdc->reuse_limit);
+	if (bdi->penalty < bdc->reuse_limit)
+		return bdi->t_updated;
 
-	i = (int)(((double)penalty / bdc->reuse_limit - 1.0)
-		  * bdc->scale_factor);
+	/* the first decay-array step taking the penalty below the limit */
+	i = (unsigned int)(log((double)bdc->reuse_limit / bdi->penalty) /
+			   log(bdc->decay_array[1])) +
+	    1;
+	if (i > bdc->decay_array_size)
+		i = bdc->decay_array_size;
 
-	if (i >= bdc->reuse_index_size)
-		i = bdc->reuse_index_size - 1;
+	return bdi->t_updated + (time_t)i * DELTA_T;
+}
+
+/* Reuse list due at @reuse_time, or the last one of the wheel */
+static int bgp_reuse_index(time_t reuse_time, struct bgp_damp_config *bdc,
+			   time_t t_now)
+{
+	unsigned int ticks = 0;
 
-	index = bdc->reuse_index[i] - bdc->reuse_index[0];
+	if (reuse_time > t_now)
+		ticks = (reuse_time - t_now + DELTA_REUSE - 1) / DELTA_REUSE;
+	if (ticks >= bdc->reuse_list_size)
+		ticks = bdc->reuse_list_size - 1;
 
-	return (bdc->reuse_offset + index) % bdc->reuse_list_size;
+	return (bdc->reuse_offset + ticks) % bdc->reuse_list_size;
 }
 
 /* Add BGP dampening information to reuse list.  */
 static void bgp_reuse_list_add(struct bgp_damp_info *bdi,
-			       struct bgp_damp_config *bdc)
+			       struct bgp_damp_config *bdc, time_t t_now)
 {
 	bgp_damp_info_claim(bdi, bdc);
-	bdi->index = bgp_reuse_index(bdi->penalty, bdc);
-	bgp_reuselist_add(&bdc->reuse_list[bdi->index], bdi);
+	bdi->reuse_time = bgp_reuse_time(bdi, bdc);
+	bdi->index = bgp_reuse_index(bdi->reuse_time, bdc, t_now);
+	bgp_damp_list_add_head(&bdc->reuse_list[bdi->index], bdi);
 }
 
 /* Delete BGP dampening information from reuse list.  */
 static void bgp_reuse_list_delete(struct bgp_damp_info *bdi)
 {
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 }
 
 static void bgp_no_reuse_list_add(struct bgp_damp_info *bdi,
@@ -128,12 +137,12 @@ static void bgp_no_reuse_list_add(struct bgp_damp_info *bdi,
 {
 	bgp_damp_info_claim(bdi, bdc);
 	bdi->index = BGP_DAMP_NO_REUSE_LIST_INDEX;
-	bgp_reuselist_add(&bdc->no_reuse_list, bdi);
+	bgp_damp_list_add_head(&bdc->no_reuse_list, bdi);
 }
 
 static void bgp_no_reuse_list_delete(struct bgp_damp_info *bdi)
 {
-	bgp_damp_info_unclaim(bdi, NULL);
+	bgp_damp_info_unclaim(bdi);
 }
 
 /* Return decayed penalty value.  */
@@ -152,80 +161,114 @@ int bgp_damp_decay(time_t tdiff, int penalty, struct bgp_damp_config *bdc)
 	return (int)(penalty * bdc->decay_array[i]);
 }
 
-/* Handler of reuse timer event.  Each route in the current reuse-list
-   is evaluated.  RFC2439 Section 4.8.7.  */
-static void bgp_reuse_timer(struct event *t)
+/* Evaluate a due route, RFC2439 Section 4.8.7.  */
+static void bgp_reuse_one(struct bgp_damp_info *bdi,
+			  struct bgp_damp_config *bdc, time_t t_now)
 {
-	struct bgp_damp_info *bdi, *bdi_next;
-	struct reuselist plist;
-	struct bgp *bgp;
-	time_t t_now, t_diff;
-	struct bgp_damp_config *bdc = EVENT_ARG(t);
+	struct bgp *bgp = bdi->path->peer->bgp;
 
-	event_add_timer(bm->master, bgp_reuse_timer, bdc, DELTA_REUSE,
-			&bdc->t_reuse);
+	/* Set t-diff = t-now - t-updated.  */
+	/* Set figure-of-merit = figure-of-merit * decay-array-ok [t-diff] */
+	bdi->penalty = bgp_damp_decay(t_now - bdi->t_updated, bdi->penalty,
+				      bdc);
 
-	t_now = monotime(NULL);
+	/* Set t-updated = t-now.  */
+	bdi->t_updated = t_now;
 
-	/* 1.  save a pointer to the current queue head and zero the list head
-	 * list head entry. */
-	assert(bdc->reuse_offset < bdc->reuse_list_size);
-	plist = bdc->reuse_list[bdc->reuse_offset];
-	SLIST_INIT(&bdc->reuse_list[bdc->reuse_offset]);
+	/* if (figure-of-merit < reuse).  */
+	if (bdi->penalty < bdc->reuse_limit) {
+		/* Reuse the route.  */
+		bgp_path_info_unset_flag(bdi->dest, bdi->path, BGP_PATH_DAMPED);
+		bdi->suppress_time = 0;
 
-	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
-	   rotating the circular queue of list-heads.  */
-	bdc->reuse_offset = (bdc->reuse_offset + 1) % bdc->reuse_list_size;
-	assert(bdc->reuse_offset < bdc->reuse_list_size);
+		if (bdi->lastrecord == BGP_RECORD_UPDATE) {
+			bgp_path_info_unset_flag(bdi->dest, bdi->path,
+						 BGP_PATH_HISTORY);
+			bgp_aggregate_increment(bgp,
+						bgp_dest_get_prefix(bdi->dest),
+						bdi->path, bdi->afi, bdi->safi);
+			bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
+				    bdi->safi);
+		}
 
-	/* 3. if ( the saved list head pointer is non-empty ) */
-	SLIST_FOREACH_SAFE (bdi, &plist, entry, bdi_next) {
-		bgp = bdi->path->peer->bgp;
+		if (bdi->penalty <= bdc->reuse_limit / 2.0) {
+			bgp_damp_info_free(bdi, 1);
+		} else {
+			bgp_reuse_list_delete(bdi);
+			bgp_no_reuse_list_add(bdi, bdc);
+		}
+	} else {
+		/* Re-insert into another list (See RFC2439 Section 4.8.6).  */
+		bgp_reuse_list_delete(bdi);
+		bgp_reuse_list_add(bdi, bdc, t_now);
+	}
+}
 
-		/* Set t-diff = t-now - t-updated.  */
-		t_diff = t_now - bdi->t_updated;
+/* Reuse up to BGP_DAMP_REUSE_BATCH due routes, returning how many are left */
+static size_t bgp_reuse_run_batch(struct bgp_damp_config *bdc, time_t t_now)
+{
+	struct bgp_damp_info *bdi;
+	unsigned int count = 0;
 
-		/* Set figure-of-merit = figure-of-merit * decay-array-ok
-		 * [t-diff] */
-		bdi->penalty = bgp_damp_decay(t_diff, bdi->penalty, bdc);
+	while (count++ < BGP_DAMP_REUSE_BATCH &&
+	       (bdi = bgp_damp_list_first(&bdc->reuse_ready)))
+		bgp_reuse_one(bdi, bdc, t_now);
 
-		/* Set t-updated = t-now.  */
-		bdi->t_updated = t_now;
+	return bgp_damp_list_count(&bdc->reuse_ready);
+}
 
-		/* if (figure-of-merit < reuse).  */
-		if (bdi->penalty < bdc->reuse_limit) {
-			/* Reuse the route.  */
-			bgp_path_info_unset_flag(bdi->dest, bdi->path,
-						 BGP_PATH_DAMPED);
-			bdi->suppress_time = 0;
-
-			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
-				bgp_path_info_unset_flag(bdi->dest, bdi->path,
-							 BGP_PATH_HISTORY);
-				bgp_aggregate_increment(
-					bgp, bgp_dest_get_prefix(bdi->dest),
-					bdi->path, bdi->afi, bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
-					    bdi->safi);
-			}
+static void bgp_reuse_run(struct event *t)
+{
+	struct bgp_damp_config *bdc = EVENT_ARG(t);
 
-			if (bdi->penalty <= bdc->reuse_limit / 2.0) {
-				bgp_damp_info_free(bdi, &plist, 1);
-			} else {
-				bdi->index = BGP_DAMP_NO_REUSE_LIST_INDEX;
-				bgp_reuselist_switch(&plist, bdi,
-						     &bdc->no_reuse_list);
-			}
-		} else {
-			/* Re-insert into another list (See RFC2439 Section
-			 * 4.8.6).  */
-			bdi->index = bgp_reuse_index(bdi->penalty, bdc);
-			bgp_reuselist_switch(&plist, bdi,
-					     &bdc->reuse_list[bdi->index]);
+	if (bgp_reuse_run_batch(bdc, monotime(NULL)))
+		event_add_event(bm->master, bgp_reuse_run, bdc, 0,
+				&bdc->t_reuse_ready);
+}
+
+/* Turn the wheel, moving the routes of the current reuse list that are due
+ * to the ready list, and the others to the list they are due on.
+ */
+static void bgp_reuse_tick(struct bgp_damp_config *bdc, time_t t_now)
+{
+	struct bgp_damp_list_head *list;
+	struct bgp_damp_info *bdi;
+	int index;
+
+	assert(bdc->reuse_offset < bdc->reuse_list_size);
+	list = &bdc->reuse_list[bdc->reuse_offset];
+	bdc->reuse_offset = (bdc->reuse_offset + 1) % bdc->reuse_list_size;
+
+	frr_each_safe (bgp_damp_list, list, bdi) {
+		if (bdi->reuse_time <= t_now) {
+			bgp_damp_list_del(list, bdi);
+			bdi->index = BGP_DAMP_REUSE_READY_INDEX;
+			bgp_damp_list_add_tail(&bdc->reuse_ready, bdi);
+			continue;
+		}
+
+		index = bgp_reuse_index(bdi->reuse_time, bdc, t_now);
+		if (&bdc->reuse_list[index] != list) {
+			bgp_damp_list_del(list, bdi);
+			bdi->index = index;
+			bgp_damp_list_add_head(&bdc->reuse_list[index], bdi);
 		}
 	}
+}
+
+/* Handler of reuse timer event.  RFC2439 Section 4.8.7.  */
+static void bgp_reuse_timer(struct event *t)
+{
+	struct bgp_damp_config *bdc = EVENT_ARG(t);
+
+	event_add_timer(bm->master, bgp_reuse_timer, bdc, DELTA_REUSE,
+			&bdc->t_reuse);
+
+	bgp_reuse_tick(bdc, monotime(NULL));
 
-	assert(SLIST_EMPTY(&plist));
+	if (bgp_damp_list_count(&bdc->reuse_ready))
+		event_add_event(bm->master, bgp_reuse_run, bdc, 0,
+				&bdc->t_reuse_ready);
 }
 
 /* A route becomes unreachable (RFC2439 Section 4.8.2).  */
@@ -272,10 +315,13 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		if (bdi->config != bdc) {
 			bgp_damp_info_claim(bdi, bdc);
 			if (bdi->index == BGP_DAMP_NO_REUSE_LIST_INDEX)
-				bgp_reuselist_add(&bdc->no_reuse_list, bdi);
-			else
-				bgp_reuselist_add(&bdc->reuse_list[bdi->index],
-						  bdi);
+				bgp_damp_list_add_head(&bdc->no_reuse_list, bdi);
+			else {
+				bdi->index = bgp_reuse_index(bdi->reuse_time,
+							     bdc, t_now);
+				bgp_damp_list_add_head(&bdc->reuse_list[bdi->index],
+						       bdi);
+			}
 		}
 		last_penalty = bdi->penalty;
 
@@ -304,7 +350,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		/* If decay rate isn't equal to 0, reinsert brn. */
 		if (bdi->penalty != last_penalty) {
 			bgp_reuse_list_delete(bdi);
-			bgp_reuse_list_add(bdi, bdc);
+			bgp_reuse_list_add(bdi, bdc, t_now);
 		}
 		return BGP_DAMP_SUPPRESSED;
 	}
@@ -315,7 +361,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 		bgp_path_info_set_flag(dest, path, BGP_PATH_DAMPED);
 		bdi->suppress_time = t_now;
 		bgp_no_reuse_list_delete(bdi);
-		bgp_reuse_list_add(bdi, bdc);
+		bgp_reuse_list_add(bdi, bdc, t_now);
 	}
 	return BGP_DAMP_USED;
 }
@@ -357,13 +403,12 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 	if (bdi->penalty > bdc->reuse_limit / 2.0)
 		bdi->t_updated = t_now;
 	else
-		bgp_damp_info_free(bdi, NULL, 0);
+		bgp_damp_info_free(bdi, 0);
 
 	return status;
 }
 
-void bgp_damp_info_free(struct bgp_damp_info *bdi, struct reuselist *list,
-			int withdraw)
+void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw)
 {
 	assert(bdi);
 
@@ -373,7 +418,7 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, struct reuselist *list,
 	struct bgp_dest *dest = bdi->dest;
 	struct bgp *bgp = bpi->peer->bgp;
 
-	bgp_damp_info_unclaim(bdi, list);
+	bgp_damp_info_unclaim(bdi);
 
 	bpi->extra->damp_info = NULL;
 	bgp_path_info_unset_flag(dest, bpi, BGP_PATH_HISTORY | BGP_PATH_DAMPED);
@@ -389,18 +434,13 @@ static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
 				   unsigned int sup, time_t maxsup,
 				   struct bgp_damp_config *bdc)
 {
-	double reuse_max_ratio;
 	unsigned int i;
-	double j;
 
 	bdc->suppress_value = sup;
 	bdc->half_life = hlife;
 	bdc->reuse_limit = reuse;
 	bdc->max_suppress_time = maxsup;
 
-	/* Initialize params per bgp_damp_config. */
-	bdc->reuse_index_size = REUSE_ARRAY_SIZE;
-
 	bdc->ceiling = (int)(bdc->reuse_limit
 			     * (pow(2, (double)bdc->max_suppress_time
 					       / bdc->half_life)));
@@ -426,28 +466,13 @@ static void bgp_damp_parameter_set(time_t hlife, unsigned int reuse,
 
 	bdc->reuse_list =
 		XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-			bdc->reuse_list_size * sizeof(struct reuselist));
-	/* Reuse-array computations */
-	bdc->reuse_index = XCALLOC(MTYPE_BGP_DAMP_ARRAY,
-				   sizeof(int) * bdc->reuse_index_size);
-
-	reuse_max_ratio = (double)bdc->ceiling / bdc->reuse_limit;
-	j = (exp((double)bdc->max_suppress_time / bdc->half_life) * log10(2.0));
-	if (reuse_max_ratio > j && j != 0)
-		reuse_max_ratio = j;
-
-	bdc->scale_factor =
-		(double)bdc->reuse_index_size / (reuse_max_ratio - 1);
-
-	for (i = 0; i < bdc->reuse_index_size; i++) {
-		bdc->reuse_index[i] =
-			(int)(((double)bdc->half_life / DELTA_REUSE)
-			      * log10(1.0
-				      / (bdc->reuse_limit
-					 * (1.0
-					    + ((double)i / bdc->scale_factor))))
-			      / log10(0.5));
-	}
+			bdc->reuse_list_size * sizeof(*bdc->reuse_list));
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		bgp_damp_list_init(&bdc->reuse_list[i]);
+	bdc->reuse_offset = 0;
+
+	bgp_damp_list_init(&bdc->reuse_ready);
+	bgp_damp_list_init(&bdc->no_reuse_list);
 }
 
 int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
@@ -475,44 +500,46 @@ int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 	return 0;
 }
 
+/* Free the dampening information on @list, reusing the routes if @reuse */
+static void bgp_damp_list_clean(struct bgp *bgp,
+				struct bgp_damp_list_head *list, bool reuse)
+{
+	struct bgp_damp_info *bdi;
+
+	/* the lists of a configuration never enabled are not initialized */
+	while (bgp_damp_list_count(list) &&
+	       (bdi = bgp_damp_list_first(list)) != NULL) {
+		if (reuse && bdi->lastrecord == BGP_RECORD_UPDATE) {
+			bgp_path_info_unset_flag(bdi->dest, bdi->path,
+						 BGP_PATH_HISTORY | BGP_PATH_DAMPED);
+			bgp_aggregate_increment(bgp,
+						bgp_dest_get_prefix(bdi->dest),
+						bdi->path, bdi->afi, bdi->safi);
+			bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
+				    bdi->safi);
+		}
+		bgp_damp_info_free(bdi, 1);
+	}
+}
+
 /* Clean all the bgp_damp_info stored in reuse_list and no_reuse_list. */
 void bgp_damp_info_clean(struct bgp *bgp, struct bgp_damp_config *bdc,
 			 afi_t afi, safi_t safi)
 {
-	struct bgp_damp_info *bdi;
-	struct reuselist *list;
 	unsigned int i;
 
-	bdc->reuse_offset = 0;
-	for (i = 0; i < bdc->reuse_list_size; ++i) {
-		list = &bdc->reuse_list[i];
-		while ((bdi = SLIST_FIRST(list)) != NULL) {
-			if (bdi->lastrecord == BGP_RECORD_UPDATE) {
-				bgp_path_info_unset_flag(bdi->dest, bdi->path,
-							 BGP_PATH_HISTORY | BGP_PATH_DAMPED);
-				bgp_aggregate_increment(bgp,
-							bgp_dest_get_prefix(
-								bdi->dest),
-							bdi->path, bdi->afi,
-							bdi->safi);
-				bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
-					    bdi->safi);
-			}
-			bgp_damp_info_free(bdi, list, 1);
-		}
-	}
+	event_cancel(&bdc->t_reuse_ready);
 
-	while ((bdi = SLIST_FIRST(&bdc->no_reuse_list)) != NULL)
-		bgp_damp_info_free(bdi, &bdc->no_reuse_list, 1);
+	bdc->reuse_offset = 0;
+	for (i = 0; i < bdc->reuse_list_size; ++i)
+		bgp_damp_list_clean(bgp, &bdc->reuse_list[i], true);
+	bgp_damp_list_clean(bgp, &bdc->reuse_ready, true);
+	bgp_damp_list_clean(bgp, &bdc->no_reuse_list, false);
 
 	/* Free decay array */
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->decay_array);
 	bdc->decay_array_size = 0;
 
-	/* Free reuse index array */
-	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_index);
-	bdc->reuse_index_size = 0;
-
 	XFREE(MTYPE_BGP_DAMP_ARRAY, bdc->reuse_list);
 	bdc->reuse_list_size = 0;
 
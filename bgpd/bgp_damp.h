@@ -6,8 +6,12 @@
 #ifndef _QUAGGA_BGP_DAMP_H
 #define _QUAGGA_BGP_DAMP_H
 
+#include "typesafe.h"
+
 #include "bgpd/bgp_table.h"
 
+PREDECL_DLIST(bgp_damp_list);
+
 /* Structure maintained on a per-route basis. */
 struct bgp_damp_info {
 	/* Figure-of-merit.  */
@@ -25,6 +29,9 @@ struct bgp_damp_info {
 	/* Time of route start to be suppressed.  */
 	time_t suppress_time;
 
+	/* Time the penalty decays below the reuse limit, on a reuse list. */
+	time_t reuse_time;
+
 	/* Back reference to associated dampening configuration. */
 	struct bgp_damp_config *config;
 
@@ -38,6 +45,8 @@ struct bgp_damp_info {
 	int index;
 #define BGP_DAMP_NO_REUSE_LIST_INDEX                                           \
 	(-1) /* index for elements on no_reuse_list */
+#define BGP_DAMP_REUSE_READY_INDEX                                             \
+	(-2) /* index for elements on reuse_ready */
 
 	/* Last time message type. */
 	uint8_t lastrecord;
@@ -47,10 +56,10 @@ struct bgp_damp_info {
 	afi_t afi;
 	safi_t safi;
 
-	SLIST_ENTRY(bgp_damp_info) entry;
+	struct bgp_damp_list_item entry;
 };
 
-SLIST_HEAD(reuselist, bgp_damp_info);
+DECLARE_DLIST(bgp_damp_list, struct bgp_damp_info, entry);
 
 /* Specified parameter set configuration. */
 struct bgp_damp_config {
@@ -70,7 +79,6 @@ struct bgp_damp_config {
 	 * To change this values, init_bgp_damp() should be modified.
 	 */
 	unsigned int reuse_list_size;  /* Number of reuse lists */
-	unsigned int reuse_index_size; /* Size of reuse index array */
 
 	/* Non-configurable parameters.  Most of these are calculated from
 	 * the configurable parameters above.
@@ -78,25 +86,24 @@ struct bgp_damp_config {
 	unsigned int ceiling;		  /* Max value a penalty can attain */
 	unsigned int decay_rate_per_tick; /* Calculated from half-life */
 	unsigned int decay_array_size; /* Calculated using config parameters */
-	unsigned int reuse_scale_factor;
-	double scale_factor;
 
 	/* Decay array per-set based. */
 	double *decay_array;
 
-	/* Reuse index array per-set based. */
-	int *reuse_index;
-
-	/* Reuse list array per-set based. */
-	struct reuselist *reuse_list;
+	/* Reuse list array per-set based, by reuse time. */
+	struct bgp_damp_list_head *reuse_list;
 	unsigned int reuse_offset;
 	safi_t safi;
 
+	/* Routes due for reuse, processed in batches. */
+	struct bgp_damp_list_head reuse_ready;
+
 	/* All dampening information which is not on reuse list.  */
-	struct reuselist no_reuse_list;
+	struct bgp_damp_list_head no_reuse_list;
 
 	/* Reuse timer thread per-set base. */
 	struct event *t_reuse;
+	struct event *t_reuse_ready;
 
 	afi_t afi;
 };
@@ -118,7 +125,6 @@ struct bgp_damp_config {
 #define DEFAULT_SUPPRESS 	2000
 
 #define REUSE_LIST_SIZE          256
-#define REUSE_ARRAY_SIZE        1024
 
 extern struct bgp_damp_config *get_active_bdc_from_pi(struct bgp_path_info *pi,
 						      afi_t afi, safi_t safi);
@@ -130,8 +136,7 @@ extern int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_dest *dest,
 			     afi_t afi, safi_t safi, int attr_change);
 extern int bgp_damp_update(struct bgp_path_info *path, struct bgp_dest *dest,
 			   afi_t afi, safi_t saff);
-extern void bgp_damp_info_free(struct bgp_damp_info *bdi,
-			       struct reuselist *list, int withdraw);
+extern void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw);
 extern void bgp_damp_info_clean(struct bgp *bgp, struct bgp_damp_config *bdc,
 				afi_t afi, safi_t safi);
 extern void bgp_damp_config_clean(struct bgp_damp_config *bdc);
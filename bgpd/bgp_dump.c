@@ -16,6 +16,9 @@
 #include "queue.h"
 #include "memory.h"
 #include "filter.h"
+#include "frr_pthread.h"
+#include "monotime.h"
+#include "lib/json.h"
 
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgpd.h"
@@ -25,6 +28,8 @@
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_packet.h"
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_DUMP_RIB, "BGP RIB dump snapshot");
+
 enum bgp_dump_type {
 	BGP_DUMP_ALL,
 	BGP_DUMP_ALL_ET,
@@ -205,14 +210,12 @@ static void bgp_dump_set_size(struct stream *s, int type)
 	stream_putl_at(s, 8, stream_get_endp(s) - BGP_DUMP_HEADER_SIZE);
 }
 
-static void bgp_dump_routes_index_table(struct bgp *bgp)
+static void bgp_dump_routes_index_table(struct bgp *bgp, struct stream *obuf)
 {
 	struct peer *peer;
 	struct listnode *node;
 	uint16_t peerno = 1;
-	struct stream *obuf;
 
-	obuf = bgp_dump_obuf;
 	stream_reset(obuf);
 
 	/* MRT header */
@@ -287,40 +290,167 @@ static void bgp_dump_routes_index_table(struct bgp *bgp)
 	}
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+}
+
+/*
+ * RIB dumps are taken in two steps.  The main pthread takes a snapshot of
+ * the IPv4 and IPv6 unicast tables: the prefixes, and for each path the
+ * peer index, the times and a reference on the interned attributes, which
+ * do not change.  The dump pthread then encodes and writes the records
+ * from the snapshot, and hands it back to the main pthread to release the
+ * attributes.  Only one RIB dump runs at a time.
+ */
+struct bgp_dump_rib_path {
+	struct attr *attr;
+	uint32_t originated;
+	uint32_t addpath_rx_id;
+	uint16_t peer_index;
+	bool addpath;
+};
+
+struct bgp_dump_rib_dest {
+	struct prefix p;
+	unsigned int first;
+	unsigned int count;
+};
+
+struct bgp_dump_rib {
+	FILE *fp;
+
+	/* encoded by the main pthread, it sets peer->table_dump_index */
+	struct stream *index_table;
+
+	struct bgp_dump_rib_dest *dests;
+	unsigned int ndests, dests_size;
+	struct bgp_dump_rib_path *paths;
+	unsigned int npaths, paths_size;
 
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
-	fflush(bgp_dump_routes.fp);
+	int64_t snapshot_usec;
+	_Atomic bool abort;
+
+	/* written by the dump pthread */
+	_Atomic unsigned int dests_done;
+	_Atomic unsigned int records;
+	_Atomic uint64_t bytes;
+	int64_t write_usec;
+	bool failed;
+};
+
+static struct bgp_dump_rib_info {
+	struct frr_pthread *fpt;
+
+	/* dump in progress, if any */
+	struct bgp_dump_rib *running;
+
+	/* statistics */
+	uint64_t dumps;
+	uint64_t skipped;
+	time_t last_time;
+	unsigned int last_dests;
+	unsigned int last_paths;
+	unsigned int last_records;
+	uint64_t last_bytes;
+	int64_t last_snapshot_usec;
+	int64_t last_write_usec;
+	bool last_failed;
+} bdr;
+
+static void bgp_dump_rib_free(struct bgp_dump_rib *rib)
+{
+	unsigned int i;
+
+	for (i = 0; i < rib->npaths; i++)
+		bgp_attr_unintern(&rib->paths[i].attr);
+
+	if (rib->fp)
+		fclose(rib->fp);
+	stream_free(rib->index_table);
+	XFREE(MTYPE_BGP_DUMP_RIB, rib->paths);
+	XFREE(MTYPE_BGP_DUMP_RIB, rib->dests);
+	XFREE(MTYPE_BGP_DUMP_RIB, rib);
 }
 
-static struct bgp_path_info *
-bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
-			   struct bgp_path_info *path, unsigned int seq)
+static void bgp_dump_rib_snapshot_table(struct bgp_dump_rib *rib,
+					struct bgp_table *table, afi_t afi)
 {
-	struct stream *obuf;
+	struct bgp_dump_rib_dest *d;
+	struct bgp_dump_rib_path *e;
+	struct bgp_path_info *path;
+	struct bgp_dest *dest;
+	time_t now = time(NULL);
+	time_t mono = monotime(NULL);
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		path = bgp_dest_get_bgp_path_info(dest);
+		if (!path)
+			continue;
+
+		if (rib->ndests == rib->dests_size) {
+			rib->dests_size = MAX(1024U, rib->dests_size * 2);
+			rib->dests = XREALLOC(MTYPE_BGP_DUMP_RIB, rib->dests,
+					      rib->dests_size * sizeof(*d));
+		}
+		d = &rib->dests[rib->ndests++];
+		prefix_copy(&d->p, bgp_dest_get_prefix(dest));
+		d->first = rib->npaths;
+		d->count = 0;
+
+		for (; path; path = path->next) {
+			if (rib->npaths == rib->paths_size) {
+				rib->paths_size = MAX(1024U,
+						      rib->paths_size * 2);
+				rib->paths = XREALLOC(MTYPE_BGP_DUMP_RIB,
+						      rib->paths,
+						      rib->paths_size *
+							      sizeof(*e));
+			}
+			e = &rib->paths[rib->npaths++];
+			e->attr = bgp_attr_intern(path->attr);
+			e->originated = now - (mono - path->uptime);
+			e->addpath_rx_id = path->addpath_rx_id;
+			e->peer_index = path->peer->table_dump_index;
+			e->addpath = bgp_addpath_encode_rx(path->peer, afi,
+							   SAFI_UNICAST);
+			d->count++;
+		}
+	}
+}
+
+/*
+ * Encode the record for paths @first and onward of @d, as many as fit.
+ * Returns the first path not in the record.
+ */
+static unsigned int bgp_dump_rib_record(struct bgp_dump_rib *rib,
+					struct stream *obuf,
+					const struct bgp_dump_rib_dest *d,
+					unsigned int first, unsigned int seq)
+{
+	const struct bgp_dump_rib_path *e;
+	const struct prefix *p = &d->p;
+	unsigned int i = first;
+	uint16_t entry_count = 0;
+	bool addpath_capable;
 	size_t sizep;
 	size_t endp;
-	bool addpath_capable;
-	const struct prefix *p = bgp_dest_get_prefix(dest);
 
-	obuf = bgp_dump_obuf;
 	stream_reset(obuf);
 
-	addpath_capable = bgp_addpath_encode_rx(path->peer, afi, SAFI_UNICAST);
+	addpath_capable = rib->paths[d->first + first].addpath;
 
 	/* MRT header */
-	if (afi == AFI_IP && addpath_capable)
+	if (p->family == AF_INET && addpath_capable)
 		bgp_dump_header(obuf, MSG_TABLE_DUMP_V2,
 				TABLE_DUMP_V2_RIB_IPV4_UNICAST_ADDPATH,
 				BGP_DUMP_ROUTES);
-	else if (afi == AFI_IP)
+	else if (p->family == AF_INET)
 		bgp_dump_header(obuf, MSG_TABLE_DUMP_V2,
 				TABLE_DUMP_V2_RIB_IPV4_UNICAST,
 				BGP_DUMP_ROUTES);
-	else if (afi == AFI_IP6 && addpath_capable)
+	else if (addpath_capable)
 		bgp_dump_header(obuf, MSG_TABLE_DUMP_V2,
 				TABLE_DUMP_V2_RIB_IPV6_UNICAST_ADDPATH,
 				BGP_DUMP_ROUTES);
-	else if (afi == AFI_IP6)
+	else
 		bgp_dump_header(obuf, MSG_TABLE_DUMP_V2,
 				TABLE_DUMP_V2_RIB_IPV6_UNICAST,
 				BGP_DUMP_ROUTES);
@@ -331,46 +461,36 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	/* Prefix length */
 	stream_putc(obuf, p->prefixlen);
 
-	/* Prefix */
-	if (afi == AFI_IP) {
-		/* We'll dump only the useful bits (those not 0), but have to
-		 * align on 8 bits */
-		stream_write(obuf, (uint8_t *)&p->u.prefix4,
-			     (p->prefixlen + 7) / 8);
-	} else if (afi == AFI_IP6) {
-		/* We'll dump only the useful bits (those not 0), but have to
-		 * align on 8 bits */
-		stream_write(obuf, (uint8_t *)&p->u.prefix6,
-			     (p->prefixlen + 7) / 8);
-	}
+	/* Prefix.  We'll dump only the useful bits (those not 0), but have
+	 * to align on 8 bits
+	 */
+	stream_write(obuf, (uint8_t *)&p->u.prefix, (p->prefixlen + 7) / 8);
 
 	/* Save where we are now, so we can overwrite the entry count later */
 	sizep = stream_get_endp(obuf);
 
-	/* Entry count */
-	uint16_t entry_count = 0;
-
 	/* Entry count, note that this is overwritten later */
 	stream_putw(obuf, 0);
 
 	endp = stream_get_endp(obuf);
-	for (; path; path = path->next) {
+	for (; i < d->count; i++) {
 		size_t cur_endp;
 
+		e = &rib->paths[d->first + i];
+
 		/* Peer index */
-		stream_putw(obuf, path->peer->table_dump_index);
+		stream_putw(obuf, e->peer_index);
 
 		/* Originated */
-		stream_putl(obuf, time(NULL) - (monotime(NULL) - path->uptime));
+		stream_putl(obuf, e->originated);
 
 		/*Path Identifier*/
-		if (addpath_capable) {
-			stream_putl(obuf, path->addpath_rx_id);
-		}
+		if (addpath_capable)
+			stream_putl(obuf, e->addpath_rx_id);
 
 		/* Dump attribute. */
 		/* Skip prefix & AFI/SAFI for MP_NLRI */
-		bgp_dump_routes_attr(obuf, path, p);
+		bgp_dump_routes_attr(obuf, e->attr, p);
 
 		cur_endp = stream_get_endp(obuf);
 		if (cur_endp > BGP_STANDARD_MESSAGE_MAX_PACKET_SIZE
@@ -380,12 +500,12 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 			if (entry_count == 0) {
 				/* A single path's encoding exceeds the
 				 * per-record cap. Skip it so the caller's
-				 * while (path) loop makes forward progress.
+				 * loop makes forward progress.
 				 */
 				flog_warn(EC_BGP_DUMP,
-					  "%s: skipping oversized path for %pFX from peer %s",
-					  __func__, p, path->peer->host);
-				path = path->next;
+					  "%s: skipping oversized path for %pFX from peer index %u",
+					  __func__, p, e->peer_index);
+				i++;
 			}
 			break;
 		}
@@ -397,56 +517,145 @@ bgp_dump_route_node_record(int afi, struct bgp_dest *dest,
 	/* Skip emitting a zero-entry record: some MRT parsers treat them as
 	 * corrupt.
 	 */
-	if (entry_count == 0)
-		return path;
+	if (entry_count == 0) {
+		stream_reset(obuf);
+		return i;
+	}
 
 	/* Overwrite the entry count, now that we know the right number */
 	stream_putw_at(obuf, sizep, entry_count);
 
 	bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
-	fwrite(STREAM_DATA(obuf), stream_get_endp(obuf), 1, bgp_dump_routes.fp);
 
-	return path;
+	return i;
 }
 
+static void bgp_dump_rib_done(struct event *event)
+{
+	struct bgp_dump_rib *rib = EVENT_ARG(event);
+
+	if (rib->failed)
+		flog_warn(EC_BGP_DUMP, "%s: writing the RIB dump failed",
+			  __func__);
+
+	bdr.running = NULL;
+	bdr.dumps++;
+	bdr.last_time = time(NULL);
+	bdr.last_dests = rib->ndests;
+	bdr.last_paths = rib->npaths;
+	bdr.last_records = atomic_load_explicit(&rib->records,
+						memory_order_relaxed);
+	bdr.last_bytes = atomic_load_explicit(&rib->bytes, memory_order_relaxed);
+	bdr.last_snapshot_usec = rib->snapshot_usec;
+	bdr.last_write_usec = rib->write_usec;
+	bdr.last_failed = rib->failed;
+
+	bgp_dump_rib_free(rib);
+}
 
-/* Runs under child process. */
-static unsigned int bgp_dump_routes_func(int afi, int first_run,
-					 unsigned int seq)
+/* Runs on the dump pthread. */
+static void bgp_dump_rib_write(struct event *event)
 {
-	struct bgp_path_info *path;
-	struct bgp_dest *dest;
+	struct bgp_dump_rib *rib = EVENT_ARG(event);
+	const struct bgp_dump_rib_dest *d;
+	struct stream *obuf;
+	struct timeval start;
+	unsigned int seq = 0;
+	unsigned int i, next;
+	size_t len;
+
+	monotime(&start);
+	obuf = stream_new(BGP_MAX_PACKET_SIZE + BGP_MAX_PACKET_SIZE_OVERFLOW);
+
+	len = stream_get_endp(rib->index_table);
+	if (fwrite(STREAM_DATA(rib->index_table), len, 1, rib->fp) != 1)
+		rib->failed = true;
+	atomic_fetch_add_explicit(&rib->bytes, len, memory_order_relaxed);
+
+	for (i = 0; i < rib->ndests && !rib->failed; i++) {
+		if (atomic_load_explicit(&rib->abort, memory_order_relaxed))
+			break;
+
+		d = &rib->dests[i];
+		next = 0;
+		while (next < d->count) {
+			next = bgp_dump_rib_record(rib, obuf, d, next, seq++);
+
+			len = stream_get_endp(obuf);
+			if (!len)
+				continue;
+			if (fwrite(STREAM_DATA(obuf), len, 1, rib->fp) != 1) {
+				rib->failed = true;
+				break;
+			}
+			atomic_fetch_add_explicit(&rib->records, 1,
+						  memory_order_relaxed);
+			atomic_fetch_add_explicit(&rib->bytes, len,
+						  memory_order_relaxed);
+		}
+		atomic_store_explicit(&rib->dests_done, i + 1,
+				      memory_order_relaxed);
+	}
+
+	if (fclose(rib->fp))
+		rib->failed = true;
+	rib->fp = NULL;
+	stream_free(obuf);
+
+	rib->write_usec = monotime_since(&start, NULL);
+
+	event_add_event(bm->master, bgp_dump_rib_done, rib, 0, NULL);
+}
+
+/* Takes over @fp. */
+static void bgp_dump_rib_start(FILE *fp)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct bgp_dump_rib *rib;
+	struct timeval start;
 	struct bgp *bgp;
-	struct bgp_table *table;
 
 	bgp = bgp_get_default();
-	if (!bgp)
-		return seq;
+	if (!bgp) {
+		fclose(fp);
+		return;
+	}
 
-	if (bgp_dump_routes.fp == NULL)
-		return seq;
+	if (bdr.running) {
+		flog_warn(EC_BGP_DUMP,
+			  "%s: previous RIB dump still in progress, skipping this one",
+			  __func__);
+		bdr.skipped++;
+		fclose(fp);
+		return;
+	}
 
-	/* Note that bgp_dump_routes_index_table will do ipv4 and ipv6 peers,
-	   so this should only be done on the first call to
-	   bgp_dump_routes_func.
-	   ( this function will be called once for ipv4 and once for ipv6 ) */
-	if (first_run)
-		bgp_dump_routes_index_table(bgp);
+	monotime(&start);
 
-	/* Walk down each BGP route. */
-	table = bgp->rib[afi][SAFI_UNICAST];
+	rib = XCALLOC(MTYPE_BGP_DUMP_RIB, sizeof(*rib));
+	rib->fp = fp;
+	rib->index_table =
+		stream_new(BGP_MAX_PACKET_SIZE + BGP_MAX_PACKET_SIZE_OVERFLOW);
+	bgp_dump_routes_index_table(bgp, rib->index_table);
 
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
-		path = bgp_dest_get_bgp_path_info(dest);
-		while (path) {
-			path = bgp_dump_route_node_record(afi, dest, path, seq);
-			seq++;
-		}
-	}
+	bgp_dump_rib_snapshot_table(rib, bgp->rib[AFI_IP][SAFI_UNICAST],
+				    AFI_IP);
+	bgp_dump_rib_snapshot_table(rib, bgp->rib[AFI_IP6][SAFI_UNICAST],
+				    AFI_IP6);
+
+	rib->snapshot_usec = monotime_since(&start, NULL);
 
-	fflush(bgp_dump_routes.fp);
+	if (!bdr.fpt) {
+		bdr.fpt = frr_pthread_new(&attr, "BGP MRT dump", "bgpd_dump");
+		frr_pthread_run(bdr.fpt, NULL);
+		frr_pthread_wait_running(bdr.fpt);
+	}
 
-	return seq;
+	bdr.running = rib;
+	event_add_event(bdr.fpt->master, bgp_dump_rib_write, rib, 0, NULL);
 }
 
 static void bgp_dump_interval_func(struct event *t)
@@ -456,15 +665,12 @@ static void bgp_dump_interval_func(struct event *t)
 
 	/* Reschedule dump even if file couldn't be opened this time... */
 	if (bgp_dump_open_file(bgp_dump) != NULL) {
-		/* In case of bgp_dump_routes, we need special route dump
-		 * function. */
+		/* In case of bgp_dump_routes, the file is handed over to the
+		 * dump pthread.  For a RIB dump there's no point in leaving
+		 * it open until the next scheduled dump starts.
+		 */
 		if (bgp_dump->type == BGP_DUMP_ROUTES) {
-			unsigned int seq = bgp_dump_routes_func(AFI_IP, 1, 0);
-			bgp_dump_routes_func(AFI_IP6, 0, seq);
-			/* Close the file now. For a RIB dump there's no point
-			 * in leaving
-			 * it open until the next scheduled dump starts. */
-			fclose(bgp_dump->fp);
+			bgp_dump_rib_start(bgp_dump->fp);
 			bgp_dump->fp = NULL;
 		}
 	}
@@ -805,12 +1011,145 @@ DEFUN (no_dump_bgp_all,
 	case BGP_DUMP_ROUTES:
 	default:
 		bgp_dump_struct = &bgp_dump_routes;
+		/* Stop writing a RIB dump in progress, it is released as
+		 * usual.
+		 */
+		if (bdr.running)
+			atomic_store_explicit(&bdr.running->abort, true,
+					      memory_order_relaxed);
 		break;
 	}
 
 	return bgp_dump_unset(bgp_dump_struct);
 }
 
+static const char *bgp_dump_type_str(enum bgp_dump_type type)
+{
+	const struct bgp_dump_type_map *map;
+
+	for (map = bgp_dump_type_map; map->str; map++)
+		if (map->type == type)
+			return map->str;
+	return "unknown";
+}
+
+static void bgp_dump_show_one(struct vty *vty, json_object *json,
+			      const struct bgp_dump *bgp_dump)
+{
+	json_object *json_dump;
+
+	if (!bgp_dump->filename)
+		return;
+
+	if (json) {
+		json_dump = json_object_new_object();
+		json_object_string_add(json_dump, "filename",
+				       bgp_dump->filename);
+		if (bgp_dump->interval_str)
+			json_object_string_add(json_dump, "interval",
+					       bgp_dump->interval_str);
+		if (bgp_dump->t_interval)
+			json_object_int_add(json_dump, "nextDumpSecs",
+					    event_timer_remain_second(
+						    bgp_dump->t_interval));
+		json_object_object_add(json, bgp_dump_type_str(bgp_dump->type),
+				       json_dump);
+	} else {
+		vty_out(vty, "Dump %s to %s", bgp_dump_type_str(bgp_dump->type),
+			bgp_dump->filename);
+		if (bgp_dump->interval_str)
+			vty_out(vty, ", interval %s", bgp_dump->interval_str);
+		if (bgp_dump->t_interval)
+			vty_out(vty, ", next in %lu seconds",
+				event_timer_remain_second(bgp_dump->t_interval));
+		vty_out(vty, "\n");
+	}
+}
+
+DEFUN (show_dump,
+       show_dump_cmd,
+       "show dump [json]",
+       SHOW_STR
+       "BGP packet and RIB dumps\n"
+       JSON_STR)
+{
+	struct bgp_dump_rib *rib = bdr.running;
+	bool uj = use_json(argc, argv);
+	json_object *json = NULL, *json_rib;
+	unsigned int dests_done = 0, records = 0;
+	uint64_t bytes = 0;
+
+	if (uj)
+		json = json_object_new_object();
+
+	bgp_dump_show_one(vty, json, &bgp_dump_all);
+	bgp_dump_show_one(vty, json, &bgp_dump_updates);
+	bgp_dump_show_one(vty, json, &bgp_dump_routes);
+
+	if (rib) {
+		dests_done = atomic_load_explicit(&rib->dests_done,
+						  memory_order_relaxed);
+		records = atomic_load_explicit(&rib->records,
+					       memory_order_relaxed);
+		bytes = atomic_load_explicit(&rib->bytes, memory_order_relaxed);
+	}
+
+	if (uj) {
+		json_rib = json_object_new_object();
+		json_object_int_add(json_rib, "dumps", bdr.dumps);
+		json_object_int_add(json_rib, "skipped", bdr.skipped);
+		json_object_boolean_add(json_rib, "inProgress", !!rib);
+		if (rib) {
+			json_object_int_add(json_rib, "prefixes", rib->ndests);
+			json_object_int_add(json_rib, "prefixesDone",
+					    dests_done);
+			json_object_int_add(json_rib, "records", records);
+			json_object_int_add(json_rib, "bytes", bytes);
+		}
+		if (bdr.dumps) {
+			json_object_int_add(json_rib, "lastPrefixes",
+					    bdr.last_dests);
+			json_object_int_add(json_rib, "lastPaths",
+					    bdr.last_paths);
+			json_object_int_add(json_rib, "lastRecords",
+					    bdr.last_records);
+			json_object_int_add(json_rib, "lastBytes",
+					    bdr.last_bytes);
+			json_object_int_add(json_rib, "lastSnapshotUsec",
+					    bdr.last_snapshot_usec);
+			json_object_int_add(json_rib, "lastWriteUsec",
+					    bdr.last_write_usec);
+			json_object_boolean_add(json_rib, "lastFailed",
+						bdr.last_failed);
+			json_object_int_add(json_rib, "lastDumpSecs",
+					    time(NULL) - bdr.last_time);
+		}
+		json_object_object_add(json, "ribDumps", json_rib);
+		return vty_json(vty, json);
+	}
+
+	vty_out(vty, "RIB dumps: %" PRIu64 " done, %" PRIu64
+		" skipped while another one was in progress\n",
+		bdr.dumps, bdr.skipped);
+	if (rib)
+		vty_out(vty,
+			"  In progress: %u of %u prefixes, %u records, %" PRIu64
+			" bytes written\n",
+			dests_done, rib->ndests, records, bytes);
+	if (bdr.dumps)
+		vty_out(vty,
+			"  Last: %u prefixes, %u paths, %u records, %" PRIu64
+			" bytes, snapshot %" PRId64 " ms, write %" PRId64
+			" ms, %lld seconds ago%s\n",
+			bdr.last_dests, bdr.last_paths, bdr.last_records,
+			bdr.last_bytes, bdr.last_snapshot_usec / 1000,
+			bdr.last_write_usec / 1000,
+			(long long)(time(NULL) - bdr.last_time),
+			bdr.last_failed ? " (failed)" : "");
+
+	return CMD_SUCCESS;
+}
+
 static int config_write_bgp_dump(struct vty *vty);
 /* BGP node structure. */
 static struct cmd_node bgp_dump_node = {
@@ -874,6 +1213,7 @@ void bgp_dump_init(void)
 
 	install_element(CONFIG_NODE, &dump_bgp_all_cmd);
 	install_element(CONFIG_NODE, &no_dump_bgp_all_cmd);
+	install_element(VIEW_NODE, &show_dump_cmd);
 
 	hook_register(bgp_packet_dump, bgp_dump_packet);
 	hook_register(peer_status_changed, bgp_dump_state);
@@ -885,6 +1225,21 @@ void bgp_dump_finish(void)
 	bgp_dump_unset(&bgp_dump_updates);
 	bgp_dump_unset(&bgp_dump_routes);
 
+	if (bdr.running)
+		atomic_store_explicit(&bdr.running->abort, true,
+				      memory_order_relaxed);
+	if (bdr.fpt) {
+		frr_pthread_stop(bdr.fpt, NULL);
+		frr_pthread_destroy(bdr.fpt);
+		bdr.fpt = NULL;
+	}
+	/* the dump pthread is gone, release what it was working on */
+	if (bdr.running) {
+		event_cancel_event(bm->master, bdr.running);
+		bgp_dump_rib_free(bdr.running);
+		bdr.running = NULL;
+	}
+
 	stream_free(bgp_dump_obuf);
 	bgp_dump_obuf = NULL;
 	hook_unregister(bgp_packet_dump, bgp_dump_packet);
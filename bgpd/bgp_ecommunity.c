@@ -19,6 +19,7 @@
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_encap_types.h"
 #include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_flowspec_private.h"
@@ -31,7 +32,7 @@ union traffic_rate {
 };
 
 /* Hash of community attribute. */
-static struct hash *ecomhash;
+static struct bgp_intern_table *ecomhash;
 
 /* Allocate a new ecommunities.  */
 struct ecommunity *ecommunity_new(void)
@@ -353,44 +354,40 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 	return ecom1;
 }
 
+/* Make the string before the ecommunity becomes visible to other users. */
+static void *ecommunity_intern_alloc(void *arg)
+{
+	struct ecommunity *ecom = arg;
+
+	if (!ecom->str)
+		ecom->str =
+			ecommunity_ecom2str(ecom, ECOMMUNITY_FORMAT_DISPLAY, 0);
+
+	return ecom;
+}
+
 /* Intern Extended Communities Attribute.  */
 struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 {
 	struct ecommunity *find;
 
 	assert(ecom->refcnt == 0);
-	find = (struct ecommunity *)hash_get(ecomhash, ecom, hash_alloc_intern);
+	find = bgp_intern_get(ecomhash, ecom, ecommunity_intern_alloc, NULL);
 	if (find != ecom)
 		ecommunity_free(&ecom);
 
-	find->refcnt++;
-
-	if (!find->str)
-		find->str =
-			ecommunity_ecom2str(find, ECOMMUNITY_FORMAT_DISPLAY, 0);
-
 	return find;
 }
 
 /* Unintern Extended Communities Attribute.  */
 void ecommunity_unintern(struct ecommunity **ecom)
 {
-	struct ecommunity *ret;
-
 	if (!*ecom)
 		return;
 
-	if ((*ecom)->refcnt)
-		(*ecom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*ecom)->refcnt == 0) {
-		/* Extended community must be in the hash.  */
-		ret = (struct ecommunity *)hash_release(ecomhash, *ecom);
-		assert(ret != NULL);
-
+	/* Pull off from hash when the last reference is gone.  */
+	if (bgp_intern_put(ecomhash, *ecom))
 		ecommunity_free(ecom);
-	}
 }
 
 /* Utinity function to make hash key.  */
@@ -447,13 +444,14 @@ static void ecommunity_color_str(char *buf, size_t bufsz, uint8_t *ptr)
 /* Initialize Extended Comminities related hash. */
 void ecommunity_init(void)
 {
-	ecomhash = hash_create(ecommunity_hash_make, ecommunity_cmp,
-			       "BGP ecommunity hash");
+	ecomhash = bgp_intern_table_new("BGP ecommunity hash", 0,
+					ecommunity_hash_make, ecommunity_cmp,
+					struct ecommunity, refcnt);
 }
 
 void ecommunity_finish(void)
 {
-	hash_clean_and_free(&ecomhash, (void (*)(void *))ecommunity_hash_free);
+	bgp_intern_table_free(&ecomhash, (void (*)(void *))ecommunity_hash_free);
 }
 
 /* Extended Communities token enum. */
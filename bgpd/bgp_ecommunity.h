@@ -154,7 +154,7 @@ enum ecommunity_origin_validation_states {
  */
 struct ecommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 
 	/* Size in octets of each value in val, i.e. the size of one unit:
 	 * ECOMMUNITY_SIZE for regular values, IPV6_ECOMMUNITY_SIZE for IPv6
@@ -4387,25 +4387,26 @@ static int install_uninstall_routes_for_vrf(struct bgp *bgp_vrf, bool install)
 	return 0;
 }
 
-#define BGP_PROC_L2VNI_LIMIT 10
-static int install_evpn_remote_route_per_l2vni(struct bgp *bgp, struct bgp_path_info *pi,
-					       const struct prefix_evpn *evp)
+/*
+ * Pending L2VNIs handled per walk of the global table.  The VNIs a route
+ * goes into are found from its RTs through the import RT hashes, so the
+ * cost of a walk hardly depends on how many VNIs it handles.
+ */
+#define BGP_PROC_L2VNI_LIMIT 256
+
+static int install_evpn_remote_route_in_l2vnis(struct bgp *bgp, struct list *vnis,
+					       struct bgp_path_info *pi,
+					       const struct prefix_evpn *evp, uint32_t seq)
 {
-	int ret = 0;
-	uint8_t vni_iter = 0;
-	struct bgpevpn *t_vpn = NULL;
-	struct bgpevpn *t_vpn_next = NULL;
-
-	for (t_vpn = zebra_l2_vni_first(&bm->zebra_l2_vni_head);
-	     t_vpn && vni_iter < BGP_PROC_L2VNI_LIMIT; t_vpn = t_vpn_next) {
-		t_vpn_next = zebra_l2_vni_next(&bm->zebra_l2_vni_head, t_vpn);
-		vni_iter++;
-		/*
-		 * Skip install/uninstall if the route entry is not needed to
-		 * be imported into the VNI i.e. RTs dont match
-		 */
-		if (!is_route_matching_for_vni(bgp, t_vpn, pi))
+	struct listnode *node, *nnode;
+	struct bgpevpn *t_vpn;
+	int ret;
+
+	for (ALL_LIST_ELEMENTS(vnis, node, nnode, t_vpn)) {
+		/* only the VNIs of this walk, once per route */
+		if (!CHECK_FLAG(t_vpn->flags, VNI_FLAG_ADD_WALK) || t_vpn->add_walk_seq == seq)
 			continue;
+		t_vpn->add_walk_seq = seq;
 
 		ret = install_evpn_route_entry(bgp, t_vpn, evp, pi);
 
@@ -4414,6 +4415,7 @@ static int install_evpn_remote_route_per_l2vni(struct bgp *bgp, struct bgp_path_
 				 "%u: Failed to install EVPN %s route in VNI %u during BP",
 				 bgp->vrf_id, bgp_evpn_route_type_str[evp->prefix.route_type].str,
 				 t_vpn->vni);
+			UNSET_FLAG(t_vpn->flags, VNI_FLAG_ADD | VNI_FLAG_ADD_WALK);
 			zebra_l2_vni_del(&bm->zebra_l2_vni_head, t_vpn);
 
 			return ret;
@@ -4423,6 +4425,80 @@ static int install_evpn_remote_route_per_l2vni(struct bgp *bgp, struct bgp_path_
 	return 0;
 }
 
+static int install_evpn_remote_route_per_l2vni(struct bgp *bgp, struct bgp_path_info *pi,
+					       const struct prefix_evpn *evp)
+{
+	static uint32_t seq;
+	struct ecommunity *ecom;
+	uint32_t i;
+	int ret;
+
+	if (!bgp_attr_exists(pi->attr, BGP_ATTR_EXT_COMMUNITIES))
+		return 0;
+
+	ecom = bgp_attr_get_ecommunity(pi->attr);
+	if (!ecom || !ecom->size)
+		return 0;
+
+	/* never 0, which new VNIs start with */
+	if (!++seq)
+		seq++;
+
+	/* cf. is_route_matching_for_vni() */
+	for (i = 0; i < ecom->size; i++) {
+		uint8_t *pnt;
+		uint8_t type, sub_type;
+		struct ecommunity_val *eval;
+		uint32_t local_admin_nbo;
+		struct bgp_evpn_l2vni_fq_irt_node *fq_irt;
+		struct bgp_evpn_l2vni_wildcard_irt_node *wildcard_irt;
+
+		/* Only deal with RTs */
+		pnt = (ecom->val + (i * ecom->unit_size));
+		eval = (struct ecommunity_val *)(ecom->val + (i * ecom->unit_size));
+		type = *pnt++;
+		sub_type = *pnt++;
+		if (sub_type != ECOMMUNITY_ROUTE_TARGET)
+			continue;
+
+		fq_irt = bgp_evpn_lookup_l2vni_fq_irt_node(bgp, eval);
+		if (fq_irt) {
+			ret = install_evpn_remote_route_in_l2vnis(bgp, fq_irt->vnis, pi, evp, seq);
+			if (ret)
+				return ret;
+		}
+
+		if (bgp_evpn_wildcard_rt_local_admin_from_eval(type, eval, &local_admin_nbo)) {
+			wildcard_irt = bgp_evpn_lookup_l2vni_wildcard_irt_node(bgp,
+									       local_admin_nbo);
+			if (wildcard_irt) {
+				ret = install_evpn_remote_route_in_l2vnis(bgp, wildcard_irt->vnis,
+									  pi, evp, seq);
+				if (ret)
+					return ret;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Mark, or unmark, the pending L2VNIs the next walk is for */
+static void install_evpn_remote_routes_l2vni_mark(bool mark)
+{
+	struct bgpevpn *t_vpn;
+	uint32_t count = 0;
+
+	frr_each (zebra_l2_vni, &bm->zebra_l2_vni_head, t_vpn) {
+		if (mark && count++ >= BGP_PROC_L2VNI_LIMIT)
+			break;
+		if (mark)
+			SET_FLAG(t_vpn->flags, VNI_FLAG_ADD_WALK);
+		else
+			UNSET_FLAG(t_vpn->flags, VNI_FLAG_ADD_WALK);
+	}
+}
+
 /*
  * Install or uninstall routes of specified type that are appropriate for this
  * particular VNI.
@@ -4435,7 +4511,7 @@ int install_uninstall_routes_for_vni(struct bgp *bgp, struct bgpevpn *vpn, bool
 	struct bgp_table *table;
 	struct bgp_path_info *pi;
 	int ret = 0;
-	uint8_t count = 0;
+	uint32_t count = 0;
 	bool walk_fifo = false;
 
 	afi = AFI_L2VPN;
@@ -4454,6 +4530,9 @@ int install_uninstall_routes_for_vni(struct bgp *bgp, struct bgpevpn *vpn, bool
 	if (BGP_DEBUG(zebra, ZEBRA))
 		zlog_debug("%s: Total %u L2VNI VPNs pending to be processed for remote route installation",
 			   __func__, (uint32_t)zebra_l2_vni_count(&bm->zebra_l2_vni_head));
+
+	if (walk_fifo)
+		install_evpn_remote_routes_l2vni_mark(true);
 	/*
 	 * Walk entire global routing table and evaluate routes which could be
 	 * imported into this VPN. Note that we cannot just look at the routes
@@ -4500,6 +4579,7 @@ int install_uninstall_routes_for_vni(struct bgp *bgp, struct bgpevpn *vpn, bool
 				if (walk_fifo) {
 					ret = install_evpn_remote_route_per_l2vni(bgp, pi, evp);
 					if (ret) {
+						install_evpn_remote_routes_l2vni_mark(false);
 						bgp_dest_unlock_node(rd_dest);
 						bgp_dest_unlock_node(dest);
 						return ret;
@@ -4542,7 +4622,7 @@ int install_uninstall_routes_for_vni(struct bgp *bgp, struct bgpevpn *vpn, bool
 			if (!vpn)
 				return 0;
 
-			UNSET_FLAG(vpn->flags, VNI_FLAG_ADD);
+			UNSET_FLAG(vpn->flags, VNI_FLAG_ADD | VNI_FLAG_ADD_WALK);
 			count++;
 		}
 	}
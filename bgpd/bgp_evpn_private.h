@@ -71,6 +71,11 @@ struct bgpevpn {
 /* Attach both L2-VNI and L3-VNI if needed for this VPN */
 #define VNI_FLAG_USE_TWO_LABELS 0x20
 #define VNI_FLAG_ADD		0x40 /* L2VNI Add */
+/* L2VNI Add being processed by the current walk of the global table */
+#define VNI_FLAG_ADD_WALK	0x80
+
+	/* Last remote route checked for import during an L2VNI Add walk */
+	uint32_t add_walk_seq;
 
 	struct bgp *bgp_vrf; /* back pointer to the vrf instance */
 
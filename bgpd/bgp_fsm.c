@@ -40,6 +40,7 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_zebra.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_trace.h"
@@ -577,9 +578,7 @@ static void bgp_holdtime_timer(struct event *event)
 	 * for systems where we are heavily loaded for one
 	 * reason or another.
 	 */
-	frr_with_mutex (&connection->io_mtx) {
-		inq_count = atomic_load_explicit(&connection->ibuf->count, memory_order_relaxed);
-	}
+	inq_count = bgp_inq_count(connection->ibuf);
 	if (inq_count) {
 		BGP_TIMER_ON(connection->t_holdtime, bgp_holdtime_timer,
 			     peer->v_holdtime);
@@ -2268,9 +2267,9 @@ enum bgp_fsm_state_progress bgp_stop(struct peer_connection *connection)
 	/* Clear input and output buffer.  */
 	frr_with_mutex (&connection->io_mtx) {
 		if (connection->ibuf)
-			stream_fifo_clean(connection->ibuf);
+			bgp_inq_clean(connection->ibuf);
 		if (connection->obuf)
-			stream_fifo_clean(connection->obuf);
+			bgp_obuf_clean(connection->obuf);
 
 		if (connection->ibuf_work) {
 			ringbuf_del(connection->ibuf_work);
@@ -2281,6 +2280,7 @@ enum bgp_fsm_state_progress bgp_stop(struct peer_connection *connection)
 			stream_free(connection->curr);
 			connection->curr = NULL;
 		}
+		bgp_parse_job_free(&connection->curr_job);
 	}
 
 	/* Close of file descriptor. */
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP intern store.
+ * Lock-striped hash of reference counted, deduplicated attribute values
+ * that may be interned and released from any pthread.
+ */
+
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "hash.h"
+#include "memory.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_intern.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_INTERN_TABLE, "BGP intern table");
+
+/* Per-shard initial size when no hint is given */
+#define BGP_INTERN_SHARD_SIZE_DEFAULT 64
+
+static inline _Atomic unsigned long *
+bgp_intern_refcnt(const struct bgp_intern_table *tbl, void *data)
+{
+	return (_Atomic unsigned long *)((char *)data + tbl->refcnt_offset);
+}
+
+static inline struct bgp_intern_shard *
+bgp_intern_shard(struct bgp_intern_table *tbl, const void *data)
+{
+	unsigned int key = tbl->hash_key(data);
+
+	return &tbl->shards[key >> (32 - BGP_INTERN_SHARD_BITS)];
+}
+
+struct bgp_intern_table *
+_bgp_intern_table_new(const char *name, unsigned int size,
+		      unsigned int (*hash_key)(const void *),
+		      bool (*cmp)(const void *, const void *),
+		      size_t refcnt_offset)
+{
+	struct bgp_intern_table *tbl;
+	unsigned int shard_size;
+	unsigned int i;
+
+	shard_size = size / BGP_INTERN_SHARDS;
+	if (shard_size < BGP_INTERN_SHARD_SIZE_DEFAULT)
+		shard_size = BGP_INTERN_SHARD_SIZE_DEFAULT;
+
+	tbl = XCALLOC(MTYPE_BGP_INTERN_TABLE, sizeof(*tbl));
+	tbl->name = name;
+	tbl->hash_key = hash_key;
+	tbl->refcnt_offset = refcnt_offset;
+
+	for (i = 0; i < BGP_INTERN_SHARDS; i++) {
+		pthread_mutex_init(&tbl->shards[i].mtx, NULL);
+		tbl->shards[i].hash =
+			hash_create_size(shard_size, hash_key, cmp, name);
+	}
+
+	return tbl;
+}
+
+void bgp_intern_table_free(struct bgp_intern_table **ptbl,
+			   void (*free_func)(void *))
+{
+	struct bgp_intern_table *tbl = *ptbl;
+	unsigned int i;
+
+	if (!tbl)
+		return;
+
+	for (i = 0; i < BGP_INTERN_SHARDS; i++) {
+		hash_clean_and_free(&tbl->shards[i].hash, free_func);
+		pthread_mutex_destroy(&tbl->shards[i].mtx);
+	}
+
+	XFREE(MTYPE_BGP_INTERN_TABLE, *ptbl);
+}
+
+void *bgp_intern_get(struct bgp_intern_table *tbl, void *data,
+		     void *(*alloc)(void *), bool *found)
+{
+	struct bgp_intern_shard *shard = bgp_intern_shard(tbl, data);
+	unsigned long prev;
+	void *ret;
+
+	/*
+	 * New references are only ever taken with the shard lock held, so an
+	 * entry whose count has dropped to zero (and is about to be removed
+	 * by bgp_intern_put()) can never be resurrected.
+	 */
+	frr_with_mutex (&shard->mtx) {
+		ret = hash_get(shard->hash, data, alloc);
+		prev = atomic_fetch_add_explicit(bgp_intern_refcnt(tbl, ret), 1,
+						 memory_order_relaxed);
+	}
+
+	if (found)
+		*found = (prev != 0);
+
+	return ret;
+}
+
+bool bgp_intern_put(struct bgp_intern_table *tbl, void *data)
+{
+	_Atomic unsigned long *refcnt = bgp_intern_refcnt(tbl, data);
+	struct bgp_intern_shard *shard;
+	unsigned long prev;
+	void *ret;
+
+	/* Fast path: not the last reference, no need to touch the shard. */
+	prev = atomic_load_explicit(refcnt, memory_order_relaxed);
+	while (prev > 1) {
+		if (atomic_compare_exchange_weak_explicit(refcnt, &prev,
+							  prev - 1,
+							  memory_order_release,
+							  memory_order_relaxed))
+			return false;
+	}
+
+	shard = bgp_intern_shard(tbl, data);
+
+	frr_with_mutex (&shard->mtx) {
+		/*
+		 * Someone may have taken a new reference before we got the
+		 * lock, or dropped one through the fast path; the count can
+		 * only go from 1 to 0 in here.
+		 */
+		prev = atomic_load_explicit(refcnt, memory_order_acquire);
+		while (prev > 1) {
+			if (atomic_compare_exchange_weak_explicit(
+				    refcnt, &prev, prev - 1,
+				    memory_order_release, memory_order_relaxed))
+				return false;
+		}
+
+		atomic_store_explicit(refcnt, 0, memory_order_relaxed);
+
+		/* This entry must exist in the table. */
+		ret = hash_release(shard->hash, data);
+		assert(ret != NULL);
+	}
+
+	return true;
+}
+
+unsigned long bgp_intern_count(struct bgp_intern_table *tbl)
+{
+	unsigned long count = 0;
+	unsigned int i;
+
+	for (i = 0; i < BGP_INTERN_SHARDS; i++)
+		frr_with_mutex (&tbl->shards[i].mtx)
+			count += tbl->shards[i].hash->count;
+
+	return count;
+}
+
+void bgp_intern_iterate(struct bgp_intern_table *tbl,
+			void (*func)(struct hash_bucket *, void *), void *arg)
+{
+	unsigned int i;
+
+	for (i = 0; i < BGP_INTERN_SHARDS; i++)
+		frr_with_mutex (&tbl->shards[i].mtx)
+			hash_iterate(tbl->shards[i].hash, func, arg);
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP intern store.
+ * Lock-striped hash of reference counted, deduplicated attribute values
+ * that may be interned and released from any pthread.
+ */
+
+#ifndef _FRR_BGP_INTERN_H
+#define _FRR_BGP_INTERN_H
+
+#include "frratomic.h"
+#include "hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Used by the AS path and (extended/large) community tables.  The table
+ * itself may be used from any pthread, but what an entry's alloc callback
+ * reads is up to its user: interning a new (large) community builds its
+ * string with the community aliases, which are main pthread only, so only
+ * AS paths are interned by the UPDATE parse workers.  attrhash and the other
+ * attribute side tables are plain lib/hash.c tables and must only be used
+ * from the main pthread.
+ *
+ * The table is split into 2^BGP_INTERN_SHARD_BITS shards, each one a
+ * regular lib/hash.c table protected by its own mutex.  The shard is chosen
+ * from the top bits of the hash key, the lower bits are left to the shard's
+ * own hash table.
+ */
+#define BGP_INTERN_SHARD_BITS 6
+#define BGP_INTERN_SHARDS (1U << BGP_INTERN_SHARD_BITS)
+
+struct bgp_intern_shard {
+	pthread_mutex_t mtx;
+	struct hash *hash;
+} __attribute__((aligned(64)));
+
+struct bgp_intern_table {
+	const char *name;
+	unsigned int (*hash_key)(const void *data);
+
+	/* offset of the "_Atomic unsigned long" refcount in the entries */
+	size_t refcnt_offset;
+
+	struct bgp_intern_shard shards[BGP_INTERN_SHARDS];
+};
+
+/*
+ * Create an intern table for entries of @type, using @type.@field as the
+ * reference count.  @size is a hint for the total number of entries and
+ * must be a power of two (or 0 for the default.)
+ */
+#define bgp_intern_table_new(name, size, hash_key, cmp, type, field)             \
+	_bgp_intern_table_new(name, size, hash_key, cmp, offsetof(type, field))
+
+extern struct bgp_intern_table *
+_bgp_intern_table_new(const char *name, unsigned int size,
+		      unsigned int (*hash_key)(const void *),
+		      bool (*cmp)(const void *, const void *),
+		      size_t refcnt_offset);
+
+/*
+ * Release the table.  Entries still present are passed to @free_func, if
+ * given.  No other pthread may be using the table at this point.
+ */
+extern void bgp_intern_table_free(struct bgp_intern_table **tbl,
+				  void (*free_func)(void *));
+
+/*
+ * Look up @data in the table and take a reference on the result.  If there
+ * is no equal entry yet, @alloc is called (with the shard lock held) to
+ * produce the one to insert.  @found, if non-NULL, is set to whether an
+ * already existing entry was returned.
+ */
+extern void *bgp_intern_get(struct bgp_intern_table *tbl, void *data,
+			    void *(*alloc)(void *), bool *found);
+
+/*
+ * Drop a reference on an interned entry.  Returns true if this was the last
+ * reference, in which case the entry has been removed from the table and
+ * must be freed by the caller.
+ */
+extern bool bgp_intern_put(struct bgp_intern_table *tbl, void *data);
+
+/* Number of entries, not a snapshot if other pthreads are interning. */
+extern unsigned long bgp_intern_count(struct bgp_intern_table *tbl);
+
+/*
+ * Walk all entries, one shard at a time with that shard's lock held.
+ * @func must not intern into or release from the same table.
+ */
+extern void bgp_intern_iterate(struct bgp_intern_table *tbl,
+			       void (*func)(struct hash_bucket *, void *),
+			       void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_BGP_INTERN_H */
@@ -14,20 +14,27 @@
 #include "linklist.h"		// for list_delete, list_delete_all_node, lis...
 #include "log.h"		// for zlog_debug, safe_strerror, zlog_err
 #include "memory.h"		// for MTYPE_TMP, XCALLOC, XFREE
+#include "monotime.h"		// for monotime, monotime_since
 #include "network.h"		// for ERRNO_IO_RETRY
 #include "stream.h"		// for stream_get_endp, stream_getw_from, str...
 #include "ringbuf.h"		// for ringbuf_remain, ringbuf_peek, ringbuf_...
 #include "frrevent.h"		// for event, EVENT_ARG, thread...
+#include "vty.h"		// for vty_out
+#include "lib/json.h"		// for json_object_new_object, json_obj...
 
 #include "bgpd/bgp_io.h"
 #include "bgpd/bgp_debug.h"	// for bgp_debug_neighbor_events, bgp_type_str
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
 #include "bgpd/bgp_packet.h"	// for bgp_notify_io_invalid...
+#include "bgpd/bgp_parse.h"	// for bgp_parse_enqueue
 #include "bgpd/bgp_trace.h"	// for frrtraces
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_INQ, "BGP input queue");
+DEFINE_MTYPE_STATIC(BGPD, BGP_INQ_SEG, "BGP input queue segment");
+
 /* forward declarations */
 static uint16_t bgp_write(struct peer_connection *connection);
 static uint16_t bgp_read(struct peer_connection *connection, int *code_p);
@@ -39,6 +46,282 @@ static bool validate_header(struct peer_connection *connection);
 #define BGP_IO_TRANS_ERR (1 << 0) /* EAGAIN or similar occurred */
 #define BGP_IO_FATAL_ERR (1 << 1) /* some kind of fatal TCP error */
 
+/* Statistics -------------------------------------------------------------- */
+
+/* Histogram buckets: 0, 1, 2-3, 4-7, ..., and everything above */
+#define BGP_IO_HIST_BUCKETS 20
+
+struct bgp_io_hist {
+	_Atomic uint64_t count[BGP_IO_HIST_BUCKETS];
+};
+
+static struct bgp_io_stats {
+	/* written by the I/O pthread */
+	struct bgp_io_hist inq_batch;	/* packets queued per read event */
+	struct bgp_io_hist mtx_wait;	/* usec waited for a contended io_mtx */
+	_Atomic uint64_t wakeups;	/* main pthread told about a connection */
+	_Atomic uint64_t wakeups_saved; /* ... that it already knew about */
+
+	/* written by the main pthread */
+	struct bgp_io_hist inq_latency; /* usec from framing to processing */
+} bio_stats;
+
+static void bgp_io_hist_add(struct bgp_io_hist *hist, uint64_t val)
+{
+	unsigned int bucket = val ? 64 - __builtin_clzll(val) : 0;
+
+	if (bucket >= BGP_IO_HIST_BUCKETS)
+		bucket = BGP_IO_HIST_BUCKETS - 1;
+
+	atomic_fetch_add_explicit(&hist->count[bucket], 1, memory_order_relaxed);
+}
+
+static void bgp_io_hist_show(struct vty *vty, json_object *json, const char *name,
+			     const char *unit, struct bgp_io_hist *hist)
+{
+	json_object *json_hist = NULL;
+	char range[32];
+	uint64_t count;
+
+	if (json)
+		json_hist = json_object_new_object();
+	else
+		vty_out(vty, "  %-20s %12s\n", unit, "Count");
+
+	for (unsigned int i = 0; i < BGP_IO_HIST_BUCKETS; i++) {
+		count = atomic_load_explicit(&hist->count[i], memory_order_relaxed);
+		if (!count)
+			continue;
+
+		if (i == 0)
+			snprintf(range, sizeof(range), "0");
+		else if (i == 1)
+			snprintf(range, sizeof(range), "1");
+		else if (i == BGP_IO_HIST_BUCKETS - 1)
+			snprintf(range, sizeof(range), "%llu+", 1ULL << (i - 1));
+		else
+			snprintf(range, sizeof(range), "%llu-%llu", 1ULL << (i - 1),
+				 (1ULL << i) - 1);
+
+		if (json)
+			json_object_int_add(json_hist, range, count);
+		else
+			vty_out(vty, "  %-20s %12" PRIu64 "\n", range, count);
+	}
+
+	if (json)
+		json_object_object_add(json, name, json_hist);
+}
+
+/*
+ * Take io_mtx on the I/O pthread.  The main pthread holds it only to queue
+ * output and to clean a connection's queues, record how long that delayed us.
+ */
+static void bgp_io_lock(struct peer_connection *connection)
+{
+	struct timeval start;
+
+	if (pthread_mutex_trylock(&connection->io_mtx) == 0)
+		return;
+
+	monotime(&start);
+	pthread_mutex_lock(&connection->io_mtx);
+	bgp_io_hist_add(&bio_stats.mtx_wait, monotime_since(&start, NULL));
+}
+
+void bgp_io_show(struct vty *vty, json_object *json)
+{
+	uint64_t wakeups, saved;
+
+	wakeups = atomic_load_explicit(&bio_stats.wakeups, memory_order_relaxed);
+	saved = atomic_load_explicit(&bio_stats.wakeups_saved,
+				     memory_order_relaxed);
+
+	if (json) {
+		json_object_int_add(json, "inputWakeups", wakeups);
+		json_object_int_add(json, "inputWakeupsSaved", saved);
+	} else {
+		vty_out(vty, "Input queues:\n");
+		vty_out(vty,
+			"  Main pthread wakeups: %" PRIu64
+			", saved by batching: %" PRIu64 "\n",
+			wakeups, saved);
+	}
+
+	bgp_io_hist_show(vty, json, "inputQueueLatencyUsec", "Latency (usec)",
+			 &bio_stats.inq_latency);
+	bgp_io_hist_show(vty, json, "inputPacketsPerRead", "Packets per read",
+			 &bio_stats.inq_batch);
+	bgp_io_hist_show(vty, json, "ioMutexWaitUsec", "I/O mutex wait (usec)",
+			 &bio_stats.mtx_wait);
+}
+
+/* Input queue ------------------------------------------------------------- */
+
+/*
+ * Framed packets go from the I/O pthread, the only producer, to the main
+ * pthread, the only consumer, through a list of fixed-size segments.  Each
+ * side only writes its own position; the release store of `pushed` that
+ * follows writing a slot publishes it, so popping never takes a lock.  The
+ * producer still runs under io_mtx, which the main pthread only takes to
+ * clean the queue.
+ *
+ * `scheduled` is set while the main pthread knows that the connection has
+ * packets (it is on bm->connection_fifo or being processed), so the I/O
+ * pthread only wakes it up for the first packets of a batch.
+ */
+#define BGP_INQ_SEG_SLOTS 64
+
+struct bgp_inq_slot {
+	struct stream *s;
+	struct bgp_parse_job *job;
+	struct timeval queued;
+};
+
+struct bgp_inq_seg {
+	struct bgp_inq_seg *_Atomic next;
+	struct bgp_inq_slot slots[BGP_INQ_SEG_SLOTS];
+};
+
+struct bgp_inq {
+	/* producer side */
+	struct bgp_inq_seg *tail;
+	unsigned int tail_idx;
+	_Atomic uint64_t pushed;
+
+	atomic_bool scheduled;
+
+	/* consumer side */
+	struct bgp_inq_seg *head;
+	unsigned int head_idx;
+	_Atomic uint64_t popped;
+};
+
+struct bgp_inq *bgp_inq_new(void)
+{
+	struct bgp_inq *q = XCALLOC(MTYPE_BGP_INQ, sizeof(*q));
+
+	q->head = q->tail = XCALLOC(MTYPE_BGP_INQ_SEG, sizeof(*q->head));
+
+	return q;
+}
+
+void bgp_inq_free(struct bgp_inq **q)
+{
+	if (!*q)
+		return;
+
+	bgp_inq_clean(*q);
+	XFREE(MTYPE_BGP_INQ_SEG, (*q)->head);
+	XFREE(MTYPE_BGP_INQ, *q);
+}
+
+unsigned long bgp_inq_count(struct bgp_inq *q)
+{
+	return atomic_load_explicit(&q->pushed, memory_order_acquire) -
+	       atomic_load_explicit(&q->popped, memory_order_relaxed);
+}
+
+/* I/O pthread, io_mtx held. */
+static void bgp_inq_push(struct bgp_inq *q, struct stream *s,
+			 struct bgp_parse_job *job)
+{
+	struct bgp_inq_slot *slot;
+	struct bgp_inq_seg *seg;
+
+	if (q->tail_idx == BGP_INQ_SEG_SLOTS) {
+		seg = XCALLOC(MTYPE_BGP_INQ_SEG, sizeof(*seg));
+		atomic_store_explicit(&q->tail->next, seg, memory_order_relaxed);
+		q->tail = seg;
+		q->tail_idx = 0;
+	}
+
+	slot = &q->tail->slots[q->tail_idx++];
+	slot->s = s;
+	slot->job = job;
+	monotime(&slot->queued);
+
+	atomic_fetch_add_explicit(&q->pushed, 1, memory_order_release);
+}
+
+/*
+ * I/O pthread, after queueing packets.  Returns true if the main pthread
+ * does not know about them yet and must be told.
+ */
+static bool bgp_inq_wakeup(struct bgp_inq *q)
+{
+	/* pairs with the fence in bgp_inq_idle() */
+	atomic_thread_fence(memory_order_seq_cst);
+
+	return !atomic_exchange_explicit(&q->scheduled, true,
+					 memory_order_relaxed);
+}
+
+struct stream *bgp_inq_pop(struct bgp_inq *q, struct bgp_parse_job **job)
+{
+	struct bgp_inq_slot *slot;
+	struct bgp_inq_seg *seg;
+	uint64_t popped;
+
+	popped = atomic_load_explicit(&q->popped, memory_order_relaxed);
+	if (popped == atomic_load_explicit(&q->pushed, memory_order_acquire)) {
+		*job = NULL;
+		return NULL;
+	}
+
+	if (q->head_idx == BGP_INQ_SEG_SLOTS) {
+		seg = atomic_load_explicit(&q->head->next, memory_order_relaxed);
+		XFREE(MTYPE_BGP_INQ_SEG, q->head);
+		q->head = seg;
+		q->head_idx = 0;
+	}
+
+	slot = &q->head->slots[q->head_idx++];
+	atomic_store_explicit(&q->popped, popped + 1, memory_order_release);
+
+	bgp_io_hist_add(&bio_stats.inq_latency, monotime_since(&slot->queued, NULL));
+
+	*job = slot->job;
+	return slot->s;
+}
+
+bool bgp_inq_idle(struct bgp_inq *q)
+{
+	if (bgp_inq_count(q))
+		return false;
+
+	atomic_store_explicit(&q->scheduled, false, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!bgp_inq_count(q))
+		return true;
+
+	/*
+	 * Raced with the I/O pthread.  Keep going with the packets unless it
+	 * has already queued the connection again.
+	 */
+	return atomic_exchange_explicit(&q->scheduled, true,
+					memory_order_relaxed);
+}
+
+void bgp_inq_unschedule(struct bgp_inq *q)
+{
+	atomic_store_explicit(&q->scheduled, false, memory_order_relaxed);
+}
+
+void bgp_inq_clean(struct bgp_inq *q)
+{
+	struct bgp_parse_job *job;
+	struct stream *s;
+
+	while ((s = bgp_inq_pop(q, &job))) {
+		job = bgp_parse_claim(job);
+		bgp_parse_job_free(&job);
+		stream_free(s);
+	}
+
+	bgp_inq_unschedule(q);
+}
+
 /* Thread external API ----------------------------------------------------- */
 
 void bgp_writes_on(struct peer_connection *connection)
@@ -74,7 +357,7 @@ void bgp_writes_off(struct peer_connection *connection)
 	frr_with_mutex (&connection->io_mtx) {
 		if (connection->obuf != NULL) {
 			while ((s = stream_fifo_pop(connection->obuf)) != NULL)
-				stream_free(s);
+				bgp_obuf_free(s);
 		}
 	}
 
@@ -112,6 +395,7 @@ void bgp_reads_off(struct peer_connection *connection)
 		if (peer_connection_fifo_member(&bm->connection_fifo, connection))
 			peer_connection_fifo_del(&bm->connection_fifo, connection);
 	}
+	bgp_inq_unschedule(connection->ibuf);
 
 	UNSET_FLAG(connection->thread_flags, PEER_THREAD_READS_ON);
 }
@@ -139,10 +423,10 @@ static void bgp_process_writes(struct event *event)
 	event_add_write(fpt->master, bgp_process_writes, connection, connection->fd,
 			&connection->t_write);
 
-	frr_with_mutex (&connection->io_mtx) {
-		status = bgp_write(connection);
-		reschedule = (stream_fifo_head(connection->obuf) != NULL);
-	}
+	bgp_io_lock(connection);
+	status = bgp_write(connection);
+	reschedule = (stream_fifo_head(connection->obuf) != NULL);
+	pthread_mutex_unlock(&connection->io_mtx);
 
 	/* no problem */
 	if (CHECK_FLAG(status, BGP_IO_TRANS_ERR)) {
@@ -175,15 +459,14 @@ static int read_ibuf_work(struct peer_connection *connection)
 	/* packet size as given by header */
 	uint16_t pktsize = 0;
 	struct stream *pkt;
+	struct bgp_parse_job *job = NULL;
 
 	/* ibuf_work is allocated on demand; nothing to do if not present */
 	if (!ibw)
 		return 0;
 
-	frr_with_mutex (&connection->io_mtx) {
-		if (connection->ibuf->count >= bm->inq_limit)
-			return -ENOMEM;
-	}
+	if (bgp_inq_count(connection->ibuf) >= bm->inq_limit)
+		return -ENOMEM;
 
 	/* check that we have enough data for a header */
 	if (ringbuf_remain(ibw) < BGP_HEADER_SIZE)
@@ -217,9 +500,14 @@ static int read_ibuf_work(struct peer_connection *connection)
 	stream_set_endp(pkt, pktsize);
 
 	frrtrace(2, frr_bgp, packet_read, connection, pkt);
-	frr_with_mutex (&connection->io_mtx) {
-		stream_fifo_push(connection->ibuf, pkt);
-	}
+
+	/* let a parse worker decode it while it sits in the queue */
+	if (pkt->data[BGP_MARKER_SIZE + 2] == BGP_MSG_UPDATE)
+		job = bgp_parse_enqueue(connection, pkt);
+
+	bgp_io_lock(connection);
+	bgp_inq_push(connection->ibuf, pkt, job);
+	pthread_mutex_unlock(&connection->io_mtx);
 
 	return pktsize;
 }
@@ -239,7 +527,7 @@ static void bgp_process_reads(struct event *event)
 	static struct peer *peer;       /* peer to read from */
 	uint16_t status;                /* bgp_read status code */
 	bool fatal = false;             /* whether fatal error occurred */
-	bool added_pkt = false;         /* whether we pushed onto ->connection.ibuf */
+	unsigned int added = 0;         /* packets pushed onto ->connection.ibuf */
 	int code = 0;                   /* FSM code if error occurred */
 	static bool ibuf_full_logged;   /* Have we logged full already */
 	int ret = 1;
@@ -252,9 +540,9 @@ static void bgp_process_reads(struct event *event)
 
 	struct frr_pthread *fpt = bgp_pth_io;
 
-	frr_with_mutex (&connection->io_mtx) {
-		status = bgp_read(connection, &code);
-	}
+	bgp_io_lock(connection);
+	status = bgp_read(connection, &code);
+	pthread_mutex_unlock(&connection->io_mtx);
 
 	/* error checking phase */
 	if (CHECK_FLAG(status, BGP_IO_TRANS_ERR)) {
@@ -278,7 +566,7 @@ static void bgp_process_reads(struct event *event)
 		if (ret <= 0)
 			break;
 
-		added_pkt = true;
+		added++;
 	}
 
 	switch (ret) {
@@ -320,7 +608,16 @@ done:
 	if (ret != -ENOMEM)
 		event_add_read(fpt->master, bgp_process_reads, connection, connection->fd,
 			       &connection->t_read);
-	if (added_pkt) {
+	if (added) {
+		bgp_io_hist_add(&bio_stats.inq_batch, added);
+
+		if (!bgp_inq_wakeup(connection->ibuf)) {
+			atomic_fetch_add_explicit(&bio_stats.wakeups_saved, 1,
+						  memory_order_relaxed);
+			return;
+		}
+
+		atomic_fetch_add_explicit(&bio_stats.wakeups, 1, memory_order_relaxed);
 		frr_with_mutex (&bm->peer_connection_mtx) {
 			if (!peer_connection_fifo_member(&bm->connection_fifo, connection))
 				peer_connection_fifo_add_tail(&bm->connection_fifo, connection);
@@ -353,39 +650,37 @@ static uint16_t bgp_write(struct peer_connection *connection)
 	uint16_t status = 0;
 	uint32_t wpkt_quanta_old;
 
-	int writenum = 0;
-	int num;
+	ssize_t num;
+	size_t left;
 	unsigned int iovsz;
-	unsigned int strmsz;
 	unsigned int total_written;
 	time_t now;
 
 	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 					       memory_order_relaxed);
 	struct stream *ostreams[wpkt_quanta_old];
-	struct stream **streams = ostreams;
-	struct iovec iov[wpkt_quanta_old];
+	/* shared packets (bpacket_ref) may take more than one */
+	struct iovec iov[wpkt_quanta_old * BGP_OBUF_IOV_MAX];
 
 	s = stream_fifo_head(connection->obuf);
 
 	if (!s)
 		goto done;
 
-	count = iovsz = 0;
-	while (count < wpkt_quanta_old && iovsz < array_size(iov) && s) {
-		ostreams[iovsz] = s;
-		iov[iovsz].iov_base = stream_pnt(s);
-		iov[iovsz].iov_len = STREAM_READABLE(s);
-		writenum += STREAM_READABLE(s);
+	count = 0;
+	while (count < wpkt_quanta_old && s) {
+		ostreams[count] = s;
 		s = s->next;
-		++iovsz;
 		++count;
 	}
 
-	strmsz = iovsz;
 	total_written = 0;
 
 	do {
+		iovsz = 0;
+		for (unsigned int i = total_written; i < count; i++)
+			iovsz += bgp_obuf_iov(ostreams[i], &iov[iovsz]);
+
 		num = writev(connection->fd, iov, iovsz);
 
 		if (num < 0) {
@@ -397,41 +692,21 @@ static uint16_t bgp_write(struct peer_connection *connection)
 			}
 
 			break;
-		} else if (num != writenum) {
-			unsigned int msg_written = 0;
-			unsigned int ic = iovsz;
-
-			for (unsigned int i = 0; i < ic; i++) {
-				size_t ss = iov[i].iov_len;
+		}
 
-				if (ss > (unsigned int) num)
-					break;
+		bgp_obuf_stats_sent(num);
 
-				msg_written++;
-				iovsz--;
-				writenum -= ss;
-				num -= ss;
+		/* step over what was written, maybe ending mid-message */
+		while (num > 0) {
+			left = STREAM_READABLE(ostreams[total_written]);
+			if ((size_t)num < left) {
+				bgp_obuf_forward(ostreams[total_written], num);
+				break;
 			}
-
-			total_written += msg_written;
-
-			assert(total_written < count);
-
-			memmove(&iov, &iov[msg_written],
-				sizeof(iov[0]) * iovsz);
-			streams = &streams[msg_written];
-			stream_forward_getp(streams[0], num);
-			iov[0].iov_base = stream_pnt(streams[0]);
-			iov[0].iov_len = STREAM_READABLE(streams[0]);
-
-			writenum -= num;
-			num = 0;
-			assert(writenum > 0);
-		} else {
-			total_written = strmsz;
+			num -= left;
+			total_written++;
 		}
-
-	} while (num != writenum);
+	} while (total_written < count);
 
 	/* Handle statistics */
 	for (unsigned int i = 0; i < total_written; i++) {
@@ -440,8 +715,7 @@ static uint16_t bgp_write(struct peer_connection *connection)
 		assert(s == ostreams[i]);
 
 		/* Retrieve BGP packet type. */
-		stream_set_getp(s, BGP_MARKER_SIZE + 2);
-		type = stream_getc(s);
+		type = bgp_obuf_type(s);
 
 		switch (type) {
 		case BGP_MSG_OPEN:
@@ -485,7 +759,7 @@ static uint16_t bgp_write(struct peer_connection *connection)
 			break;
 		}
 
-		stream_free(s);
+		bgp_obuf_free(s);
 		ostreams[i] = NULL;
 		update_last_write = 1;
 	}
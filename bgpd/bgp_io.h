@@ -14,8 +14,10 @@
 
 #include "bgpd/bgpd.h"
 #include "frr_pthread.h"
+#include "lib/json.h"
 
 struct peer_connection;
+struct bgp_parse_job;
 
 /**
  * Start function for write thread.
@@ -63,7 +65,7 @@ extern void bgp_writes_off(struct peer_connection *connection);
  * Turns on packet reading for a peer.
  *
  * After this function is called, any packets received on connection->fd
- * will be read and copied into the FIFO queue connection->ibuf.
+ * will be read and copied into the input queue connection->ibuf.
  *
  * Additionally, it becomes unsafe to perform socket actions on connection->fd.
  *
@@ -89,4 +91,50 @@ extern void bgp_reads_on(struct peer_connection *connection);
  */
 extern void bgp_reads_off(struct peer_connection *connection);
 
+/**
+ * Input queue of a connection.
+ *
+ * Filled by the I/O pthread, emptied by the main pthread without locking.
+ */
+extern struct bgp_inq *bgp_inq_new(void);
+extern void bgp_inq_free(struct bgp_inq **q);
+
+/**
+ * Number of packets waiting in the queue; may be called from any pthread.
+ */
+extern unsigned long bgp_inq_count(struct bgp_inq *q);
+
+/**
+ * Pop the next packet, main pthread only.
+ *
+ * @param job - set to the packet's parse job, see bgp_parse_claim()
+ * @return the packet, NULL if the queue is empty
+ */
+extern struct stream *bgp_inq_pop(struct bgp_inq *q, struct bgp_parse_job **job);
+
+/**
+ * Check whether the main pthread is done with a connection's queue, main
+ * pthread only.
+ *
+ * If the queue is empty, the I/O pthread will wake the main pthread up again
+ * for the next packet it queues.
+ *
+ * @return true if the queue is empty or the connection has been put on
+ * bm->connection_fifo again meanwhile, false if there are packets to process
+ */
+extern bool bgp_inq_idle(struct bgp_inq *q);
+
+/**
+ * Note that the connection was taken off bm->connection_fifo with packets
+ * possibly left in its queue, main pthread only.
+ */
+extern void bgp_inq_unschedule(struct bgp_inq *q);
+
+/**
+ * Drop all queued packets, main pthread only, with io_mtx held.
+ */
+extern void bgp_inq_clean(struct bgp_inq *q);
+
+extern void bgp_io_show(struct vty *vty, json_object *json);
+
 #endif /* _FRR_BGP_IO_H */
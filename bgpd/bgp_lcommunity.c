@@ -17,10 +17,11 @@
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_aspath.h"
 
 /* Hash of community attribute. */
-static struct hash *lcomhash;
+static struct bgp_intern_table *lcomhash;
 
 /* Allocate a new lcommunities.  */
 static struct lcommunity *lcommunity_new(void)
@@ -251,6 +252,17 @@ static void set_lcommunity_string(struct lcommunity *lcom, bool make_json,
 	lcom->str = str_buf;
 }
 
+/* Make the string before the lcommunity becomes visible to other users. */
+static void *lcommunity_intern_alloc(void *arg)
+{
+	struct lcommunity *lcom = arg;
+
+	if (!lcom->str)
+		set_lcommunity_string(lcom, false, true);
+
+	return lcom;
+}
+
 /* Intern Large Communities Attribute.  */
 struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 {
@@ -258,38 +270,23 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 
 	assert(lcom->refcnt == 0);
 
-	find = (struct lcommunity *)hash_get(lcomhash, lcom, hash_alloc_intern);
+	find = bgp_intern_get(lcomhash, lcom, lcommunity_intern_alloc, NULL);
 
 	if (find != lcom)
 		lcommunity_free(&lcom);
 
-	find->refcnt++;
-
-	if (!find->str)
-		set_lcommunity_string(find, false, true);
-
 	return find;
 }
 
 /* Unintern Large Communities Attribute.  */
 void lcommunity_unintern(struct lcommunity **lcom)
 {
-	struct lcommunity *ret;
-
 	if (!*lcom)
 		return;
 
-	if ((*lcom)->refcnt)
-		(*lcom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*lcom)->refcnt == 0) {
-		/* Large community must be in the hash.  */
-		ret = (struct lcommunity *)hash_release(lcomhash, *lcom);
-		assert(ret != NULL);
-
+	/* Pull off from hash when the last reference is gone.  */
+	if (bgp_intern_put(lcomhash, *lcom))
 		lcommunity_free(lcom);
-	}
 }
 
 /* Return string representation of lcommunities attribute. */
@@ -333,8 +330,8 @@ bool lcommunity_cmp(const void *arg1, const void *arg2)
 		&& memcmp(lcom1->val, lcom2->val, lcom_length(lcom1)) == 0);
 }
 
-/* Return communities hash.  */
-struct hash *lcommunity_hash(void)
+/* Return large communities intern table.  */
+struct bgp_intern_table *lcommunity_hash(void)
 {
 	return lcomhash;
 }
@@ -342,13 +339,14 @@ struct hash *lcommunity_hash(void)
 /* Initialize Large Comminities related hash. */
 void lcommunity_init(void)
 {
-	lcomhash = hash_create(lcommunity_hash_make, lcommunity_cmp,
-			       "BGP lcommunity hash");
+	lcomhash = bgp_intern_table_new("BGP lcommunity hash", 0,
+					lcommunity_hash_make, lcommunity_cmp,
+					struct lcommunity, refcnt);
 }
 
 void lcommunity_finish(void)
 {
-	hash_clean_and_free(&lcomhash, (void (*)(void *))lcommunity_hash_free);
+	bgp_intern_table_free(&lcomhash, (void (*)(void *))lcommunity_hash_free);
 }
 
 /* Get next Large Communities token from the string.
@@ -17,7 +17,7 @@
 /* Large Communities attribute.  */
 struct lcommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 
 	/* Size of Extended Communities attribute.  */
 	int size;
@@ -51,7 +51,7 @@ extern struct lcommunity *lcommunity_intern(struct lcommunity *lcom);
 extern bool lcommunity_cmp(const void *arg1, const void *arg2);
 extern void lcommunity_unintern(struct lcommunity **lcom);
 extern unsigned int lcommunity_hash_make(const void *arg);
-extern struct hash *lcommunity_hash(void);
+extern struct bgp_intern_table *lcommunity_hash(void);
 extern struct lcommunity *lcommunity_str2com(const char *str);
 extern bool lcommunity_match(const struct lcommunity *lcom1, const struct lcommunity *lcom2);
 extern char *lcommunity_str(struct lcommunity *lcom, bool make_json,
@@ -51,6 +51,7 @@
 #include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_routemap_nb.h"
 #include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_reclaim.h"
 
 DEFINE_HOOK(bgp_hook_config_write_vrf, (struct vty *vty, struct vrf *vrf),
 	    (vty, vrf));
@@ -209,8 +210,12 @@ static FRR_NORETURN void bgp_exit(int status)
 	if (bgp_default)
 		bgp_delete(bgp_default);
 
+	/* what the instances held, and anything freed from here on */
+	bgp_reclaim_finish();
+
 	bgp_evpn_mh_finish();
 	bgp_nhg_finish();
+	bgp_mplsvpn_finish();
 
 	zebra_announce_fini(&bm->zebra_announce_head);
 	zebra_announce_fini(&bm->zebra_announce_early_head);
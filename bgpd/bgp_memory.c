@@ -38,9 +38,9 @@ DEFINE_MTYPE(BGPD, AS_SEG_DATA, "BGP aspath segment data");
 DEFINE_MTYPE(BGPD, AS_STR, "BGP aspath str");
 
 DEFINE_MTYPE(BGPD, BGP_TABLE, "BGP table");
-DEFINE_MTYPE(BGPD, BGP_NODE, "BGP node");
-DEFINE_MTYPE(BGPD, BGP_ROUTE, "BGP route");
-DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA, "BGP ancillary route info");
+DEFINE_MTYPE_SLAB(BGPD, BGP_NODE, "BGP node");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ROUTE, "BGP route");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ROUTE_EXTRA, "BGP ancillary route info");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_EVPN, "BGP extra info for EVPN");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_FS, "BGP extra info for flowspec");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_UNREACH, "BGP extra info for unreachability");
@@ -51,8 +51,10 @@ DEFINE_MTYPE(BGPD, BGP_STATIC, "BGP static");
 DEFINE_MTYPE(BGPD, BGP_ADVERTISE_ATTR, "BGP adv attr");
 DEFINE_MTYPE(BGPD, BGP_ADVERTISE, "BGP adv");
 DEFINE_MTYPE(BGPD, BGP_SYNCHRONISE, "BGP synchronise");
-DEFINE_MTYPE(BGPD, BGP_ADJ_IN, "BGP adj in");
-DEFINE_MTYPE(BGPD, BGP_ADJ_OUT, "BGP adj out");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ADJ_IN, "BGP adj in");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ADJ_OUT, "BGP adj out");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ADJ_OUT_COMPACT, "BGP adj out (compact)");
+DEFINE_MTYPE(BGPD, BGP_ADJ_OUT_EXT, "BGP adj out side entry");
 DEFINE_MTYPE(BGPD, BGP_MPATH_INFO, "BGP multipath info");
 
 DEFINE_MTYPE(BGPD, AS_LIST, "BGP AS list");
@@ -49,6 +49,8 @@ DECLARE_MTYPE(BGP_ADVERTISE);
 DECLARE_MTYPE(BGP_SYNCHRONISE);
 DECLARE_MTYPE(BGP_ADJ_IN);
 DECLARE_MTYPE(BGP_ADJ_OUT);
+DECLARE_MTYPE(BGP_ADJ_OUT_COMPACT);
+DECLARE_MTYPE(BGP_ADJ_OUT_EXT);
 DECLARE_MTYPE(BGP_MPATH_INFO);
 
 DECLARE_MTYPE(AS_LIST);
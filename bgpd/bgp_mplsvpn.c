@@ -14,6 +14,8 @@
 #include "filter.h"
 #include "mpls.h"
 #include "json.h"
+#include "jhash.h"
+#include "typesafe.h"
 #include "zclient.h"
 
 #include "bgpd/bgpd.h"
@@ -42,6 +44,8 @@
 
 DEFINE_MTYPE_STATIC(BGPD, MPLSVPN_NH_LABEL_BIND_CACHE,
 		    "BGP MPLSVPN nexthop label bind cache");
+DEFINE_MTYPE_STATIC(BGPD, VPN_RT_INDEX, "BGP VPN import route-target index");
+DEFINE_MTYPE_STATIC(BGPD, VPN_LEAK_JOB, "BGP VPN to VRF leak job");
 
 /*
  * Definitions and external declarations.
@@ -2677,17 +2681,466 @@ static void vpn_leak_to_vrf_update_onevrf(struct bgp *to_bgp,	/* to */
 	bgp_attr_flush(&static_attr);
 }
 
+/*
+ * Route-target index.
+ *
+ * Every VPN path used to be matched against the import RT list of every BGP
+ * instance, which with many VRFs is most of the cost of leaking.  The index
+ * maps each import route-target to the instances importing it, per address
+ * family, and is rebuilt on first use after any import RT list or the list
+ * of instances changed.  Import RT lists not made of plain 8-byte extended
+ * communities are kept aside and matched as before.
+ */
+PREDECL_HASH(vpn_rt_index);
+
+struct vpn_rt_entry {
+	struct vpn_rt_index_item itm;
+	uint8_t rt[ECOMMUNITY_SIZE];
+
+	struct bgp **targets;
+	unsigned int ntargets;
+	unsigned int size;
+};
+
+static int vpn_rt_entry_cmp(const struct vpn_rt_entry *a,
+			    const struct vpn_rt_entry *b)
+{
+	return memcmp(a->rt, b->rt, sizeof(a->rt));
+}
+
+static uint32_t vpn_rt_entry_hash(const struct vpn_rt_entry *e)
+{
+	return jhash(e->rt, sizeof(e->rt), 0x52544958);
+}
+
+DECLARE_HASH(vpn_rt_index, struct vpn_rt_entry, itm, vpn_rt_entry_cmp,
+	     vpn_rt_entry_hash);
+
+static struct {
+	bool inited;
+	bool valid;
+	uint64_t rebuilds;
+
+	struct vpn_rt_index_head rts[AFI_MAX];
+	/* instances whose import RT list is not indexed */
+	struct list *scan[AFI_MAX];
+
+	/* lookup results */
+	struct bgp **res;
+	unsigned int res_size;
+} vpn_rti;
+
+void vpn_leak_rt_index_invalidate(void)
+{
+	vpn_rti.valid = false;
+}
+
+static void vpn_rt_index_insert(struct vpn_rt_index_head *head,
+				const uint8_t *rt, struct bgp *bgp)
+{
+	struct vpn_rt_entry ref, *e;
+
+	memcpy(ref.rt, rt, sizeof(ref.rt));
+	e = vpn_rt_index_find(head, &ref);
+	if (!e) {
+		e = XCALLOC(MTYPE_VPN_RT_INDEX, sizeof(*e));
+		memcpy(e->rt, rt, sizeof(e->rt));
+		vpn_rt_index_add(head, e);
+	}
+
+	/* the same RT may be listed twice */
+	if (e->ntargets && e->targets[e->ntargets - 1] == bgp)
+		return;
+
+	if (e->ntargets == e->size) {
+		e->size = MAX(4U, e->size * 2);
+		e->targets = XREALLOC(MTYPE_VPN_RT_INDEX, e->targets,
+				      e->size * sizeof(*e->targets));
+	}
+	e->targets[e->ntargets++] = bgp;
+}
+
+static void vpn_rt_index_flush(void)
+{
+	struct vpn_rt_entry *e;
+	afi_t afi;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+		while ((e = vpn_rt_index_pop(&vpn_rti.rts[afi]))) {
+			XFREE(MTYPE_VPN_RT_INDEX, e->targets);
+			XFREE(MTYPE_VPN_RT_INDEX, e);
+		}
+		list_delete_all_node(vpn_rti.scan[afi]);
+	}
+}
+
+static void vpn_rt_index_build(void)
+{
+	struct ecommunity *ecom;
+	struct listnode *node;
+	struct bgp *bgp;
+	uint32_t i;
+	afi_t afi;
+
+	if (!vpn_rti.inited) {
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			vpn_rt_index_init(&vpn_rti.rts[afi]);
+			vpn_rti.scan[afi] = list_new();
+		}
+		vpn_rti.inited = true;
+	}
+
+	vpn_rt_index_flush();
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			ecom = bgp->vpn_policy[afi]
+				       .rtlist[BGP_VPN_POLICY_DIR_FROMVPN];
+			if (!ecom)
+				continue;
+
+			if (ecom->unit_size != ECOMMUNITY_SIZE) {
+				listnode_add(vpn_rti.scan[afi], bgp);
+				continue;
+			}
+
+			for (i = 0; i < ecom->size; i++)
+				vpn_rt_index_insert(&vpn_rti.rts[afi],
+						    ecom->val +
+							    i * ECOMMUNITY_SIZE,
+						    bgp);
+		}
+	}
+
+	vpn_rti.valid = true;
+	vpn_rti.rebuilds++;
+}
+
+static void vpn_rt_index_res_add(unsigned int *nres, struct bgp *bgp)
+{
+	if (*nres == vpn_rti.res_size) {
+		vpn_rti.res_size = MAX(16U, vpn_rti.res_size * 2);
+		vpn_rti.res = XREALLOC(MTYPE_VPN_RT_INDEX, vpn_rti.res,
+				       vpn_rti.res_size * sizeof(*vpn_rti.res));
+	}
+	vpn_rti.res[(*nres)++] = bgp;
+}
+
+static int vpn_rt_index_res_cmp(const void *a, const void *b)
+{
+	uintptr_t pa = (uintptr_t)*(struct bgp *const *)a;
+	uintptr_t pb = (uintptr_t)*(struct bgp *const *)b;
+
+	return (pa > pb) - (pa < pb);
+}
+
+/*
+ * The instances importing @afi routes carrying @ecom, that is those whose
+ * import RT list intersects it (cf. ecommunity_include()), in no particular
+ * order.  The result is only valid until the next lookup.
+ */
+static unsigned int vpn_rt_index_lookup(afi_t afi, struct ecommunity *ecom,
+					struct bgp ***targets)
+{
+	struct vpn_rt_entry ref, *e;
+	struct listnode *node;
+	struct bgp *bgp;
+	unsigned int nres = 0, nhits = 0, i, j;
+	uint32_t k;
+
+	*targets = vpn_rti.res;
+	if (!ecom || !ecom->size)
+		return 0;
+
+	if (!vpn_rti.valid)
+		vpn_rt_index_build();
+
+	/* only plain RTs are indexed, match anything else the long way */
+	if (ecom->unit_size != ECOMMUNITY_SIZE) {
+		for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+			if (ecommunity_include(bgp->vpn_policy[afi].rtlist
+						       [BGP_VPN_POLICY_DIR_FROMVPN],
+					       ecom))
+				vpn_rt_index_res_add(&nres, bgp);
+		*targets = vpn_rti.res;
+		return nres;
+	}
+
+	for (k = 0; k < ecom->size; k++) {
+		memcpy(ref.rt, ecom->val + k * ECOMMUNITY_SIZE, sizeof(ref.rt));
+		e = vpn_rt_index_find(&vpn_rti.rts[afi], &ref);
+		if (!e)
+			continue;
+
+		nhits++;
+		for (i = 0; i < e->ntargets; i++)
+			vpn_rt_index_res_add(&nres, e->targets[i]);
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(vpn_rti.scan[afi], node, bgp))
+		if (ecommunity_include(bgp->vpn_policy[afi].rtlist
+					       [BGP_VPN_POLICY_DIR_FROMVPN],
+				       ecom))
+			vpn_rt_index_res_add(&nres, bgp);
+
+	/* several RTs of the path may lead to the same instance */
+	if (nhits > 1) {
+		qsort(vpn_rti.res, nres, sizeof(*vpn_rti.res),
+		      vpn_rt_index_res_cmp);
+		for (i = 0, j = 0; i < nres; i++)
+			if (!j || vpn_rti.res[j - 1] != vpn_rti.res[i])
+				vpn_rti.res[j++] = vpn_rti.res[i];
+		nres = j;
+	}
+
+	*targets = vpn_rti.res;
+	return nres;
+}
+
+/* A copy of the lookup result, for callers which leak while going over it */
+static struct bgp **vpn_rt_index_targets(afi_t afi, struct ecommunity *ecom,
+					 unsigned int *ntargets)
+{
+	struct bgp **found, **targets;
+
+	*ntargets = vpn_rt_index_lookup(afi, ecom, &found);
+	if (!*ntargets)
+		return NULL;
+
+	targets = XMALLOC(MTYPE_VPN_RT_INDEX, *ntargets * sizeof(*targets));
+	memcpy(targets, found, *ntargets * sizeof(*targets));
+	return targets;
+}
+
+/*
+ * VPN to VRF leak queue.
+ *
+ * VPN paths to leak into VRFs are queued rather than leaked as they are
+ * received, and leaked in batches from the event loop.  A batch is sorted
+ * by target instance, then by source, so that all the paths going into one
+ * VRF are leaked together.  Withdrawals are still done synchronously; a
+ * queued path which is removed meanwhile is skipped.
+ */
+#define VPN_LEAK_BATCH 2048
+
+PREDECL_LIST(vpn_leakq);
+
+struct vpn_leak_job {
+	struct vpn_leakq_item itm;
+
+	struct bgp *from_bgp;
+	struct bgp_path_info *path;
+	struct peer *peer;
+	struct prefix_rd prd;
+	bool has_prd;
+};
+
+DECLARE_LIST(vpn_leakq, struct vpn_leak_job, itm);
+
+/* a path to leak into one instance */
+struct vpn_leak_pair {
+	struct bgp *to_bgp;
+	struct vpn_leak_job *job;
+	unsigned int seq;
+};
+
+static struct {
+	bool inited;
+	struct vpn_leakq_head queue;
+	struct event *t_process;
+
+	struct vpn_leak_pair *pairs;
+	unsigned int pairs_size;
+
+	/* statistics */
+	size_t max_depth;
+	uint64_t queued;
+	uint64_t processed;
+	uint64_t leaks;
+	uint64_t batches;
+	int64_t busy_usec;
+	size_t last_batch;
+	int64_t last_usec;
+} vpn_leakq;
+
+static void vpn_leak_job_free(struct vpn_leak_job *job)
+{
+	bgp_path_info_unlock(job->path);
+	if (job->peer)
+		peer_unlock(job->peer);
+	bgp_unlock(job->from_bgp);
+	XFREE(MTYPE_VPN_LEAK_JOB, job);
+}
+
+static int vpn_leak_pair_cmp(const void *a, const void *b)
+{
+	const struct vpn_leak_pair *pa = a, *pb = b;
+
+	if (pa->to_bgp != pb->to_bgp)
+		return (uintptr_t)pa->to_bgp < (uintptr_t)pb->to_bgp ? -1 : 1;
+	if (pa->job->from_bgp != pb->job->from_bgp)
+		return (uintptr_t)pa->job->from_bgp <
+				       (uintptr_t)pb->job->from_bgp
+			       ? -1
+			       : 1;
+	return (pa->seq > pb->seq) - (pa->seq < pb->seq);
+}
+
+static void vpn_leak_pair_add(unsigned int *npairs, struct bgp *to_bgp,
+			      struct vpn_leak_job *job, unsigned int seq)
+{
+	if (*npairs == vpn_leakq.pairs_size) {
+		vpn_leakq.pairs_size = MAX(256U, vpn_leakq.pairs_size * 2);
+		vpn_leakq.pairs =
+			XREALLOC(MTYPE_VPN_LEAK_JOB, vpn_leakq.pairs,
+				 vpn_leakq.pairs_size * sizeof(*vpn_leakq.pairs));
+	}
+	vpn_leakq.pairs[*npairs].to_bgp = to_bgp;
+	vpn_leakq.pairs[*npairs].job = job;
+	vpn_leakq.pairs[*npairs].seq = seq;
+	(*npairs)++;
+}
+
+/* Leak one path into all the instances importing it */
+static void vpn_leak_to_vrf_update_now(struct bgp *from_bgp,
+				       struct bgp_path_info *path_vpn,
+				       struct prefix_rd *prd, struct peer *peer)
+{
+	const struct prefix *p = bgp_dest_get_prefix(path_vpn->net);
+	struct bgp **targets;
+	unsigned int ntargets, i;
+
+	targets = vpn_rt_index_targets(family2afi(p->family),
+				       bgp_attr_get_ecommunity(path_vpn->attr),
+				       &ntargets);
+
+	for (i = 0; i < ntargets; i++) {
+		if (!path_vpn->extra || !path_vpn->extra->vrfleak ||
+		    path_vpn->extra->vrfleak->bgp_orig != targets[i]) /* no loop */
+			vpn_leak_to_vrf_update_onevrf(targets[i], from_bgp,
+						      path_vpn, prd, peer);
+	}
+
+	XFREE(MTYPE_VPN_RT_INDEX, targets);
+}
+
+static void vpn_leak_to_vrf_process(struct event *event)
+{
+	struct vpn_leak_job *jobs[VPN_LEAK_BATCH];
+	struct vpn_leak_job *job;
+	struct bgp_path_info *path;
+	struct bgp **targets;
+	const struct prefix *p;
+	struct vpn_leak_pair *pair;
+	struct timeval start;
+	unsigned int njobs = 0, npairs = 0, ntargets, i;
+
+	monotime(&start);
+
+	while (njobs < VPN_LEAK_BATCH &&
+	       (job = vpn_leakq_pop(&vpn_leakq.queue))) {
+		jobs[njobs] = job;
+		path = job->path;
+
+		if (!CHECK_FLAG(path->flags, BGP_PATH_REMOVED) && path->net &&
+		    !CHECK_FLAG(job->from_bgp->flags,
+				BGP_FLAG_DELETE_IN_PROGRESS)) {
+			p = bgp_dest_get_prefix(path->net);
+			ntargets = vpn_rt_index_lookup(family2afi(p->family),
+						       bgp_attr_get_ecommunity(
+							       path->attr),
+						       &targets);
+
+			for (i = 0; i < ntargets; i++) {
+				if (path->extra && path->extra->vrfleak &&
+				    path->extra->vrfleak->bgp_orig ==
+					    targets[i]) /* no loop */
+					continue;
+				vpn_leak_pair_add(&npairs, targets[i], job,
+						  njobs);
+			}
+		}
+		njobs++;
+	}
+
+	qsort(vpn_leakq.pairs, npairs, sizeof(*vpn_leakq.pairs),
+	      vpn_leak_pair_cmp);
+
+	for (i = 0; i < npairs; i++) {
+		pair = &vpn_leakq.pairs[i];
+		job = pair->job;
+
+		/* an earlier leak of the batch may have removed it */
+		if (CHECK_FLAG(job->path->flags, BGP_PATH_REMOVED))
+			continue;
+
+		vpn_leak_to_vrf_update_onevrf(pair->to_bgp, job->from_bgp,
+					      job->path,
+					      job->has_prd ? &job->prd : NULL,
+					      job->peer);
+	}
+
+	for (i = 0; i < njobs; i++)
+		vpn_leak_job_free(jobs[i]);
+
+	vpn_leakq.processed += njobs;
+	vpn_leakq.leaks += npairs;
+	vpn_leakq.batches++;
+	vpn_leakq.last_batch = njobs;
+	vpn_leakq.last_usec = monotime_since(&start, NULL);
+	vpn_leakq.busy_usec += vpn_leakq.last_usec;
+
+	if (vpn_leakq_count(&vpn_leakq.queue))
+		event_add_event(bm->master, vpn_leak_to_vrf_process, NULL, 0,
+				&vpn_leakq.t_process);
+}
+
+void vpn_leak_to_vrf_queue_flush(struct bgp *bgp)
+{
+	struct vpn_leak_job *job;
+	struct bgp_table *table;
+
+	if (!vpn_leakq.inited)
+		return;
+
+	/*
+	 * Drop what comes from @bgp or lives in its tables, and the removed
+	 * paths, whose dest may be gone with the tables.
+	 */
+	frr_each_safe (vpn_leakq, &vpn_leakq.queue, job) {
+		if (bgp && job->from_bgp != bgp &&
+		    !CHECK_FLAG(job->path->flags, BGP_PATH_REMOVED) &&
+		    job->path->net) {
+			table = bgp_dest_table(job->path->net);
+			if (!table || table->bgp != bgp)
+				continue;
+		}
+
+		vpn_leakq_del(&vpn_leakq.queue, job);
+		vpn_leak_job_free(job);
+	}
+
+	if (!vpn_leakq_count(&vpn_leakq.queue))
+		event_cancel(&vpn_leakq.t_process);
+
+	vpn_leak_rt_index_invalidate();
+}
+
 bool vpn_leak_to_vrf_no_retain_filter_check(struct bgp *from_bgp,
 					    struct attr *attr, afi_t afi)
 {
 	struct ecommunity *ecom_route_target = bgp_attr_get_ecommunity(attr);
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
-	struct listnode *node;
 	const char *debugmsg;
+	struct bgp **targets;
 	struct bgp *to_bgp;
+	unsigned int ntargets, i;
+
+	/* Loop over the BGP instances importing one of the route targets */
+	ntargets = vpn_rt_index_lookup(afi, ecom_route_target, &targets);
+	for (i = 0; i < ntargets; i++) {
+		to_bgp = targets[i];
 
-	/* Loop over BGP instances */
-	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, to_bgp)) {
 		if (!vpn_leak_from_vpn_active(to_bgp, afi, &debugmsg)) {
 			if (debug)
 				zlog_debug(
@@ -2697,20 +3150,6 @@ bool vpn_leak_to_vrf_no_retain_filter_check(struct bgp *from_bgp,
 					debugmsg);
 			continue;
 		}
-
-		/* Check for intersection of route targets */
-		if (!ecommunity_include(
-			    to_bgp->vpn_policy[afi]
-				    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-			    ecom_route_target)) {
-			if (debug)
-				zlog_debug(
-					"%s: from vpn (%s) to vrf (%s) afi %s %s, skipping after no intersection of route targets",
-					__func__, from_bgp->name_pretty,
-					to_bgp->name_pretty, afi2str(afi),
-					ecommunity_str(ecom_route_target));
-			continue;
-		}
 		return false;
 	}
 
@@ -2726,22 +3165,44 @@ bool vpn_leak_to_vrf_no_retain_filter_check(struct bgp *from_bgp,
 void vpn_leak_to_vrf_update(struct bgp *from_bgp, struct bgp_path_info *path_vpn,
 			    struct prefix_rd *prd, struct peer *peer)
 {
-	struct listnode *mnode, *mnnode;
-	struct bgp *bgp;
 	const struct prefix *p = bgp_dest_get_prefix(path_vpn->net);
+	struct vpn_leak_job *job;
+	size_t depth;
 
 	int debug = BGP_DEBUG(vpn, VPN_LEAK_TO_VRF);
 
 	if (debug)
 		zlog_debug("%s: start (path_vpn=%p, prefix=%pFX)", __func__, path_vpn, p);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
-		if (!path_vpn->extra || !path_vpn->extra->vrfleak ||
-		    path_vpn->extra->vrfleak->bgp_orig != bgp) { /* no loop */
-			vpn_leak_to_vrf_update_onevrf(bgp, from_bgp, path_vpn, prd, peer);
-		}
+	/* Without an event loop, leak right away */
+	if (!bm->master) {
+		vpn_leak_to_vrf_update_now(from_bgp, path_vpn, prd, peer);
+		return;
 	}
+
+	if (!vpn_leakq.inited) {
+		vpn_leakq_init(&vpn_leakq.queue);
+		vpn_leakq.inited = true;
+	}
+
+	job = XCALLOC(MTYPE_VPN_LEAK_JOB, sizeof(*job));
+	job->from_bgp = bgp_lock(from_bgp);
+	job->path = bgp_path_info_lock(path_vpn);
+	if (peer)
+		job->peer = peer_lock(peer);
+	if (prd) {
+		job->prd = *prd;
+		job->has_prd = true;
+	}
+	vpn_leakq_add_tail(&vpn_leakq.queue, job);
+
+	vpn_leakq.queued++;
+	depth = vpn_leakq_count(&vpn_leakq.queue);
+	if (depth > vpn_leakq.max_depth)
+		vpn_leakq.max_depth = depth;
+
+	event_add_event(bm->master, vpn_leak_to_vrf_process, NULL, 0,
+			&vpn_leakq.t_process);
 }
 
 void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
@@ -2749,8 +3210,8 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 	const struct prefix *p;
 	afi_t afi;
 	safi_t safi = SAFI_UNICAST;
-	struct bgp *bgp;
-	struct listnode *mnode, *mnnode;
+	struct bgp *bgp, **targets;
+	unsigned int ntargets, i;
 	struct bgp_dest *bn;
 	struct bgp_path_info *bpi;
 	const char *debugmsg;
@@ -2783,8 +3244,13 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 	p = bgp_dest_get_prefix(path_vpn->net);
 	afi = family2afi(p->family);
 
-	/* Loop over VRFs */
-	for (ALL_LIST_ELEMENTS(bm->bgp, mnode, mnnode, bgp)) {
+	/* Loop over the VRFs importing one of the route targets */
+	targets = vpn_rt_index_targets(afi,
+				       bgp_attr_get_ecommunity(path_vpn->attr),
+				       &ntargets);
+	for (i = 0; i < ntargets; i++) {
+		bgp = targets[i];
+
 		if (!vpn_leak_from_vpn_active(bgp, afi, &debugmsg)) {
 			if (debug)
 				zlog_debug("%s: from %s, skipping: %s",
@@ -2793,15 +3259,6 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 			continue;
 		}
 
-		/* Check for intersection of route targets */
-		if (!ecommunity_include(
-			    bgp->vpn_policy[afi]
-				    .rtlist[BGP_VPN_POLICY_DIR_FROMVPN],
-			    bgp_attr_get_ecommunity(path_vpn->attr))) {
-
-			continue;
-		}
-
 		if (debug)
 			zlog_debug("%s: withdrawing from vrf %s", __func__,
 				   bgp->name_pretty);
@@ -2827,6 +3284,8 @@ void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn)
 		}
 		bgp_dest_unlock_node(bn);
 	}
+
+	XFREE(MTYPE_VPN_RT_INDEX, targets);
 }
 
 void vpn_leak_to_vrf_withdraw_all(struct bgp *to_bgp, afi_t afi)
@@ -3130,6 +3589,7 @@ void vpn_handle_router_id_update(struct bgp *bgp, bool withdraw,
 				else
 					bgp_import->vpn_policy[afi].rtlist[idir]
 						= ecommunity_dup(ecom);
+				vpn_leak_rt_index_invalidate();
 			}
 
 			/* Update routes to VPN */
@@ -3275,6 +3735,7 @@ void vrf_import_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp, const char *i
 					 .rtlist[idir], ecom);
 	else
 		to_bgp->vpn_policy[afi].rtlist[idir] = ecommunity_dup(ecom);
+	vpn_leak_rt_index_invalidate();
 
 	if (debug) {
 		const char *from_name;
@@ -3363,6 +3824,7 @@ void vrf_unimport_from_vrf(struct bgp *to_bgp, struct bgp *from_bgp, const char
 				   BGP_CONFIG_VRF_TO_VRF_IMPORT);
 		if (to_bgp->vpn_policy[afi].rtlist[idir])
 			ecommunity_free(&to_bgp->vpn_policy[afi].rtlist[idir]);
+		vpn_leak_rt_index_invalidate();
 	} else if (from_bgp) {
 		ecom = from_bgp->vpn_policy[afi].rtlist[edir];
 		if (ecom)
@@ -4034,6 +4496,72 @@ DEFUN (show_ip_bgp_vpn_rd_neighbor_advertised_routes,
 }
 #endif /* KEEP_OLD_VPN_COMMANDS */
 
+DEFUN (show_bgp_vpn_leak_queue,
+       show_bgp_vpn_leak_queue_cmd,
+       "show bgp vpn leak-queue [json]",
+       SHOW_STR
+       BGP_STR
+       "Display VPN specific information\n"
+       "VPN to VRF leak queue\n"
+       JSON_STR)
+{
+	bool uj = use_json(argc, argv);
+	size_t depth = 0, rts = 0, scan = 0;
+	uint64_t rate;
+	json_object *json;
+	afi_t afi;
+
+	if (vpn_leakq.inited)
+		depth = vpn_leakq_count(&vpn_leakq.queue);
+	for (afi = AFI_IP; vpn_rti.inited && afi < AFI_MAX; afi++) {
+		rts += vpn_rt_index_count(&vpn_rti.rts[afi]);
+		scan += listcount(vpn_rti.scan[afi]);
+	}
+	rate = vpn_leakq.busy_usec
+		       ? vpn_leakq.processed * 1000000 / vpn_leakq.busy_usec
+		       : 0;
+
+	if (uj) {
+		json = json_object_new_object();
+		json_object_int_add(json, "depth", depth);
+		json_object_int_add(json, "maxDepth", vpn_leakq.max_depth);
+		json_object_int_add(json, "queued", vpn_leakq.queued);
+		json_object_int_add(json, "processed", vpn_leakq.processed);
+		json_object_int_add(json, "leaks", vpn_leakq.leaks);
+		json_object_int_add(json, "batches", vpn_leakq.batches);
+		json_object_int_add(json, "busyUsec", vpn_leakq.busy_usec);
+		json_object_int_add(json, "pathsPerSecond", rate);
+		json_object_int_add(json, "lastBatch", vpn_leakq.last_batch);
+		json_object_int_add(json, "lastBatchUsec", vpn_leakq.last_usec);
+		json_object_int_add(json, "indexRouteTargets", rts);
+		json_object_int_add(json, "indexUnindexedVrfs", scan);
+		json_object_int_add(json, "indexRebuilds", vpn_rti.rebuilds);
+		vty_json(vty, json);
+		return CMD_SUCCESS;
+	}
+
+	vty_out(vty, "VPN to VRF leak queue:\n");
+	vty_out(vty, "  Depth: %zu, max %zu\n", depth, vpn_leakq.max_depth);
+	vty_out(vty,
+		"  Paths queued: %" PRIu64 ", processed: %" PRIu64
+		", leaked into VRFs: %" PRIu64 "\n",
+		vpn_leakq.queued, vpn_leakq.processed, vpn_leakq.leaks);
+	vty_out(vty,
+		"  Batches: %" PRIu64 ", busy %" PRId64 ".%03" PRId64
+		" ms, %" PRIu64 " paths/s\n",
+		vpn_leakq.batches, vpn_leakq.busy_usec / 1000,
+		vpn_leakq.busy_usec % 1000, rate);
+	vty_out(vty, "  Last batch: %zu paths in %" PRId64 " us\n",
+		vpn_leakq.last_batch, vpn_leakq.last_usec);
+	vty_out(vty, "Import route-target index:\n");
+	vty_out(vty,
+		"  Route-targets: %zu, unindexed VRFs: %zu, rebuilt %" PRIu64
+		" times\n",
+		rts, scan, vpn_rti.rebuilds);
+
+	return CMD_SUCCESS;
+}
+
 void bgp_mplsvpn_init(void)
 {
 	install_element(BGP_VPNV4_NODE, &vpnv4_network_cmd);
@@ -4045,6 +4573,7 @@ void bgp_mplsvpn_init(void)
 
 	install_element(VIEW_NODE, &show_bgp_ip_vpn_all_rd_cmd);
 	install_element(VIEW_NODE, &show_bgp_ip_vpn_rd_cmd);
+	install_element(VIEW_NODE, &show_bgp_vpn_leak_queue_cmd);
 #ifdef KEEP_OLD_VPN_COMMANDS
 	install_element(VIEW_NODE, &show_ip_bgp_vpn_rd_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_vpn_all_cmd);
@@ -4059,6 +4588,31 @@ void bgp_mplsvpn_init(void)
 #endif /* KEEP_OLD_VPN_COMMANDS */
 }
 
+void bgp_mplsvpn_finish(void)
+{
+	afi_t afi;
+
+	vpn_leak_to_vrf_queue_flush(NULL);
+	if (vpn_leakq.inited) {
+		vpn_leakq_fini(&vpn_leakq.queue);
+		vpn_leakq.inited = false;
+	}
+	XFREE(MTYPE_VPN_LEAK_JOB, vpn_leakq.pairs);
+	vpn_leakq.pairs_size = 0;
+
+	if (vpn_rti.inited) {
+		vpn_rt_index_flush();
+		for (afi = AFI_IP; afi < AFI_MAX; afi++) {
+			vpn_rt_index_fini(&vpn_rti.rts[afi]);
+			list_delete(&vpn_rti.scan[afi]);
+		}
+		vpn_rti.inited = false;
+	}
+	XFREE(MTYPE_VPN_RT_INDEX, vpn_rti.res);
+	vpn_rti.res_size = 0;
+	vpn_rti.valid = false;
+}
+
 vrf_id_t get_first_vrf_for_redirect_with_rt(struct ecommunity *eckey)
 {
 	struct listnode *mnode, *mnnode;
@@ -4321,6 +4875,7 @@ void bgp_vpn_leak_export(struct bgp *from_bgp)
 						to_vpolicy->rtlist[idir],
 						(struct ecommunity_val *)
 							ecom->val);
+				vpn_leak_rt_index_invalidate();
 				vrf_import_from_vrf(to_bgp, from_bgp, export_name, afi, safi);
 				break;
 
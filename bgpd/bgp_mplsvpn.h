@@ -33,6 +33,7 @@
 #define BGP_PREFIX_SID_SRV6_MAX_FUNCTION_LENGTH_FOR_BGP	  32
 
 extern void bgp_mplsvpn_init(void);
+extern void bgp_mplsvpn_finish(void);
 extern void bgp_mplsvpn_path_nh_label_unlink(struct bgp_path_info *pi);
 extern int bgp_nlri_parse_vpn(struct peer *peer, struct attr *attr, struct bgp_nlri *packet);
 
@@ -71,6 +72,12 @@ extern void vpn_leak_to_vrf_update(struct bgp *from_bgp, struct bgp_path_info *p
 
 extern void vpn_leak_to_vrf_withdraw(struct bgp_path_info *path_vpn);
 
+/* Drop the queued leaks of paths from or in @bgp, or all of them if NULL */
+extern void vpn_leak_to_vrf_queue_flush(struct bgp *bgp);
+
+/* To be called whenever an import RT list or the list of instances changes */
+extern void vpn_leak_rt_index_invalidate(void);
+
 extern void vpn_leak_zebra_vrf_label_update(struct bgp *bgp, afi_t afi);
 extern void vpn_leak_zebra_vrf_label_withdraw(struct bgp *bgp, afi_t afi);
 extern void vpn_leak_zebra_vrf_sid_update(struct bgp *bgp, afi_t afi);
@@ -267,6 +274,8 @@ static inline void vpn_leak_postchange(enum vpn_policy_direction direction,
 				       afi_t afi, struct bgp *bgp_vpn,
 				       struct bgp *bgp_vrf)
 {
+	vpn_leak_rt_index_invalidate();
+
 	/* Detect when default bgp instance is not (yet) defined by config */
 	if (!bgp_vpn)
 		return;
@@ -90,6 +90,7 @@ bool bnc_existing_for_prefix(struct bgp_nexthop_cache *bnc)
 
 void bnc_free(struct bgp_nexthop_cache *bnc)
 {
+	bgp_nht_eval_cancel(bnc);
 	bnc_nexthop_free(bnc);
 	bgp_nexthop_cache_del(bnc->tree, bnc);
 	XFREE(MTYPE_BGP_NEXTHOP_CACHE, bnc);
@@ -1123,6 +1124,14 @@ static void bgp_show_nexthop(struct vty *vty, struct bgp *bgp, struct bgp_nextho
 		vty_out(vty, "  Last update: %s", time_to_string(bnc->last_update, timebuf));
 	}
 
+	if (bgp_nht_eval_anywhere(bnc)) {
+		if (uj)
+			json_object_boolean_true_add(json_nexthop,
+						     "evaluationPending");
+		else
+			vty_out(vty, "  Paths being evaluated\n");
+	}
+
 	/* show paths dependent on nexthop, if needed. */
 	if (detail)
 		bgp_show_nexthop_paths(vty, bgp, bnc, json_nexthop);
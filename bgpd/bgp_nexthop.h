@@ -23,6 +23,7 @@
 #define BGP_MP_NEXTHOP_FAMILY NEXTHOP_FAMILY
 
 PREDECL_RBTREE_UNIQ(bgp_nexthop_cache);
+PREDECL_DLIST(bgp_nht_eval);
 
 /* BGP nexthop cache value structure. */
 struct bgp_nexthop_cache {
@@ -95,12 +96,20 @@ struct bgp_nexthop_cache {
 	LIST_HEAD(path_list, bgp_path_info) paths;
 	unsigned int path_count;
 	struct bgp *bgp;
+
+	/* Queued when there are too many paths to evaluate at once: the next
+	 * path to evaluate, and the changes seen since the walk (re)started.
+	 */
+	struct bgp_nht_eval_item eval_item;
+	struct bgp_path_info *eval_next;
+	uint8_t eval_flags;
 };
 
 extern int bgp_nexthop_cache_compare(const struct bgp_nexthop_cache *a,
 				     const struct bgp_nexthop_cache *b);
 DECLARE_RBTREE_UNIQ(bgp_nexthop_cache, struct bgp_nexthop_cache, entry,
 		    bgp_nexthop_cache_compare);
+DECLARE_DLIST(bgp_nht_eval, struct bgp_nexthop_cache, eval_item);
 
 /* Own tunnel-ip address structure */
 struct tip_addr {
@@ -1406,17 +1406,36 @@ static bool bgp_nht_handle_gr_stale_nh_unreach(struct bgp_path_info *path,
 	return true;
 }
 
+/*
+ * Nexthops with more than BGP_NHT_EVAL_BATCH paths are not evaluated at once,
+ * the walk over their paths is resumed from an event, a batch at a time.
+ * Walks for nexthops that became reachable or unreachable, or whose
+ * nexthops changed, go before those for nexthops whose metric alone
+ * changed.  An update for a nexthop whose walk is pending restarts the
+ * walk, with the changes of both, rather than queueing another one.
+ */
+static struct bgp_nht_eval_queue {
+	struct bgp_nht_eval_head high;
+	struct bgp_nht_eval_head low;
+	struct event *t_eval;
+} bne = {
+	.high = INIT_DLIST(bne.high),
+	.low = INIT_DLIST(bne.low),
+};
+
 /**
- * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
+ * evaluate_path - Evaluate one of the paths associated with a nexthop.
  * ARGUMENTS:
  *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
+ *   struct bgp_path_info *path -- the path.
+ *   uint8_t change_flags -- the changes to the nexthop.
  * RETURNS:
  *   void.
  */
-void evaluate_paths(struct bgp_nexthop_cache *bnc)
+static void evaluate_path(struct bgp_nexthop_cache *bnc,
+			  struct bgp_path_info *path, uint8_t change_flags)
 {
 	struct bgp_dest *dest;
-	struct bgp_path_info *path;
 	struct bgp_path_info *bpi_ultimate;
 	int afi;
 	struct peer *peer = (struct peer *)bnc->nht_info;
@@ -1425,227 +1444,331 @@ void evaluate_paths(struct bgp_nexthop_cache *bnc)
 	struct bgp *bgp_path;
 	const struct prefix *p;
 
-	if (BGP_DEBUG(nht, NHT)) {
-		char bnc_buf[BNC_FLAG_DUMP_SIZE];
-		char chg_buf[BNC_FLAG_DUMP_SIZE];
-
-		zlog_debug(
-			"NH update for %pFX(%d)(%u)(%s) - flags %s chgflags %s- evaluate paths",
-			&bnc->prefix, bnc->ifindex_ipv6_ll, bnc->srte_color,
-			bnc->bgp->name_pretty,
-			bgp_nexthop_dump_bnc_flags(bnc, bnc_buf,
-						   sizeof(bnc_buf)),
-			bgp_nexthop_dump_bnc_change_flags(bnc, chg_buf,
-							  sizeof(bnc_buf)));
-	}
+	/*
+	 * Currently when a peer goes down, bgp immediately
+	 * sees this via the interface events( if it is directly
+	 * connected).  And in this case it takes and puts on
+	 * a special peer queue all path info's associated with
+	 * but these items are not yet processed typically when
+	 * the nexthop is being handled here.  Thus we end
+	 * up in a situation where the process Queue for BGP
+	 * is being asked to look at the same path info multiple
+	 * times.  Let's just cut to the chase here and if
+	 * the bnc has a peer associated with it and the path info
+	 * being looked at uses that peer and the peer is no
+	 * longer established we know the path_info is being
+	 * handled elsewhere and we do not need to process
+	 * it here at all since the pathinfo is going away
+	 */
+	if (peer && path->peer == peer && !peer_established(peer->connection))
+		return;
 
-	LIST_FOREACH (path, &(bnc->paths), nh_thread) {
-		/*
-		 * Currently when a peer goes down, bgp immediately
-		 * sees this via the interface events( if it is directly
-		 * connected).  And in this case it takes and puts on
-		 * a special peer queue all path info's associated with
-		 * but these items are not yet processed typically when
-		 * the nexthop is being handled here.  Thus we end
-		 * up in a situation where the process Queue for BGP
-		 * is being asked to look at the same path info multiple
-		 * times.  Let's just cut to the chase here and if
-		 * the bnc has a peer associated with it and the path info
-		 * being looked at uses that peer and the peer is no
-		 * longer established we know the path_info is being
-		 * handled elsewhere and we do not need to process
-		 * it here at all since the pathinfo is going away
+	if (path->type == ZEBRA_ROUTE_BGP &&
+	    (path->sub_type == BGP_ROUTE_NORMAL ||
+	     path->sub_type == BGP_ROUTE_STATIC ||
+	     path->sub_type == BGP_ROUTE_IMPORTED))
+		/* evaluate the path */
+		;
+	else if (path->sub_type == BGP_ROUTE_REDISTRIBUTE) {
+		/* evaluate the path for redistributed routes
+		 * except those from VNC
 		 */
-		if (peer && path->peer == peer && !peer_established(peer->connection))
-			continue;
+		if ((path->type == ZEBRA_ROUTE_VNC) ||
+		    (path->type == ZEBRA_ROUTE_VNC_DIRECT))
+			return;
+	} else
+		/* don't evaluate the path */
+		return;
 
-		if (path->type == ZEBRA_ROUTE_BGP &&
-		    (path->sub_type == BGP_ROUTE_NORMAL ||
-		     path->sub_type == BGP_ROUTE_STATIC ||
-		     path->sub_type == BGP_ROUTE_IMPORTED))
-			/* evaluate the path */
-			;
-		else if (path->sub_type == BGP_ROUTE_REDISTRIBUTE) {
-			/* evaluate the path for redistributed routes
-			 * except those from VNC
-			 */
-			if ((path->type == ZEBRA_ROUTE_VNC) ||
-			    (path->type == ZEBRA_ROUTE_VNC_DIRECT))
-				continue;
+	dest = path->net;
+	assert(dest && bgp_dest_table(dest));
+	p = bgp_dest_get_prefix(dest);
+	afi = family2afi(p->family);
+	table = bgp_dest_table(dest);
+	safi = table->safi;
+
+	/*
+	 * handle routes from other VRFs (they can have a
+	 * nexthop in THIS VRF). bgp_path is the bgp instance
+	 * that owns the route referencing this nexthop.
+	 */
+	bgp_path = table->bgp;
+
+	/*
+	 * Path becomes valid/invalid depending on whether the nexthop
+	 * reachable/unreachable.
+	 *
+	 * In case of unicast routes that were imported from vpn
+	 * and that have labels, they are valid only if there are
+	 * nexthops with labels
+	 *
+	 * If the nexthop is EVPN gateway-IP,
+	 * do not check for a valid label.
+	 */
+
+	bool bnc_is_valid_nexthop = false;
+	bool old_path_valid = false;
+	struct bgp_route_evpn *bre =
+		bgp_attr_get_evpn_overlay(path->attr);
+
+	if (safi == SAFI_UNICAST &&
+	    path->sub_type == BGP_ROUTE_IMPORTED &&
+	    BGP_PATH_INFO_NUM_LABELS(path) &&
+	    !(bre && bre->type == OVERLAY_INDEX_GATEWAY_IP)) {
+		bnc_is_valid_nexthop =
+			bgp_isvalid_nexthop_for_l3vpn(bnc, path)
+				? true
+				: false;
+	} else if (safi == SAFI_MPLS_VPN &&
+		   path->sub_type != BGP_ROUTE_IMPORTED) {
+		/* avoid not redistributing mpls vpn routes */
+		bnc_is_valid_nexthop = true;
+	} else {
+		/* mpls-vpn routes with BGP_ROUTE_IMPORTED subtype */
+		if (bgp_update_martian_nexthop(
+			    bnc->bgp, afi, safi, path->type,
+			    path->sub_type, path->attr, dest)) {
+			if (BGP_DEBUG(nht, NHT))
+				zlog_debug(
+					"%s: prefix %pBD (vrf %s), ignoring path due to martian or self-next-hop",
+					__func__, dest, bgp_path->name);
 		} else
-			/* don't evaluate the path */
-			continue;
+			bnc_is_valid_nexthop =
+				bgp_isvalid_nexthop(bnc) ? true : false;
+	}
 
-		dest = path->net;
-		assert(dest && bgp_dest_table(dest));
-		p = bgp_dest_get_prefix(dest);
-		afi = family2afi(p->family);
-		table = bgp_dest_table(dest);
-		safi = table->safi;
+	if (BGP_DEBUG(nht, NHT)) {
 
-		/*
-		 * handle routes from other VRFs (they can have a
-		 * nexthop in THIS VRF). bgp_path is the bgp instance
-		 * that owns the route referencing this nexthop.
-		 */
-		bgp_path = table->bgp;
+		if (dest->pdest) {
+			char rd_buf[RD_ADDRSTRLEN];
 
-		/*
-		 * Path becomes valid/invalid depending on whether the nexthop
-		 * reachable/unreachable.
-		 *
-		 * In case of unicast routes that were imported from vpn
-		 * and that have labels, they are valid only if there are
-		 * nexthops with labels
-		 *
-		 * If the nexthop is EVPN gateway-IP,
-		 * do not check for a valid label.
-		 */
+			prefix_rd2str(
+				(struct prefix_rd *)bgp_dest_get_prefix(
+					dest->pdest),
+				rd_buf, sizeof(rd_buf),
+				bgp_get_asnotation(bnc->bgp));
+			zlog_debug(
+				"... eval path %d/%d %pBD RD %s %s flags 0x%x",
+				afi, safi, dest, rd_buf,
+				bgp_path->name_pretty, path->flags);
+		} else
+			zlog_debug(
+				"... eval path %d/%d %pBD %s flags 0x%x",
+				afi, safi, dest, bgp_path->name_pretty,
+				path->flags);
+	}
 
-		bool bnc_is_valid_nexthop = false;
-		bool old_path_valid = false;
-		struct bgp_route_evpn *bre =
-			bgp_attr_get_evpn_overlay(path->attr);
+	/* Skip paths marked for removal or as history. */
+	if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED)
+	    || CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
+		return;
 
-		if (safi == SAFI_UNICAST &&
-		    path->sub_type == BGP_ROUTE_IMPORTED &&
-		    BGP_PATH_INFO_NUM_LABELS(path) &&
-		    !(bre && bre->type == OVERLAY_INDEX_GATEWAY_IP)) {
-			bnc_is_valid_nexthop =
-				bgp_isvalid_nexthop_for_l3vpn(bnc, path)
-					? true
-					: false;
-		} else if (safi == SAFI_MPLS_VPN &&
-			   path->sub_type != BGP_ROUTE_IMPORTED) {
-			/* avoid not redistributing mpls vpn routes */
-			bnc_is_valid_nexthop = true;
+	/* Copy the metric to the path. Will be used for bestpath
+	 * computation */
+	bpi_ultimate = bgp_get_imported_bpi_ultimate(path);
+	if (bgp_isvalid_nexthop(bnc) && bnc->metric)
+		(bgp_path_info_extra_get(bpi_ultimate))->igpmetric =
+			bnc->metric;
+	else if (bpi_ultimate->extra)
+		bpi_ultimate->extra->igpmetric = 0;
+
+	if (CHECK_FLAG(change_flags, BGP_NEXTHOP_METRIC_CHANGED) ||
+	    CHECK_FLAG(change_flags, BGP_NEXTHOP_CHANGED) ||
+	    bgp_path_info_get_srte_color(path))
+		SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
+
+	old_path_valid = CHECK_FLAG(path->flags, BGP_PATH_VALID);
+	if (path->type == ZEBRA_ROUTE_BGP &&
+	    path->sub_type == BGP_ROUTE_STATIC &&
+	    !CHECK_FLAG(bgp_path->flags, BGP_FLAG_IMPORT_CHECK))
+		/* static routes with 'no bgp network import-check' are
+		 * always valid. if nht is called with static routes,
+		 * the vpn exportation needs to be triggered
+		 */
+		vpn_leak_from_vrf_update(bgp_get_default(), bgp_path,
+					 path);
+	else if (path->sub_type == BGP_ROUTE_REDISTRIBUTE &&
+		 safi == SAFI_UNICAST &&
+		 (bgp_path->inst_type == BGP_INSTANCE_TYPE_VRF ||
+		  bgp_path->inst_type == BGP_INSTANCE_TYPE_DEFAULT))
+		/* redistribute routes are always valid
+		 * if nht is called with redistribute routes, the vpn
+		 * exportation needs to be triggered
+		 */
+		vpn_leak_from_vrf_update(bgp_get_default(), bgp_path,
+					 path);
+	else if (old_path_valid != bnc_is_valid_nexthop) {
+		if (old_path_valid) {
+			if (bgp_nht_handle_gr_stale_nh_unreach(path, bnc, dest, p,
+							       bgp_path, afi, safi))
+				return;
+
+			/* No longer valid, clear flag; also for EVPN
+			 * routes, unimport from VRFs if needed.
+			 */
+			bgp_aggregate_decrement(bgp_path, p, path, afi,
+						safi);
+			bgp_path_info_unset_flag(dest, path,
+						 BGP_PATH_VALID);
+			if (safi == SAFI_EVPN &&
+			    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
+				bgp_evpn_unimport_route(bgp_path,
+					afi, safi, bgp_dest_get_prefix(dest), path);
+			if (safi == SAFI_UNICAST &&
+			    (bgp_path->inst_type !=
+			     BGP_INSTANCE_TYPE_VIEW))
+				vpn_leak_from_vrf_withdraw(
+					bgp_get_default(), bgp_path,
+					path);
 		} else {
-			/* mpls-vpn routes with BGP_ROUTE_IMPORTED subtype */
-			if (bgp_update_martian_nexthop(
-				    bnc->bgp, afi, safi, path->type,
-				    path->sub_type, path->attr, dest)) {
-				if (BGP_DEBUG(nht, NHT))
-					zlog_debug(
-						"%s: prefix %pBD (vrf %s), ignoring path due to martian or self-next-hop",
-						__func__, dest, bgp_path->name);
-			} else
-				bnc_is_valid_nexthop =
-					bgp_isvalid_nexthop(bnc) ? true : false;
+			/* Path becomes valid, set flag; also for EVPN
+			 * routes, import from VRFs if needed.
+			 */
+			bgp_path_info_set_flag(dest, path,
+					       BGP_PATH_VALID);
+			bgp_aggregate_increment(bgp_path, p, path, afi,
+						safi);
+			if (safi == SAFI_EVPN &&
+			    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
+				bgp_evpn_import_route(bgp_path,
+					afi, safi, bgp_dest_get_prefix(dest), path);
+			if (safi == SAFI_UNICAST &&
+			    (bgp_path->inst_type !=
+			     BGP_INSTANCE_TYPE_VIEW))
+				vpn_leak_from_vrf_update(
+					bgp_get_default(), bgp_path,
+					path);
 		}
+	}
 
-		if (BGP_DEBUG(nht, NHT)) {
+	if (old_path_valid != bnc_is_valid_nexthop)
+		hook_call(bgp_nht_path_update, bgp_path, path, bnc_is_valid_nexthop);
 
-			if (dest->pdest) {
-				char rd_buf[RD_ADDRSTRLEN];
+	if (old_path_valid != bnc_is_valid_nexthop ||
+	    CHECK_FLAG(change_flags, BGP_NEXTHOP_METRIC_CHANGED) ||
+	    CHECK_FLAG(change_flags, BGP_NEXTHOP_CHANGED))
+		bgp_process(bgp_path, dest, path, afi, safi);
+}
 
-				prefix_rd2str(
-					(struct prefix_rd *)bgp_dest_get_prefix(
-						dest->pdest),
-					rd_buf, sizeof(rd_buf),
-					bgp_get_asnotation(bnc->bgp));
-				zlog_debug(
-					"... eval path %d/%d %pBD RD %s %s flags 0x%x",
-					afi, safi, dest, rd_buf,
-					bgp_path->name_pretty, path->flags);
-			} else
-				zlog_debug(
-					"... eval path %d/%d %pBD %s flags 0x%x",
-					afi, safi, dest, bgp_path->name_pretty,
-					path->flags);
-		}
+static void bgp_nht_eval_run(struct event *event);
 
-		/* Skip paths marked for removal or as history. */
-		if (CHECK_FLAG(path->flags, BGP_PATH_REMOVED)
-		    || CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
-			continue;
+static void bgp_nht_eval_schedule(void)
+{
+	if (!bne.t_eval)
+		event_add_event(bm->master, bgp_nht_eval_run, NULL, 0,
+				&bne.t_eval);
+}
 
-		/* Copy the metric to the path. Will be used for bestpath
-		 * computation */
-		bpi_ultimate = bgp_get_imported_bpi_ultimate(path);
-		if (bgp_isvalid_nexthop(bnc) && bnc->metric)
-			(bgp_path_info_extra_get(bpi_ultimate))->igpmetric =
-				bnc->metric;
-		else if (bpi_ultimate->extra)
-			bpi_ultimate->extra->igpmetric = 0;
+static void bgp_nht_eval_run(struct event *event)
+{
+	struct bgp_nexthop_cache *bnc;
+	struct bgp_path_info *path;
+	unsigned int count = 0;
+
+	while (count < BGP_NHT_EVAL_BATCH) {
+		bnc = bgp_nht_eval_first(&bne.high);
+		if (!bnc)
+			bnc = bgp_nht_eval_first(&bne.low);
+		if (!bnc)
+			break;
+
+		/* path_nh_map() moves the cursor on if it unlinks its path */
+		while (count < BGP_NHT_EVAL_BATCH && (path = bnc->eval_next)) {
+			bnc->eval_next = LIST_NEXT(path, nh_thread);
+			evaluate_path(bnc, path, bnc->eval_flags);
+			count++;
+		}
 
-		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED) ||
-		    CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED) ||
-		    bgp_path_info_get_srte_color(path))
-			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
-
-		old_path_valid = CHECK_FLAG(path->flags, BGP_PATH_VALID);
-		if (path->type == ZEBRA_ROUTE_BGP &&
-		    path->sub_type == BGP_ROUTE_STATIC &&
-		    !CHECK_FLAG(bgp_path->flags, BGP_FLAG_IMPORT_CHECK))
-			/* static routes with 'no bgp network import-check' are
-			 * always valid. if nht is called with static routes,
-			 * the vpn exportation needs to be triggered
-			 */
-			vpn_leak_from_vrf_update(bgp_get_default(), bgp_path,
-						 path);
-		else if (path->sub_type == BGP_ROUTE_REDISTRIBUTE &&
-			 safi == SAFI_UNICAST &&
-			 (bgp_path->inst_type == BGP_INSTANCE_TYPE_VRF ||
-			  bgp_path->inst_type == BGP_INSTANCE_TYPE_DEFAULT))
-			/* redistribute routes are always valid
-			 * if nht is called with redistribute routes, the vpn
-			 * exportation needs to be triggered
-			 */
-			vpn_leak_from_vrf_update(bgp_get_default(), bgp_path,
-						 path);
-		else if (old_path_valid != bnc_is_valid_nexthop) {
-			if (old_path_valid) {
-				if (bgp_nht_handle_gr_stale_nh_unreach(path, bnc, dest, p,
-								       bgp_path, afi, safi))
-					continue;
-
-				/* No longer valid, clear flag; also for EVPN
-				 * routes, unimport from VRFs if needed.
-				 */
-				bgp_aggregate_decrement(bgp_path, p, path, afi,
-							safi);
-				bgp_path_info_unset_flag(dest, path,
-							 BGP_PATH_VALID);
-				if (safi == SAFI_EVPN &&
-				    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
-					bgp_evpn_unimport_route(bgp_path,
-						afi, safi, bgp_dest_get_prefix(dest), path);
-				if (safi == SAFI_UNICAST &&
-				    (bgp_path->inst_type !=
-				     BGP_INSTANCE_TYPE_VIEW))
-					vpn_leak_from_vrf_withdraw(
-						bgp_get_default(), bgp_path,
-						path);
-			} else {
-				/* Path becomes valid, set flag; also for EVPN
-				 * routes, import from VRFs if needed.
-				 */
-				bgp_path_info_set_flag(dest, path,
-						       BGP_PATH_VALID);
-				bgp_aggregate_increment(bgp_path, p, path, afi,
-							safi);
-				if (safi == SAFI_EVPN &&
-				    bgp_evpn_is_prefix_nht_supported(bgp_dest_get_prefix(dest)))
-					bgp_evpn_import_route(bgp_path,
-						afi, safi, bgp_dest_get_prefix(dest), path);
-				if (safi == SAFI_UNICAST &&
-				    (bgp_path->inst_type !=
-				     BGP_INSTANCE_TYPE_VIEW))
-					vpn_leak_from_vrf_update(
-						bgp_get_default(), bgp_path,
-						path);
-			}
+		if (!bnc->eval_next) {
+			if (BGP_DEBUG(nht, NHT))
+				zlog_debug("%s: done evaluating paths for %pFX(%s)",
+					   __func__, &bnc->prefix,
+					   bnc->bgp->name_pretty);
+			bgp_nht_eval_cancel(bnc);
 		}
+	}
+
+	if (bgp_nht_eval_count(&bne.high) || bgp_nht_eval_count(&bne.low))
+		bgp_nht_eval_schedule();
+}
+
+static void bgp_nht_eval_queue(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_nht_eval_head *head;
+
+	if (bgp_nht_eval_anywhere(bnc)) {
+		SET_FLAG(bnc->eval_flags, bnc->change_flags);
+		if (bgp_nht_eval_member(&bne.high, bnc))
+			bgp_nht_eval_del(&bne.high, bnc);
+		else
+			bgp_nht_eval_del(&bne.low, bnc);
+	} else
+		bnc->eval_flags = bnc->change_flags;
 
-		if (old_path_valid != bnc_is_valid_nexthop)
-			hook_call(bgp_nht_path_update, bgp_path, path, bnc_is_valid_nexthop);
+	/* reachability is found out per path, so only metric changes wait */
+	head = bnc->eval_flags == BGP_NEXTHOP_METRIC_CHANGED ? &bne.low
+							     : &bne.high;
+	bnc->eval_next = LIST_FIRST(&bnc->paths);
+	bgp_nht_eval_add_tail(head, bnc);
+	bgp_nht_eval_schedule();
 
-		if (old_path_valid != bnc_is_valid_nexthop ||
-		    CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED) ||
-		    CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
-			bgp_process(bgp_path, dest, path, afi, safi);
+	if (BGP_DEBUG(nht, NHT))
+		zlog_debug("%s: %u paths for %pFX(%s) to evaluate in the background%s",
+			   __func__, bnc->path_count, &bnc->prefix,
+			   bnc->bgp->name_pretty,
+			   head == &bne.low ? ", after reachability changes"
+					    : "");
+}
+
+void bgp_nht_eval_cancel(struct bgp_nexthop_cache *bnc)
+{
+	if (!bgp_nht_eval_anywhere(bnc))
+		return;
+
+	if (bgp_nht_eval_member(&bne.high, bnc))
+		bgp_nht_eval_del(&bne.high, bnc);
+	else
+		bgp_nht_eval_del(&bne.low, bnc);
+	bnc->eval_next = NULL;
+	bnc->eval_flags = 0;
+
+	if (!bgp_nht_eval_count(&bne.high) && !bgp_nht_eval_count(&bne.low))
+		event_cancel(&bne.t_eval);
+}
+
+/**
+ * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
+ * ARGUMENTS:
+ *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
+ * RETURNS:
+ *   void.
+ */
+void evaluate_paths(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_path_info *path;
+	struct peer *peer = (struct peer *)bnc->nht_info;
+
+	if (BGP_DEBUG(nht, NHT)) {
+		char bnc_buf[BNC_FLAG_DUMP_SIZE];
+		char chg_buf[BNC_FLAG_DUMP_SIZE];
+
+		zlog_debug(
+			"NH update for %pFX(%d)(%u)(%s) - flags %s chgflags %s- evaluate paths",
+			&bnc->prefix, bnc->ifindex_ipv6_ll, bnc->srte_color,
+			bnc->bgp->name_pretty,
+			bgp_nexthop_dump_bnc_flags(bnc, bnc_buf,
+						   sizeof(bnc_buf)),
+			bgp_nexthop_dump_bnc_change_flags(bnc, chg_buf,
+							  sizeof(bnc_buf)));
 	}
 
+	if (bnc->path_count > BGP_NHT_EVAL_BATCH ||
+	    bgp_nht_eval_anywhere(bnc))
+		bgp_nht_eval_queue(bnc);
+	else
+		LIST_FOREACH (path, &(bnc->paths), nh_thread)
+			evaluate_path(bnc, path, bnc->change_flags);
+
 	if (peer) {
 		int valid_nexthops = bgp_isvalid_nexthop(bnc);
 
@@ -1686,6 +1809,8 @@ void path_nh_map(struct bgp_path_info *path, struct bgp_nexthop_cache *bnc,
 		 bool make)
 {
 	if (path->nexthop) {
+		if (path->nexthop->eval_next == path)
+			path->nexthop->eval_next = LIST_NEXT(path, nh_thread);
 		LIST_REMOVE(path, nh_thread);
 		path->nexthop->path_count--;
 		path->nexthop = NULL;
@@ -78,6 +78,14 @@ extern void bgp_nht_reg_enhe_cap_intfs(struct peer *peer);
 extern void bgp_nht_dereg_enhe_cap_intfs(struct peer *peer);
 extern void evaluate_paths(struct bgp_nexthop_cache *bnc);
 
+/*
+ * Nexthops with more paths than are evaluated in one go have the rest of
+ * them evaluated in the background, see evaluate_paths().  Called before
+ * the nexthop is freed.
+ */
+#define BGP_NHT_EVAL_BATCH 10000
+extern void bgp_nht_eval_cancel(struct bgp_nexthop_cache *bnc);
+
 extern void bgp_nht_ifp_up(struct interface *ifp);
 extern void bgp_nht_ifp_down(struct interface *ifp);
 
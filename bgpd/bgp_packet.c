@@ -7,6 +7,7 @@
 
 #include <zebra.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #include "frrevent.h"
 #include "stream.h"
@@ -45,8 +46,10 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_updgrp_build.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_unreach.h"
@@ -104,6 +107,102 @@ void bgp_packet_set_size(struct stream *s)
 	stream_putw_at(s, BGP_MARKER_SIZE, cp);
 }
 
+/* Output queue byte counters, see "show bgp io" */
+static struct {
+	/* UPDATE bytes copied for each peer */
+	atomic_uint_fast64_t copied;
+	/* UPDATE bytes queued as a reference to the subgroup packet */
+	atomic_uint_fast64_t shared;
+	/* bytes written to the sockets */
+	atomic_uint_fast64_t sent;
+} obuf_stats;
+
+void bgp_obuf_stats_add(size_t copied, size_t shared)
+{
+	atomic_fetch_add_explicit(&obuf_stats.copied, copied,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&obuf_stats.shared, shared,
+				  memory_order_relaxed);
+}
+
+void bgp_obuf_stats_sent(size_t sent)
+{
+	atomic_fetch_add_explicit(&obuf_stats.sent, sent, memory_order_relaxed);
+}
+
+void bgp_obuf_show(struct vty *vty, json_object *json)
+{
+	uint64_t copied, shared, sent;
+
+	copied = atomic_load_explicit(&obuf_stats.copied, memory_order_relaxed);
+	shared = atomic_load_explicit(&obuf_stats.shared, memory_order_relaxed);
+	sent = atomic_load_explicit(&obuf_stats.sent, memory_order_relaxed);
+
+	if (json) {
+		json_object_boolean_add(json, "outputZeroCopy",
+					CHECK_FLAG(bm->flags,
+						   BM_FLAG_OUTPUT_ZERO_COPY));
+		json_object_int_add(json, "outputBytesCopied", copied);
+		json_object_int_add(json, "outputBytesShared", shared);
+		json_object_int_add(json, "outputBytesSent", sent);
+		return;
+	}
+
+	vty_out(vty, "Output zero-copy: %s\n",
+		CHECK_FLAG(bm->flags, BM_FLAG_OUTPUT_ZERO_COPY) ? "enabled"
+								 : "disabled");
+	vty_out(vty,
+		"  UPDATE bytes copied: %" PRIu64 ", shared: %" PRIu64
+		", total bytes sent: %" PRIu64 "\n",
+		copied, shared, sent);
+}
+
+/*
+ * Output queue entries are either plain streams or bpacket_refs sharing
+ * a subgroup packet; these handle both.
+ */
+unsigned int bgp_obuf_iov(struct stream *s, struct iovec *iov)
+{
+	if (bpacket_ref_check(s))
+		return bpacket_ref_iov(s, iov);
+
+	iov->iov_base = stream_pnt(s);
+	iov->iov_len = STREAM_READABLE(s);
+	return 1;
+}
+
+void bgp_obuf_forward(struct stream *s, size_t size)
+{
+	if (bpacket_ref_check(s))
+		bpacket_ref_forward(s, size);
+	else
+		stream_forward_getp(s, size);
+}
+
+uint8_t bgp_obuf_type(struct stream *s)
+{
+	if (bpacket_ref_check(s))
+		return bpacket_ref_type(s);
+
+	return stream_getc_from(s, BGP_MARKER_SIZE + 2);
+}
+
+void bgp_obuf_free(struct stream *s)
+{
+	if (bpacket_ref_check(s))
+		bpacket_ref_free(s);
+	else
+		stream_free(s);
+}
+
+void bgp_obuf_clean(struct stream_fifo *fifo)
+{
+	struct stream *s;
+
+	while ((s = stream_fifo_pop(fifo)) != NULL)
+		bgp_obuf_free(s);
+}
+
 /*
  * Push a packet onto the beginning of the peer's output queue.
  * This function acquires the peer's write mutex before proceeding.
@@ -526,6 +625,11 @@ void bgp_generate_updgrp_packets(struct event *event)
 			 * the end of the list. Always try to push out
 			 * WITHDRAWs first.
 			 */
+			if (!next_pkt || !next_pkt->buffer) {
+				/* Format for all ready subgroups at once */
+				bgp_updgrp_build_run();
+				next_pkt = paf->next_pkt_to_send;
+			}
 			if (!next_pkt || !next_pkt->buffer) {
 				next_pkt = subgroup_withdraw_packet(
 					PAF_SUBGRP(paf));
@@ -985,7 +1089,7 @@ static void bgp_notify_send_internal(struct peer_connection *connection,
 	bgp_packet_set_size(s);
 
 	/* wipe output buffer */
-	stream_fifo_clean(connection->obuf);
+	bgp_obuf_clean(connection->obuf);
 
 	/*
 	 * If possible, store last packet for debugging purposes. This check is
@@ -2408,6 +2512,7 @@ static int bgp_update_receive(struct peer_connection *connection, bgp_size_t siz
 		NLRI_TYPE_MAX
 	};
 	struct bgp_nlri nlris[NLRI_TYPE_MAX];
+	const struct bgp_parse_nlri *decoded;
 
 	/* Status must be Established. */
 	if (!peer_established(connection)) {
@@ -2576,16 +2681,26 @@ static int bgp_update_receive(struct peer_connection *connection, bgp_size_t siz
 		if (nlris[i].length == 0)
 			continue;
 
+		/* Already decoded by a parse worker? */
+		decoded = bgp_parse_job_nlri(connection->curr_job, peer, &nlris[i]);
+
 		switch (i) {
 		case NLRI_UPDATE:
 		case NLRI_MP_UPDATE:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 0);
+			if (decoded)
+				nlri_ret = bgp_nlri_parse_decoded(peer, NLRI_ATTR_ARG,
+								  decoded);
+			else
+				nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
+							  &nlris[i], 0);
 			break;
 		case NLRI_WITHDRAW:
 		case NLRI_MP_WITHDRAW:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 1);
+			if (decoded)
+				nlri_ret = bgp_nlri_parse_decoded(peer, NULL, decoded);
+			else
+				nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
+							  &nlris[i], 1);
 			break;
 		default:
 			nlri_ret = BGP_NLRI_PARSE_ERROR;
@@ -4148,6 +4263,7 @@ void bgp_process_packet(struct event *event)
 	while ((processed < total_packets_to_process) && connection) {
 		/* Guard against scheduled events that occur after peer deletion. */
 		if (connection->status == Deleted || connection->status == Clearing) {
+			bgp_inq_unschedule(connection->ibuf);
 			frr_with_mutex (&bm->peer_connection_mtx)
 				connection = peer_connection_fifo_pop(&bm->connection_fifo);
 
@@ -4162,16 +4278,18 @@ void bgp_process_packet(struct event *event)
 		char notify_data_length[2];
 
 		bool rearm_reads = false;
+		struct bgp_parse_job *job;
 
-		frr_with_mutex (&connection->io_mtx) {
-			rearm_reads = (bm->inq_limit && connection->ibuf->count >= bm->inq_limit);
-			connection->curr = stream_fifo_pop(connection->ibuf);
-		}
+		rearm_reads = (bm->inq_limit && bgp_inq_count(connection->ibuf) >= bm->inq_limit);
+		connection->curr = bgp_inq_pop(connection->ibuf, &job);
 
 		if (rearm_reads)
 			bgp_reads_on(connection);
 
 		if (connection->curr == NULL) {
+			if (!bgp_inq_idle(connection->ibuf))
+				continue;
+
 			frr_with_mutex (&bm->peer_connection_mtx)
 				connection = peer_connection_fifo_pop(&bm->connection_fifo);
 
@@ -4182,6 +4300,9 @@ void bgp_process_packet(struct event *event)
 			continue;
 		}
 
+		/* pick up the parse worker's result, if any */
+		connection->curr_job = bgp_parse_claim(job);
+
 		/* skip the marker and copy the packet length */
 		stream_forward_getp(connection->curr, BGP_MARKER_SIZE);
 		memcpy(notify_data_length, stream_pnt(connection->curr), 2);
@@ -4283,6 +4404,7 @@ void bgp_process_packet(struct event *event)
 		/* delete processed packet */
 		stream_free(connection->curr);
 		connection->curr = NULL;
+		bgp_parse_job_free(&connection->curr_job);
 		processed++;
 		curr_connection_processed++;
 
@@ -4296,6 +4418,7 @@ void bgp_process_packet(struct event *event)
 		 */
 		if (fsm_update_result == FSM_PEER_TRANSFERRED ||
 		    fsm_update_result == FSM_PEER_STOPPED) {
+			bgp_inq_unschedule(connection->ibuf);
 			frr_with_mutex (&bm->peer_connection_mtx)
 				connection = peer_connection_fifo_pop(&bm->connection_fifo);
 
@@ -4323,12 +4446,7 @@ void bgp_process_packet(struct event *event)
 			continue;
 		}
 
-		frr_with_mutex (&connection->io_mtx) {
-			if (connection->ibuf->count > 0)
-				more_work = true;
-			else
-				more_work = false;
-		}
+		more_work = !bgp_inq_idle(connection->ibuf);
 
 		if (!more_work) {
 			frr_with_mutex (&bm->peer_connection_mtx)
@@ -4340,12 +4458,7 @@ void bgp_process_packet(struct event *event)
 	}
 
 	if (connection) {
-		frr_with_mutex (&connection->io_mtx) {
-			if (connection->ibuf->count > 0)
-				more_work = true;
-			else
-				more_work = false;
-		}
+		more_work = !bgp_inq_idle(connection->ibuf);
 		frr_with_mutex (&bm->peer_connection_mtx) {
 			if (more_work &&
 			    !peer_connection_fifo_member(&bm->connection_fifo, connection))
@@ -7,6 +7,9 @@
 #define _QUAGGA_BGP_PACKET_H
 
 #include "hook.h"
+#include "json.h"
+
+struct iovec;
 
 struct bgp_enhe_capability {
 	uint16_t afi;
@@ -88,4 +91,16 @@ extern bool bgp_notify_send_hard_reset(struct peer *peer, uint8_t code,
 extern bool bgp_notify_received_hard_reset(struct peer *peer, uint8_t code,
 					   uint8_t subcode);
 
+/* Helpers for the entries of a connection's output queue (obuf) */
+#define BGP_OBUF_IOV_MAX 3 /* iovecs filled by bgp_obuf_iov() at most */
+extern unsigned int bgp_obuf_iov(struct stream *s, struct iovec *iov);
+extern void bgp_obuf_forward(struct stream *s, size_t size);
+extern uint8_t bgp_obuf_type(struct stream *s);
+extern void bgp_obuf_free(struct stream *s);
+extern void bgp_obuf_clean(struct stream_fifo *fifo);
+
+extern void bgp_obuf_stats_add(size_t copied, size_t shared);
+extern void bgp_obuf_stats_sent(size_t sent);
+extern void bgp_obuf_show(struct vty *vty, json_object *json);
+
 #endif /* _QUAGGA_BGP_PACKET_H */
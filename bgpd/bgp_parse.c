@@ -0,0 +1,776 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP UPDATE parse workers.
+ * Pre-decodes received UPDATE messages on a pool of pthreads.
+ */
+
+/*
+ * The I/O pthread frames packets into connection->ibuf.  When parse workers
+ * are configured, every framed UPDATE is additionally handed to one of the
+ * workers, which walks the message and decodes the NLRI sections of the
+ * unicast/multicast IPv4/IPv6 address families into arrays of prefixes.
+ *
+ * The main pthread still consumes connection->ibuf in order, so per-peer
+ * ordering is never affected by which worker decoded what, or when.  The job
+ * travels along with its packet in the input queue; when the main pthread
+ * pops the packet it claims the job:
+ *  - if the worker has finished, the decoded prefixes are used directly and
+ *    the main pthread only runs bgp_update()/bgp_withdraw();
+ *  - if the worker is in the middle of decoding, it waits for it;
+ *  - if the worker has not picked the job up yet, the job is cancelled and
+ *    the regular parser is used.
+ *
+ * The workers also decode AS_PATH, AS4_PATH, COMMUNITIES and
+ * LARGE_COMMUNITIES, which make up most of the attribute parsing cost.  AS
+ * paths are interned right away into the sharded aspath table; (large)
+ * communities are only decoded and sorted, and interned on the main pthread
+ * when taken, since interning builds their string with the community aliases,
+ * which belong to the main pthread.  bgp_attr_parse() adopts those when
+ * their location and decoding settings still match, and keeps doing all of
+ * the validation.  The remaining attributes, and the attribute hash itself,
+ * are still parsed and interned on the main pthread.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "frr_pthread.h"
+#include "memory.h"
+#include "monotime.h"
+#include "stream.h"
+#include "vty.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_route.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PARSE_WORKER, "BGP parse worker");
+DEFINE_MTYPE_STATIC(BGPD, BGP_PARSE_JOB, "BGP parse job");
+DEFINE_MTYPE_STATIC(BGPD, BGP_PARSE_PFX, "BGP parse prefixes");
+
+/* Maximum number of jobs handled per worker event */
+#define BGP_PARSE_JOBS_PER_RUN 64
+
+DECLARE_DLIST(bgp_parse_workq, struct bgp_parse_job, workq_item);
+
+struct bgp_parse_worker {
+	struct frr_pthread *fpt;
+	struct event *t_work;
+
+	/* protects jobs */
+	pthread_mutex_t mtx;
+	struct bgp_parse_workq_head jobs;
+
+	/* statistics, written by the worker */
+	_Atomic uint64_t packets;
+	_Atomic uint64_t prefixes;
+	_Atomic uint64_t cancelled;
+	_Atomic uint64_t busy_usec;
+};
+
+static struct bgp_parse_info {
+	/* protects workers/count/next against the I/O pthread */
+	pthread_mutex_t mtx;
+	struct bgp_parse_worker *workers[BGP_PARSE_WORKERS_MAX];
+	unsigned int count;
+	unsigned int next;
+
+	/* lockless fast path for the I/O pthread, mirrors count */
+	atomic_bool active;
+
+	/* statistics, written by the main pthread */
+	uint64_t claim_done;
+	uint64_t claim_wait;
+	uint64_t claim_miss;
+	uint64_t nlri_hit;
+	uint64_t nlri_miss;
+	uint64_t attr_hit;
+	uint64_t attr_miss;
+} bpi;
+
+/* Decode one NLRI section into @nlri; returns false on any syntax error. */
+static bool bgp_parse_section(struct bgp_parse_nlri *nlri)
+{
+	const uint8_t *pnt, *lim;
+	struct bgp_parse_pfx *pfx;
+	uint32_t count = 0;
+	uint8_t plen;
+	size_t psize;
+	uint8_t maxlen = (nlri->afi == AFI_IP) ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+
+	/* first pass: validate and count */
+	pnt = nlri->nlri;
+	lim = pnt + nlri->length;
+	while (pnt < lim) {
+		if (nlri->addpath) {
+			if (pnt + BGP_ADDPATH_ID_LEN >= lim)
+				return false;
+			pnt += BGP_ADDPATH_ID_LEN;
+		}
+		plen = *pnt++;
+		if (plen > maxlen)
+			return false;
+		psize = PSIZE(plen);
+		if (pnt + psize > lim)
+			return false;
+		pnt += psize;
+		count++;
+	}
+
+	if (!count)
+		return false;
+
+	/* second pass: fill in */
+	nlri->pfx = XCALLOC(MTYPE_BGP_PARSE_PFX, count * sizeof(*nlri->pfx));
+	nlri->count = count;
+
+	pnt = nlri->nlri;
+	for (pfx = nlri->pfx; pnt < lim; pfx++) {
+		if (nlri->addpath) {
+			memcpy(&pfx->addpath_id, pnt, BGP_ADDPATH_ID_LEN);
+			pfx->addpath_id = ntohl(pfx->addpath_id);
+			pnt += BGP_ADDPATH_ID_LEN;
+		}
+		pfx->p.family = afi2family(nlri->afi);
+		pfx->p.prefixlen = *pnt++;
+		psize = PSIZE(pfx->p.prefixlen);
+		memcpy(pfx->p.u.val, pnt, psize);
+		pnt += psize;
+	}
+
+	return true;
+}
+
+static void bgp_parse_add_section(struct bgp_parse_job *job, afi_t afi,
+				  safi_t safi, const uint8_t *pnt,
+				  bgp_size_t length)
+{
+	struct bgp_parse_nlri *nlri;
+
+	if (!length || job->nsections >= BGP_PARSE_SECTIONS_MAX)
+		return;
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return;
+	if (safi != SAFI_UNICAST && safi != SAFI_MULTICAST)
+		return;
+
+	nlri = &job->sections[job->nsections];
+	nlri->afi = afi;
+	nlri->safi = safi;
+	nlri->nlri = pnt;
+	nlri->length = length;
+	nlri->addpath = bgp_addpath_encode_rx(job->connection->peer, afi, safi);
+
+	if (bgp_parse_section(nlri))
+		job->nsections++;
+	else
+		memset(nlri, 0, sizeof(*nlri));
+}
+
+/*
+ * Decode an attribute value, see enum bgp_parse_attr_slot.
+ *
+ * The AS4 capability and the AS notation are read here without any lock, as
+ * the main pthread may change them meanwhile.  That is fine because they are
+ * recorded along with the result, and bgp_parse_job_aspath() on the main
+ * pthread drops it unless they still match.
+ */
+static void bgp_parse_add_attr(struct bgp_parse_job *job, uint8_t type,
+			       const uint8_t *val, bgp_size_t length)
+{
+	struct peer *peer = job->connection->peer;
+	struct bgp_parse_attr *pa;
+	struct community com;
+	struct lcommunity lcom;
+	struct stream *s;
+
+	switch (type) {
+	case BGP_ATTR_AS_PATH:
+		pa = &job->attrs[BGP_PARSE_ATTR_AS_PATH];
+		break;
+	case BGP_ATTR_AS4_PATH:
+		pa = &job->attrs[BGP_PARSE_ATTR_AS4_PATH];
+		break;
+	case BGP_ATTR_COMMUNITIES:
+		pa = &job->attrs[BGP_PARSE_ATTR_COMMUNITIES];
+		break;
+	case BGP_ATTR_LARGE_COMMUNITIES:
+		pa = &job->attrs[BGP_PARSE_ATTR_LARGE_COMMUNITIES];
+		break;
+	default:
+		return;
+	}
+
+	/* duplicates are left to bgp_attr_parse() */
+	if (pa->val)
+		return;
+
+	pa->val = val;
+	pa->length = length;
+
+	switch (type) {
+	case BGP_ATTR_AS_PATH:
+	case BGP_ATTR_AS4_PATH:
+		if (type == BGP_ATTR_AS4_PATH)
+			pa->use32bit = true;
+		else
+			pa->use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV) &&
+				       CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+		pa->asnotation = bgp_get_asnotation(peer->bgp);
+
+		/* aspath_parse() consumes a stream, leave the packet alone */
+		s = stream_new(MAX(length, 1));
+		stream_put(s, val, length);
+		pa->aspath = aspath_parse(s, length, pa->use32bit, pa->asnotation);
+		stream_free(s);
+		break;
+	/* as community_parse()/lcommunity_parse(), short of interning */
+	case BGP_ATTR_COMMUNITIES:
+		if (!length || length % COMMUNITY_SIZE)
+			break;
+		com.size = length / COMMUNITY_SIZE;
+		com.val = (uint32_t *)val;
+		pa->community = community_uniq_sort(&com);
+		break;
+	case BGP_ATTR_LARGE_COMMUNITIES:
+		if (!length || length % LCOMMUNITY_SIZE)
+			break;
+		lcom.size = length / LCOMMUNITY_SIZE;
+		lcom.val = (uint8_t *)val;
+		pa->lcommunity = lcommunity_uniq_sort(&lcom);
+		break;
+	}
+}
+
+/*
+ * Locate the MP_REACH_NLRI/MP_UNREACH_NLRI NLRI fields in the path
+ * attributes, and decode the attributes in enum bgp_parse_attr_slot.  Only
+ * the framing is checked here, bgp_attr_parse() on the main pthread remains
+ * responsible for validating the attributes.
+ */
+static void bgp_parse_attrs(struct bgp_parse_job *job, const uint8_t *pnt,
+			    const uint8_t *lim)
+{
+	iana_afi_t pkt_afi;
+	iana_safi_t pkt_safi;
+	afi_t afi;
+	safi_t safi;
+	uint8_t flags, type, nhlen;
+	bgp_size_t length;
+	const uint8_t *val;
+
+	while (pnt + 3 <= lim) {
+		flags = pnt[0];
+		type = pnt[1];
+		if (CHECK_FLAG(flags, BGP_ATTR_FLAG_EXTLEN)) {
+			if (pnt + 4 > lim)
+				return;
+			length = (pnt[2] << 8) | pnt[3];
+			val = pnt + 4;
+		} else {
+			length = pnt[2];
+			val = pnt + 3;
+		}
+		if (val + length > lim)
+			return;
+		pnt = val + length;
+
+		if (type != BGP_ATTR_MP_REACH_NLRI &&
+		    type != BGP_ATTR_MP_UNREACH_NLRI) {
+			bgp_parse_add_attr(job, type, val, length);
+			continue;
+		}
+		if (length < 3)
+			continue;
+
+		pkt_afi = (val[0] << 8) | val[1];
+		pkt_safi = val[2];
+		if (bgp_map_afi_safi_iana2int(pkt_afi, pkt_safi, &afi, &safi))
+			continue;
+
+		if (type == BGP_ATTR_MP_UNREACH_NLRI) {
+			bgp_parse_add_section(job, afi, safi, val + 3, length - 3);
+			continue;
+		}
+
+		/* AFI, SAFI, next-hop length, next-hop, reserved */
+		if (length < 4)
+			continue;
+		nhlen = val[3];
+		if (4 + nhlen + 1 > length)
+			continue;
+		bgp_parse_add_section(job, afi, safi, val + 4 + nhlen + 1,
+				      length - (4 + nhlen + 1));
+	}
+}
+
+static void bgp_parse_decode(struct bgp_parse_job *job)
+{
+	const uint8_t *data = job->s->data;
+	const uint8_t *pnt = data + BGP_HEADER_SIZE;
+	const uint8_t *end = data + stream_get_endp(job->s);
+	bgp_size_t withdraw_len, attribute_len;
+
+	if (pnt + 2 > end)
+		return;
+	withdraw_len = (pnt[0] << 8) | pnt[1];
+	pnt += 2;
+	if (pnt + withdraw_len > end)
+		return;
+	bgp_parse_add_section(job, AFI_IP, SAFI_UNICAST, pnt, withdraw_len);
+	pnt += withdraw_len;
+
+	if (pnt + 2 > end)
+		return;
+	attribute_len = (pnt[0] << 8) | pnt[1];
+	pnt += 2;
+	if (pnt + attribute_len > end)
+		return;
+	bgp_parse_attrs(job, pnt, pnt + attribute_len);
+	pnt += attribute_len;
+
+	bgp_parse_add_section(job, AFI_IP, SAFI_UNICAST, pnt, end - pnt);
+}
+
+static void bgp_parse_job_release(struct bgp_parse_job *job)
+{
+	for (unsigned int i = 0; i < job->nsections; i++)
+		XFREE(MTYPE_BGP_PARSE_PFX, job->sections[i].pfx);
+
+	/* whatever bgp_attr_parse() did not take; communities are not interned */
+	aspath_unintern(&job->attrs[BGP_PARSE_ATTR_AS_PATH].aspath);
+	aspath_unintern(&job->attrs[BGP_PARSE_ATTR_AS4_PATH].aspath);
+	community_free(&job->attrs[BGP_PARSE_ATTR_COMMUNITIES].community);
+	lcommunity_free(&job->attrs[BGP_PARSE_ATTR_LARGE_COMMUNITIES].lcommunity);
+
+	XFREE(MTYPE_BGP_PARSE_JOB, job);
+}
+
+void bgp_parse_job_free(struct bgp_parse_job **job)
+{
+	if (!*job)
+		return;
+
+	bgp_parse_job_release(*job);
+	*job = NULL;
+}
+
+/* Worker pthread: decode queued packets. */
+static void bgp_parse_work(struct event *event)
+{
+	struct bgp_parse_worker *w = EVENT_ARG(event);
+	struct bgp_parse_job *job;
+	enum bgp_parse_job_state expected;
+	struct timeval start;
+	unsigned int done = 0;
+	bool more;
+
+	monotime(&start);
+
+	while (done < BGP_PARSE_JOBS_PER_RUN) {
+		frr_with_mutex (&w->mtx)
+			job = bgp_parse_workq_pop(&w->jobs);
+
+		if (!job)
+			break;
+
+		expected = BGP_PARSE_JOB_PENDING;
+		if (!atomic_compare_exchange_strong_explicit(&job->state, &expected,
+							     BGP_PARSE_JOB_RUNNING,
+							     memory_order_acq_rel,
+							     memory_order_acquire)) {
+			/* main pthread has given up on this one */
+			assert(expected == BGP_PARSE_JOB_CANCELLED);
+			bgp_parse_job_release(job);
+			atomic_fetch_add_explicit(&w->cancelled, 1,
+						  memory_order_relaxed);
+			continue;
+		}
+
+		bgp_parse_decode(job);
+
+		for (unsigned int i = 0; i < job->nsections; i++)
+			atomic_fetch_add_explicit(&w->prefixes,
+						  job->sections[i].count,
+						  memory_order_relaxed);
+		atomic_fetch_add_explicit(&w->packets, 1, memory_order_relaxed);
+
+		/* job belongs to the main pthread from here on */
+		atomic_store_explicit(&job->state, BGP_PARSE_JOB_DONE,
+				      memory_order_release);
+		done++;
+	}
+
+	atomic_fetch_add_explicit(&w->busy_usec, monotime_since(&start, NULL),
+				  memory_order_relaxed);
+
+	frr_with_mutex (&w->mtx)
+		more = bgp_parse_workq_count(&w->jobs) > 0;
+
+	if (more)
+		event_add_event(w->fpt->master, bgp_parse_work, w, 0,
+				&w->t_work);
+}
+
+struct bgp_parse_job *bgp_parse_enqueue(struct peer_connection *connection,
+				       struct stream *pkt)
+{
+	struct bgp_parse_worker *w;
+	struct bgp_parse_job *job = NULL;
+
+	if (!atomic_load_explicit(&bpi.active, memory_order_relaxed))
+		return NULL;
+
+	frr_with_mutex (&bpi.mtx) {
+		if (!bpi.count)
+			return NULL;
+
+		w = bpi.workers[bpi.next++ % bpi.count];
+
+		job = XCALLOC(MTYPE_BGP_PARSE_JOB, sizeof(*job));
+		job->connection = connection;
+		job->s = pkt;
+		atomic_store_explicit(&job->state, BGP_PARSE_JOB_PENDING,
+				      memory_order_relaxed);
+
+		frr_with_mutex (&w->mtx)
+			bgp_parse_workq_add_tail(&w->jobs, job);
+
+		event_add_event(w->fpt->master, bgp_parse_work, w, 0,
+				&w->t_work);
+	}
+
+	return job;
+}
+
+/*
+ * Take ownership of a job away from the workers.  Returns true if the job
+ * was decoded and may be used, false if it must not be touched anymore or
+ * carries no result.  In both cases a job that ends up owned by the main
+ * pthread is left in *jobp, NULL otherwise.
+ */
+static bool bgp_parse_job_take(struct bgp_parse_job **jobp)
+{
+	struct bgp_parse_job *job = *jobp;
+	enum bgp_parse_job_state state = BGP_PARSE_JOB_PENDING;
+
+	if (atomic_compare_exchange_strong_explicit(&job->state, &state,
+						    BGP_PARSE_JOB_CANCELLED,
+						    memory_order_acq_rel,
+						    memory_order_acquire)) {
+		/* still queued, the worker will free it */
+		*jobp = NULL;
+		bpi.claim_miss++;
+		return false;
+	}
+
+	if (state == BGP_PARSE_JOB_RUNNING) {
+		bpi.claim_wait++;
+		do {
+			sched_yield();
+			state = atomic_load_explicit(&job->state,
+						     memory_order_acquire);
+		} while (state == BGP_PARSE_JOB_RUNNING);
+	}
+
+	if (state == BGP_PARSE_JOB_DONE) {
+		bpi.claim_done++;
+		return true;
+	}
+
+	/* skipped by a stopping worker */
+	bpi.claim_miss++;
+	return false;
+}
+
+struct bgp_parse_job *bgp_parse_claim(struct bgp_parse_job *job)
+{
+	if (!job)
+		return NULL;
+
+	if (!bgp_parse_job_take(&job))
+		bgp_parse_job_free(&job);
+
+	return job;
+}
+
+const struct bgp_parse_nlri *bgp_parse_job_nlri(const struct bgp_parse_job *job,
+						struct peer *peer,
+						const struct bgp_nlri *packet)
+{
+	const struct bgp_parse_nlri *nlri;
+
+	if (!job)
+		return NULL;
+
+	for (unsigned int i = 0; i < job->nsections; i++) {
+		nlri = &job->sections[i];
+
+		if (nlri->nlri != packet->nlri || nlri->length != packet->length ||
+		    nlri->afi != packet->afi || nlri->safi != packet->safi)
+			continue;
+
+		/* add-path may have been changed by a dynamic capability */
+		if (nlri->addpath !=
+		    bgp_addpath_encode_rx(peer, packet->afi, packet->safi))
+			break;
+
+		bpi.nlri_hit++;
+		return nlri;
+	}
+
+	bpi.nlri_miss++;
+	return NULL;
+}
+
+/* The pre-decoded attribute in @slot, if it was found at @val. */
+static struct bgp_parse_attr *bgp_parse_job_attr(struct bgp_parse_job *job,
+						 enum bgp_parse_attr_slot slot,
+						 const uint8_t *val,
+						 bgp_size_t length)
+{
+	struct bgp_parse_attr *pa = &job->attrs[slot];
+
+	if (pa->val != val || pa->length != length)
+		return NULL;
+
+	return pa;
+}
+
+struct aspath *bgp_parse_job_aspath(struct bgp_parse_job *job, uint8_t type,
+				    const uint8_t *val, bgp_size_t length,
+				    bool use32bit, enum asnotation_mode asnotation)
+{
+	struct bgp_parse_attr *pa;
+	struct aspath *aspath;
+
+	if (!job)
+		return NULL;
+
+	pa = bgp_parse_job_attr(job,
+				type == BGP_ATTR_AS4_PATH ? BGP_PARSE_ATTR_AS4_PATH
+							  : BGP_PARSE_ATTR_AS_PATH,
+				val, length);
+
+	/* AS4 capability or asnotation may have changed meanwhile */
+	if (!pa || !pa->aspath || pa->use32bit != use32bit ||
+	    pa->asnotation != asnotation) {
+		bpi.attr_miss++;
+		return NULL;
+	}
+
+	aspath = pa->aspath;
+	pa->aspath = NULL;
+	bpi.attr_hit++;
+	return aspath;
+}
+
+struct community *bgp_parse_job_community(struct bgp_parse_job *job,
+					  const uint8_t *val, bgp_size_t length)
+{
+	struct bgp_parse_attr *pa;
+	struct community *com;
+
+	if (!job)
+		return NULL;
+
+	pa = bgp_parse_job_attr(job, BGP_PARSE_ATTR_COMMUNITIES, val, length);
+	if (!pa || !pa->community) {
+		bpi.attr_miss++;
+		return NULL;
+	}
+
+	com = community_intern(pa->community);
+	pa->community = NULL;
+	bpi.attr_hit++;
+	return com;
+}
+
+struct lcommunity *bgp_parse_job_lcommunity(struct bgp_parse_job *job,
+					    const uint8_t *val, bgp_size_t length)
+{
+	struct bgp_parse_attr *pa;
+	struct lcommunity *lcom;
+
+	if (!job)
+		return NULL;
+
+	pa = bgp_parse_job_attr(job, BGP_PARSE_ATTR_LARGE_COMMUNITIES, val,
+				length);
+	if (!pa || !pa->lcommunity) {
+		bpi.attr_miss++;
+		return NULL;
+	}
+
+	lcom = lcommunity_intern(pa->lcommunity);
+	pa->lcommunity = NULL;
+	bpi.attr_hit++;
+	return lcom;
+}
+
+static struct bgp_parse_worker *bgp_parse_worker_start(unsigned int idx)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct bgp_parse_worker *w;
+	char name[32], os_name[OS_THREAD_NAMELEN];
+
+	snprintf(name, sizeof(name), "BGP parse worker %u", idx);
+	snprintf(os_name, sizeof(os_name), "bgpd_parse%u", idx);
+
+	w = XCALLOC(MTYPE_BGP_PARSE_WORKER, sizeof(*w));
+	pthread_mutex_init(&w->mtx, NULL);
+	bgp_parse_workq_init(&w->jobs);
+
+	w->fpt = frr_pthread_new(&attr, name, os_name);
+	frr_pthread_run(w->fpt, NULL);
+	frr_pthread_wait_running(w->fpt);
+
+	return w;
+}
+
+static void bgp_parse_worker_stop(struct bgp_parse_worker *w)
+{
+	struct bgp_parse_job *job;
+	enum bgp_parse_job_state state;
+
+	frr_pthread_stop(w->fpt, NULL);
+	frr_pthread_destroy(w->fpt);
+
+	/* hand whatever is left back to the main pthread */
+	while ((job = bgp_parse_workq_pop(&w->jobs))) {
+		state = BGP_PARSE_JOB_PENDING;
+		if (!atomic_compare_exchange_strong_explicit(&job->state, &state,
+							     BGP_PARSE_JOB_SKIPPED,
+							     memory_order_acq_rel,
+							     memory_order_acquire))
+			bgp_parse_job_release(job);
+	}
+
+	bgp_parse_workq_fini(&w->jobs);
+	pthread_mutex_destroy(&w->mtx);
+	XFREE(MTYPE_BGP_PARSE_WORKER, w);
+}
+
+void bgp_parse_workers_set(unsigned int count)
+{
+	struct bgp_parse_worker *stop[BGP_PARSE_WORKERS_MAX];
+	unsigned int nstop = 0, i;
+
+	count = MIN(count, BGP_PARSE_WORKERS_MAX);
+
+	if (count == bpi.count)
+		return;
+
+	frr_with_mutex (&bpi.mtx) {
+		for (i = count; i < bpi.count; i++) {
+			stop[nstop++] = bpi.workers[i];
+			bpi.workers[i] = NULL;
+		}
+		for (i = bpi.count; i < count; i++)
+			bpi.workers[i] = bgp_parse_worker_start(i);
+		bpi.count = count;
+		bpi.next = 0;
+		atomic_store_explicit(&bpi.active, count > 0,
+				      memory_order_relaxed);
+	}
+
+	/* the I/O pthread cannot see these anymore */
+	for (i = 0; i < nstop; i++)
+		bgp_parse_worker_stop(stop[i]);
+}
+
+unsigned int bgp_parse_workers_get(void)
+{
+	return bpi.count;
+}
+
+void bgp_parse_show(struct vty *vty, json_object *json)
+{
+	struct bgp_parse_worker *w;
+	json_object *json_workers = NULL, *json_worker;
+	unsigned int i;
+
+	if (json) {
+		json_object_int_add(json, "parseWorkers", bpi.count);
+		json_object_int_add(json, "parseClaimDone", bpi.claim_done);
+		json_object_int_add(json, "parseClaimWait", bpi.claim_wait);
+		json_object_int_add(json, "parseClaimMiss", bpi.claim_miss);
+		json_object_int_add(json, "parseNlriHit", bpi.nlri_hit);
+		json_object_int_add(json, "parseNlriMiss", bpi.nlri_miss);
+		json_object_int_add(json, "parseAttrHit", bpi.attr_hit);
+		json_object_int_add(json, "parseAttrMiss", bpi.attr_miss);
+		json_workers = json_object_new_array();
+		json_object_object_add(json, "parseWorkerStats", json_workers);
+	} else {
+		vty_out(vty, "UPDATE parse workers: %u\n", bpi.count);
+		vty_out(vty,
+			"  Packets claimed: %" PRIu64 " decoded (%" PRIu64
+			" waited), %" PRIu64 " not decoded\n",
+			bpi.claim_done, bpi.claim_wait, bpi.claim_miss);
+		vty_out(vty,
+			"  NLRI sections: %" PRIu64 " pre-decoded, %" PRIu64
+			" parsed inline\n",
+			bpi.nlri_hit, bpi.nlri_miss);
+		vty_out(vty,
+			"  Attributes: %" PRIu64 " pre-decoded, %" PRIu64
+			" parsed inline\n",
+			bpi.attr_hit, bpi.attr_miss);
+	}
+
+	frr_with_mutex (&bpi.mtx) {
+		for (i = 0; i < bpi.count; i++) {
+			w = bpi.workers[i];
+
+			if (json) {
+				json_worker = json_object_new_object();
+				json_object_string_add(json_worker, "name",
+						       w->fpt->name);
+				json_object_int_add(json_worker, "packets",
+						    atomic_load_explicit(&w->packets,
+									 memory_order_relaxed));
+				json_object_int_add(json_worker, "prefixes",
+						    atomic_load_explicit(&w->prefixes,
+									 memory_order_relaxed));
+				json_object_int_add(json_worker, "cancelled",
+						    atomic_load_explicit(&w->cancelled,
+									 memory_order_relaxed));
+				json_object_int_add(json_worker, "busyUsec",
+						    atomic_load_explicit(&w->busy_usec,
+									 memory_order_relaxed));
+				json_object_array_add(json_workers, json_worker);
+				continue;
+			}
+
+			vty_out(vty,
+				"  %s: %" PRIu64 " packets, %" PRIu64
+				" prefixes, %" PRIu64 " cancelled, busy %" PRIu64
+				" usec\n",
+				w->fpt->name,
+				atomic_load_explicit(&w->packets, memory_order_relaxed),
+				atomic_load_explicit(&w->prefixes, memory_order_relaxed),
+				atomic_load_explicit(&w->cancelled, memory_order_relaxed),
+				atomic_load_explicit(&w->busy_usec, memory_order_relaxed));
+		}
+	}
+}
+
+void bgp_parse_init(void)
+{
+	memset(&bpi, 0, sizeof(bpi));
+	pthread_mutex_init(&bpi.mtx, NULL);
+}
+
+void bgp_parse_finish(void)
+{
+	bgp_parse_workers_set(0);
+	pthread_mutex_destroy(&bpi.mtx);
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP UPDATE parse workers.
+ * Pre-decodes received UPDATE messages on a pool of pthreads.
+ */
+
+#ifndef _FRR_BGP_PARSE_H
+#define _FRR_BGP_PARSE_H
+
+#include "frr_pthread.h"
+#include "typesafe.h"
+
+#include "bgpd/bgpd.h"
+
+/* Upper bound for "bgp input-parse-workers" */
+#define BGP_PARSE_WORKERS_MAX 16
+
+/*
+ * NLRI sections that may be pre-decoded for a single UPDATE: the plain
+ * IPv4 withdrawn routes and NLRI fields, plus the NLRI carried in
+ * MP_REACH_NLRI and MP_UNREACH_NLRI.
+ */
+#define BGP_PARSE_SECTIONS_MAX 4
+
+struct bgp_parse_pfx {
+	struct prefix p;
+	uint32_t addpath_id;
+};
+
+/*
+ * Decoded NLRI section.  A section is identified by the location of its
+ * NLRI bytes in the received packet, so the main thread can match it
+ * against what bgp_attr_parse() and bgp_update_receive() found.
+ */
+struct bgp_parse_nlri {
+	afi_t afi;
+	safi_t safi;
+	bool addpath;
+	const uint8_t *nlri;
+	bgp_size_t length;
+
+	uint32_t count;
+	struct bgp_parse_pfx *pfx;
+};
+
+/*
+ * Path attributes that may be decoded ahead of bgp_attr_parse().  AS paths
+ * are interned by the workers into the sharded aspath table.  (Large)
+ * communities are only decoded and sorted there: interning them looks up
+ * community aliases, which only the main pthread may do, so that is left to
+ * bgp_parse_job_(l)community().
+ */
+enum bgp_parse_attr_slot {
+	BGP_PARSE_ATTR_AS_PATH = 0,
+	BGP_PARSE_ATTR_AS4_PATH,
+	BGP_PARSE_ATTR_COMMUNITIES,
+	BGP_PARSE_ATTR_LARGE_COMMUNITIES,
+
+	BGP_PARSE_ATTR_MAX,
+};
+
+/*
+ * Decoded attribute.  Like NLRI sections, it is identified by the location of
+ * its value in the received packet.  The result is owned by the job until
+ * bgp_attr_parse() takes it, whatever is left is released along with the
+ * job.
+ */
+struct bgp_parse_attr {
+	const uint8_t *val;
+	bgp_size_t length;
+
+	/* AS_PATH/AS4_PATH: settings the path was decoded with */
+	bool use32bit;
+	enum asnotation_mode asnotation;
+
+	union {
+		struct aspath *aspath;
+		struct community *community;
+		struct lcommunity *lcommunity;
+	};
+};
+
+enum bgp_parse_job_state {
+	/* queued on a worker, not yet looked at */
+	BGP_PARSE_JOB_PENDING = 0,
+	/* a worker is decoding the packet */
+	BGP_PARSE_JOB_RUNNING,
+	/* decoded; owned by the main thread */
+	BGP_PARSE_JOB_DONE,
+	/* dropped by a stopping worker; owned by the main thread */
+	BGP_PARSE_JOB_SKIPPED,
+	/* given up on by the main thread; owned by the worker */
+	BGP_PARSE_JOB_CANCELLED,
+};
+
+PREDECL_DLIST(bgp_parse_workq);
+
+struct bgp_parse_job {
+	/* Linkage on the worker queue, protected by the worker mutex */
+	struct bgp_parse_workq_item workq_item;
+
+	_Atomic enum bgp_parse_job_state state;
+
+	struct peer_connection *connection;
+	/* The packet, owned by connection->ibuf / connection->curr */
+	struct stream *s;
+
+	uint8_t nsections;
+	struct bgp_parse_nlri sections[BGP_PARSE_SECTIONS_MAX];
+
+	struct bgp_parse_attr attrs[BGP_PARSE_ATTR_MAX];
+};
+
+/*
+ * Configure the number of parse workers; 0 disables pre-decoding.
+ * Must be called from the main pthread.
+ */
+extern void bgp_parse_workers_set(unsigned int count);
+extern unsigned int bgp_parse_workers_get(void);
+
+/*
+ * Called on the I/O pthread for an UPDATE packet about to be appended to
+ * connection->ibuf.  Returns the job to queue along with the packet, NULL if
+ * there are no workers.
+ */
+extern struct bgp_parse_job *bgp_parse_enqueue(struct peer_connection *connection,
+					       struct stream *pkt);
+
+/*
+ * Called on the main pthread with the job popped from connection->ibuf along
+ * with its packet.  Returns the decoded form of the packet, or NULL if there
+ * is none (in which case the regular parsing path has to be used).  The
+ * result must be released with bgp_parse_job_free().
+ */
+extern struct bgp_parse_job *bgp_parse_claim(struct bgp_parse_job *job);
+extern void bgp_parse_job_free(struct bgp_parse_job **job);
+
+/*
+ * Look up the pre-decoded version of an NLRI section, NULL if it was not
+ * decoded or was decoded under different add-path settings.
+ */
+extern const struct bgp_parse_nlri *
+bgp_parse_job_nlri(const struct bgp_parse_job *job, struct peer *peer,
+		   const struct bgp_nlri *packet);
+
+/*
+ * Take over the pre-decoded version of an attribute whose value starts at
+ * @val, interned, NULL if it was not decoded or was decoded with different
+ * settings.  Main pthread only.  The caller then has to skip the value in the
+ * stream.
+ */
+extern struct aspath *bgp_parse_job_aspath(struct bgp_parse_job *job, uint8_t type,
+					   const uint8_t *val, bgp_size_t length,
+					   bool use32bit, enum asnotation_mode asnotation);
+extern struct community *bgp_parse_job_community(struct bgp_parse_job *job,
+						 const uint8_t *val, bgp_size_t length);
+extern struct lcommunity *bgp_parse_job_lcommunity(struct bgp_parse_job *job,
+						   const uint8_t *val, bgp_size_t length);
+
+extern void bgp_parse_init(void);
+extern void bgp_parse_finish(void);
+
+extern void bgp_parse_show(struct vty *vty, json_object *json);
+
+#endif /* _FRR_BGP_PARSE_H */
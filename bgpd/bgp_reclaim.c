@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP deferred reclaim.
+ * Releases removed paths and Adj-RIB-In entries in the background rather
+ * than as they are removed, see "bgp deferred-reclaim".
+ */
+
+/*
+ * When a peer with a full table goes down, clearing and then selecting a
+ * new best path for each of its routes also releases a million paths and
+ * Adj-RIB-In entries: the attributes and labels they hold, which may then
+ * be released themselves, their reference to the peer, and their memory.
+ *
+ * With deferred reclaim, removal only unlinks the entries from the RIB and
+ * the nexthop cache, and queues them here.  The rest is released from a
+ * timer, a batch at a time, so that the best paths of the routes are
+ * updated sooner.  The attributes and labels are interned in hashes of the
+ * main pthread, so they are released from it; the entries themselves are
+ * then freed through RCU, by its pthread.  The queues are linked through
+ * the next pointer of the entries, and RCU uses the same space.
+ */
+
+#include <zebra.h>
+
+#include "frrcu.h"
+#include "frrevent.h"
+#include "memory.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_reclaim.h"
+
+static struct {
+	struct bgp_path_info *paths;
+	struct bgp_adj_in *adj_ins;
+	unsigned long npaths;
+	unsigned long nadj_ins;
+	struct event *t_reclaim;
+} brq;
+
+static void bgp_reclaim_path_release(struct bgp_path_info *path)
+{
+	bgp_attr_unintern(&path->attr);
+	peer_unlock(path->peer); /* bgp_path_info peer reference */
+	rcu_free(MTYPE_BGP_ROUTE, path, rcu_head);
+}
+
+static void bgp_reclaim_adj_in_release(struct bgp_adj_in *ain)
+{
+	bgp_attr_unintern(&ain->attr);
+	bgp_labels_unintern(&ain->labels);
+	peer_unlock(ain->peer); /* adj_in peer reference */
+	rcu_free(MTYPE_BGP_ADJ_IN, ain, rcu_head);
+}
+
+static void bgp_reclaim_run(struct event *event);
+
+static void bgp_reclaim_schedule(void)
+{
+	if (!brq.t_reclaim)
+		event_add_timer_msec(bm->master, bgp_reclaim_run, NULL,
+				     BGP_RECLAIM_DELAY_MSEC, &brq.t_reclaim);
+}
+
+static void bgp_reclaim_run(struct event *event)
+{
+	struct bgp_path_info *path;
+	struct bgp_adj_in *ain;
+	unsigned int count = 0;
+
+	while (count < BGP_RECLAIM_BATCH && (path = brq.paths)) {
+		brq.paths = path->next;
+		brq.npaths--;
+		bgp_reclaim_path_release(path);
+		count++;
+	}
+
+	while (count < BGP_RECLAIM_BATCH && (ain = brq.adj_ins)) {
+		brq.adj_ins = ain->next;
+		brq.nadj_ins--;
+		bgp_reclaim_adj_in_release(ain);
+		count++;
+	}
+
+	if (brq.paths || brq.adj_ins)
+		bgp_reclaim_schedule();
+}
+
+void bgp_reclaim_path(struct bgp_path_info *path)
+{
+	path->next = brq.paths;
+	brq.paths = path;
+	brq.npaths++;
+	bgp_reclaim_schedule();
+}
+
+void bgp_reclaim_adj_in(struct bgp_adj_in *ain)
+{
+	ain->next = brq.adj_ins;
+	brq.adj_ins = ain;
+	brq.nadj_ins++;
+	bgp_reclaim_schedule();
+}
+
+void bgp_reclaim_pending(unsigned long *paths, unsigned long *adj_ins)
+{
+	*paths = brq.npaths;
+	*adj_ins = brq.nadj_ins;
+}
+
+void bgp_reclaim_finish(void)
+{
+	UNSET_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM);
+
+	while (brq.paths || brq.adj_ins) {
+		event_cancel(&brq.t_reclaim);
+		bgp_reclaim_run(NULL);
+	}
+	event_cancel(&brq.t_reclaim);
+}
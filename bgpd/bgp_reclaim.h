@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP deferred reclaim.
+ * Releases removed paths and Adj-RIB-In entries in the background rather
+ * than as they are removed, see "bgp deferred-reclaim".
+ */
+
+#ifndef _FRR_BGP_RECLAIM_H
+#define _FRR_BGP_RECLAIM_H
+
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_advertise.h"
+
+/* Entries released in a go, before letting other events run */
+#define BGP_RECLAIM_BATCH 10000
+/* Delay of each go, for the events the release of a table holds up */
+#define BGP_RECLAIM_DELAY_MSEC 10
+
+/*
+ * Queue the release of @path, or @ain, once it is unlinked from everything
+ * else: what it holds of the attributes, labels and its peer is released
+ * from a later event, and its memory from the RCU pthread.
+ */
+extern void bgp_reclaim_path(struct bgp_path_info *path);
+extern void bgp_reclaim_adj_in(struct bgp_adj_in *ain);
+
+/* Number of paths and Adj-RIB-In entries queued */
+extern void bgp_reclaim_pending(unsigned long *paths, unsigned long *adj_ins);
+
+/* Release all that is queued, and stop deferring */
+extern void bgp_reclaim_finish(void);
+
+#endif /* _FRR_BGP_RECLAIM_H */
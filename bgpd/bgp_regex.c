@@ -14,6 +14,7 @@
 
 #include "bgpd.h"
 #include "bgp_aspath.h"
+#include "bgp_community.h"
 #include "bgp_regex.h"
 
 /* Character `_' has special mean.  It represents [,{}() ] and the
@@ -21,6 +22,128 @@
 
    (^|[,{}() ]|$) */
 
+/*
+ * Most expressions only look for one ASN or community, or a short run of
+ * them, delimited on both sides: "_65000_", "^65000_", "_65000$",
+ * "^65000_65001_", "_65000:100_"...  These are also compiled into a list of
+ * tokens that is matched directly against the ASNs of the AS_SEQUENCE
+ * segments or the community values, which gives the same result as the
+ * regular expression on their string form without having to run it.  Other
+ * expressions, and AS paths with sets or confederation segments, go
+ * through the regular expression, with the result cached in the interned
+ * attribute.
+ */
+#define BGP_REGEX_TOKENS_MAX 8
+
+/* longer AS paths go through the regular expression */
+#define BGP_REGEX_PATH_MAX 64
+
+enum bgp_regex_kind {
+	BGP_REGEX_REGEXP,
+	BGP_REGEX_ANY,
+	BGP_REGEX_ASN,
+	BGP_REGEX_COMMUNITY,
+};
+
+struct bgp_regex {
+	struct frregex re;
+
+	/* for the caches, never 0 */
+	uint32_t id;
+
+	enum bgp_regex_kind kind;
+	bool head, tail;
+	unsigned int ntokens;
+	uint32_t tokens[BGP_REGEX_TOKENS_MAX];
+};
+
+static uint32_t bgp_regex_next_id;
+
+static bool bgp_regex_parse_num(const char **p, uint32_t max, uint32_t *val)
+{
+	const char *s = *p;
+	uint64_t v = 0;
+
+	if (!isdigit((unsigned char)*s))
+		return false;
+
+	/* "065000" does not match "65000" */
+	if (s[0] == '0' && isdigit((unsigned char)s[1]))
+		return false;
+
+	for (; isdigit((unsigned char)*s); s++) {
+		v = v * 10 + (*s - '0');
+		if (v > max)
+			return false;
+	}
+
+	*val = v;
+	*p = s;
+	return true;
+}
+
+static void bgp_regex_parse(struct bgp_regex *regex, const char *str)
+{
+	enum bgp_regex_kind kind = BGP_REGEX_REGEXP;
+	uint32_t val, lo;
+	const char *p = str;
+
+	regex->kind = BGP_REGEX_REGEXP;
+
+	if (!strcmp(str, "") || !strcmp(str, ".*")) {
+		regex->kind = BGP_REGEX_ANY;
+		return;
+	}
+
+	if (*p == '^')
+		regex->head = true;
+	else if (*p != '_')
+		return;
+	p++;
+
+	if (regex->head && !strcmp(p, "$")) {
+		regex->tail = true;
+		regex->kind = BGP_REGEX_ASN;
+		return;
+	}
+
+	for (;;) {
+		if (regex->ntokens == BGP_REGEX_TOKENS_MAX)
+			return;
+		if (!bgp_regex_parse_num(&p, UINT32_MAX, &val))
+			return;
+
+		if (*p == ':') {
+			p++;
+			if (kind == BGP_REGEX_ASN || val > UINT16_MAX ||
+			    !bgp_regex_parse_num(&p, UINT16_MAX, &lo))
+				return;
+			val = (val << 16) | lo;
+
+			/* well-known communities are displayed by name */
+			if ((val >> 16) == UINT16_MAX)
+				return;
+			kind = BGP_REGEX_COMMUNITY;
+		} else {
+			if (kind == BGP_REGEX_COMMUNITY)
+				return;
+			kind = BGP_REGEX_ASN;
+		}
+		regex->tokens[regex->ntokens++] = val;
+
+		if (*p == '$' && p[1] == '\0') {
+			regex->tail = true;
+			break;
+		}
+		if (*p != '_')
+			return;
+		if (*++p == '\0')
+			break;
+	}
+
+	regex->kind = kind;
+}
+
 struct frregex *bgp_regcomp(const char *regstr)
 {
 	/* Convert _ character to generic regular expression. */
@@ -30,7 +153,7 @@ struct frregex *bgp_regcomp(const char *regstr)
 	char *magic_str;
 	char magic_regexp[] = "(^|[,{}() ]|$)";
 	int ret;
-	struct frregex *regex;
+	struct bgp_regex *regex;
 
 	len = strlen(regstr);
 	for (i = 0; i < len; i++)
@@ -49,9 +172,9 @@ struct frregex *bgp_regcomp(const char *regstr)
 	}
 	magic_str[j] = '\0';
 
-	regex = XMALLOC(MTYPE_BGP_REGEXP, sizeof(*regex));
+	regex = XCALLOC(MTYPE_BGP_REGEXP, sizeof(*regex));
 
-	ret = regcomp(&regex->real, magic_str, REG_EXTENDED | REG_NOSUB);
+	ret = regcomp(&regex->re.real, magic_str, REG_EXTENDED | REG_NOSUB);
 
 	XFREE(MTYPE_TMP, magic_str);
 
@@ -60,16 +183,136 @@ struct frregex *bgp_regcomp(const char *regstr)
 		return NULL;
 	}
 
-	return regex;
+	bgp_regex_next_id = (bgp_regex_next_id + 1) & 0x7fffffff;
+	if (!bgp_regex_next_id)
+		bgp_regex_next_id = 1;
+	regex->id = bgp_regex_next_id;
+
+	bgp_regex_parse(regex, regstr);
+
+	return &regex->re;
+}
+
+/* Match the tokens on @count values, in network byte order if @ntoh. */
+static bool bgp_regex_match_tokens(const struct bgp_regex *regex,
+				   const uint32_t *vals, unsigned int count,
+				   bool ntoh)
+{
+	unsigned int first, last, i;
+
+	if (regex->ntokens > count)
+		return false;
+
+	first = 0;
+	last = count - regex->ntokens;
+	if (regex->head)
+		last = 0;
+	if (regex->tail)
+		first = count - regex->ntokens;
+
+	for (; first <= last; first++) {
+		for (i = 0; i < regex->ntokens; i++)
+			if ((ntoh ? ntohl(vals[first + i]) : vals[first + i]) !=
+			    regex->tokens[i])
+				break;
+		if (i == regex->ntokens)
+			return true;
+	}
+
+	return false;
 }
 
-int bgp_regexec(struct frregex *regex, struct aspath *aspath)
+static bool bgp_regex_cache_get(struct bgp_regex_cache *cache,
+				const struct bgp_regex *regex, bool *match)
 {
-	return regexec(&regex->real, aspath->str, 0, NULL, 0);
+	uint32_t val;
+
+	val = atomic_load_explicit(&cache->slot[regex->id %
+						BGP_REGEX_CACHE_SLOTS],
+				   memory_order_relaxed);
+	if ((val >> 1) != regex->id)
+		return false;
+
+	*match = val & 1;
+	return true;
+}
+
+static void bgp_regex_cache_put(struct bgp_regex_cache *cache,
+				const struct bgp_regex *regex, bool match)
+{
+	atomic_store_explicit(&cache->slot[regex->id % BGP_REGEX_CACHE_SLOTS],
+			      (regex->id << 1) | match, memory_order_relaxed);
 }
 
-void bgp_regex_free(struct frregex *regex)
+int bgp_regexec(struct frregex *re, struct aspath *aspath)
 {
-	regfree(&regex->real);
+	struct bgp_regex *regex = container_of(re, struct bgp_regex, re);
+	as_t asns[BGP_REGEX_PATH_MAX];
+	struct assegment *seg;
+	unsigned int count = 0;
+	bool match;
+	int ret;
+
+	if (regex->kind == BGP_REGEX_ANY)
+		return 0;
+
+	/* the ASNs are only displayed as they are in plain notation */
+	if (regex->kind == BGP_REGEX_ASN &&
+	    aspath->asnotation == ASNOTATION_PLAIN) {
+		for (seg = aspath->segments; seg; seg = seg->next) {
+			if (seg->type != AS_SEQUENCE || !seg->length ||
+			    count + seg->length > array_size(asns))
+				break;
+			memcpy(asns + count, seg->as,
+			       seg->length * sizeof(asns[0]));
+			count += seg->length;
+		}
+		if (!seg)
+			return bgp_regex_match_tokens(regex, asns, count, false)
+				       ? 0
+				       : REG_NOMATCH;
+	}
+
+	/* only interned AS paths are immutable */
+	if (aspath->refcnt && bgp_regex_cache_get(&aspath->recache, regex, &match))
+		return match ? 0 : REG_NOMATCH;
+
+	ret = regexec(&regex->re.real, aspath->str, 0, NULL, 0);
+
+	if (aspath->refcnt)
+		bgp_regex_cache_put(&aspath->recache, regex, ret == 0);
+	return ret;
+}
+
+int bgp_regexec_community(struct frregex *re, struct community *com)
+{
+	struct bgp_regex *regex = container_of(re, struct bgp_regex, re);
+	bool match;
+	int ret;
+
+	if (regex->kind == BGP_REGEX_ANY)
+		return 0;
+
+	if (regex->kind == BGP_REGEX_COMMUNITY)
+		return bgp_regex_match_tokens(regex, com->val, com->size, true)
+			       ? 0
+			       : REG_NOMATCH;
+
+	if (com->refcnt && bgp_regex_cache_get(&com->recache, regex, &match))
+		return match ? 0 : REG_NOMATCH;
+
+	ret = regexec(&regex->re.real, community_str(com, false, false), 0,
+		      NULL, 0);
+
+	if (com->refcnt)
+		bgp_regex_cache_put(&com->recache, regex, ret == 0);
+	return ret;
+}
+
+void bgp_regex_free(struct frregex *re)
+{
+	struct bgp_regex *regex = container_of(re, struct bgp_regex, re);
+
+	regfree(&regex->re.real);
 	XFREE(MTYPE_BGP_REGEXP, regex);
 }
@@ -9,9 +9,25 @@
 #include <zebra.h>
 
 struct frregex;
+struct aspath;
+struct community;
+
+/*
+ * Results of regular expression matches on an interned AS path or
+ * communities attribute, which many paths share.  Each slot holds the id of
+ * a compiled expression and its result.
+ */
+#define BGP_REGEX_CACHE_SLOTS 4
+
+struct bgp_regex_cache {
+	_Atomic uint32_t slot[BGP_REGEX_CACHE_SLOTS];
+};
 
 extern void bgp_regex_free(struct frregex *regex);
 extern struct frregex *bgp_regcomp(const char *str);
 extern int bgp_regexec(struct frregex *regex, struct aspath *aspath);
 
+/* Same as bgp_regexec(), on communities rendered without aliases. */
+extern int bgp_regexec_community(struct frregex *regex, struct community *com);
+
 #endif /* _FRR_BGP_REGEX_H */
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP route-map results cache.
+ * Remembers what a route-map did to a set of attributes, for the many paths
+ * that go through the same route-map with the same attributes.
+ */
+
+/*
+ * Paths mostly share a few sets of attributes, and with route-maps that
+ * only look at the attributes the outcome is the same for all of them: a
+ * route server applying the same export policy to a full table does the
+ * same work over and over.
+ *
+ * The cache is a direct-mapped table of entries, each one holding the
+ * attributes a route-map was applied to and the attributes it produced,
+ * both interned, along with the result.  An entry is keyed by the route-map,
+ * the peers the path goes between and the direction, and the attributes,
+ * which must only point to interned structures so they can be compared the
+ * way the attribute hash does.  Entries are valid for one route-map
+ * generation, which changes with any configuration that may affect a
+ * route-map, and one epoch of this cache, for what the route-map code does
+ * not know of (community aliases, deleted peers...).
+ *
+ * On a hit, the caller's attributes point to the structures of the entry
+ * until they are interned or flushed, so the attributes of replaced entries
+ * are only released from the event loop, once the caller is done.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "jhash.h"
+#include "memory.h"
+#include "routemap.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_rmap_cache.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_RMAP_CACHE, "BGP route-map results cache");
+
+struct bgp_rmap_cache_entry {
+	/* interned attributes, before and after; out is NULL when denied */
+	struct attr *in;
+	struct attr *out;
+	route_map_result_t ret;
+
+	struct route_map *map;
+	struct peer *peer;
+	struct peer *from;
+	uint8_t dir;
+	uint32_t hash;
+	uint32_t gen;
+	uint32_t epoch;
+};
+
+static struct {
+	bool enabled;
+	pthread_t owner;
+	uint32_t epoch;
+	struct bgp_rmap_cache_entry *slots;
+
+	/* attributes of replaced entries, released from the event loop */
+	struct attr **reap;
+	unsigned int nreap;
+	unsigned int reap_size;
+	struct event *t_reap;
+} brc;
+
+static void bgp_rmap_cache_reap(struct event *event)
+{
+	unsigned int i;
+
+	for (i = 0; i < brc.nreap; i++)
+		bgp_attr_unintern(&brc.reap[i]);
+	brc.nreap = 0;
+}
+
+static void bgp_rmap_cache_release(struct attr **attr)
+{
+	if (!*attr)
+		return;
+
+	if (brc.nreap == brc.reap_size) {
+		brc.reap_size = MAX(64U, brc.reap_size * 2);
+		brc.reap = XREALLOC(MTYPE_BGP_RMAP_CACHE, brc.reap,
+				    brc.reap_size * sizeof(*brc.reap));
+	}
+	brc.reap[brc.nreap++] = *attr;
+	*attr = NULL;
+
+	if (bm && bm->master)
+		event_add_event(bm->master, bgp_rmap_cache_reap, NULL, 0,
+				&brc.t_reap);
+}
+
+static bool bgp_rmap_cache_usable(struct route_map *map, uint32_t gen)
+{
+	if (map->cache_gen != gen) {
+		map->cacheable = bgp_route_map_attr_only(map, 0);
+		map->cache_gen = gen;
+	}
+
+	return map->cacheable;
+}
+
+route_map_result_t bgp_rmap_cache_apply(struct route_map *map,
+					const struct prefix *p,
+					struct bgp_path_info *path, uint8_t dir)
+{
+	struct bgp_rmap_cache_entry *e;
+	struct attr *attr = path->attr;
+	route_map_result_t ret;
+	struct attr tmp;
+	uint32_t gen, hash;
+
+	if (!map || !brc.enabled || !pthread_equal(pthread_self(), brc.owner) ||
+	    !bgp_attr_subs_interned(attr))
+		return route_map_apply(map, p, path);
+
+	gen = route_map_generation();
+	if (!bgp_rmap_cache_usable(map, gen))
+		return route_map_apply(map, p, path);
+
+	hash = jhash_3words((uintptr_t)map, (uintptr_t)path->peer,
+			    (uintptr_t)path->from,
+			    attrhash_key_make(attr) ^ dir);
+	e = &brc.slots[hash % BGP_RMAP_CACHE_SLOTS];
+
+	if (e->in && e->hash == hash && e->gen == gen &&
+	    e->epoch == brc.epoch && e->map == map && e->peer == path->peer &&
+	    e->from == path->from && e->dir == dir && attrhash_cmp(e->in, attr)) {
+		map->cache_hits++;
+
+		if (e->out) {
+			bgp_attr_flush(attr);
+			bgp_attr_dup_into(attr, e->out);
+		}
+		return e->ret;
+	}
+
+	map->cache_misses++;
+
+	bgp_rmap_cache_release(&e->in);
+	bgp_rmap_cache_release(&e->out);
+
+	bgp_attr_dup_into(&tmp, attr);
+	e->in = bgp_attr_intern(&tmp);
+	bgp_attr_flush(&tmp);
+
+	ret = route_map_apply(map, p, path);
+
+	if (ret != RMAP_DENYMATCH) {
+		/*
+		 * Interning takes over what the route-map allocated, so the
+		 * caller's attributes then point to the interned structures.
+		 */
+		bgp_attr_dup_into(&tmp, attr);
+		e->out = bgp_attr_intern(&tmp);
+		bgp_attr_flush(&tmp);
+
+		bgp_attr_extra_discard(attr);
+		bgp_attr_dup_into(attr, e->out);
+	}
+
+	e->ret = ret;
+	e->map = map;
+	e->peer = path->peer;
+	e->from = path->from;
+	e->dir = dir;
+	e->hash = hash;
+	e->gen = gen;
+	e->epoch = brc.epoch;
+
+	return ret;
+}
+
+void bgp_rmap_cache_invalidate(void)
+{
+	brc.epoch++;
+}
+
+void bgp_rmap_cache_init(void)
+{
+	memset(&brc, 0, sizeof(brc));
+	brc.owner = pthread_self();
+	brc.slots = XCALLOC(MTYPE_BGP_RMAP_CACHE,
+			    BGP_RMAP_CACHE_SLOTS * sizeof(*brc.slots));
+	brc.enabled = true;
+}
+
+void bgp_rmap_cache_finish(void)
+{
+	unsigned int i;
+
+	event_cancel(&brc.t_reap);
+	bgp_rmap_cache_reap(NULL);
+
+	for (i = 0; brc.slots && i < BGP_RMAP_CACHE_SLOTS; i++) {
+		if (brc.slots[i].in)
+			bgp_attr_unintern(&brc.slots[i].in);
+		if (brc.slots[i].out)
+			bgp_attr_unintern(&brc.slots[i].out);
+	}
+
+	XFREE(MTYPE_BGP_RMAP_CACHE, brc.slots);
+	XFREE(MTYPE_BGP_RMAP_CACHE, brc.reap);
+	brc.enabled = false;
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP route-map results cache.
+ * Remembers what a route-map did to a set of attributes, for the many paths
+ * that go through the same route-map with the same attributes.
+ */
+
+#ifndef _FRR_BGP_RMAP_CACHE_H
+#define _FRR_BGP_RMAP_CACHE_H
+
+#include "routemap.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_route.h"
+
+/* Number of entries, each one holding two interned attributes */
+#define BGP_RMAP_CACHE_SLOTS 4096
+
+/*
+ * route_map_apply() on @path, with the result and the attributes it
+ * produced remembered for the attributes @path->attr points to, as seen
+ * from @path->peer and @path->from in direction @dir (PEER_RMAP_TYPE_IN or
+ * PEER_RMAP_TYPE_OUT).  The cache is only used when the route-map, and the
+ * ones it calls, do not depend on the prefix or on anything of the path
+ * but these (see bgp_route_map_attr_only()), and from the main pthread.
+ *
+ * On a hit, @path->attr is replaced with a copy of the remembered result,
+ * which may then be interned or flushed as usual.
+ */
+extern route_map_result_t bgp_rmap_cache_apply(struct route_map *map,
+					       const struct prefix *p,
+					       struct bgp_path_info *path,
+					       uint8_t dir);
+
+/* Forget all entries, for changes the route-map code does not know of. */
+extern void bgp_rmap_cache_invalidate(void);
+
+extern void bgp_rmap_cache_init(void);
+extern void bgp_rmap_cache_finish(void);
+
+#endif /* _FRR_BGP_RMAP_CACHE_H */
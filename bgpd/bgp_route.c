@@ -41,7 +41,9 @@
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_reclaim.h"
 #include "bgpd/bgp_regex.h"
+#include "bgpd/bgp_rmap_cache.h"
 #include "bgpd/bgp_community.h"
 #include "bgpd/bgp_community_alias.h"
 #include "bgpd/bgp_ecommunity.h"
@@ -70,6 +72,9 @@
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_ls_nlri.h"
 #include "bgpd/bgp_ls.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_soft_reconfig.h"
+#include "bgpd/bgp_conditional_adv.h"
 
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/rfapi_backend.h"
@@ -104,6 +109,8 @@ static bool bgp_attr_nexthop_same(const struct attr *attr1, const struct attr *a
 
 DEFINE_MTYPE_STATIC(BGPD, BGP_EOIU_MARKER_INFO, "BGP EOIU Marker info");
 DEFINE_MTYPE_STATIC(BGPD, BGP_METAQ, "BGP MetaQ");
+DEFINE_MTYPE_STATIC(BGPD, BGP_PATH_CAND, "BGP bestpath candidates");
+DEFINE_MTYPE_STATIC(BGPD, BGP_SHOW_YIELD, "BGP suspended show");
 /* Memory for batched clearing of peers from the RIB */
 DEFINE_MTYPE(BGPD, CLEARING_BATCH, "Clearing batch");
 
@@ -350,7 +357,7 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 	e = *extra;
 
 	if (e->damp_info)
-		bgp_damp_info_free(e->damp_info, NULL, 0);
+		bgp_damp_info_free(e->damp_info, 0);
 	e->damp_info = NULL;
 	if (e->vrfleak && e->vrfleak->parent) {
 		struct bgp_path_info *bpi =
@@ -503,7 +510,6 @@ void bgp_path_info_free_with_caller(const char *name,
 				    struct bgp_path_info *path)
 {
 	frrtrace(2, frr_bgp, bgp_path_info_free, path, name);
-	bgp_attr_unintern(&path->attr);
 
 	bgp_unlink_nexthop(path);
 	bgp_path_info_extra_free(&path->extra);
@@ -511,6 +517,12 @@ void bgp_path_info_free_with_caller(const char *name,
 		bgp_addpath_free_info_data(&path->tx_addpath,
 					   &path->net->tx_addpath);
 
+	if (CHECK_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM)) {
+		bgp_reclaim_path(path);
+		return;
+	}
+
+	bgp_attr_unintern(&path->attr);
 	peer_unlock(path->peer); /* bgp_path_info peer reference */
 
 	XFREE(MTYPE_BGP_ROUTE, path);
@@ -1918,6 +1930,332 @@ int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 }
 
 
+/*
+ * Snapshot the decision-relevant fields of @pi for bgp_path_cand_cmp().
+ * Paths for which the decision process needs more than the snapshot (EVPN,
+ * locally originated or imported paths, ACCEPT_OWN, AIGP) are flagged
+ * BGP_PATH_CAND_COMPLEX and compared with bgp_path_info_cmp() instead.
+ */
+void bgp_path_cand_fill(struct bgp *bgp, struct bgp_path_cand *cand,
+			struct bgp_path_info *pi, afi_t afi, safi_t safi)
+{
+	struct attr *attr = pi->attr;
+	struct peer *peer = pi->peer;
+	const struct assegment *seg;
+
+	memset(cand, 0, sizeof(*cand));
+	cand->pi = pi;
+
+	if (!peer || safi == SAFI_EVPN || pi->sub_type != BGP_ROUTE_NORMAL ||
+	    (safi == SAFI_MPLS_VPN &&
+	     CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_ACCEPT_OWN)) ||
+	    (CHECK_FLAG(bgp->flags, BGP_FLAG_COMPARE_AIGP) &&
+	     bgp_attr_exists(attr, BGP_ATTR_AIGP))) {
+		SET_FLAG(cand->flags, BGP_PATH_CAND_COMPLEX);
+		return;
+	}
+
+	if (CHECK_FLAG(pi->flags, BGP_PATH_UPA))
+		SET_FLAG(cand->flags, BGP_PATH_CAND_UPA);
+	if (CHECK_FLAG(pi->flags, BGP_PATH_STALE))
+		SET_FLAG(cand->flags, BGP_PATH_CAND_STALE);
+	if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+		SET_FLAG(cand->flags, BGP_PATH_CAND_SELECTED);
+	if (bgp_path_info_has_valid_label(pi))
+		SET_FLAG(cand->flags, BGP_PATH_CAND_LABEL_VALID);
+	if (bgp_attr_get_community(attr) &&
+	    community_include(bgp_attr_get_community(attr), COMMUNITY_LLGR_STALE))
+		SET_FLAG(cand->flags, BGP_PATH_CAND_LLGR_STALE);
+
+	cand->weight = attr->weight;
+	if (bgp_attr_exists(attr, BGP_ATTR_LOCAL_PREF))
+		cand->local_pref = attr->local_pref;
+	else
+		cand->local_pref = bgp->default_local_pref;
+	cand->med = bgp_med_value(attr, bgp);
+	cand->origin = attr->origin;
+	cand->igpmetric = pi->extra ? pi->extra->igpmetric : 0;
+	cand->cluster_len = BGP_CLUSTER_LIST_LENGTH(attr);
+
+	if (bgp_attr_exists(attr, BGP_ATTR_ORIGINATOR_ID))
+		cand->router_id = attr->originator_id;
+	else
+		cand->router_id = peer->remote_id;
+
+	/* AS_PATH length and the leftmost AS tests done by aspath_cmp_left()
+	 * and aspath_cmp_left_confed()
+	 */
+	cand->aspath = attr->aspath;
+	cand->hops = aspath_count_hops(attr->aspath);
+	cand->confeds = aspath_count_confeds(attr->aspath);
+
+	if (attr->aspath && !attr->aspath->segments)
+		cand->left = BGP_PATH_CAND_LEFT_EMPTY;
+	else if (attr->aspath) {
+		seg = attr->aspath->segments;
+		if (seg->type == AS_CONFED_SEQUENCE) {
+			cand->left_confed = true;
+			cand->left_confed_as = seg->as[0];
+		}
+
+		while (seg && (seg->type == AS_CONFED_SEQUENCE ||
+			       seg->type == AS_CONFED_SET))
+			seg = seg->next;
+		if (seg && seg->type == AS_SEQUENCE) {
+			cand->left = BGP_PATH_CAND_LEFT_AS;
+			cand->left_as = seg->as[0];
+		}
+	}
+
+	cand->sort = peer->sort;
+	cand->sub_sort = peer->sub_sort;
+	cand->peer_as = peer->as;
+
+	if (peer->connection->su_remote)
+		cand->su_remote = *peer->connection->su_remote;
+	else
+		SET_FLAG(cand->flags, BGP_PATH_CAND_NO_SU_REMOTE);
+}
+
+/*
+ * Same decision as bgp_path_info_cmp(), taken from the snapshots built by
+ * bgp_path_cand_fill().  Any change to the decision process must be made in
+ * both places; tests/bgpd/test_bestpath_compact checks they agree.
+ */
+int bgp_path_cand_cmp(struct bgp *bgp, const struct bgp_path_cand *new,
+		      const struct bgp_path_cand *exist, int *paths_eq,
+		      struct bgp_maxpaths_cfg *mpath_cfg, afi_t afi,
+		      safi_t safi, enum bgp_path_selection_reason *reason)
+{
+	char pfx_buf[1] = "";
+	uint32_t newm, existm;
+	int igp_metric_ret = 0;
+	int peer_sort_ret = -1;
+	bool internal_as_route;
+	bool confed_as_route;
+	bool left_eq;
+	int ret;
+
+	if (CHECK_FLAG(new->flags, BGP_PATH_CAND_COMPLEX) ||
+	    CHECK_FLAG(exist->flags, BGP_PATH_CAND_COMPLEX))
+		return bgp_path_info_cmp(bgp, new->pi, exist->pi, paths_eq,
+					 mpath_cfg, false, pfx_buf, afi, safi,
+					 reason);
+
+	bgp->bestpath_runs++;
+
+	*paths_eq = 0;
+
+	/* UPA routes always lose to non-UPA routes */
+	if (CHECK_FLAG(new->flags, BGP_PATH_CAND_UPA) !=
+	    CHECK_FLAG(exist->flags, BGP_PATH_CAND_UPA)) {
+		*reason = bgp_path_selection_local_route;
+		return !CHECK_FLAG(new->flags, BGP_PATH_CAND_UPA);
+	}
+
+	/* LLGR_STALE is least preferred */
+	if (CHECK_FLAG(new->flags, BGP_PATH_CAND_LLGR_STALE))
+		return 0;
+	if (CHECK_FLAG(exist->flags, BGP_PATH_CAND_LLGR_STALE))
+		return 1;
+
+	/* 1. Weight check. */
+	if (new->weight != exist->weight) {
+		*reason = bgp_path_selection_weight;
+		return new->weight > exist->weight;
+	}
+
+	/* 2. Local preference check. */
+	if (new->local_pref != exist->local_pref) {
+		*reason = bgp_path_selection_local_pref;
+		return new->local_pref > exist->local_pref;
+	}
+
+	/* 4. AS path length check. */
+	if (!CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_IGNORE)) {
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_CONFED)) {
+			int new_len = new->hops + new->confeds;
+			int exist_len = exist->hops + exist->confeds;
+
+			if (new_len != exist_len) {
+				*reason = bgp_path_selection_confed_as_path;
+				return new_len < exist_len;
+			}
+		} else if (new->hops != exist->hops) {
+			*reason = bgp_path_selection_as_path;
+			return new->hops < exist->hops;
+		}
+	}
+
+	/* 5. Origin check. */
+	if (new->origin != exist->origin) {
+		*reason = bgp_path_selection_origin;
+		return new->origin < exist->origin;
+	}
+
+	/* 6. MED check. */
+	internal_as_route = (new->hops == 0 && exist->hops == 0);
+	confed_as_route = (new->confeds > 0 && exist->confeds > 0 &&
+			   new->hops == 0 && exist->hops == 0);
+	left_eq = new->left != BGP_PATH_CAND_LEFT_NONE &&
+		  new->left == exist->left && new->left_as == exist->left_as;
+
+	if (CHECK_FLAG(bgp->flags, BGP_FLAG_ALWAYS_COMPARE_MED) ||
+	    (CHECK_FLAG(bgp->flags, BGP_FLAG_MED_CONFED) && confed_as_route) ||
+	    left_eq ||
+	    (new->left_confed && exist->left_confed &&
+	     new->left_confed_as == exist->left_confed_as) ||
+	    internal_as_route) {
+		if (new->med != exist->med) {
+			*reason = bgp_path_selection_med;
+			return new->med < exist->med;
+		}
+	}
+
+	/* 7. Peer type check. */
+	if (new->sort == BGP_PEER_EBGP &&
+	    (exist->sort == BGP_PEER_IBGP || exist->sort == BGP_PEER_CONFED ||
+	     exist->sub_sort == BGP_PEER_EBGP_OAD)) {
+		*reason = bgp_path_selection_peer;
+		if (!CHECK_FLAG(bgp->flags, BGP_FLAG_PEERTYPE_MULTIPATH_RELAX))
+			return 1;
+		peer_sort_ret = 1;
+	}
+
+	if (exist->sort == BGP_PEER_EBGP &&
+	    (new->sort == BGP_PEER_IBGP || new->sort == BGP_PEER_CONFED ||
+	     new->sub_sort == BGP_PEER_EBGP_OAD)) {
+		*reason = bgp_path_selection_peer;
+		if (!CHECK_FLAG(bgp->flags, BGP_FLAG_PEERTYPE_MULTIPATH_RELAX))
+			return 0;
+		peer_sort_ret = 0;
+	}
+
+	/* 8. IGP metric check. */
+	newm = new->igpmetric;
+	existm = exist->igpmetric;
+
+	if (newm != existm)
+		igp_metric_ret = newm < existm;
+
+	/* 9. Same IGP metric, compare the cluster list length. */
+	if (newm == existm && new->sort == BGP_PEER_IBGP &&
+	    exist->sort == BGP_PEER_IBGP &&
+	    (mpath_cfg == NULL || mpath_cfg->same_clusterlen)) {
+		newm = new->cluster_len;
+		existm = exist->cluster_len;
+
+		if (newm != existm)
+			igp_metric_ret = newm < existm;
+	}
+
+	/* 10. confed-external vs. confed-internal */
+	if (CHECK_FLAG(bgp->config, BGP_CONFIG_CONFEDERATION)) {
+		if (new->sort == BGP_PEER_CONFED && exist->sort == BGP_PEER_IBGP) {
+			*reason = bgp_path_selection_confed;
+			if (!CHECK_FLAG(bgp->flags,
+					BGP_FLAG_PEERTYPE_MULTIPATH_RELAX))
+				return 1;
+			peer_sort_ret = 1;
+		}
+
+		if (exist->sort == BGP_PEER_CONFED && new->sort == BGP_PEER_IBGP) {
+			*reason = bgp_path_selection_confed;
+			if (!CHECK_FLAG(bgp->flags,
+					BGP_FLAG_PEERTYPE_MULTIPATH_RELAX))
+				return 0;
+			peer_sort_ret = 0;
+		}
+	}
+
+	/* 11. Maximum path check. */
+	if (newm == existm) {
+		if (CHECK_FLAG(new->flags, BGP_PATH_CAND_LABEL_VALID) !=
+		    CHECK_FLAG(exist->flags, BGP_PATH_CAND_LABEL_VALID)) {
+			/* labeled and unlabeled paths are not multipath equal */
+		} else if (CHECK_FLAG(bgp->flags, BGP_FLAG_ASPATH_MULTIPATH_RELAX))
+			*paths_eq = 1;
+		else if (new->sort == BGP_PEER_IBGP) {
+			if (new->aspath == exist->aspath ||
+			    aspath_cmp(new->aspath, exist->aspath))
+				*paths_eq = 1;
+		} else if (new->peer_as == exist->peer_as)
+			*paths_eq = 1;
+	} else {
+		ret = peer_sort_ret;
+		if (peer_sort_ret < 0) {
+			ret = igp_metric_ret;
+			*reason = bgp_path_selection_igp_metric;
+		}
+		return ret;
+	}
+
+	if (peer_sort_ret >= 0)
+		return peer_sort_ret;
+
+	/* 12. If both paths are external, prefer the older one. */
+	if (!CHECK_FLAG(bgp->flags, BGP_FLAG_COMPARE_ROUTER_ID) &&
+	    new->sort == BGP_PEER_EBGP && exist->sort == BGP_PEER_EBGP) {
+		if (CHECK_FLAG(new->flags, BGP_PATH_CAND_SELECTED)) {
+			*reason = bgp_path_selection_older;
+			return 1;
+		}
+
+		if (CHECK_FLAG(exist->flags, BGP_PATH_CAND_SELECTED)) {
+			*reason = bgp_path_selection_older;
+			return 0;
+		}
+	}
+
+	/* 13. Router-ID comparison. */
+	if (new->router_id.s_addr != exist->router_id.s_addr) {
+		*reason = bgp_path_selection_router_id;
+		return ntohl(new->router_id.s_addr) <
+		       ntohl(exist->router_id.s_addr);
+	}
+
+	/* 14. Cluster length comparison. */
+	if (new->cluster_len != exist->cluster_len) {
+		*reason = bgp_path_selection_cluster_length;
+		return new->cluster_len < exist->cluster_len;
+	}
+
+	/* 15. Neighbor address comparison. */
+	if (CHECK_FLAG(exist->flags, BGP_PATH_CAND_STALE)) {
+		*reason = bgp_path_selection_stale;
+		return 1;
+	}
+
+	if (CHECK_FLAG(new->flags, BGP_PATH_CAND_STALE)) {
+		*reason = bgp_path_selection_stale;
+		return 0;
+	}
+
+	if (CHECK_FLAG(new->flags, BGP_PATH_CAND_NO_SU_REMOTE)) {
+		*reason = bgp_path_selection_local_configured;
+		return 0;
+	}
+
+	if (CHECK_FLAG(exist->flags, BGP_PATH_CAND_NO_SU_REMOTE)) {
+		*reason = bgp_path_selection_local_configured;
+		return 1;
+	}
+
+	ret = sockunion_cmp(&new->su_remote, &exist->su_remote);
+	if (ret > 0) {
+		*reason = bgp_path_selection_neighbor_ip;
+		return 0;
+	}
+
+	if (ret < 0) {
+		*reason = bgp_path_selection_neighbor_ip;
+		return 1;
+	}
+
+	*reason = bgp_path_selection_default;
+	return 1;
+}
+
 int bgp_evpn_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 			   struct bgp_path_info *exist, int *paths_eq,
 			   bool debug)
@@ -2202,7 +2540,7 @@ static int bgp_input_modifier(struct peer *peer, const struct prefix *p, struct
 		SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_IN);
 
 		/* Apply BGP route map to the attribute. */
-		ret = route_map_apply(rmap, p, path);
+		ret = bgp_rmap_cache_apply(rmap, p, path, PEER_RMAP_TYPE_IN);
 
 		peer->rmap_type = 0;
 
@@ -2212,6 +2550,52 @@ static int bgp_input_modifier(struct peer *peer, const struct prefix *p, struct
 	return RMAP_PERMIT;
 }
 
+bool bgp_input_policy_eval(struct peer *peer, struct bgp_dest *dest,
+			   struct bgp_adj_in *ain, afi_t afi, safi_t safi,
+			   struct bgp_inpolicy *pol)
+{
+	const struct prefix *p = bgp_dest_get_prefix(dest);
+	struct bgp_path_info_extra rmap_extra = {};
+	struct bgp_path_info rmap_bpi = { .extra = &rmap_extra };
+	struct bgp_path_info pi_lookup = { .net = dest,
+					   .peer = peer,
+					   .type = ZEBRA_ROUTE_BGP,
+					   .sub_type = BGP_ROUTE_NORMAL,
+					   .addpath_rx_id = ain->addpath_rx_id };
+	uint8_t num_labels = ain->labels ? ain->labels->num_labels : 0;
+	mpls_label_t *label = num_labels ? &ain->labels->label[0] : NULL;
+
+	memset(pol, 0, sizeof(*pol));
+
+	if (bgp_input_filter(peer, p, ain->attr, afi, safi) == FILTER_DENY)
+		pol->filter_deny = true;
+	else {
+		bgp_attr_dup_into(&pol->attr, ain->attr);
+		pol->rmap_ret = bgp_input_modifier(peer, p, &pol->attr, afi, safi, NULL, label,
+						   num_labels, dest, &rmap_bpi);
+		pol->srte_color = rmap_extra.srte_color;
+
+		if (pol->rmap_ret != RMAP_DENY)
+			return false;
+	}
+
+	/* bgp_update() puts labeled-unicast routes in the unicast table */
+	if (safi == SAFI_LABELED_UNICAST)
+		return false;
+
+	return !bgp_pi_hash_find(&bgp_dest_table(dest)->pi_hash, &pi_lookup);
+}
+
+void bgp_input_policy_discard(struct bgp_inpolicy *pol)
+{
+	if (pol->consumed || pol->filter_deny)
+		return;
+
+	bgp_attr_flush(&pol->attr);
+	bgp_attr_extra_discard(&pol->attr);
+	pol->consumed = true;
+}
+
 static int bgp_output_modifier(struct peer *peer, const struct prefix *p,
 			       struct attr *attr, afi_t afi, safi_t safi,
 			       const char *rmap_name)
@@ -2970,11 +3354,13 @@ bool subgroup_announce_check(struct bgp_dest *dest, struct bgp_path_info *pi,
 		SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_OUT);
 
 		if (bgp_path_suppressed(pi))
-			ret = route_map_apply(UNSUPPRESS_MAP(filter), p,
-					      &rmap_path);
+			ret = bgp_rmap_cache_apply(UNSUPPRESS_MAP(filter), p,
+						   &rmap_path,
+						   PEER_RMAP_TYPE_OUT);
 		else
-			ret = route_map_apply(ROUTE_MAP_OUT(filter), p,
-					      &rmap_path);
+			ret = bgp_rmap_cache_apply(ROUTE_MAP_OUT(filter), p,
+						   &rmap_path,
+						   PEER_RMAP_TYPE_OUT);
 
 		bgp_attr_flush(&dummy_attr);
 		peer->rmap_type = 0;
@@ -3516,6 +3902,64 @@ static void bgp_route_select_timer_expire(struct event *event)
 	bgp_do_deferred_path_selection(bgp, afi, safi);
 }
 
+/* Candidate array for "bgp bestpath compact-selection", main pthread only */
+static struct bgp_path_cand *bgp_path_cands;
+static uint32_t bgp_path_cands_size;
+
+static struct bgp_path_cand *bgp_path_cands_get(uint32_t count)
+{
+	if (count > bgp_path_cands_size) {
+		bgp_path_cands_size = MAX(count, bgp_path_cands_size * 2);
+		bgp_path_cands = XREALLOC(MTYPE_BGP_PATH_CAND, bgp_path_cands,
+					  bgp_path_cands_size *
+						  sizeof(*bgp_path_cands));
+	}
+
+	return bgp_path_cands;
+}
+
+/* Snapshot all paths on the dest, in list order */
+static uint32_t bgp_path_cands_fill(struct bgp *bgp, struct bgp_dest *dest,
+				    struct bgp_path_cand *cands, afi_t afi,
+				    safi_t safi)
+{
+	struct bgp_path_info *pi;
+	uint32_t n = 0;
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		bgp_path_cand_fill(bgp, &cands[n++], pi, afi, safi);
+
+	return n;
+}
+
+static void bgp_path_cands_insert(struct bgp_path_cand *cands,
+				  uint32_t *ncands, uint32_t pos,
+				  const struct bgp_path_cand *cand)
+{
+	memmove(&cands[pos + 1], &cands[pos],
+		(*ncands - pos) * sizeof(*cands));
+	cands[pos] = *cand;
+	(*ncands)++;
+}
+
+static void bgp_path_cands_delete(struct bgp_path_cand *cands,
+				  uint32_t *ncands, uint32_t pos)
+{
+	(*ncands)--;
+	memmove(&cands[pos], &cands[pos + 1],
+		(*ncands - pos) * sizeof(*cands));
+}
+
+static uint32_t bgp_path_list_count(struct bgp_path_info *pi)
+{
+	uint32_t count = 0;
+
+	for (; pi; pi = pi->next)
+		count++;
+
+	return count;
+}
+
 void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			struct bgp_maxpaths_cfg *mpath_cfg,
 			struct bgp_path_info_pair *result, afi_t afi,
@@ -3526,13 +3970,18 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	struct bgp_path_info *pi;
 	struct bgp_path_info *pi1;
 	struct bgp_path_info *pi2;
-	int paths_eq, do_mpath;
+	int paths_eq, do_mpath, ret;
 	bool debug, any_comparisons;
 	char pfx_buf[PREFIX2STR_BUFFER + VRF_NAMSIZ + 2] = {};
 	char path_buf[PATH_ADDPATH_STR_BUFFER];
 	enum bgp_path_selection_reason reason = bgp_path_selection_none;
 	bool unsorted_items = true;
 	uint32_t num_candidates = 0;
+	struct bgp_path_cand *cands = NULL;
+	struct bgp_path_cand first_cand, best_cand;
+	uint32_t ncands = 0;
+	int32_t k;
+	bool compact;
 
 	do_mpath =
 		(mpath_cfg->maxpaths_ebgp > 1 || mpath_cfg->maxpaths_ibgp > 1);
@@ -3542,6 +3991,9 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	if (debug)
 		snprintfrr(pfx_buf, sizeof(pfx_buf), "%pBD(%s)", dest, bgp->name_pretty);
 
+	/* Debug output comes from bgp_path_info_cmp() only */
+	compact = CHECK_FLAG(bgp->flags, BGP_FLAG_BESTPATH_COMPACT) && !debug;
+
 	/* bgp deterministic-med */
 	new_select = NULL;
 	if (CHECK_FLAG(bgp->flags, BGP_FLAG_DETERMINISTIC_MED)) {
@@ -3672,6 +4124,17 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	else
 		unsorted_items = false;
 
+	/*
+	 * The candidate array mirrors the sorted part of the path list, entry
+	 * for entry, while the unsorted paths are inserted below.
+	 */
+	if (compact && unsorted_list) {
+		cands = bgp_path_cands_get(
+			bgp_path_list_count(bgp_dest_get_bgp_path_info(dest)) +
+			bgp_path_list_count(unsorted_list));
+		ncands = bgp_path_cands_fill(bgp, dest, cands, afi, safi);
+	}
+
 	any_comparisons = false;
 	worse = NULL;
 	while (unsorted_list) {
@@ -3748,10 +4211,14 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 
 		worse = NULL;
 
+		if (compact)
+			bgp_path_cand_fill(bgp, &first_cand, first, afi, safi);
+
 		struct bgp_path_info *look_thru_next;
 
-		for (look_thru = bgp_dest_get_bgp_path_info(dest); look_thru;
-		     look_thru = look_thru_next) {
+		/* k is look_thru's position in the candidate array */
+		for (look_thru = bgp_dest_get_bgp_path_info(dest), k = 0;
+		     look_thru; look_thru = look_thru_next, k++) {
 			/* look thru can be reaped save the next pointer */
 			look_thru_next = look_thru->next;
 
@@ -3776,6 +4243,11 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					dest = bgp_path_info_reap(dest,
 								  look_thru);
 					assert(dest);
+
+					if (compact)
+						bgp_path_cands_delete(cands,
+								      &ncands,
+								      k--);
 				}
 
 				continue;
@@ -3803,9 +4275,17 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 						 BGP_PATH_DMED_CHECK);
 			reason = dest->reason;
 			any_comparisons = true;
-			if (bgp_path_info_cmp(bgp, first, look_thru, &paths_eq,
-					      mpath_cfg, debug, pfx_buf, afi,
-					      safi, &reason)) {
+			if (compact)
+				ret = bgp_path_cand_cmp(bgp, &first_cand,
+							&cands[k], &paths_eq,
+							mpath_cfg, afi, safi,
+							&reason);
+			else
+				ret = bgp_path_info_cmp(bgp, first, look_thru,
+							&paths_eq, mpath_cfg,
+							debug, pfx_buf, afi,
+							safi, &reason);
+			if (ret) {
 				first->reason = reason;
 				worse = look_thru;
 				/*
@@ -3841,12 +4321,21 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					bgp_dest_set_bgp_path_info(dest, first);
 				first->prev = end;
 				first->next = NULL;
+
+				if (compact)
+					bgp_path_cands_insert(cands, &ncands,
+							      ncands,
+							      &first_cand);
 			} else {
 				bgp_dest_set_bgp_path_info(dest, first);
 				if (end)
 					end->prev = first;
 				first->next = end;
 				first->prev = NULL;
+
+				if (compact)
+					bgp_path_cands_insert(cands, &ncands, 0,
+							      &first_cand);
 			}
 
 			dest->reason = first->reason;
@@ -3857,6 +4346,10 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 			first->prev = worse->prev;
 			worse->prev = first;
 
+			if (compact)
+				bgp_path_cands_insert(cands, &ncands, k,
+						      &first_cand);
+
 			if (dest->info == worse) {
 				bgp_dest_set_bgp_path_info(dest, first);
 				dest->reason = first->reason;
@@ -3927,7 +4420,23 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 	if (do_mpath && new_select) {
 		bool first_reason = true;
 
-		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+		/*
+		 * Paths past the end of the array are the unsorted holddown
+		 * ones appended above, which are never compared.
+		 */
+		if (compact) {
+			if (!cands) {
+				cands = bgp_path_cands_get(bgp_path_list_count(
+					bgp_dest_get_bgp_path_info(dest)));
+				ncands = bgp_path_cands_fill(bgp, dest, cands,
+							     afi, safi);
+			}
+			bgp_path_cand_fill(bgp, &best_cand, new_select, afi,
+					   safi);
+		}
+
+		for (pi = bgp_dest_get_bgp_path_info(dest), k = 0; pi;
+		     pi = pi->next, k++) {
 			if (debug)
 				bgp_path_info_path_with_addpath_rx_str(
 					pi, path_buf, sizeof(path_buf));
@@ -3945,8 +4454,14 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_dest *dest,
 					continue;
 
 			reason = dest->reason;
-			bgp_path_info_cmp(bgp, pi, new_select, &paths_eq, mpath_cfg, debug,
-					  pfx_buf, afi, safi, &reason);
+			if (compact && (uint32_t)k < ncands)
+				bgp_path_cand_cmp(bgp, &cands[k], &best_cand,
+						  &paths_eq, mpath_cfg, afi,
+						  safi, &reason);
+			else
+				bgp_path_info_cmp(bgp, pi, new_select, &paths_eq,
+						  mpath_cfg, debug, pfx_buf,
+						  afi, safi, &reason);
 
 			if (!paths_eq && first_reason) {
 				dest->reason = reason;
@@ -4040,7 +4555,7 @@ void subgroup_process_announce_selected(struct update_subgroup *subgrp,
 							if (adj->subgroup != subgrp)
 								continue;
 
-							if (!adj->adv &&
+							if (!bgp_adj_out_adv(adj) &&
 							    adj->addpath_tx_id != addpath_tx_id) {
 								bgp_adj_out_unset_subgroup(dest,
 											   subgrp,
@@ -4413,6 +4928,10 @@ void bgp_process_main_one(struct bgp *bgp, struct bgp_dest *dest, afi_t afi, saf
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
+	/* Condition-maps of advertise-maps may be looking at this */
+	if (bgp->condition_filter_count)
+		bgp_conditional_adv_dest_changed(bgp, dest, afi, safi);
+
 	if (safi == SAFI_UNICAST && is_srv6_unicast_enabled(bgp, afi))
 		bgp_srv6_unicast_register_route(bgp, afi, dest, new_select);
 
@@ -6027,6 +6546,12 @@ void bgp_update_check_valid_flags(struct bgp *bgp, struct peer *peer, struct bgp
 	}
 }
 
+/*
+ * Inbound policy already evaluated for the next bgp_update() call, set by
+ * bgp_soft_reconfig_table_update().
+ */
+static struct bgp_inpolicy *bgp_update_inpolicy;
+
 void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		struct attr *attr, afi_t afi, safi_t safi, int type,
 		int sub_type, struct prefix_rd *prd, mpls_label_t *label,
@@ -6050,8 +6575,11 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	struct bgp_path_info_extra rmap_extra = {};
 	struct bgp_path_info rmap_bpi = { .extra = &rmap_extra };
 	struct bgp_route_evpn *p_evpn = evpn;
+	struct bgp_inpolicy *inpolicy = bgp_update_inpolicy;
 	uint8_t i;
 
+	bgp_update_inpolicy = NULL;
+
 	if (frrtrace_enabled(frr_bgp, process_update)) {
 		char pfxprint[PREFIX2STR_BUFFER] = { 0 };
 
@@ -6300,7 +6828,8 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	}
 
 	/* Apply incoming filter.  */
-	if (bgp_input_filter(peer, p, attr, afi, orig_safi) == FILTER_DENY) {
+	if (inpolicy ? inpolicy->filter_deny
+		     : bgp_input_filter(peer, p, attr, afi, orig_safi) == FILTER_DENY) {
 		peer->stat_pfx_filter++;
 		reason = "filter;";
 		goto filtered;
@@ -6343,7 +6872,12 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 			goto filtered;
 		}
 
-	bgp_attr_dup_into(&new_attr, attr);
+	if (inpolicy) {
+		/* take over the copy the route-map was applied to */
+		new_attr = inpolicy->attr;
+		inpolicy->consumed = true;
+	} else
+		bgp_attr_dup_into(&new_attr, attr);
 	/*
 	 * If bgp_update is called with soft_reconfig set then
 	 * attr is interned. In this case, do not overwrite the
@@ -6362,8 +6896,13 @@ void bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 	 * commands, so we need bgp_attr_flush in the error paths, until we
 	 * intern
 	 * the attr (which takes over the memory references) */
-	if (bgp_input_modifier(peer, p, &new_attr, afi, orig_safi, NULL, label, num_labels, dest,
-			       &rmap_bpi) == RMAP_DENY) {
+	if (inpolicy) {
+		ret = inpolicy->rmap_ret;
+		rmap_extra.srte_color = inpolicy->srte_color;
+	} else
+		ret = bgp_input_modifier(peer, p, &new_attr, afi, orig_safi, NULL, label,
+					 num_labels, dest, &rmap_bpi);
+	if (ret == RMAP_DENY) {
 		peer->stat_pfx_filter++;
 		reason = "route-map;";
 		bgp_attr_flush(&new_attr);
@@ -7349,7 +7888,8 @@ static void bgp_soft_reconfig_table_flag(struct bgp_table *table, bool flag)
 static void bgp_soft_reconfig_table_update(struct peer *peer,
 					   struct bgp_dest *dest,
 					   struct bgp_adj_in *ain, afi_t afi,
-					   safi_t safi, struct prefix_rd *prd)
+					   safi_t safi, struct prefix_rd *prd,
+					   struct bgp_inpolicy *pol)
 {
 	struct bgp_path_info *pi;
 	uint8_t num_labels;
@@ -7366,9 +7906,37 @@ static void bgp_soft_reconfig_table_update(struct peer *peer,
 	if (pi)
 		bre = bgp_attr_get_evpn_overlay(pi->attr);
 
+	bgp_update_inpolicy = pol;
 	bgp_update(peer, bgp_dest_get_prefix(dest), ain->addpath_rx_id,
 		   ain->attr, afi, safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, prd,
 		   label_pnt, num_labels, 1, bre, NULL);
+
+	if (pol)
+		bgp_input_policy_discard(pol);
+}
+
+/*
+ * Apply the policy evaluated by the soft reconfiguration workers.  A route
+ * that is denied and was not in the RIB is only accounted for, as
+ * bgp_update() would not do anything else with it.
+ */
+static void bgp_soft_reconfig_item_apply(struct bgp_soft_reconfig_item *item,
+					 afi_t afi, safi_t safi,
+					 struct prefix_rd *prd)
+{
+	struct peer *peer = item->ain->peer;
+	struct bgp_dest *dest = item->dest;
+
+	if (item->unchanged &&
+	    !bgp_debug_update(peer, bgp_dest_get_prefix(dest), NULL, 1)) {
+		peer->stat_pfx_filter++;
+		hook_call(bgp_process, peer->bgp, afi, safi, dest, peer, true);
+		bgp_input_policy_discard(&item->pol);
+		return;
+	}
+
+	bgp_soft_reconfig_table_update(peer, dest, item->ain, afi, safi, prd,
+				       &item->pol);
 }
 
 static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
@@ -7387,7 +7955,7 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 				continue;
 
 			bgp_soft_reconfig_table_update(peer, dest, ain, afi,
-						       safi, prd);
+						       safi, prd, NULL);
 		}
 }
 
@@ -7408,6 +7976,9 @@ static void bgp_soft_reconfig_table_task(struct event *event)
 	struct bgp_table *table;
 	struct prefix_rd *prd;
 	struct listnode *node, *nnode;
+	struct bgp_soft_reconfig_item *items;
+	unsigned int i, nitems;
+	bool batch = !!bgp_soft_reconfig_workers_get();
 
 	table = EVENT_ARG(event);
 	prd = NULL;
@@ -7434,14 +8005,27 @@ static void bgp_soft_reconfig_table_task(struct event *event)
 				if (ain->peer != peer)
 					continue;
 
-				bgp_soft_reconfig_table_update(
-					peer, dest, ain, table->afi,
-					table->safi, prd);
+				if (batch)
+					bgp_soft_reconfig_batch_add(dest, ain);
+				else
+					bgp_soft_reconfig_table_update(
+						peer, dest, ain, table->afi,
+						table->safi, prd, NULL);
 				iter++;
 			}
 		}
 	}
 
+	/* Evaluate the policy for the slice in parallel, apply it in order */
+	if (batch) {
+		items = bgp_soft_reconfig_batch_run(table->afi, table->safi,
+						    &nitems);
+		for (i = 0; i < nitems; i++)
+			bgp_soft_reconfig_item_apply(&items[i], table->afi,
+						     table->safi, prd);
+		bgp_soft_reconfig_batch_clear();
+	}
+
 	/* we're either starting the initial iteration,
 	 * or we're going to continue an ongoing iteration
 	 */
@@ -8643,6 +9227,95 @@ bool bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
 			      PEER_CAP_ADDPATH_AF_TX_RCV));
 }
 
+/* Semantic check of a unicast NLRI prefix; invalid ones are logged and
+ * must be ignored.
+ */
+static bool bgp_nlri_ip_invalid(struct peer *peer, afi_t afi, safi_t safi,
+				const struct prefix *p)
+{
+	if (afi == AFI_IP && safi == SAFI_UNICAST) {
+		if (IN_CLASSD(ntohl(p->u.prefix4.s_addr))) {
+			/* From RFC4271 Section 6.3:
+			 *
+			 * If a prefix in the NLRI field is semantically
+			 * incorrect
+			 * (e.g., an unexpected multicast IP address),
+			 * an error SHOULD
+			 * be logged locally, and the prefix SHOULD be
+			 * ignored.
+			 */
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
+				peer->host, &p->u.prefix4);
+			return true;
+		}
+	}
+
+	if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
+		if (IN6_IS_ADDR_LINKLOCAL(&p->u.prefix6)) {
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv6 unicast NLRI is link-local address %pI6, ignoring",
+				peer->host, &p->u.prefix6);
+
+			return true;
+		}
+		if (IN6_IS_ADDR_MULTICAST(&p->u.prefix6)) {
+			flog_err(
+				EC_BGP_UPDATE_RCV,
+				"%s: IPv6 unicast NLRI is multicast address %pI6, ignoring",
+				peer->host, &p->u.prefix6);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Same as bgp_nlri_parse_ip(), for NLRI already decoded by a parse worker.
+ * The syntax checks have been done by the worker.
+ */
+int bgp_nlri_parse_decoded(struct peer *peer, struct attr *attr,
+			   const struct bgp_parse_nlri *nlri)
+{
+	const struct bgp_parse_pfx *pfx;
+	afi_t afi = nlri->afi;
+	safi_t safi = nlri->safi;
+
+	/* cache the incoming attr to avoid repeated intern */
+	if (attr) {
+		memset(&attr->attr_intern_reuse, 0, sizeof(attr->attr_intern_reuse));
+		attr->attr_intern_reuse.parsed_attr = attr;
+	}
+
+	for (pfx = nlri->pfx; pfx < nlri->pfx + nlri->count; pfx++) {
+		if (bgp_nlri_ip_invalid(peer, afi, safi, &pfx->p))
+			continue;
+
+		if (attr)
+			bgp_update(peer, &pfx->p, pfx->addpath_id, attr, afi,
+				   safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
+				   NULL, NULL, 0, 0, NULL, NULL);
+		else
+			bgp_withdraw(peer, &pfx->p, pfx->addpath_id, afi, safi,
+				     ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL,
+				     NULL, 0);
+
+		/* Do not send BGP notification twice when maximum-prefix count
+		 * overflow. */
+		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+	}
+
+	/* Reset the attr_intern_reuse cache */
+	if (attr)
+		memset(&attr->attr_intern_reuse, 0, sizeof(attr->attr_intern_reuse));
+
+	return BGP_NLRI_PARSE_OK;
+}
+
 /* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
    value. */
 int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
@@ -8728,44 +9401,8 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 		memcpy(p.u.val, pnt, psize);
 
 		/* Check address. */
-		if (afi == AFI_IP && safi == SAFI_UNICAST) {
-			if (IN_CLASSD(ntohl(p.u.prefix4.s_addr))) {
-				/* From RFC4271 Section 6.3:
-				 *
-				 * If a prefix in the NLRI field is semantically
-				 * incorrect
-				 * (e.g., an unexpected multicast IP address),
-				 * an error SHOULD
-				 * be logged locally, and the prefix SHOULD be
-				 * ignored.
-				 */
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv4 unicast NLRI is multicast address %pI4, ignoring",
-					peer->host, &p.u.prefix4);
-				continue;
-			}
-		}
-
-		/* Check address. */
-		if (afi == AFI_IP6 && safi == SAFI_UNICAST) {
-			if (IN6_IS_ADDR_LINKLOCAL(&p.u.prefix6)) {
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is link-local address %pI6, ignoring",
-					peer->host, &p.u.prefix6);
-
-				continue;
-			}
-			if (IN6_IS_ADDR_MULTICAST(&p.u.prefix6)) {
-				flog_err(
-					EC_BGP_UPDATE_RCV,
-					"%s: IPv6 unicast NLRI is multicast address %pI6, ignoring",
-					peer->host, &p.u.prefix6);
-
-				continue;
-			}
-		}
+		if (bgp_nlri_ip_invalid(peer, afi, safi, &p))
+			continue;
 
 		/* Normal process. */
 		if (attr)
@@ -14962,14 +15599,27 @@ static void bgp_fib_flags_info(struct vty *vty, struct bgp *bgp, struct bgp_dest
 	}
 }
 
+/*
+ * Position of a table walk done in several calls to bgp_show_table(): the
+ * next dest to look at (locked, NULL once the walk is over), whether an entry
+ * was output already and how many dests to look at per call.
+ */
+struct bgp_show_resume {
+	struct bgp_dest *dest;
+	bool first;
+	unsigned int limit;
+};
+
 static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 			  struct bgp_table *table, enum bgp_show_type type, void *output_arg,
 			  const char *rd, int is_last, unsigned long *output_cum,
 			  unsigned long *total_cum, unsigned long *json_header_depth,
-			  uint16_t show_flags, enum rpki_states rpki_target_state, bool brief)
+			  uint16_t show_flags, enum rpki_states rpki_target_state, bool brief,
+			  struct bgp_show_resume *resume)
 {
 	struct bgp_path_info *pi;
 	struct bgp_dest *dest;
+	unsigned int visited = 0;
 	bool header = true;
 	bool json_detail_header = false;
 	int display;
@@ -15034,12 +15684,22 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t sa
 	    type != bgp_show_type_flap_neighbor)
 		json_detail_header = true;
 
+	if (resume) {
+		dest = resume->dest;
+		first = resume->first;
+	} else
+		dest = bgp_table_top(table);
+
 	/* Start processing of routes. */
-	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+	for (; dest; dest = bgp_route_next(dest)) {
 		const struct prefix *dest_p = bgp_dest_get_prefix(dest);
 		enum rpki_states rpki_curr_state = RPKI_NOT_BEING_USED;
 		bool json_detail_header_used = false;
 
+		/* Keep the lock on dest, the walk continues from there */
+		if (resume && visited++ == resume->limit)
+			break;
+
 		pi = bgp_dest_get_bgp_path_info(dest);
 		if (pi == NULL)
 			continue;
@@ -15467,6 +16127,12 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t sa
 		total_count += *total_cum;
 		*total_cum = total_count;
 	}
+	if (resume) {
+		resume->dest = dest;
+		resume->first = first;
+		if (dest)
+			return CMD_SUCCESS;
+	}
 	if (use_json) {
 		if (rd) {
 			vty_out(vty, " }%s ", (is_last ? "" : ","));
@@ -15543,7 +16209,8 @@ int bgp_show_table_rd(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 			prefix_rd2str(&prd, rd, sizeof(rd), bgp->asnotation);
 			bgp_show_table(vty, bgp, afi, safi, itable, type, output_arg, rd,
 				       !bgp_dest_get_bgp_table_info(next), &output_cum, &total_cum,
-				       &json_header_depth, show_flags, RPKI_NOT_BEING_USED, false);
+				       &json_header_depth, show_flags, RPKI_NOT_BEING_USED, false,
+				       NULL);
 			if (next == NULL)
 				show_msg = false;
 		}
@@ -15563,6 +16230,139 @@ int bgp_show_table_rd(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 	return CMD_SUCCESS;
 }
 
+/* Dests looked at by a "show bgp" before it yields to the event loop */
+#define BGP_SHOW_YIELD_DESTS 10000
+/* Retry interval while the client has not read the previous chunk yet */
+#define BGP_SHOW_YIELD_WAIT_MSEC 10
+
+PREDECL_DLIST(bgp_show_yields);
+
+/* A "show bgp" of a single table, suspended between two chunks. */
+struct bgp_show_yield {
+	struct bgp_show_yields_item item;
+
+	struct vty *vty;
+	struct bgp *bgp;
+	struct bgp_table *table;
+	afi_t afi;
+	safi_t safi;
+	enum bgp_show_type type;
+	uint16_t show_flags;
+	enum rpki_states rpki_target_state;
+	bool brief;
+
+	unsigned long output_cum;
+	unsigned long total_cum;
+	unsigned long json_header_depth;
+	struct bgp_show_resume resume;
+
+	struct event *t_resume;
+};
+
+DECLARE_DLIST(bgp_show_yields, struct bgp_show_yield, item);
+
+static struct bgp_show_yields_head bgp_show_yields[1] = {
+	INIT_DLIST(bgp_show_yields[0]),
+};
+
+static void bgp_show_yield_free(struct bgp_show_yield *sy)
+{
+	event_cancel(&sy->t_resume);
+	if (sy->resume.dest)
+		bgp_dest_unlock_node(sy->resume.dest);
+	bgp_table_unlock(sy->table);
+	bgp_unlock(sy->bgp);
+	bgp_show_yields_del(bgp_show_yields, sy);
+	XFREE(MTYPE_BGP_SHOW_YIELD, sy);
+}
+
+static void bgp_show_yield_chunk(struct bgp_show_yield *sy)
+{
+	bgp_show_table(sy->vty, sy->bgp, sy->afi, sy->safi, sy->table, sy->type, NULL, NULL, 1,
+		       &sy->output_cum, &sy->total_cum, &sy->json_header_depth, sy->show_flags,
+		       sy->rpki_target_state, sy->brief, &sy->resume);
+}
+
+static void bgp_show_yield_resume(struct event *event)
+{
+	struct bgp_show_yield *sy = EVENT_ARG(event);
+	struct vty *vty = sy->vty;
+
+	/* Do not buffer more than one chunk for a slow reader */
+	if (vty_out_pending(vty)) {
+		event_add_timer_msec(bm->master, bgp_show_yield_resume, sy,
+				     BGP_SHOW_YIELD_WAIT_MSEC, &sy->t_resume);
+		return;
+	}
+
+	/* Cut the walk short, but still terminate the output properly */
+	if (vty->status == VTY_CLOSE || CHECK_FLAG(sy->bgp->flags, BGP_FLAG_DELETE_IN_PROGRESS)) {
+		bgp_dest_unlock_node(sy->resume.dest);
+		sy->resume.dest = NULL;
+	}
+
+	bgp_show_yield_chunk(sy);
+	if (sy->resume.dest) {
+		event_add_event(bm->master, bgp_show_yield_resume, sy, 0, &sy->t_resume);
+		return;
+	}
+
+	bgp_show_yield_free(sy);
+	vty_resume_response(vty, CMD_SUCCESS);
+}
+
+static int bgp_show_yield_vty_closing(struct vty *vty)
+{
+	struct bgp_show_yield *sy;
+
+	frr_each_safe (bgp_show_yields, bgp_show_yields, sy)
+		if (sy->vty == vty)
+			bgp_show_yield_free(sy);
+
+	return 0;
+}
+
+/*
+ * Same as bgp_show_table() for a whole table, but give the event loop a chance
+ * to run every BGP_SHOW_YIELD_DESTS dests: the command is suspended and the
+ * output of every chunk sent to the client before the next one is produced,
+ * so neither the main thread nor the vty buffer grow with the table size.
+ */
+static int bgp_show_table_yield(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
+				struct bgp_table *table, enum bgp_show_type type,
+				uint16_t show_flags, enum rpki_states rpki_target_state,
+				bool brief)
+{
+	struct bgp_show_yield *sy;
+
+	sy = XCALLOC(MTYPE_BGP_SHOW_YIELD, sizeof(*sy));
+	sy->vty = vty;
+	sy->bgp = bgp;
+	sy->table = table;
+	sy->afi = afi;
+	sy->safi = safi;
+	sy->type = type;
+	sy->show_flags = show_flags;
+	sy->rpki_target_state = rpki_target_state;
+	sy->brief = brief;
+	sy->resume.dest = bgp_table_top(table);
+	sy->resume.first = true;
+	sy->resume.limit = BGP_SHOW_YIELD_DESTS;
+
+	bgp_show_yield_chunk(sy);
+	if (!sy->resume.dest) {
+		XFREE(MTYPE_BGP_SHOW_YIELD, sy);
+		return CMD_SUCCESS;
+	}
+
+	bgp_lock(bgp);
+	bgp_table_lock(table);
+	bgp_show_yields_add_tail(bgp_show_yields, sy);
+	event_add_event(bm->master, bgp_show_yield_resume, sy, 0, &sy->t_resume);
+
+	return CMD_SUSPEND;
+}
+
 static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 		    enum bgp_show_type type, void *output_arg, uint16_t show_flags,
 		    enum rpki_states rpki_target_state, bool brief)
@@ -15610,8 +16410,17 @@ static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 		return CMD_SUCCESS;
 	}
 
+	/*
+	 * Only vtysh can wait for the end of a suspended command, and neither
+	 * a "| include" filter nor output_arg survive the command's return.
+	 */
+	if (CHECK_FLAG(show_flags, BGP_SHOW_OPT_YIELD) && !output_arg &&
+	    vty->type == VTY_SHELL_SERV && !vty->filter)
+		return bgp_show_table_yield(vty, bgp, afi, safi, table, type, show_flags,
+					    rpki_target_state, brief);
+
 	return bgp_show_table(vty, bgp, afi, safi, table, type, output_arg, NULL, 1, NULL, NULL,
-			      &json_header_depth, show_flags, rpki_target_state, brief);
+			      &json_header_depth, show_flags, rpki_target_state, brief, NULL);
 }
 
 static void bgp_show_all_instances_routes_vty(struct vty *vty, afi_t afi,
@@ -16851,8 +17660,9 @@ DEFPY(show_ip_bgp, show_ip_bgp_cmd,
 						  match_p, afi, safi,
 						  show_flags);
 		else
-			return bgp_show(vty, bgp, afi, safi, sh_type, output_arg, show_flags,
-					rpki_target_state, brief);
+			return bgp_show(vty, bgp, afi, safi, sh_type, output_arg,
+					show_flags | BGP_SHOW_OPT_YIELD, rpki_target_state,
+					brief);
 	} else {
 		struct listnode *node;
 		struct bgp *abgp;
@@ -19787,7 +20597,7 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 					if (pi->extra && pi->extra->damp_info) {
 						pi_temp = pi->next;
 						bgp_damp_info_free(pi->extra->damp_info,
-								   NULL, 1);
+								   1);
 						pi = pi_temp;
 					} else
 						pi = pi->next;
@@ -19825,7 +20635,7 @@ static int bgp_clear_damp_route(struct vty *vty, const char *view_name,
 			bgp_process(bgp, bdi->dest, bdi->path, bdi->afi,
 				    bdi->safi);
 
-			bgp_damp_info_free(pi->extra->damp_info, NULL, 1);
+			bgp_damp_info_free(pi->extra->damp_info, 1);
 			pi = pi_temp;
 		}
 
@@ -20460,6 +21270,8 @@ void bgp_route_init(void)
 	FOREACH_AFI_SAFI (afi, safi)
 		bgp_distance_table[afi][safi] = bgp_table_init(NULL, afi, safi);
 
+	hook_register(vty_closing, bgp_show_yield_vty_closing);
+
 	/* IPv4 BGP commands. */
 	install_element(BGP_NODE, &bgp_table_map_cmd);
 	install_element(BGP_NODE, &bgp_network_cmd);
@@ -20608,6 +21420,7 @@ void bgp_route_init(void)
 
 void bgp_route_finish(void)
 {
+	struct bgp_show_yield *sy;
 	afi_t afi;
 	safi_t safi;
 
@@ -20615,4 +21428,11 @@ void bgp_route_finish(void)
 		bgp_table_unlock(bgp_distance_table[afi][safi]);
 		bgp_distance_table[afi][safi] = NULL;
 	}
+
+	XFREE(MTYPE_BGP_PATH_CAND, bgp_path_cands);
+	bgp_path_cands_size = 0;
+
+	hook_unregister(vty_closing, bgp_show_yield_vty_closing);
+	while ((sy = bgp_show_yields_first(bgp_show_yields)))
+		bgp_show_yield_free(sy);
 }
@@ -8,9 +8,11 @@
 
 #include <stdbool.h>
 
+#include "frrcu.h"
 #include "hook.h"
 #include "queue.h"
 #include "nexthop.h"
+#include "sockunion.h"
 #include "typesafe.h"
 #include "bgp_table.h"
 #include "bgp_addpath_types.h"
@@ -19,6 +21,7 @@
 struct bgp_nexthop_cache;
 struct bgp_route_evpn;
 struct bgp_unreach_nlri;
+struct bgp_parse_nlri;
 
 enum bgp_show_type {
 	bgp_show_type_normal,
@@ -303,9 +306,14 @@ struct bgp_mplsvpn_nh_label_bind {
 };
 
 struct bgp_path_info {
-	/* For linked list. */
-	struct bgp_path_info *next;
-	struct bgp_path_info *prev;
+	/* For linked list, and RCU once released (see bgp_reclaim.c) */
+	union {
+		struct {
+			struct bgp_path_info *next;
+			struct bgp_path_info *prev;
+		};
+		struct rcu_head rcu_head;
+	};
 
 	/* Hash linkage for pi_hash in bgp_table */
 	struct bgp_pi_hash_item pi_hash_link;
@@ -412,6 +420,54 @@ struct bgp_path_info_pair {
 	struct bgp_path_info *new;
 };
 
+/*
+ * Snapshot of the fields of a path that the decision process looks at,
+ * used by "bgp bestpath compact-selection" to run the comparisons over a
+ * contiguous array instead of chasing attr/peer/extra pointers.  Only
+ * valid for the duration of one bgp_best_selection() run.
+ */
+#define BGP_PATH_CAND_COMPLEX (1 << 0)
+#define BGP_PATH_CAND_UPA (1 << 1)
+#define BGP_PATH_CAND_LLGR_STALE (1 << 2)
+#define BGP_PATH_CAND_STALE (1 << 3)
+#define BGP_PATH_CAND_SELECTED (1 << 4)
+#define BGP_PATH_CAND_LABEL_VALID (1 << 5)
+#define BGP_PATH_CAND_NO_SU_REMOTE (1 << 6)
+
+/* How the leftmost AS of the AS_PATH compares for MED purposes */
+enum bgp_path_cand_left {
+	BGP_PATH_CAND_LEFT_NONE = 0,
+	BGP_PATH_CAND_LEFT_EMPTY,
+	BGP_PATH_CAND_LEFT_AS,
+};
+
+struct bgp_path_cand {
+	struct bgp_path_info *pi;
+
+	uint32_t weight;
+	uint32_t local_pref;
+	uint32_t med;
+	uint32_t igpmetric;
+	uint32_t cluster_len;
+	struct in_addr router_id;
+
+	const struct aspath *aspath;
+	uint32_t hops;
+	uint32_t confeds;
+	as_t left_as;
+	as_t left_confed_as;
+	as_t peer_as;
+
+	uint8_t origin;
+	uint8_t sort;
+	uint8_t sub_sort;
+	uint8_t left;
+	bool left_confed;
+	uint8_t flags;
+
+	union sockunion su_remote;
+};
+
 /* BGP static route configuration. */
 struct bgp_static {
 	/* Backdoor configuration.  */
@@ -849,6 +905,8 @@ DECLARE_HASH(bgp_upa_prefix_hash, struct bgp_upa_prefix_entry, hash_link, bgp_up
 #define BGP_SHOW_OPT_TERSE (1 << 8)
 #define BGP_SHOW_OPT_ROUTES_DETAIL (1 << 9)
 #define BGP_SHOW_OPT_INTERNAL_DATA (1 << 10)
+/* may return CMD_SUSPEND and finish the output from the event loop */
+#define BGP_SHOW_OPT_YIELD (1 << 11)
 
 /* Prototypes. */
 extern void bgp_rib_remove(struct bgp_dest *dest, struct bgp_path_info *pi,
@@ -873,6 +931,21 @@ extern void bgp_soft_reconfig_table_task_cancel(const struct bgp *bgp,
  * and return true.  If it is not return false; and do nothing
  */
 extern bool bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi);
+
+/*
+ * Evaluate the inbound filters and route-map of @peer for the route it sent
+ * in @ain as bgp_update() would, without changing anything but @pol.  Safe
+ * to call from a pthread other than the main one as long as the main pthread
+ * is waiting, one pthread per peer (see bgp_soft_reconfig.c).  Returns true
+ * when the route is denied and @peer has no path for it, so bgp_update()
+ * would leave the RIB unchanged.
+ */
+struct bgp_inpolicy;
+extern bool bgp_input_policy_eval(struct peer *peer, struct bgp_dest *dest,
+				  struct bgp_adj_in *ain, afi_t afi,
+				  safi_t safi, struct bgp_inpolicy *pol);
+/* Release what bgp_update() did not take over from @pol. */
+extern void bgp_input_policy_discard(struct bgp_inpolicy *pol);
 extern void bgp_clear_route(struct peer *peer, afi_t afi, safi_t safi);
 extern void bgp_clear_route_all(struct peer *peer);
 extern bool bgp_clear_node_queue_drain(struct peer *peer);
@@ -914,6 +987,8 @@ extern bool bgp_path_info_labels_same(const struct bgp_path_info *bpi,
 				      const mpls_label_t *label, uint32_t n);
 
 extern int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr, struct bgp_nlri *packet);
+extern int bgp_nlri_parse_decoded(struct peer *peer, struct attr *attr,
+				  const struct bgp_parse_nlri *nlri);
 
 extern bool bgp_maximum_prefix_overflow(struct peer *peer, afi_t afi, safi_t safi, int always);
 
@@ -1122,6 +1197,12 @@ extern int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 			     struct bgp_maxpaths_cfg *mpath_cfg, bool debug,
 			     char *pfx_buf, afi_t afi, safi_t safi,
 			     enum bgp_path_selection_reason *reason);
+extern void bgp_path_cand_fill(struct bgp *bgp, struct bgp_path_cand *cand,
+			       struct bgp_path_info *pi, afi_t afi, safi_t safi);
+extern int bgp_path_cand_cmp(struct bgp *bgp, const struct bgp_path_cand *new,
+			     const struct bgp_path_cand *exist, int *paths_eq,
+			     struct bgp_maxpaths_cfg *mpath_cfg, afi_t afi,
+			     safi_t safi, enum bgp_path_selection_reason *reason);
 #define bgp_path_info_add(A, B)                                                \
 	bgp_path_info_add_with_caller(__func__, (A), (B))
 #define bgp_path_info_free(B) bgp_path_info_free_with_caller(__func__, (B))
@@ -51,6 +51,7 @@
 #include "bgpd/bgp_script.h"
 #include "bgpd/bgp_encap_types.h"
 #include "bgpd/bgp_errors.h"
+#include "bgpd/bgp_rmap_cache.h"
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
 #endif
@@ -740,6 +741,21 @@ route_match_prefix_list_evpn(afi_t afi, struct prefix_list *plist,
 							      : RMAP_MATCH);
 }
 
+static enum route_map_cmd_result_t
+route_match_prefix_list(struct prefix_list *plist, afi_t afi,
+			const struct prefix *prefix)
+{
+	if (prefix->family == AF_FLOWSPEC)
+		return route_match_prefix_list_flowspec(afi, plist,
+							prefix);
+
+	else if (prefix->family == AF_EVPN)
+		return route_match_prefix_list_evpn(afi, plist, prefix);
+
+	return (prefix_list_apply(plist, prefix) == PREFIX_DENY ? RMAP_NOMATCH
+								: RMAP_MATCH);
+}
+
 static enum route_map_cmd_result_t
 route_match_address_prefix_list(void *rule, afi_t afi,
 				const struct prefix *prefix, void *object)
@@ -754,15 +770,7 @@ route_match_address_prefix_list(void *rule, afi_t afi,
 		return RMAP_NOMATCH;
 	}
 
-	if (prefix->family == AF_FLOWSPEC)
-		return route_match_prefix_list_flowspec(afi, plist,
-							prefix);
-
-	else if (prefix->family == AF_EVPN)
-		return route_match_prefix_list_evpn(afi, plist, prefix);
-
-	return (prefix_list_apply(plist, prefix) == PREFIX_DENY ? RMAP_NOMATCH
-								: RMAP_MATCH);
+	return route_match_prefix_list(plist, afi, prefix);
 }
 
 static enum route_map_cmd_result_t
@@ -772,6 +780,19 @@ route_match_ip_address_prefix_list(void *rule, const struct prefix *prefix,
 	return route_match_address_prefix_list(rule, AFI_IP, prefix, object);
 }
 
+static void *route_match_ip_address_prefix_list_bind(void *rule)
+{
+	return prefix_list_lookup(AFI_IP, (char *)rule);
+}
+
+static enum route_map_cmd_result_t
+route_match_ip_address_prefix_list_bound(void *rule, void *bound,
+					 const struct prefix *prefix,
+					 void *object)
+{
+	return route_match_prefix_list(bound, AFI_IP, prefix);
+}
+
 static void *route_match_ip_address_prefix_list_compile(const char *arg)
 {
 	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
@@ -787,7 +808,10 @@ static const struct route_map_rule_cmd
 	"ip address prefix-list",
 	route_match_ip_address_prefix_list,
 	route_match_ip_address_prefix_list_compile,
-	route_match_ip_address_prefix_list_free
+	route_match_ip_address_prefix_list_free,
+	NULL,
+	route_match_ip_address_prefix_list_bind,
+	route_match_ip_address_prefix_list_bound
 };
 
 /* `match ip next-hop prefix-list PREFIX_LIST' */
@@ -1729,22 +1753,36 @@ static const struct route_map_rule_cmd route_match_metric_cmd = {
 
 /* Match function for as-path match.  I assume given object is */
 static enum route_map_cmd_result_t
-route_match_aspath(void *rule, const struct prefix *prefix, void *object)
+route_match_aspath_list(struct as_list *as_list, struct bgp_path_info *path)
 {
+	/* Perform match. */
+	return ((as_list_apply(as_list, path->attr->aspath) == AS_FILTER_DENY)
+			? RMAP_NOMATCH
+			: RMAP_MATCH);
+}
 
+static enum route_map_cmd_result_t
+route_match_aspath(void *rule, const struct prefix *prefix, void *object)
+{
 	struct as_list *as_list;
-	struct bgp_path_info *path;
 
 	as_list = as_list_lookup((char *)rule);
 	if (as_list == NULL)
 		return RMAP_NOMATCH;
 
-	path = object;
+	return route_match_aspath_list(as_list, object);
+}
 
-	/* Perform match. */
-	return ((as_list_apply(as_list, path->attr->aspath) == AS_FILTER_DENY)
-			? RMAP_NOMATCH
-			: RMAP_MATCH);
+static void *route_match_aspath_bind(void *rule)
+{
+	return as_list_lookup((char *)rule);
+}
+
+static enum route_map_cmd_result_t
+route_match_aspath_bound(void *rule, void *bound, const struct prefix *prefix,
+			 void *object)
+{
+	return route_match_aspath_list(bound, object);
 }
 
 /* Compile function for as-path match. */
@@ -1764,7 +1802,10 @@ static const struct route_map_rule_cmd route_match_aspath_cmd = {
 	"as-path",
 	route_match_aspath,
 	route_match_aspath_compile,
-	route_match_aspath_free
+	route_match_aspath_free,
+	NULL,
+	route_match_aspath_bind,
+	route_match_aspath_bound
 };
 
 /* `match as-path-count' */
@@ -1829,20 +1870,10 @@ struct rmap_community {
 
 /* Match function for community match. */
 static enum route_map_cmd_result_t
-route_match_community(void *rule, const struct prefix *prefix, void *object)
+route_match_community_list(struct rmap_community *rcom,
+			   struct community_list *list,
+			   struct bgp_path_info *path)
 {
-	struct community_list *list;
-	struct bgp_path_info *path;
-	struct rmap_community *rcom = rule;
-
-	path = object;
-	rcom = rule;
-
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     COMMUNITY_LIST_MASTER);
-	if (!list)
-		return RMAP_NOMATCH;
-
 	if (rcom->exact) {
 		if (community_list_exact_match(
 			    bgp_attr_get_community(path->attr), list))
@@ -1862,6 +1893,35 @@ route_match_community(void *rule, const struct prefix *prefix, void *object)
 	return RMAP_NOMATCH;
 }
 
+static enum route_map_cmd_result_t
+route_match_community(void *rule, const struct prefix *prefix, void *object)
+{
+	struct community_list *list;
+	struct rmap_community *rcom = rule;
+
+	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     COMMUNITY_LIST_MASTER);
+	if (!list)
+		return RMAP_NOMATCH;
+
+	return route_match_community_list(rcom, list, object);
+}
+
+static void *route_match_community_bind(void *rule)
+{
+	struct rmap_community *rcom = rule;
+
+	return community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     COMMUNITY_LIST_MASTER);
+}
+
+static enum route_map_cmd_result_t
+route_match_community_bound(void *rule, void *bound,
+			    const struct prefix *prefix, void *object)
+{
+	return route_match_community_list(rule, bound, object);
+}
+
 /* Compile function for community match. */
 static void *route_match_community_compile(const char *arg)
 {
@@ -1922,24 +1982,17 @@ static const struct route_map_rule_cmd route_match_community_cmd = {
 	route_match_community,
 	route_match_community_compile,
 	route_match_community_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	route_match_community_bind,
+	route_match_community_bound
 };
 
 /* Match function for lcommunity match. */
 static enum route_map_cmd_result_t
-route_match_lcommunity(void *rule, const struct prefix *prefix, void *object)
+route_match_lcommunity_list(struct rmap_community *rcom,
+			    struct community_list *list,
+			    struct bgp_path_info *path)
 {
-	struct community_list *list;
-	struct bgp_path_info *path;
-	struct rmap_community *rcom = rule;
-
-	path = object;
-
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     LARGE_COMMUNITY_LIST_MASTER);
-	if (!list)
-		return RMAP_NOMATCH;
-
 	if (rcom->exact) {
 		if (lcommunity_list_exact_match(
 			    bgp_attr_get_lcommunity(path->attr), list))
@@ -1959,6 +2012,35 @@ route_match_lcommunity(void *rule, const struct prefix *prefix, void *object)
 	return RMAP_NOMATCH;
 }
 
+static enum route_map_cmd_result_t
+route_match_lcommunity(void *rule, const struct prefix *prefix, void *object)
+{
+	struct community_list *list;
+	struct rmap_community *rcom = rule;
+
+	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     LARGE_COMMUNITY_LIST_MASTER);
+	if (!list)
+		return RMAP_NOMATCH;
+
+	return route_match_lcommunity_list(rcom, list, object);
+}
+
+static void *route_match_lcommunity_bind(void *rule)
+{
+	struct rmap_community *rcom = rule;
+
+	return community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     LARGE_COMMUNITY_LIST_MASTER);
+}
+
+static enum route_map_cmd_result_t
+route_match_lcommunity_bound(void *rule, void *bound,
+			     const struct prefix *prefix, void *object)
+{
+	return route_match_lcommunity_list(rule, bound, object);
+}
+
 /* Compile function for community match. */
 static void *route_match_lcommunity_compile(const char *arg)
 {
@@ -2003,25 +2085,18 @@ static const struct route_map_rule_cmd route_match_lcommunity_cmd = {
 	route_match_lcommunity,
 	route_match_lcommunity_compile,
 	route_match_lcommunity_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	route_match_lcommunity_bind,
+	route_match_lcommunity_bound
 };
 
 
 /* Match function for extcommunity match. */
 static enum route_map_cmd_result_t
-route_match_ecommunity(void *rule, const struct prefix *prefix, void *object)
+route_match_ecommunity_list(struct rmap_community *rcom,
+			    struct community_list *list,
+			    struct bgp_path_info *path)
 {
-	struct community_list *list;
-	struct bgp_path_info *path;
-	struct rmap_community *rcom = rule;
-
-	path = object;
-
-	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
-				     EXTCOMMUNITY_LIST_MASTER);
-	if (!list)
-		return RMAP_NOMATCH;
-
 	if (rcom->exact) {
 		if (ecommunity_list_exact_match(bgp_attr_get_ecommunity(path->attr), list))
 			return RMAP_MATCH;
@@ -2038,6 +2113,35 @@ route_match_ecommunity(void *rule, const struct prefix *prefix, void *object)
 	return RMAP_NOMATCH;
 }
 
+static enum route_map_cmd_result_t
+route_match_ecommunity(void *rule, const struct prefix *prefix, void *object)
+{
+	struct community_list *list;
+	struct rmap_community *rcom = rule;
+
+	list = community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     EXTCOMMUNITY_LIST_MASTER);
+	if (!list)
+		return RMAP_NOMATCH;
+
+	return route_match_ecommunity_list(rcom, list, object);
+}
+
+static void *route_match_ecommunity_bind(void *rule)
+{
+	struct rmap_community *rcom = rule;
+
+	return community_list_lookup(bgp_clist, rcom->name, rcom->name_hash,
+				     EXTCOMMUNITY_LIST_MASTER);
+}
+
+static enum route_map_cmd_result_t
+route_match_ecommunity_bound(void *rule, void *bound,
+			     const struct prefix *prefix, void *object)
+{
+	return route_match_ecommunity_list(rule, bound, object);
+}
+
 /* Compile function for extcommunity match. */
 static void *route_match_ecommunity_compile(const char *arg)
 {
@@ -2081,7 +2185,10 @@ static const struct route_map_rule_cmd route_match_ecommunity_cmd = {
 	"extcommunity",
 	route_match_ecommunity,
 	route_match_ecommunity_compile,
-	route_match_ecommunity_free
+	route_match_ecommunity_free,
+	NULL,
+	route_match_ecommunity_bind,
+	route_match_ecommunity_bound
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
@@ -4182,6 +4289,19 @@ route_match_ipv6_address_prefix_list(void *rule, const struct prefix *prefix,
 	return route_match_address_prefix_list(rule, AFI_IP6, prefix, object);
 }
 
+static void *route_match_ipv6_address_prefix_list_bind(void *rule)
+{
+	return prefix_list_lookup(AFI_IP6, (char *)rule);
+}
+
+static enum route_map_cmd_result_t
+route_match_ipv6_address_prefix_list_bound(void *rule, void *bound,
+					   const struct prefix *prefix,
+					   void *object)
+{
+	return route_match_prefix_list(bound, AFI_IP6, prefix);
+}
+
 static void *route_match_ipv6_address_prefix_list_compile(const char *arg)
 {
 	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
@@ -4197,7 +4317,10 @@ static const struct route_map_rule_cmd
 	"ipv6 address prefix-list",
 	route_match_ipv6_address_prefix_list,
 	route_match_ipv6_address_prefix_list_compile,
-	route_match_ipv6_address_prefix_list_free
+	route_match_ipv6_address_prefix_list_free,
+	NULL,
+	route_match_ipv6_address_prefix_list_bind,
+	route_match_ipv6_address_prefix_list_bound
 };
 
 /* `match ipv6 next-hop type <TYPE>' */
@@ -5244,6 +5367,160 @@ bool bgp_route_map_has_extcommunity_rt(const struct route_map *map)
 	return false;
 }
 
+/*
+ * Rules whose result only depends on the attributes of the path, the peers
+ * it goes between and the direction, and which only change the attributes.
+ * @check, if set, tells whether a given value of the rule qualifies.
+ */
+static bool route_value_attr_only(void *rule)
+{
+	struct rmap_value *rv = rule;
+
+	return rv->variable != RMAP_VALUE_TYPE_RTT &&
+	       rv->variable != RMAP_VALUE_TYPE_IGP;
+}
+
+static bool route_set_aigp_metric_attr_only(void *rule)
+{
+	return !strmatch(rule, "igp-metric");
+}
+
+static const struct {
+	const struct route_map_rule_cmd *cmd;
+	bool (*check)(void *rule);
+} bgp_route_map_attr_only_cmds[] = {
+	{ &route_match_local_pref_cmd },
+	{ &route_match_metric_cmd },
+	{ &route_match_aspath_cmd },
+	{ &route_match_aspath_count_cmd },
+	{ &route_match_community_cmd },
+	{ &route_match_community_limit_cmd },
+	{ &route_match_lcommunity_cmd },
+	{ &route_match_ecommunity_cmd },
+	{ &route_match_extcommunity_limit_cmd },
+	{ &route_match_origin_cmd },
+	{ &route_match_tag_cmd },
+	{ &route_set_local_pref_cmd, route_value_attr_only },
+	{ &route_set_weight_cmd, route_value_attr_only },
+	{ &route_set_metric_cmd, route_value_attr_only },
+	{ &route_set_aspath_prepend_cmd },
+	{ &route_set_community_cmd },
+	{ &route_set_community_delete_cmd },
+	{ &route_set_community_add_cmd },
+	{ &route_set_community_replace_cmd },
+	{ &route_set_lcommunity_cmd },
+	{ &route_set_lcommunity_delete_cmd },
+	{ &route_set_ecommunity_rt_cmd },
+	{ &route_set_ecommunity_soo_cmd },
+	{ &route_set_ecommunity_none_cmd },
+	{ &route_set_ecommunity_delete_cmd },
+	{ &route_set_origin_cmd },
+	{ &route_set_atomic_aggregate_cmd },
+	{ &route_set_aigp_metric_cmd, route_set_aigp_metric_attr_only },
+	{ &route_set_aggregator_as_cmd },
+	{ &route_set_tag_cmd },
+	{ &route_set_originator_id_cmd },
+};
+
+static bool bgp_route_map_rule_attr_only(const struct route_map_rule *rule)
+{
+	unsigned int i;
+
+	for (i = 0; i < array_size(bgp_route_map_attr_only_cmds); i++) {
+		if (bgp_route_map_attr_only_cmds[i].cmd != rule->cmd)
+			continue;
+		return !bgp_route_map_attr_only_cmds[i].check ||
+		       bgp_route_map_attr_only_cmds[i].check(rule->value);
+	}
+
+	return false;
+}
+
+/*
+ * Whether the result of @map, and of the route-maps it calls, does not
+ * depend on the prefix or on anything of the path but its attributes.
+ */
+bool bgp_route_map_attr_only(struct route_map *map, int depth)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+
+	if (!map)
+		return true;
+	if (depth > RMAP_RECURSION_LIMIT)
+		return false;
+
+	for (index = map->head; index; index = index->next) {
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			if (!bgp_route_map_rule_attr_only(rule))
+				return false;
+		for (rule = index->set_list.head; rule; rule = rule->next)
+			if (!bgp_route_map_rule_attr_only(rule))
+				return false;
+
+		if (index->nextrm &&
+		    !bgp_route_map_attr_only(route_map_lookup_by_name(
+						     index->nextrm),
+					     depth + 1))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Collect in @plists the prefix-lists a route must be permitted by to match
+ * a permit entry of @map: each of these entries needs a "match ip(v6)
+ * address prefix-list" rule.  A missing list matches nothing.  Routes which
+ * do not match a permit entry are denied, whatever the entries they go to
+ * or the route-maps they call, so only these prefixes can be permitted.
+ * Returns false when some permit entry may match any prefix, or if more
+ * than @max lists would be needed.
+ */
+bool bgp_route_map_prefix_lists(struct route_map *map,
+				struct prefix_list **plists,
+				unsigned int *nplists, unsigned int max)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+	struct prefix_list *plist;
+	unsigned int i;
+	afi_t afi;
+
+	if (!map)
+		return false;
+
+	for (index = map->head; index; index = index->next) {
+		if (index->type != RMAP_PERMIT)
+			continue;
+
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			if (rule->cmd == &route_match_ip_address_prefix_list_cmd ||
+			    rule->cmd == &route_match_ipv6_address_prefix_list_cmd)
+				break;
+		if (!rule)
+			return false;
+
+		afi = rule->cmd == &route_match_ip_address_prefix_list_cmd
+			      ? AFI_IP
+			      : AFI_IP6;
+		plist = prefix_list_lookup(afi, rule->rule_str);
+		if (!plist)
+			continue;
+
+		for (i = 0; i < *nplists; i++)
+			if (plists[i] == plist)
+				break;
+		if (i < *nplists)
+			continue;
+		if (*nplists == max)
+			return false;
+		plists[(*nplists)++] = plist;
+	}
+
+	return true;
+}
+
 static void bgp_route_map_event(const char *rmap_name)
 {
 	if (route_map_mark_updated(rmap_name) == 0)
@@ -8499,6 +8776,7 @@ DEFPY_YANG (match_vpn_dataplane,
 void bgp_route_map_init(void)
 {
 	route_map_init();
+	bgp_rmap_cache_init();
 
 	route_map_add_hook(bgp_route_map_add);
 	route_map_delete_hook(bgp_route_map_delete);
@@ -8809,5 +9087,6 @@ void bgp_route_map_init(void)
 void bgp_route_map_terminate(void)
 {
 	/* ToDo: Cleanup all the used memory */
+	bgp_rmap_cache_finish();
 	route_map_finish();
 }
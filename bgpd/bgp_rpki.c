@@ -23,9 +23,11 @@
 #include "command.h"
 #include "linklist.h"
 #include "memory.h"
+#include "monotime.h"
 #include "frrevent.h"
 #include "filter.h"
 #include "lib_errors.h"
+#include "table.h"
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
 #include "bgp_advertise.h"
@@ -35,6 +37,7 @@
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_rpki.h"
+#include "bgpd/bgp_rpki_roa.h"
 #include "bgpd/bgp_debug.h"
 #include "northbound_cli.h"
 
@@ -51,7 +54,6 @@ DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_TEMP, "BGP RPKI Intermediate Buffer");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE, "BGP RPKI Cache server");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_CACHE_GROUP, "BGP RPKI Cache server group");
 DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_RTRLIB, "BGP RPKI RTRLib");
-DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_REVALIDATE, "BGP RPKI Revalidation");
 
 #define STR_SEPARATOR 10
 
@@ -60,6 +62,11 @@ DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_REVALIDATE, "BGP RPKI Revalidation");
 #define RETRY_INTERVAL_DEFAULT 600
 #define BGP_RPKI_CACHE_SERVER_SYNC_RETRY_TIMEOUT 3
 
+/* ROA changes read from the RTR pthreads at a time */
+#define RPKI_SYNC_BATCH 1000
+/* Routes revalidated before yielding, give or take a ROA prefix */
+#define RPKI_REVALIDATE_BATCH 10000
+
 #define RPKI_DEBUG(...)                                                        \
 	if (rpki_debug_conf || rpki_debug_term) {                              \
 		zlog_debug("RPKI: " __VA_ARGS__);                              \
@@ -94,6 +101,24 @@ struct rpki_for_each_record_arg {
 	enum asnotation_mode asnotation;
 };
 
+/* What the RTR pthreads tell the main one of a ROA */
+struct rpki_roa_update {
+	struct pfx_record rec;
+	bool added;
+};
+
+struct rpki_vrf_stats {
+	uint64_t roa_adds;
+	uint64_t roa_dels;
+	uint64_t resyncs;
+	uint64_t revalidations;
+	uint64_t revalidated_prefixes;
+	uint64_t revalidated_routes;
+	uint64_t revalidation_usec;
+	/* "match rpki" also runs on the soft-reconfiguration workers */
+	_Atomic uint64_t validations;
+};
+
 struct rpki_vrf {
 	struct rtr_mgr_config *rtr_config;
 	struct list *cache_list;
@@ -109,6 +134,13 @@ struct rpki_vrf {
 	char *vrfname;
 	struct event *t_rpki_sync;
 
+	/* the ROAs of rtr_config, changed by the main pthread only */
+	struct bgp_rpki_roa_table *roas;
+	/* prefixes with changed ROAs, the routes of which to revalidate */
+	struct route_table *revalidate[AFI_MAX];
+	struct event *t_revalidate;
+	struct rpki_vrf_stats stats;
+
 	QOBJ_FIELDS;
 };
 
@@ -236,14 +268,6 @@ static void ipv6_addr_to_network_byte_order(const uint32_t *src, uint32_t *dest)
 		dest[i] = htonl(src[i]);
 }
 
-static void ipv6_addr_to_host_byte_order(const uint32_t *src, uint32_t *dest)
-{
-	int i;
-
-	for (i = 0; i < 4; i++)
-		dest[i] = ntohl(src[i]);
-}
-
 static enum route_map_cmd_result_t route_match(void *rule,
 					       const struct prefix *prefix,
 					       void *object)
@@ -577,7 +601,7 @@ static int bgp_rpki_is_connected(const char *vrf_name)
 	return 0;
 }
 
-static void pfx_record_to_prefix(struct pfx_record *record,
+static void pfx_record_to_prefix(const struct pfx_record *record,
 				 struct prefix *prefix)
 {
 	prefix->prefixlen = record->min_len;
@@ -592,119 +616,249 @@ static void pfx_record_to_prefix(struct pfx_record *record,
 	}
 }
 
-struct rpki_revalidate_prefix {
-	struct bgp *bgp;
-	struct prefix prefix;
-	afi_t afi;
-	safi_t safi;
-};
+static struct vrf *rpki_vrf_get_vrf(struct rpki_vrf *rpki_vrf)
+{
+	if (!rpki_vrf->vrfname)
+		return vrf_lookup_by_id(VRF_DEFAULT);
+	return vrf_lookup_by_name(rpki_vrf->vrfname);
+}
 
-static void rpki_revalidate_prefix(struct event *event)
+/* Revalidate the routes covered by @prefix, returning how many there are */
+static unsigned long rpki_revalidate_prefix(struct vrf *vrf,
+					    const struct prefix *prefix)
 {
-	struct rpki_revalidate_prefix *rrp = EVENT_ARG(event);
 	struct bgp_dest *match, *node;
+	unsigned long count = 0;
+	afi_t afi = family2afi(prefix->family);
+	struct listnode *bnode;
+	struct bgp *bgp;
+	safi_t safi;
 
-	match = bgp_table_subtree_lookup(rrp->bgp->rib[rrp->afi][rrp->safi],
-					 &rrp->prefix);
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, bnode, bgp)) {
+		if (bgp->vrf_id != vrf->vrf_id)
+			continue;
 
-	node = match;
+		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
+			if (!bgp->rib[afi][safi])
+				continue;
 
-	while (node) {
-		if (bgp_dest_has_bgp_path_info_data(node)) {
-			revalidate_bgp_node(rrp->bgp, node, rrp->afi, rrp->safi);
+			match = bgp_table_subtree_lookup(bgp->rib[afi][safi],
+							 prefix);
+			for (node = match; node;
+			     node = bgp_route_next_until(node, match)) {
+				if (!bgp_dest_has_bgp_path_info_data(node))
+					continue;
+				revalidate_bgp_node(bgp, node, afi, safi);
+				count++;
+			}
 		}
-
-		node = bgp_route_next_until(node, match);
 	}
 
-	XFREE(MTYPE_BGP_RPKI_REVALIDATE, rrp);
+	return count;
 }
 
-static void revalidate_single_prefix(struct vrf *vrf, struct prefix prefix, afi_t afi)
+/*
+ * Revalidate the routes of the prefixes with changed ROAs, each route once
+ * even if it is under several of them, and a batch of routes at a time.
+ */
+static void rpki_revalidate(struct event *event)
 {
-	struct bgp *bgp;
-	struct listnode *node;
+	struct rpki_vrf *rpki_vrf = EVENT_ARG(event);
+	struct route_node *rn, *sub;
+	unsigned long routes = 0;
+	struct timeval tv;
+	struct vrf *vrf;
+	afi_t afi;
 
-	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
-		safi_t safi;
+	vrf = rpki_vrf_get_vrf(rpki_vrf);
+	monotime(&tv);
 
-		if (!vrf && bgp->vrf_id != VRF_DEFAULT)
-			continue;
-		if (vrf && bgp->vrf_id != vrf->vrf_id)
-			continue;
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		for (rn = route_top(rpki_vrf->revalidate[afi]); rn;
+		     rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
 
-		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
-			struct bgp_table *table = bgp->rib[afi][safi];
-			struct rpki_revalidate_prefix *rrp;
+			if (vrf)
+				routes += rpki_revalidate_prefix(vrf, &rn->p);
+			rpki_vrf->stats.revalidated_prefixes++;
 
-			if (!table)
-				continue;
+			/* the changed prefixes below are done with as well */
+			for (sub = route_lock_node(rn); sub;
+			     sub = route_next_until(sub, rn)) {
+				if (!sub->info)
+					continue;
+				sub->info = NULL;
+				route_unlock_node(sub);
+			}
 
-			rrp = XCALLOC(MTYPE_BGP_RPKI_REVALIDATE, sizeof(*rrp));
-			rrp->bgp = bgp;
-			rrp->prefix = prefix;
-			rrp->afi = afi;
-			rrp->safi = safi;
-			event_add_event(bm->master, rpki_revalidate_prefix, rrp,
-					0, &bgp->t_revalidate[afi][safi]);
+			if (routes >= RPKI_REVALIDATE_BATCH) {
+				route_unlock_node(rn);
+				event_add_event(bm->master, rpki_revalidate,
+						rpki_vrf, 0,
+						&rpki_vrf->t_revalidate);
+				goto done;
+			}
 		}
 	}
+
+done:
+	rpki_vrf->stats.revalidations++;
+	rpki_vrf->stats.revalidated_routes += routes;
+	rpki_vrf->stats.revalidation_usec += monotime_since(&tv, NULL);
 }
 
-static void bgpd_sync_callback(struct event *event)
+static void rpki_revalidate_add(struct rpki_vrf *rpki_vrf,
+				const struct prefix *prefix)
 {
-	struct prefix prefix;
-	struct pfx_record rec;
-	struct rpki_vrf *rpki_vrf = EVENT_ARG(event);
-	struct vrf *vrf = NULL;
+	struct route_node *rn;
+
+	rn = route_node_get(rpki_vrf->revalidate[family2afi(prefix->family)],
+			    prefix);
+	if (rn->info)
+		route_unlock_node(rn);
+	else
+		rn->info = rpki_vrf;
+
+	event_add_event(bm->master, rpki_revalidate, rpki_vrf, 0,
+			&rpki_vrf->t_revalidate);
+}
+
+static void rpki_revalidate_clear(struct rpki_vrf *rpki_vrf)
+{
+	struct route_node *rn;
 	afi_t afi;
-	int retval;
 
-	event_add_read(bm->master, bgpd_sync_callback, rpki_vrf, rpki_vrf->rpki_sync_socket_bgpd,
-		       NULL);
+	event_cancel(&rpki_vrf->t_revalidate);
 
-	if (rpki_vrf->vrfname) {
-		vrf = vrf_lookup_by_name(rpki_vrf->vrfname);
-		if (!vrf) {
-			flog_err(EC_BGP_VRF_NOT_FOUND, "%s(): vrf for rpki %s not found", __func__,
-				 rpki_vrf->vrfname);
-			return;
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		for (rn = route_top(rpki_vrf->revalidate[afi]); rn;
+		     rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
+			rn->info = NULL;
+			route_unlock_node(rn);
 		}
-	}
+}
 
-	if (atomic_load_explicit(&rpki_vrf->rtr_update_overflow, memory_order_seq_cst)) {
-		ssize_t size = 0;
+static void rpki_roa_update(struct rpki_vrf *rpki_vrf,
+			    struct bgp_rpki_roa_table *roas,
+			    const struct pfx_record *rec, bool added)
+{
+	struct prefix prefix;
+	bool changed;
 
-		retval = read(rpki_vrf->rpki_sync_socket_bgpd, &rec, sizeof(struct pfx_record));
-		while (retval != -1) {
-			if (retval != sizeof(struct pfx_record))
-				break;
+	pfx_record_to_prefix(rec, &prefix);
 
-			size += retval;
-			pfx_record_to_prefix(&rec, &prefix);
-			afi = (rec.prefix.ver == LRTR_IPV4) ? AFI_IP : AFI_IP6;
-			revalidate_single_prefix(vrf, prefix, afi);
+	if (added)
+		changed = bgp_rpki_roa_add(roas, &prefix, rec->max_len,
+					   rec->asn, rec->socket);
+	else
+		changed = bgp_rpki_roa_del(roas, &prefix, rec->max_len,
+					   rec->asn, rec->socket);
 
-			retval = read(rpki_vrf->rpki_sync_socket_bgpd, &rec,
-				      sizeof(struct pfx_record));
-		}
+	/* only for changes to the ROAs in use, not while copying them */
+	if (!changed || roas != rpki_vrf->roas)
+		return;
 
-		RPKI_DEBUG("Socket overflow detected (%zu), revalidating affected prefixes", size);
+	if (added)
+		rpki_vrf->stats.roa_adds++;
+	else
+		rpki_vrf->stats.roa_dels++;
+	rpki_revalidate_add(rpki_vrf, &prefix);
+}
 
-		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 0, memory_order_seq_cst);
+struct rpki_roa_resync_arg {
+	struct rpki_vrf *rpki_vrf;
+	struct bgp_rpki_roa_table *roas;
+};
+
+static void rpki_roa_resync_cb(const struct pfx_record *record, void *data)
+{
+	struct rpki_roa_resync_arg *arg = data;
+
+	rpki_roa_update(arg->rpki_vrf, arg->roas, record, true);
+}
+
+static void rpki_roa_resync_diff(const struct prefix *prefix, void *arg)
+{
+	rpki_revalidate_add(arg, prefix);
+}
+
+/*
+ * Copy the ROAs again from rtrlib, when changes to them were lost, and
+ * revalidate the routes of the prefixes the copy was wrong for.
+ */
+static void rpki_roa_resync(struct rpki_vrf *rpki_vrf)
+{
+	struct rpki_roa_resync_arg arg = { .rpki_vrf = rpki_vrf };
+	struct pfx_table *pfx_table;
+
+	if (!is_running(rpki_vrf))
 		return;
-	}
 
-	retval = read(rpki_vrf->rpki_sync_socket_bgpd, &rec, sizeof(struct pfx_record));
-	if (retval != sizeof(struct pfx_record)) {
-		RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
+	pfx_table = rpki_vrf->rtr_config->pfx_table;
+	arg.roas = bgp_rpki_roa_table_new();
+	pfx_table_for_each_ipv4_record(pfx_table, rpki_roa_resync_cb, &arg);
+	pfx_table_for_each_ipv6_record(pfx_table, rpki_roa_resync_cb, &arg);
+
+	bgp_rpki_roa_diff(rpki_vrf->roas, arg.roas, rpki_roa_resync_diff,
+			  rpki_vrf);
+	bgp_rpki_roa_table_free(&rpki_vrf->roas);
+	rpki_vrf->roas = arg.roas;
+	rpki_vrf->stats.resyncs++;
+}
+
+/* Forget the ROAs, and the changes to them not read yet */
+static void rpki_roa_reset(struct rpki_vrf *rpki_vrf)
+{
+	struct rpki_roa_update update;
+
+	while (read(rpki_vrf->rpki_sync_socket_bgpd, &update, sizeof(update)) > 0)
+		;
+
+	rpki_revalidate_clear(rpki_vrf);
+	bgp_rpki_roa_table_free(&rpki_vrf->roas);
+	rpki_vrf->roas = bgp_rpki_roa_table_new();
+}
+
+static void bgpd_sync_callback(struct event *event)
+{
+	struct rpki_roa_update update;
+	struct rpki_vrf *rpki_vrf = EVENT_ARG(event);
+	unsigned int count = 0;
+	int retval;
+
+	event_add_read(bm->master, bgpd_sync_callback, rpki_vrf, rpki_vrf->rpki_sync_socket_bgpd,
+		       NULL);
+
+	if (atomic_load_explicit(&rpki_vrf->rtr_update_overflow, memory_order_seq_cst)) {
+		/*
+		 * Changes were dropped, so copy all the ROAs after the ones
+		 * queued, which are then stale; any that come after the copy
+		 * was made are applied to it again, to no effect.
+		 */
+		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 0, memory_order_seq_cst);
+
+		while (read(rpki_vrf->rpki_sync_socket_bgpd, &update, sizeof(update)) > 0)
+			count++;
+
+		RPKI_DEBUG("Socket overflow detected (%u), copying the ROAs again", count);
+
+		rpki_roa_resync(rpki_vrf);
 		return;
 	}
-	pfx_record_to_prefix(&rec, &prefix);
 
-	afi = (rec.prefix.ver == LRTR_IPV4) ? AFI_IP : AFI_IP6;
+	while (count++ < RPKI_SYNC_BATCH) {
+		retval = read(rpki_vrf->rpki_sync_socket_bgpd, &update, sizeof(update));
+		if (retval != sizeof(update)) {
+			if (retval != -1 || (errno != EAGAIN && errno != EWOULDBLOCK))
+				RPKI_DEBUG("Could not read from rpki_sync_socket_bgpd");
+			return;
+		}
 
-	revalidate_single_prefix(vrf, prefix, afi);
+		rpki_roa_update(rpki_vrf, rpki_vrf->roas, &update.rec, update.added);
+	}
 }
 
 static void revalidate_bgp_node(struct bgp *bgp, struct bgp_dest *bgp_dest, afi_t afi, safi_t safi)
@@ -747,9 +901,9 @@ static void revalidate_bgp_node(struct bgp *bgp, struct bgp_dest *bgp_dest, afi_
 }
 
 static void rpki_update_cb_sync_rtr(struct pfx_table *p __attribute__((unused)),
-				    const struct pfx_record rec,
-				    const bool added __attribute__((unused)))
+				    const struct pfx_record rec, const bool added)
 {
+	struct rpki_roa_update update = { .rec = rec, .added = added };
 	struct rpki_vrf *rpki_vrf;
 	const char *msg;
 	const struct rtr_socket *rtr = rec.socket;
@@ -779,13 +933,13 @@ static void rpki_update_cb_sync_rtr(struct pfx_table *p __attribute__((unused)),
 				 memory_order_seq_cst))
 		return;
 
-	int retval = write(rpki_vrf->rpki_sync_socket_rtr, &rec,
-			   sizeof(struct pfx_record));
+	int retval = write(rpki_vrf->rpki_sync_socket_rtr, &update,
+			   sizeof(update));
 	if (retval == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		atomic_store_explicit(&rpki_vrf->rtr_update_overflow, 1,
 				      memory_order_seq_cst);
 
-	else if (retval != sizeof(struct pfx_record))
+	else if (retval != sizeof(update))
 		RPKI_DEBUG("Could not write to rpki_sync_socket_rtr");
 	return;
 err:
@@ -839,6 +993,9 @@ static struct rpki_vrf *bgp_rpki_allocate(const char *vrfname)
 	rpki_vrf->polling_period = POLLING_PERIOD_DEFAULT;
 	rpki_vrf->expire_interval = EXPIRE_INTERVAL_DEFAULT;
 	rpki_vrf->retry_interval = RETRY_INTERVAL_DEFAULT;
+	rpki_vrf->roas = bgp_rpki_roa_table_new();
+	rpki_vrf->revalidate[AFI_IP] = route_table_init();
+	rpki_vrf->revalidate[AFI_IP6] = route_table_init();
 
 	if (vrfname && !strmatch(vrfname, VRF_DEFAULT_NAME))
 		rpki_vrf->vrfname = XSTRDUP(MTYPE_BGP_RPKI_CACHE, vrfname);
@@ -872,6 +1029,11 @@ static int bgp_rpki_fini(void)
 		close(rpki_vrf->rpki_sync_socket_rtr);
 		close(rpki_vrf->rpki_sync_socket_bgpd);
 
+		rpki_revalidate_clear(rpki_vrf);
+		route_table_finish(rpki_vrf->revalidate[AFI_IP]);
+		route_table_finish(rpki_vrf->revalidate[AFI_IP6]);
+		bgp_rpki_roa_table_free(&rpki_vrf->roas);
+
 		listnode_delete(rpki_vrf_list, rpki_vrf);
 		QOBJ_UNREG(rpki_vrf);
 		if (rpki_vrf->vrfname)
@@ -992,6 +1154,8 @@ static void stop(struct rpki_vrf *rpki_vrf)
 		rtr_mgr_stop(rpki_vrf->rtr_config);
 		rtr_mgr_free(rpki_vrf->rtr_config);
 		rpki_vrf->rtr_is_running = false;
+
+		rpki_roa_reset(rpki_vrf);
 	}
 }
 
@@ -1154,8 +1318,7 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 {
 	struct assegment *as_segment;
 	as_t as_number = 0;
-	struct lrtr_ip_addr ip_addr_prefix;
-	enum pfxv_state result;
+	enum rpki_states result;
 	struct bgp *bgp = peer->bgp;
 	struct vrf *vrf;
 	struct rpki_vrf *rpki_vrf;
@@ -1201,51 +1364,35 @@ static int rpki_validate_prefix(struct peer *peer, struct attr *attr,
 		}
 	}
 
-	// Get the prefix in requested format
-	switch (prefix->family) {
-	case AF_INET:
-		ip_addr_prefix.ver = LRTR_IPV4;
-		ip_addr_prefix.u.addr4.addr = ntohl(prefix->u.prefix4.s_addr);
-		break;
-
-	case AF_INET6:
-		ip_addr_prefix.ver = LRTR_IPV6;
-		ipv6_addr_to_host_byte_order(prefix->u.prefix6.s6_addr32,
-					     ip_addr_prefix.u.addr6.addr);
-		break;
-
-	default:
-		return RPKI_NOT_BEING_USED;
-	}
-
-	// Do the actual validation
-	rtr_mgr_validate(rpki_vrf->rtr_config, as_number, &ip_addr_prefix,
-			 prefix->prefixlen, &result);
+	// Do the actual validation, on the copy of the ROAs
+	result = bgp_rpki_roa_validate(rpki_vrf->roas, prefix, as_number);
+	atomic_fetch_add_explicit(&rpki_vrf->stats.validations, 1,
+				  memory_order_relaxed);
 
 	// Print Debug output
 	switch (result) {
-	case BGP_PFXV_STATE_VALID:
+	case RPKI_VALID:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: VALID",
 			prefix, as_number);
-		return RPKI_VALID;
-	case BGP_PFXV_STATE_NOT_FOUND:
+		break;
+	case RPKI_NOTFOUND:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: NOT FOUND",
 			prefix, as_number);
-		return RPKI_NOTFOUND;
-	case BGP_PFXV_STATE_INVALID:
+		break;
+	case RPKI_INVALID:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: INVALID",
 			prefix, as_number);
-		return RPKI_INVALID;
-	default:
+		break;
+	case RPKI_NOT_BEING_USED:
 		RPKI_DEBUG(
 			"Validating Prefix %pFX from asn %u    Result: CANNOT VALIDATE",
 			prefix, as_number);
 		break;
 	}
-	return RPKI_NOT_BEING_USED;
+	return result;
 }
 
 static int add_cache(struct cache *cache)
@@ -2597,6 +2744,67 @@ DEFPY(show_rpki_configuration, show_rpki_configuration_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFPY(show_rpki_statistics, show_rpki_statistics_cmd,
+      "show rpki statistics [vrf NAME$vrfname] [json$uj]",
+      SHOW_STR RPKI_OUTPUT_STRING
+      "Show RPKI validation statistics\n"
+      VRF_CMD_HELP_STR
+      JSON_STR)
+{
+	struct json_object *json = NULL;
+	struct rpki_vrf_stats *stats;
+	struct rpki_vrf *rpki_vrf;
+
+	if (uj)
+		json = json_object_new_object();
+
+	rpki_vrf = find_rpki_vrf(vrfname);
+	if (!rpki_vrf) {
+		if (uj)
+			vty_json(vty, json);
+		return CMD_SUCCESS;
+	}
+	stats = &rpki_vrf->stats;
+
+	if (uj) {
+		json_object_int_add(json, "roaCount",
+				    bgp_rpki_roa_count(rpki_vrf->roas));
+		json_object_int_add(json, "roasAdded", stats->roa_adds);
+		json_object_int_add(json, "roasRemoved", stats->roa_dels);
+		json_object_int_add(json, "roaResyncs", stats->resyncs);
+		json_object_int_add(json, "validations",
+				    atomic_load_explicit(&stats->validations,
+							 memory_order_relaxed));
+		json_object_int_add(json, "revalidationRuns",
+				    stats->revalidations);
+		json_object_int_add(json, "revalidatedPrefixes",
+				    stats->revalidated_prefixes);
+		json_object_int_add(json, "revalidatedRoutes",
+				    stats->revalidated_routes);
+		json_object_int_add(json, "revalidationMsecs",
+				    stats->revalidation_usec / 1000);
+
+		vty_json(vty, json);
+
+		return CMD_SUCCESS;
+	}
+
+	vty_out(vty, "ROAs: %lu\n", bgp_rpki_roa_count(rpki_vrf->roas));
+	vty_out(vty, "\tadded %" PRIu64 ", removed %" PRIu64
+		     ", copied again %" PRIu64 " times\n",
+		stats->roa_adds, stats->roa_dels, stats->resyncs);
+	vty_out(vty, "Validations: %" PRIu64 "\n",
+		atomic_load_explicit(&stats->validations,
+				     memory_order_relaxed));
+	vty_out(vty, "Revalidations: %" PRIu64 "\n", stats->revalidations);
+	vty_out(vty, "\t%" PRIu64 " prefixes, %" PRIu64 " routes in %" PRIu64
+		     " ms\n",
+		stats->revalidated_prefixes, stats->revalidated_routes,
+		stats->revalidation_usec / 1000);
+
+	return CMD_SUCCESS;
+}
+
 static int config_on_exit(struct vty *vty)
 {
 	struct rpki_vrf *rpki_vrf;
@@ -2778,6 +2986,7 @@ static void install_cli_commands(void)
 	install_element(VIEW_NODE, &show_rpki_prefix_cmd);
 	install_element(VIEW_NODE, &show_rpki_as_number_cmd);
 	install_element(VIEW_NODE, &show_rpki_configuration_cmd);
+	install_element(VIEW_NODE, &show_rpki_statistics_cmd);
 
 	/* Install debug commands */
 	install_element(CONFIG_NODE, &debug_rpki_cmd);
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP RPKI ROA table.
+ * The ROAs of an RPKI cache group, by prefix, for origin validation.
+ */
+
+/*
+ * rtrlib keeps the ROAs in its own table, behind a lock that validating a
+ * route takes, and which the RTR pthreads hold while they update it.  This
+ * is a copy of it that the main pthread updates from the ROA changes rtrlib
+ * reports, and so can look up on its own, as can the soft-reconfiguration
+ * workers while it waits for them.
+ *
+ * It is a route table per address family, with the ROAs of a prefix kept
+ * sorted in the info of its node, so that two tables can be compared.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "table.h"
+
+#include "bgpd/bgp_rpki_roa.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_RPKI_ROA, "BGP RPKI ROAs");
+
+struct bgp_rpki_roa {
+	as_t asn;
+	uint8_t max_len;
+	const void *src;
+};
+
+/* ROAs of a prefix, the info of its node */
+struct bgp_rpki_roa_set {
+	unsigned int count;
+	struct bgp_rpki_roa roas[];
+};
+
+struct bgp_rpki_roa_table {
+	struct route_table *tables[AFI_MAX];
+	unsigned long count;
+};
+
+static int bgp_rpki_roa_cmp(const struct bgp_rpki_roa *a,
+			    const struct bgp_rpki_roa *b)
+{
+	if (a->asn != b->asn)
+		return a->asn < b->asn ? -1 : 1;
+	if (a->max_len != b->max_len)
+		return a->max_len < b->max_len ? -1 : 1;
+	if (a->src != b->src)
+		return (uintptr_t)a->src < (uintptr_t)b->src ? -1 : 1;
+	return 0;
+}
+
+/* Position of @roa in @set, or where it goes, with *found telling which */
+static unsigned int bgp_rpki_roa_find(const struct bgp_rpki_roa_set *set,
+				      const struct bgp_rpki_roa *roa,
+				      bool *found)
+{
+	unsigned int lo = 0, hi = set ? set->count : 0, mid;
+	int cmp;
+
+	*found = false;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = bgp_rpki_roa_cmp(&set->roas[mid], roa);
+		if (!cmp) {
+			*found = true;
+			return mid;
+		}
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static struct route_table *bgp_rpki_roa_afi_table(struct bgp_rpki_roa_table *roas,
+						  const struct prefix *p)
+{
+	afi_t afi = family2afi(p->family);
+
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return NULL;
+	return roas->tables[afi];
+}
+
+struct bgp_rpki_roa_table *bgp_rpki_roa_table_new(void)
+{
+	struct bgp_rpki_roa_table *roas;
+
+	roas = XCALLOC(MTYPE_BGP_RPKI_ROA, sizeof(*roas));
+	roas->tables[AFI_IP] = route_table_init();
+	roas->tables[AFI_IP6] = route_table_init();
+
+	return roas;
+}
+
+void bgp_rpki_roa_table_free(struct bgp_rpki_roa_table **roas)
+{
+	struct route_node *rn;
+	afi_t afi;
+
+	if (!*roas)
+		return;
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		for (rn = route_top((*roas)->tables[afi]); rn;
+		     rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
+			XFREE(MTYPE_BGP_RPKI_ROA, rn->info);
+			route_unlock_node(rn);
+		}
+		route_table_finish((*roas)->tables[afi]);
+	}
+
+	XFREE(MTYPE_BGP_RPKI_ROA, *roas);
+}
+
+bool bgp_rpki_roa_add(struct bgp_rpki_roa_table *roas, const struct prefix *p,
+		      uint8_t max_len, as_t asn, const void *src)
+{
+	struct bgp_rpki_roa roa = { .asn = asn, .max_len = max_len, .src = src };
+	struct route_table *table = bgp_rpki_roa_afi_table(roas, p);
+	struct bgp_rpki_roa_set *set;
+	struct route_node *rn;
+	struct prefix pm;
+	unsigned int pos;
+	bool found;
+
+	if (!table)
+		return false;
+
+	prefix_copy(&pm, p);
+	apply_mask(&pm);
+	rn = route_node_get(table, &pm);
+	set = rn->info;
+
+	pos = bgp_rpki_roa_find(set, &roa, &found);
+	if (found) {
+		route_unlock_node(rn);
+		return false;
+	}
+
+	if (set)
+		/* the node is locked once for its info already */
+		route_unlock_node(rn);
+
+	set = XREALLOC(MTYPE_BGP_RPKI_ROA, set,
+		       sizeof(*set) +
+			       ((set ? set->count : 0) + 1) * sizeof(roa));
+	if (!rn->info)
+		set->count = 0;
+	memmove(&set->roas[pos + 1], &set->roas[pos],
+		(set->count - pos) * sizeof(roa));
+	set->roas[pos] = roa;
+	set->count++;
+	rn->info = set;
+	roas->count++;
+
+	return true;
+}
+
+bool bgp_rpki_roa_del(struct bgp_rpki_roa_table *roas, const struct prefix *p,
+		      uint8_t max_len, as_t asn, const void *src)
+{
+	struct bgp_rpki_roa roa = { .asn = asn, .max_len = max_len, .src = src };
+	struct route_table *table = bgp_rpki_roa_afi_table(roas, p);
+	struct bgp_rpki_roa_set *set;
+	struct route_node *rn;
+	struct prefix pm;
+	unsigned int pos;
+	bool found;
+
+	if (!table)
+		return false;
+
+	prefix_copy(&pm, p);
+	apply_mask(&pm);
+	rn = route_node_lookup(table, &pm);
+	if (!rn)
+		return false;
+	route_unlock_node(rn);
+
+	set = rn->info;
+	pos = bgp_rpki_roa_find(set, &roa, &found);
+	if (!found)
+		return false;
+
+	set->count--;
+	memmove(&set->roas[pos], &set->roas[pos + 1],
+		(set->count - pos) * sizeof(roa));
+	roas->count--;
+
+	if (!set->count) {
+		XFREE(MTYPE_BGP_RPKI_ROA, rn->info);
+		route_unlock_node(rn);
+	}
+
+	return true;
+}
+
+enum rpki_states bgp_rpki_roa_validate(struct bgp_rpki_roa_table *roas,
+				       const struct prefix *p, as_t asn)
+{
+	struct route_table *table = bgp_rpki_roa_afi_table(roas, p);
+	struct bgp_rpki_roa_set *set;
+	struct route_node *rn;
+	unsigned int i;
+
+	if (!table)
+		return RPKI_NOT_BEING_USED;
+
+	rn = route_node_match_nolock(table, p);
+	if (!rn)
+		return RPKI_NOTFOUND;
+
+	/* every node above a match covers @p as well */
+	for (; rn; rn = rn->parent) {
+		set = rn->info;
+		if (!set)
+			continue;
+
+		for (i = 0; i < set->count; i++)
+			if (set->roas[i].asn == asn &&
+			    p->prefixlen <= set->roas[i].max_len)
+				return RPKI_VALID;
+	}
+
+	return RPKI_INVALID;
+}
+
+unsigned long bgp_rpki_roa_count(struct bgp_rpki_roa_table *roas)
+{
+	return roas->count;
+}
+
+static bool bgp_rpki_roa_set_same(const struct bgp_rpki_roa_set *a,
+				  const struct bgp_rpki_roa_set *b)
+{
+	unsigned int i;
+
+	if (!a || !b)
+		return a == b;
+	if (a->count != b->count)
+		return false;
+
+	for (i = 0; i < a->count; i++)
+		if (bgp_rpki_roa_cmp(&a->roas[i], &b->roas[i]))
+			return false;
+
+	return true;
+}
+
+/* Prefixes with ROAs in @a and none in @b, or other ones when @changed */
+static void bgp_rpki_roa_diff_one(struct route_table *a, struct route_table *b,
+				  bool changed,
+				  void (*func)(const struct prefix *p,
+					       void *arg),
+				  void *arg)
+{
+	struct route_node *rn, *other;
+	bool same;
+
+	for (rn = route_top(a); rn; rn = route_next(rn)) {
+		if (!rn->info)
+			continue;
+
+		other = route_node_lookup(b, &rn->p);
+		if (other) {
+			same = bgp_rpki_roa_set_same(rn->info, other->info);
+			route_unlock_node(other);
+			if (same || !changed)
+				continue;
+		}
+
+		func(&rn->p, arg);
+	}
+}
+
+void bgp_rpki_roa_diff(struct bgp_rpki_roa_table *a,
+		       struct bgp_rpki_roa_table *b,
+		       void (*func)(const struct prefix *p, void *arg),
+		       void *arg)
+{
+	afi_t afi;
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		bgp_rpki_roa_diff_one(a->tables[afi], b->tables[afi], true,
+				      func, arg);
+		/* those in both tables were reported above */
+		bgp_rpki_roa_diff_one(b->tables[afi], a->tables[afi], false,
+				      func, arg);
+	}
+}
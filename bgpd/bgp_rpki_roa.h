@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP RPKI ROA table.
+ * The ROAs of an RPKI cache group, by prefix, for origin validation.
+ */
+
+#ifndef _FRR_BGP_RPKI_ROA_H
+#define _FRR_BGP_RPKI_ROA_H
+
+#include "prefix.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_rpki.h"
+
+struct bgp_rpki_roa_table;
+
+extern struct bgp_rpki_roa_table *bgp_rpki_roa_table_new(void);
+extern void bgp_rpki_roa_table_free(struct bgp_rpki_roa_table **roas);
+
+/*
+ * Add or remove the ROA of @asn for @p up to @max_len, as learnt from cache
+ * @src.  A ROA is only there once per cache, so both are idempotent, and
+ * return whether the table changed.
+ */
+extern bool bgp_rpki_roa_add(struct bgp_rpki_roa_table *roas,
+			     const struct prefix *p, uint8_t max_len, as_t asn,
+			     const void *src);
+extern bool bgp_rpki_roa_del(struct bgp_rpki_roa_table *roas,
+			     const struct prefix *p, uint8_t max_len, as_t asn,
+			     const void *src);
+
+/*
+ * Origin validation of @p announced by @asn, RFC 6811: RPKI_NOTFOUND when
+ * no ROA covers @p, RPKI_VALID when one of them is for @asn and as long as
+ * @p, RPKI_INVALID otherwise.  Only a longest match and a walk up the
+ * covering prefixes, without any lock: the table is changed by one pthread,
+ * and lookups write nothing to it, so other pthreads may validate while
+ * that one waits for them.
+ */
+extern enum rpki_states bgp_rpki_roa_validate(struct bgp_rpki_roa_table *roas,
+					      const struct prefix *p, as_t asn);
+
+extern unsigned long bgp_rpki_roa_count(struct bgp_rpki_roa_table *roas);
+
+/* Call @func for each prefix whose ROAs differ between @a and @b */
+extern void bgp_rpki_roa_diff(struct bgp_rpki_roa_table *a,
+			      struct bgp_rpki_roa_table *b,
+			      void (*func)(const struct prefix *p, void *arg),
+			      void *arg);
+
+#endif /* _FRR_BGP_RPKI_ROA_H */
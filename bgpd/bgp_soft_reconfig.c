@@ -0,0 +1,450 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP soft reconfiguration inbound workers.
+ * Evaluates the inbound policy for routes kept in Adj-RIB-In on a pool of
+ * pthreads.
+ */
+
+/*
+ * bgp_soft_reconfig_table_task() walks the Adj-RIB-In in slices.  With
+ * workers configured, it queues the routes of a slice here instead of
+ * feeding them to bgp_update() one by one, and the inbound filters and
+ * route-map are evaluated for all of them in one parallel run:
+ *  - the routes of one peer are always evaluated by the same pthread, as
+ *    the route-map code keeps per-peer state (peer->rmap_type);
+ *  - evaluation only reads the configuration, the Adj-RIB-In and the RIB,
+ *    and writes into the item; interning is left to bgp_update();
+ *  - the main pthread does nothing else until all workers are done, so
+ *    nothing read meanwhile can change under them.
+ *
+ * The caller then applies the results in order on the main pthread, passing
+ * each one to bgp_update() in place of its own evaluation, and skips the
+ * routes that are denied now and were not in the RIB before.
+ *
+ * Route-maps using "match script" run Lua code, which may only be used from
+ * the main pthread; the routes of peers with such a route-map are evaluated
+ * by the main pthread itself.  "match rpki" only reads the ROA table, which
+ * changes on the main pthread, and counts validations atomically.
+ * Route-map and prefix-list hit counters are relaxed atomics, so that the
+ * workers can count them too.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "frr_pthread.h"
+#include "memory.h"
+#include "monotime.h"
+#include "routemap.h"
+#include "vty.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_soft_reconfig.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_SOFT_RECONFIG_WORKER,
+		    "BGP soft reconfiguration worker");
+DEFINE_MTYPE_STATIC(BGPD, BGP_SOFT_RECONFIG_ITEM,
+		    "BGP soft reconfiguration item");
+
+struct bgp_soft_reconfig_worker {
+	struct frr_pthread *fpt;
+	struct event *t_work;
+
+	/* statistics, written by the worker */
+	_Atomic uint64_t items;
+	_Atomic uint64_t busy_usec;
+};
+
+/* Consecutive entries of order[] for the routes of one peer */
+struct bgp_soft_reconfig_unit {
+	unsigned int first;
+	unsigned int count;
+};
+
+static struct bgp_soft_reconfig_info {
+	struct bgp_soft_reconfig_worker *workers[BGP_SOFT_RECONFIG_WORKERS_MAX];
+	unsigned int count;
+
+	/* the queued routes, in queueing order */
+	struct bgp_soft_reconfig_item *items;
+	unsigned int nitems;
+	unsigned int size;
+
+	/* the current run; set up before the workers are woken */
+	unsigned int *order;
+	struct bgp_soft_reconfig_unit *units;
+	unsigned int nunits;
+	/* units past this one are for the main pthread only */
+	unsigned int nunits_shared;
+	afi_t afi;
+	safi_t safi;
+	_Atomic unsigned int next_unit;
+
+	/* protects running */
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int running;
+
+	/* statistics, written by the main pthread */
+	uint64_t runs;
+	uint64_t items_total;
+	uint64_t main_items;
+	uint64_t unchanged;
+	uint64_t wait_usec;
+} bsr;
+
+void bgp_soft_reconfig_batch_add(struct bgp_dest *dest, struct bgp_adj_in *ain)
+{
+	struct bgp_soft_reconfig_item *item;
+
+	if (bsr.nitems == bsr.size) {
+		bsr.size = MAX(256U, bsr.size * 2);
+		bsr.items = XREALLOC(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.items,
+				     bsr.size * sizeof(*bsr.items));
+		bsr.order = XREALLOC(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.order,
+				     bsr.size * sizeof(*bsr.order));
+		bsr.units = XREALLOC(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.units,
+				     bsr.size * sizeof(*bsr.units));
+	}
+
+	item = &bsr.items[bsr.nitems++];
+	memset(item, 0, sizeof(*item));
+	item->dest = bgp_dest_lock_node(dest);
+	item->ain = ain;
+}
+
+void bgp_soft_reconfig_batch_clear(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < bsr.nitems; i++)
+		bgp_dest_unlock_node(bsr.items[i].dest);
+	bsr.nitems = 0;
+}
+
+/* "match script" runs Lua code, which is for the main pthread only. */
+static bool bgp_soft_reconfig_rmap_shared(struct route_map *map, int depth)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+
+	if (!map)
+		return true;
+	if (depth > RMAP_RECURSION_LIMIT)
+		return false;
+
+	for (index = map->head; index; index = index->next) {
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			if (strmatch(rule->cmd->str, "script"))
+				return false;
+
+		if (index->nextrm &&
+		    !bgp_soft_reconfig_rmap_shared(route_map_lookup_by_name(
+							   index->nextrm),
+						   depth + 1))
+			return false;
+	}
+
+	return true;
+}
+
+static bool bgp_soft_reconfig_peer_shared(struct peer *peer)
+{
+	struct bgp_filter *filter = &peer->filter[bsr.afi][bsr.safi];
+
+	if (!ROUTE_MAP_IN_NAME(filter))
+		return true;
+
+	return bgp_soft_reconfig_rmap_shared(route_map_lookup_by_name(
+						     ROUTE_MAP_IN_NAME(filter)),
+					     0);
+}
+
+static int bgp_soft_reconfig_order_cmp(const void *a, const void *b)
+{
+	unsigned int ia = *(const unsigned int *)a;
+	unsigned int ib = *(const unsigned int *)b;
+	uintptr_t pa = (uintptr_t)bsr.items[ia].ain->peer;
+	uintptr_t pb = (uintptr_t)bsr.items[ib].ain->peer;
+
+	if (pa != pb)
+		return pa < pb ? -1 : 1;
+	if (ia != ib)
+		return ia < ib ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Group the items by peer, with the units that must be evaluated on the
+ * main pthread at the end of units[].
+ */
+static void bgp_soft_reconfig_units_setup(void)
+{
+	struct bgp_soft_reconfig_unit *runs, *unit;
+	struct peer *peer = NULL;
+	unsigned int i, nruns = 0;
+	bool *is_shared;
+
+	for (i = 0; i < bsr.nitems; i++)
+		bsr.order[i] = i;
+	qsort(bsr.order, bsr.nitems, sizeof(*bsr.order),
+	      bgp_soft_reconfig_order_cmp);
+
+	runs = XCALLOC(MTYPE_BGP_SOFT_RECONFIG_ITEM,
+		       bsr.nitems * sizeof(*runs));
+	is_shared = XCALLOC(MTYPE_BGP_SOFT_RECONFIG_ITEM,
+			    bsr.nitems * sizeof(*is_shared));
+
+	unit = NULL;
+	for (i = 0; i < bsr.nitems; i++) {
+		if (!unit || bsr.items[bsr.order[i]].ain->peer != peer) {
+			peer = bsr.items[bsr.order[i]].ain->peer;
+			is_shared[nruns] = bgp_soft_reconfig_peer_shared(peer);
+			unit = &runs[nruns++];
+			unit->first = i;
+			unit->count = 0;
+		}
+		unit->count++;
+	}
+
+	bsr.nunits = 0;
+	for (i = 0; i < nruns; i++)
+		if (is_shared[i])
+			bsr.units[bsr.nunits++] = runs[i];
+	bsr.nunits_shared = bsr.nunits;
+	for (i = 0; i < nruns; i++)
+		if (!is_shared[i])
+			bsr.units[bsr.nunits++] = runs[i];
+
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_ITEM, is_shared);
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_ITEM, runs);
+
+	atomic_store_explicit(&bsr.next_unit, 0, memory_order_relaxed);
+}
+
+static unsigned int bgp_soft_reconfig_unit_eval(struct bgp_soft_reconfig_unit *unit)
+{
+	struct bgp_soft_reconfig_item *item;
+	unsigned int i;
+
+	for (i = unit->first; i < unit->first + unit->count; i++) {
+		item = &bsr.items[bsr.order[i]];
+		item->unchanged = bgp_input_policy_eval(item->ain->peer,
+							item->dest, item->ain,
+							bsr.afi, bsr.safi,
+							&item->pol);
+	}
+
+	return unit->count;
+}
+
+/* Evaluate shared units until there are none left; any pthread. */
+static unsigned int bgp_soft_reconfig_units(void)
+{
+	unsigned int u, done = 0;
+
+	while ((u = atomic_fetch_add_explicit(&bsr.next_unit, 1,
+					      memory_order_relaxed)) <
+	       bsr.nunits_shared)
+		done += bgp_soft_reconfig_unit_eval(&bsr.units[u]);
+
+	return done;
+}
+
+/* Worker pthread: take part in the current run. */
+static void bgp_soft_reconfig_work(struct event *event)
+{
+	struct bgp_soft_reconfig_worker *w = EVENT_ARG(event);
+	struct timeval start;
+	unsigned int done;
+
+	monotime(&start);
+
+	done = bgp_soft_reconfig_units();
+
+	atomic_fetch_add_explicit(&w->items, done, memory_order_relaxed);
+	atomic_fetch_add_explicit(&w->busy_usec, monotime_since(&start, NULL),
+				  memory_order_relaxed);
+
+	frr_with_mutex (&bsr.mtx) {
+		bsr.running--;
+		pthread_cond_signal(&bsr.cond);
+	}
+}
+
+struct bgp_soft_reconfig_item *
+bgp_soft_reconfig_batch_run(afi_t afi, safi_t safi, unsigned int *count)
+{
+	struct timeval start;
+	unsigned int i;
+
+	*count = bsr.nitems;
+	if (!bsr.nitems)
+		return bsr.items;
+
+	bsr.afi = afi;
+	bsr.safi = safi;
+	bgp_soft_reconfig_units_setup();
+
+	/* Not worth waking anyone up for. */
+	if (!bsr.count || bsr.nunits_shared < 2) {
+		for (i = 0; i < bsr.nunits; i++)
+			bsr.main_items +=
+				bgp_soft_reconfig_unit_eval(&bsr.units[i]);
+		goto done;
+	}
+
+	frr_with_mutex (&bsr.mtx)
+		bsr.running = bsr.count;
+
+	for (i = 0; i < bsr.count; i++)
+		event_add_event(bsr.workers[i]->fpt->master,
+				bgp_soft_reconfig_work, bsr.workers[i], 0,
+				&bsr.workers[i]->t_work);
+
+	for (i = bsr.nunits_shared; i < bsr.nunits; i++)
+		bsr.main_items += bgp_soft_reconfig_unit_eval(&bsr.units[i]);
+	bsr.main_items += bgp_soft_reconfig_units();
+
+	monotime(&start);
+	frr_with_mutex (&bsr.mtx) {
+		while (bsr.running)
+			pthread_cond_wait(&bsr.cond, &bsr.mtx);
+	}
+	bsr.wait_usec += monotime_since(&start, NULL);
+
+done:
+	for (i = 0; i < bsr.nitems; i++)
+		if (bsr.items[i].unchanged)
+			bsr.unchanged++;
+	bsr.items_total += bsr.nitems;
+	bsr.runs++;
+
+	return bsr.items;
+}
+
+static struct bgp_soft_reconfig_worker *
+bgp_soft_reconfig_worker_start(unsigned int idx)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct bgp_soft_reconfig_worker *w;
+	char name[32], os_name[OS_THREAD_NAMELEN];
+
+	snprintf(name, sizeof(name), "BGP soft-reconfig worker %u", idx);
+	snprintf(os_name, sizeof(os_name), "bgpd_src%u", idx);
+
+	w = XCALLOC(MTYPE_BGP_SOFT_RECONFIG_WORKER, sizeof(*w));
+
+	w->fpt = frr_pthread_new(&attr, name, os_name);
+	frr_pthread_run(w->fpt, NULL);
+	frr_pthread_wait_running(w->fpt);
+
+	return w;
+}
+
+static void bgp_soft_reconfig_worker_stop(struct bgp_soft_reconfig_worker *w)
+{
+	frr_pthread_stop(w->fpt, NULL);
+	frr_pthread_destroy(w->fpt);
+
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_WORKER, w);
+}
+
+void bgp_soft_reconfig_workers_set(unsigned int count)
+{
+	unsigned int i;
+
+	count = MIN(count, BGP_SOFT_RECONFIG_WORKERS_MAX);
+
+	if (count == bsr.count)
+		return;
+
+	/* no run is in progress outside of bgp_soft_reconfig_batch_run() */
+	for (i = count; i < bsr.count; i++) {
+		bgp_soft_reconfig_worker_stop(bsr.workers[i]);
+		bsr.workers[i] = NULL;
+	}
+	for (i = bsr.count; i < count; i++)
+		bsr.workers[i] = bgp_soft_reconfig_worker_start(i);
+	bsr.count = count;
+}
+
+unsigned int bgp_soft_reconfig_workers_get(void)
+{
+	return bsr.count;
+}
+
+void bgp_soft_reconfig_show(struct vty *vty, json_object *json)
+{
+	struct bgp_soft_reconfig_worker *w;
+	json_object *json_workers = NULL, *json_worker;
+	unsigned int i;
+
+	if (json) {
+		json_object_int_add(json, "softReconfigWorkers", bsr.count);
+		json_object_int_add(json, "softReconfigRuns", bsr.runs);
+		json_object_int_add(json, "softReconfigRoutes", bsr.items_total);
+		json_object_int_add(json, "softReconfigRoutesMain",
+				    bsr.main_items);
+		json_object_int_add(json, "softReconfigRoutesUnchanged",
+				    bsr.unchanged);
+		json_object_int_add(json, "softReconfigWaitUsec", bsr.wait_usec);
+		json_workers = json_object_new_array();
+		json_object_object_add(json, "softReconfigWorkerStats",
+				       json_workers);
+	} else {
+		vty_out(vty, "Soft reconfiguration workers: %u\n", bsr.count);
+		vty_out(vty,
+			"  Runs: %" PRIu64 ", %" PRIu64 " routes (%" PRIu64
+			" on main), %" PRIu64 " left unchanged\n",
+			bsr.runs, bsr.items_total, bsr.main_items,
+			bsr.unchanged);
+		vty_out(vty, "  Main pthread waited %" PRIu64 " usec\n",
+			bsr.wait_usec);
+	}
+
+	for (i = 0; i < bsr.count; i++) {
+		w = bsr.workers[i];
+
+		if (json) {
+			json_worker = json_object_new_object();
+			json_object_string_add(json_worker, "name", w->fpt->name);
+			json_object_int_add(json_worker, "routes",
+					    atomic_load_explicit(&w->items,
+								 memory_order_relaxed));
+			json_object_int_add(json_worker, "busyUsec",
+					    atomic_load_explicit(&w->busy_usec,
+								 memory_order_relaxed));
+			json_object_array_add(json_workers, json_worker);
+			continue;
+		}
+
+		vty_out(vty, "  %s: %" PRIu64 " routes, busy %" PRIu64 " usec\n",
+			w->fpt->name,
+			atomic_load_explicit(&w->items, memory_order_relaxed),
+			atomic_load_explicit(&w->busy_usec, memory_order_relaxed));
+	}
+}
+
+void bgp_soft_reconfig_init(void)
+{
+	memset(&bsr, 0, sizeof(bsr));
+	pthread_mutex_init(&bsr.mtx, NULL);
+	pthread_cond_init(&bsr.cond, NULL);
+}
+
+void bgp_soft_reconfig_finish(void)
+{
+	bgp_soft_reconfig_workers_set(0);
+	bgp_soft_reconfig_batch_clear();
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.items);
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.order);
+	XFREE(MTYPE_BGP_SOFT_RECONFIG_ITEM, bsr.units);
+	pthread_cond_destroy(&bsr.cond);
+	pthread_mutex_destroy(&bsr.mtx);
+}
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP soft reconfiguration inbound workers.
+ * Evaluates the inbound policy for routes kept in Adj-RIB-In on a pool of
+ * pthreads.
+ */
+
+#ifndef _FRR_BGP_SOFT_RECONFIG_H
+#define _FRR_BGP_SOFT_RECONFIG_H
+
+#include "frr_pthread.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_table.h"
+
+/* Upper bound for "bgp soft-reconfiguration-workers" */
+#define BGP_SOFT_RECONFIG_WORKERS_MAX 16
+
+/*
+ * Outcome of the inbound filters and route-map for one route, computed
+ * ahead of bgp_update() by bgp_input_policy_eval().
+ */
+struct bgp_inpolicy {
+	/* denied by distribute-list, prefix-list or filter-list */
+	bool filter_deny;
+
+	/* otherwise, the route-map result and the attributes it produced */
+	int rmap_ret;
+	struct attr attr;
+	uint32_t srte_color;
+
+	/* attr was taken over by bgp_update() */
+	bool consumed;
+};
+
+struct bgp_soft_reconfig_item {
+	struct bgp_dest *dest;
+	struct bgp_adj_in *ain;
+
+	/* set by the evaluation: the route stays denied, there is no work */
+	bool unchanged;
+	struct bgp_inpolicy pol;
+};
+
+/*
+ * Configure the number of soft reconfiguration workers; 0 keeps the
+ * evaluation inline in bgp_update().  Must be called from the main pthread.
+ */
+extern void bgp_soft_reconfig_workers_set(unsigned int count);
+extern unsigned int bgp_soft_reconfig_workers_get(void);
+
+/* Queue @ain, received for @dest, for evaluation in the next run. */
+extern void bgp_soft_reconfig_batch_add(struct bgp_dest *dest,
+					struct bgp_adj_in *ain);
+
+/*
+ * Evaluate the inbound policy of all queued routes, in parallel.  Returns
+ * them in the order they were queued, for the caller to apply on the main
+ * pthread; bgp_soft_reconfig_batch_clear() releases them.
+ */
+extern struct bgp_soft_reconfig_item *
+bgp_soft_reconfig_batch_run(afi_t afi, safi_t safi, unsigned int *count);
+extern void bgp_soft_reconfig_batch_clear(void);
+
+extern void bgp_soft_reconfig_init(void);
+extern void bgp_soft_reconfig_finish(void);
+
+extern void bgp_soft_reconfig_show(struct vty *vty, json_object *json);
+
+#endif /* _FRR_BGP_SOFT_RECONFIG_H */
@@ -12,6 +12,7 @@
 #include "filter.h"
 #include "command.h"
 #include "printfrr.h"
+#include "id_alloc.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -20,6 +21,9 @@
 #include "bgp_mpath.h"
 #include "bgp_ls.h"
 #include "bgp_srv6.h"
+#include "bgp_vty.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_DEST_BITMAP, "BGP dest bitmap");
 
 void bgp_table_lock(struct bgp_table *rt)
 {
@@ -52,6 +56,89 @@ void bgp_table_finish(struct bgp_table **rt)
 	}
 }
 
+void bgp_dest_id_assign(struct bgp_table *table, struct bgp_dest *dest)
+{
+	struct bgp *bgp = table->bgp;
+	struct id_alloc **ids;
+	char name[64];
+
+	if (!bgp)
+		return;
+
+	ids = &bgp->dest_ids[table->afi][table->safi];
+	if (!*ids) {
+		snprintf(name, sizeof(name), "BGP dest IDs %s %s",
+			 bgp->name_pretty ? bgp->name_pretty : "default",
+			 get_afi_safi_str(table->afi, table->safi, false));
+		*ids = idalloc_new(name);
+	}
+
+	dest->id = idalloc_allocate(*ids);
+}
+
+static void bgp_dest_id_release(struct bgp_table *rt, struct bgp_dest *dest)
+{
+	struct id_alloc *ids;
+
+	if (!dest->id || !rt->bgp)
+		return;
+
+	ids = rt->bgp->dest_ids[rt->afi][rt->safi];
+	if (ids)
+		idalloc_free(ids, dest->id);
+	dest->id = 0;
+}
+
+uint32_t bgp_dest_id_max(const struct bgp *bgp, afi_t afi, safi_t safi)
+{
+	const struct id_alloc *ids = bgp->dest_ids[afi][safi];
+
+	/* pages of IDs are only ever added, at the top */
+	return ids ? ids->capacity : 0;
+}
+
+void bgp_dest_ids_finish(struct bgp *bgp)
+{
+	afi_t afi;
+	safi_t safi;
+
+	for (afi = AFI_IP; afi < AFI_MAX; afi++)
+		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+			if (bgp->dest_ids[afi][safi]) {
+				idalloc_destroy(bgp->dest_ids[afi][safi]);
+				bgp->dest_ids[afi][safi] = NULL;
+			}
+}
+
+void bgp_dest_bitmap_set(struct bgp_dest_bitmap *set,
+			 const struct bgp_dest *dest)
+{
+	const struct bgp_table *table = route_table_get_info(dest->rn->table);
+	uint32_t id = bgp_dest_id(dest);
+	uint32_t nwords;
+
+	if (id / 64 >= set->nwords) {
+		/* size for every ID in use, not just this one */
+		nwords = id / 64 + 1;
+		if (table->bgp)
+			nwords = MAX(nwords, bgp_dest_id_max(table->bgp, table->afi,
+							     table->safi) / 64 + 1);
+		set->words = XREALLOC(MTYPE_BGP_DEST_BITMAP, set->words,
+				      nwords * sizeof(*set->words));
+		memset(set->words + set->nwords, 0,
+		       (nwords - set->nwords) * sizeof(*set->words));
+		set->nwords = nwords;
+	}
+
+	set->words[id / 64] |= 1ULL << (id % 64);
+}
+
+void bgp_dest_bitmap_fini(struct bgp_dest_bitmap *set)
+{
+	XFREE(MTYPE_BGP_DEST_BITMAP, set->words);
+	set->nwords = 0;
+}
+
 /*
  * bgp_dest_lock_node
  */
@@ -118,6 +205,7 @@ inline struct bgp_dest *bgp_dest_unlock_node(struct bgp_dest *dest)
 		if (dest->srv6_unicast)
 			bgp_srv6_unicast_unregister_route(dest);
 
+		bgp_dest_id_release(rt, dest);
 		XFREE(MTYPE_BGP_NODE, dest);
 		dest = NULL;
 		route_node_set_info(rn, NULL);
@@ -160,6 +248,7 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
 		if (dest->srv6_unicast)
 			bgp_srv6_unicast_unregister_route(dest);
 
+		bgp_dest_id_release(rt, dest);
 		XFREE(MTYPE_BGP_NODE, dest);
 		route_node_set_info(node, NULL);
 	}
@@ -94,6 +94,9 @@ struct bgp_dest {
 
 	mpls_label_t local_label;
 
+	/* see bgp_dest_id() */
+	uint32_t id;
+
 	struct bgp_ls_nlri *ls_nlri;
 
 	struct bgp_attr_srv6_l3service *srv6_unicast;
@@ -143,6 +146,51 @@ extern struct bgp_dest *bgp_dest_unlock_node(struct bgp_dest *dest);
 extern struct bgp_dest *bgp_dest_lock_node(struct bgp_dest *dest);
 extern const char *bgp_dest_get_prefix_str(struct bgp_dest *dest);
 
+/*
+ * Dests of tables that belong to an instance get a small integer ID, unique
+ * among all dests of that instance and AFI/SAFI (RD sub-tables included) and
+ * reused once the dest is freed, so per-prefix data can be kept in flat
+ * arrays and bitmaps instead of hashes or trees keyed on the dest.  IDs are
+ * below bgp_dest_id_max(); 0 means the dest has none.
+ */
+static inline uint32_t bgp_dest_id(const struct bgp_dest *dest)
+{
+	return dest->id;
+}
+
+extern void bgp_dest_id_assign(struct bgp_table *table, struct bgp_dest *dest);
+extern uint32_t bgp_dest_id_max(const struct bgp *bgp, afi_t afi, safi_t safi);
+extern void bgp_dest_ids_finish(struct bgp *bgp);
+
+/* Set of dests of one instance and AFI/SAFI, indexed by their ID */
+struct bgp_dest_bitmap {
+	uint64_t *words;
+	uint32_t nwords;
+};
+
+static inline bool bgp_dest_bitmap_test(const struct bgp_dest_bitmap *set,
+					const struct bgp_dest *dest)
+{
+	uint32_t id = bgp_dest_id(dest);
+
+	if (id / 64 >= set->nwords)
+		return false;
+	return !!(set->words[id / 64] & (1ULL << (id % 64)));
+}
+
+static inline void bgp_dest_bitmap_unset(struct bgp_dest_bitmap *set,
+					 const struct bgp_dest *dest)
+{
+	uint32_t id = bgp_dest_id(dest);
+
+	if (id / 64 < set->nwords)
+		set->words[id / 64] &= ~(1ULL << (id % 64));
+}
+
+extern void bgp_dest_bitmap_set(struct bgp_dest_bitmap *set,
+				const struct bgp_dest *dest);
+extern void bgp_dest_bitmap_fini(struct bgp_dest_bitmap *set);
+
 
 /*
  * bgp_dest_from_rnode
@@ -269,6 +317,7 @@ static inline struct bgp_dest *bgp_node_get(struct bgp_table *const table,
 		RB_INIT(bgp_adj_out_rb, &dest->adj_out);
 		route_node_set_info(rn, dest);
 		dest->rn = rn;
+		bgp_dest_id_assign(table, dest);
 	}
 	return rn->info;
 }
@@ -38,6 +38,7 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_updgrp_build.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_filter.h"
 #include "bgpd/bgp_io.h"
@@ -1197,8 +1198,10 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 	event_cancel(&subgrp->t_merge_check);
 	event_cancel(&subgrp->t_coalesce);
 
+	bgp_updgrp_build_cancel(subgrp);
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
+	bgp_dest_bitmap_fini(&subgrp->adj_dests);
 
 	sync_delete(subgrp);
 
@@ -1567,20 +1570,23 @@ bool update_subgroup_trigger_merge_check(struct update_subgroup *subgrp,
  * routes) from one subgroup to another. It assumes that the adj out
  * of the target subgroup is empty.
  */
+static void update_subgroup_copy_one_adj_out(struct bgp_adj_out *aout,
+					     void *arg)
+{
+	struct update_subgroup *dest = arg;
+	struct bgp_adj_out *aout_copy;
+
+	/*
+	 * Copy the adj out.
+	 */
+	aout_copy = bgp_adj_out_alloc(dest, aout->dest, aout->addpath_tx_id);
+	aout_copy->attr = aout->attr ? bgp_attr_intern(aout->attr) : NULL;
+}
+
 static void update_subgroup_copy_adj_out(struct update_subgroup *source,
 					 struct update_subgroup *dest)
 {
-	struct bgp_adj_out *aout, *aout_copy;
-
-	SUBGRP_FOREACH_ADJ (source, aout) {
-		/*
-		 * Copy the adj out.
-		 */
-		aout_copy = bgp_adj_out_alloc(dest, aout->dest,
-					      aout->addpath_tx_id);
-		aout_copy->attr =
-			aout->attr ? bgp_attr_intern(aout->attr) : NULL;
-	}
+	subgroup_adj_walk(source, update_subgroup_copy_one_adj_out, dest);
 
 	dest->scount = source->scount;
 }
@@ -12,7 +12,16 @@
 #ifndef _QUAGGA_BGP_UPDGRP_H
 #define _QUAGGA_BGP_UPDGRP_H
 
+#include "frratomic.h"
+#include "stream.h"
+
 #include "bgp_advertise.h"
+#include "bgp_table.h"
+
+/* Subgroups waiting for the format workers, see bgp_updgrp_build.h */
+PREDECL_DLIST(bgp_updgrp_build_list);
+struct bgp_updgrp_build_job;
+struct iovec;
 
 /*
  * The following three heuristic constants determine how long advertisement to
@@ -85,6 +94,37 @@ typedef struct bpacket_attr_vec_arr {
 	bpacket_attr_vec entries[BGP_ATTR_VEC_MAX];
 } bpacket_attr_vec_arr;
 
+/*
+ * Data of a bpacket that has been queued to peers without being copied
+ * ("bgp output-zero-copy").  Shared by the bpacket and the bpacket_refs on
+ * the peers' output queues, whoever lets go last frees it; so this may
+ * happen on the I/O pthread.
+ */
+struct bpacket_buf {
+	atomic_uint refcnt;
+	struct stream *s;
+};
+
+/*
+ * Output queue entry for a shared bpacket.  The stream is an empty shell,
+ * marked by its size of 0, whose getp and endp track how much of the packet
+ * has been written: use the bgp_obuf_*() helpers on output queue entries.
+ */
+struct bpacket_ref {
+	struct stream s;
+
+	struct bpacket_buf *buf;
+
+	/* copy of the bytes rewritten for this peer, NULL if none */
+	struct stream *frag;
+	size_t frag_off;
+};
+
+static inline bool bpacket_ref_check(const struct stream *s)
+{
+	return STREAM_SIZE(s) == 0;
+}
+
 struct bpacket {
 	/* for being part of an update subgroup's message list */
 	TAILQ_ENTRY(bpacket) pkt_train;
@@ -95,6 +135,9 @@ struct bpacket {
 	struct stream *buffer;
 	bpacket_attr_vec_arr arr;
 
+	/* set once buffer is shared with output queues */
+	struct bpacket_buf *shared;
+
 	unsigned int ver;
 };
 
@@ -175,11 +218,15 @@ struct update_subgroup {
 	struct bpacket_queue pkt_queue;
 
 	/*
-	 * List of adj-out structures for this subgroup.
-	 * It essentially represents the snapshot of every prefix that
-	 * has been advertised to the members of the subgroup
+	 * List of full adj-out structures for this subgroup.  Together with
+	 * the compact ones, which are only reachable through the RIB, it
+	 * represents the snapshot of every prefix that has been advertised
+	 * to the members of the subgroup.  Use subgroup_adj_walk().
 	 */
-	TAILQ_HEAD(adjout_queue, bgp_adj_out) adjq;
+	TAILQ_HEAD(adjout_queue, bgp_adj_out_full) adjq;
+
+	/* dests that have at least one adj-out of this subgroup */
+	struct bgp_dest_bitmap adj_dests;
 
 	/* packet buffer for update generation */
 	struct stream *work;
@@ -235,6 +282,8 @@ struct update_subgroup {
 	uint32_t updgrp_switch_events;
 	uint32_t peer_refreshes_combined;
 	uint32_t adj_count;
+	/* adj_count entries that are compact */
+	uint32_t adj_compact_count;
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
 
@@ -254,6 +303,9 @@ struct update_subgroup {
 
 	uint16_t flags;
 #define SUBGRP_FLAG_NEEDS_REFRESH (1 << 0)
+
+	/* for being on the format workers' list of pending subgroups */
+	struct bgp_updgrp_build_list_item build_item;
 };
 
 /*
@@ -345,10 +397,11 @@ struct updwalk_context {
 #define SUBGRP_FOREACH_PEER_SAFE(subgrp, paf, temp_paf)                        \
 	LIST_FOREACH_SAFE (paf, &(subgrp->peers), subgrp_train, temp_paf)
 
-#define SUBGRP_FOREACH_ADJ(subgrp, adj)                                        \
+/* Only walks the full adj-outs, see subgroup_adj_walk() */
+#define SUBGRP_FOREACH_ADJ_FULL(subgrp, adj)                                   \
 	TAILQ_FOREACH (adj, &(subgrp->adjq), subgrp_adj_train)
 
-#define SUBGRP_FOREACH_ADJ_SAFE(subgrp, adj, adj_temp)                         \
+#define SUBGRP_FOREACH_ADJ_FULL_SAFE(subgrp, adj, adj_temp)                    \
 	TAILQ_FOREACH_SAFE (adj, &(subgrp->adjq), subgrp_adj_train, adj_temp)
 
 /* Prototypes.  */
@@ -403,8 +456,15 @@ extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 bool subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
+extern bool subgroup_packets_format_deferrable(struct update_subgroup *subgrp);
+extern void subgroup_packets_format(struct bgp_updgrp_build_job *job);
+extern void subgroup_packets_commit(struct bgp_updgrp_build_job *job);
 extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 						struct peer_af *paf);
+extern void bpacket_ref_free(struct stream *s);
+extern unsigned int bpacket_ref_iov(struct stream *s, struct iovec *iov);
+extern void bpacket_ref_forward(struct stream *s, size_t size);
+extern uint8_t bpacket_ref_type(struct stream *s);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
 extern void bpacket_attr_vec_arr_set_vec(struct bpacket_attr_vec_arr *vecarr,
 					 enum bpacket_attr_vec_type type,
@@ -435,6 +495,13 @@ extern void group_announce_route(struct bgp *bgp, afi_t afi, safi_t safi,
 				 struct bgp_dest *dest,
 				 struct bgp_path_info *pi);
 extern void subgroup_clear_table(struct update_subgroup *subgrp);
+/*
+ * Call @func on every adj-out of @subgrp, full and compact alike.  @func may
+ * free the adj-out it is passed.
+ */
+extern void subgroup_adj_walk(struct update_subgroup *subgrp,
+			      void (*func)(struct bgp_adj_out *adj, void *arg),
+			      void *arg);
 extern void update_group_announce(struct bgp *bgp);
 extern void update_group_announce_rrclients(struct bgp *bgp);
 extern void peer_af_announce_route(struct peer_af *paf, int combine);
@@ -33,6 +33,7 @@
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_updgrp_build.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_addpath.h"
 #include "bgpd/bgp_nhc.h"
@@ -70,6 +71,11 @@ static inline struct bgp_adj_out *adj_lookup(struct bgp_dest *dest,
 	if (!dest || !subgrp)
 		return NULL;
 
+	/* cheap answer for the dests the subgroup was never sent */
+	if (bgp_dest_id(dest) &&
+	    !bgp_dest_bitmap_test(&subgrp->adj_dests, dest))
+		return NULL;
+
 	/* update-groups that do not support addpath will pass 0 for
 	 * addpath_tx_id. */
 	lookup.subgroup = subgrp;
@@ -80,15 +86,53 @@ static inline struct bgp_adj_out *adj_lookup(struct bgp_dest *dest,
 
 static void adj_free(struct bgp_adj_out *adj)
 {
-	bgp_labels_unintern(&adj->labels);
+	struct bgp_adj_out_full *full;
+	struct bgp_labels *labels;
+	struct bgp_adj_out *prev, *next;
+
+	labels = bgp_adj_out_labels(adj);
+	if (labels) {
+		bgp_adj_out_set_labels(adj, NULL);
+		bgp_labels_unintern(&labels);
+	}
 
-	TAILQ_REMOVE(&(adj->subgroup->adjq), adj, subgrp_adj_train);
 	SUBGRP_DECR_STAT(adj->subgroup, adj_count);
 
+	/* the subgroup's other addpath entries, if any, are next to this one */
+	prev = RB_PREV(bgp_adj_out_rb, adj);
+	next = RB_NEXT(bgp_adj_out_rb, adj);
+	if ((!prev || prev->subgroup != adj->subgroup) &&
+	    (!next || next->subgroup != adj->subgroup))
+		bgp_dest_bitmap_unset(&adj->subgroup->adj_dests, adj->dest);
+
 	RB_REMOVE(bgp_adj_out_rb, &adj->dest->adj_out, adj);
 	bgp_dest_unlock_node(adj->dest);
 
-	XFREE(MTYPE_BGP_ADJ_OUT, adj);
+	if (CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL)) {
+		full = container_of(adj, struct bgp_adj_out_full, adj);
+		TAILQ_REMOVE(&(adj->subgroup->adjq), full, subgrp_adj_train);
+		XFREE(MTYPE_BGP_ADJ_OUT, full);
+	} else {
+		assert(!CHECK_FLAG(adj->flags, BGP_ADJ_OUT_EXT));
+		adj->subgroup->adj_compact_count--;
+		XFREE(MTYPE_BGP_ADJ_OUT_COMPACT, adj);
+	}
+}
+
+/*
+ * Compact adj-outs are found by walking the RIB, which only works for the
+ * single level tables.
+ */
+static bool subgroup_adj_compact_ok(struct update_subgroup *subgrp)
+{
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return false;
+
+	return safi == SAFI_UNICAST || safi == SAFI_MULTICAST ||
+	       safi == SAFI_LABELED_UNICAST;
 }
 
 static void
@@ -307,6 +351,7 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 {
 	struct bgp_table *table;
 	struct bgp_adj_out *adj;
+	struct bgp_advertise *adv;
 	unsigned long output_count;
 	struct bgp_dest *dest;
 	int header1 = 1;
@@ -341,10 +386,10 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 				vty_out(vty, BGP_SHOW_HEADER);
 				header2 = 0;
 			}
-			if ((flags & UPDWALK_FLAGS_ADVQUEUE) && adj->adv &&
-			    adj->adv->baa) {
+			adv = bgp_adj_out_adv(adj);
+			if ((flags & UPDWALK_FLAGS_ADVQUEUE) && adv && adv->baa) {
 				route_vty_out_tmp(vty, bgp, dest, dest_p,
-						  adj->adv->baa->attr,
+						  adv->baa->attr,
 						  SUBGRP_SAFI(subgrp), 0, NULL,
 						  false);
 				output_count++;
@@ -485,17 +530,29 @@ struct bgp_adj_out *bgp_adj_out_alloc(struct update_subgroup *subgrp,
 				      struct bgp_dest *dest,
 				      uint32_t addpath_tx_id)
 {
+	struct bgp_adj_out_full *full;
 	struct bgp_adj_out *adj;
 
-	adj = XCALLOC(MTYPE_BGP_ADJ_OUT, sizeof(struct bgp_adj_out));
+	if (CHECK_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT) &&
+	    subgroup_adj_compact_ok(subgrp)) {
+		adj = XCALLOC(MTYPE_BGP_ADJ_OUT_COMPACT,
+			      sizeof(struct bgp_adj_out));
+		subgrp->adj_compact_count++;
+	} else {
+		full = XCALLOC(MTYPE_BGP_ADJ_OUT,
+			       sizeof(struct bgp_adj_out_full));
+		TAILQ_INSERT_TAIL(&(subgrp->adjq), full, subgrp_adj_train);
+		adj = &full->adj;
+		SET_FLAG(adj->flags, BGP_ADJ_OUT_FULL);
+	}
 	adj->subgroup = subgrp;
 	adj->addpath_tx_id = addpath_tx_id;
 
 	RB_INSERT(bgp_adj_out_rb, &dest->adj_out, adj);
 	bgp_dest_lock_node(dest);
 	adj->dest = dest;
+	bgp_dest_bitmap_set(&subgrp->adj_dests, dest);
 
-	TAILQ_INSERT_TAIL(&(subgrp->adjq), adj, subgrp_adj_train);
 	SUBGRP_INCR_STAT(subgrp, adj_count);
 	return adj;
 }
@@ -510,7 +567,7 @@ bgp_advertise_clean_subgroup(struct update_subgroup *subgrp,
 	struct bgp_advertise *next;
 	struct bgp_adv_fifo_head *fhead;
 
-	adv = adj->adv;
+	adv = bgp_adj_out_adv(adj);
 	baa = adv->baa;
 	next = NULL;
 
@@ -533,8 +590,8 @@ bgp_advertise_clean_subgroup(struct update_subgroup *subgrp,
 	bgp_adv_fifo_del(fhead, adv);
 
 	/* Free memory.  */
-	bgp_advertise_free(adj->adv);
-	adj->adv = NULL;
+	bgp_adj_out_set_adv(adj, NULL);
+	bgp_advertise_free(adv);
 
 	return next;
 }
@@ -593,12 +650,14 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 	 * the one that was sent out, or the one that has been queued.
 	 */
 	attr_new = bgp_attr_intern(attr);
+	adv = bgp_adj_out_adv(adj);
 
 	if (CHECK_FLAG(bgp->flags, BGP_FLAG_SUPPRESS_DUPLICATES) &&
 	    !CHECK_FLAG(subgrp->sflags, SUBGRP_STATUS_FORCE_UPDATES) &&
 	    ((attr_new == adj->attr) ||
-	     (adj->adv && adj->adv->baa && (attr_new == adj->adv->baa->attr))) &&
-	    bgp_labels_cmp(path->extra ? path->extra->labels : NULL, adj->labels)) {
+	     (adv && adv->baa && (attr_new == adv->baa->attr))) &&
+	    bgp_labels_cmp(path->extra ? path->extra->labels : NULL,
+			   bgp_adj_out_labels(adj))) {
 		if (debug) {
 			char attr_str[BUFSIZ] = {0};
 
@@ -613,7 +672,7 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 		 * clean up the queued update, regardless whether it is a
 		 * withdraw or an advertisement.
 		 */
-		if (adj->adv && (attr_new == adj->attr)) {
+		if (adv && (attr_new == adj->attr)) {
 			if (debug) {
 				zlog_debug("%s delete queued UPDATE %pBD, afi=%s, safi=%s",
 					   peer->host, dest, afi2str(afi), safi2str(safi));
@@ -643,11 +702,11 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 		return false;
 	}
 
-	if (adj->adv)
+	if (adv)
 		bgp_advertise_clean_subgroup(subgrp, adj);
-	adj->adv = bgp_advertise_new();
+	adv = bgp_advertise_new();
+	bgp_adj_out_set_adv(adj, adv);
 
-	adv = adj->adv;
 	adv->dest = dest;
 	assert(adv->pathi == NULL);
 	/* bgp_path_info adj_out reference */
@@ -656,9 +715,10 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 	adv->baa = bgp_advertise_attr_intern(subgrp->hash, attr_new);
 	adv->adj = adj;
 	if (path->extra)
-		adj->labels = bgp_labels_intern(path->extra->labels);
+		bgp_adj_out_set_labels(adj,
+				       bgp_labels_intern(path->extra->labels));
 	else
-		adj->labels = NULL;
+		bgp_adj_out_set_labels(adj, NULL);
 
 	/* Add new advertisement to advertisement attribute list. */
 	bgp_advertise_add(adv->baa, adv);
@@ -694,6 +754,7 @@ bool bgp_adj_out_set_subgroup(struct bgp_dest *dest,
 	}
 
 	bgp_adv_fifo_add_tail(&subgrp->sync->update, adv);
+	bgp_updgrp_build_schedule(subgrp);
 
 	subgrp->version = MAX(subgrp->version, dest->version);
 
@@ -717,7 +778,7 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest, struct update_subgroup *s
 	adj = adj_lookup(dest, subgrp, addpath_tx_id);
 	if (adj != NULL) {
 		/* Clean up previous advertisement.  */
-		if (adj->adv)
+		if (bgp_adj_out_adv(adj))
 			bgp_advertise_clean_subgroup(subgrp, adj);
 
 		/* If default originate is enabled and the route is default
@@ -730,8 +791,8 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest, struct update_subgroup *s
 
 		if (adj->attr) {
 			/* We need advertisement structure.  */
-			adj->adv = bgp_advertise_new();
-			adv = adj->adv;
+			adv = bgp_advertise_new();
+			bgp_adj_out_set_adv(adj, adv);
 			adv->dest = dest;
 			adv->adj = adj;
 
@@ -747,6 +808,7 @@ void bgp_adj_out_unset_subgroup(struct bgp_dest *dest, struct update_subgroup *s
 			/* Add to synchronization entry for withdraw
 			 * announcement.  */
 			bgp_adv_fifo_add_tail(&subgrp->sync->withdraw, adv);
+			bgp_updgrp_build_schedule(subgrp);
 
 			if (BGP_DEBUG(update, UPDATE_OUT)) {
 				peer = SUBGRP_PEER(subgrp);
@@ -773,22 +835,63 @@ void bgp_adj_out_remove_subgroup(struct bgp_dest *dest, struct bgp_adj_out *adj,
 	if (adj->attr)
 		bgp_attr_unintern(&adj->attr);
 
-	if (adj->adv)
+	if (bgp_adj_out_adv(adj))
 		bgp_advertise_clean_subgroup(subgrp, adj);
 
 	adj_free(adj);
 }
 
+void subgroup_adj_walk(struct update_subgroup *subgrp,
+		       void (*func)(struct bgp_adj_out *adj, void *arg),
+		       void *arg)
+{
+	struct bgp_adj_out_full *full, *tfull;
+	struct bgp_adj_out *adj, *tadj;
+	struct bgp_table *table;
+	struct bgp_dest *dest;
+	struct bgp *bgp;
+	safi_t safi_rib;
+
+	SUBGRP_FOREACH_ADJ_FULL_SAFE (subgrp, full, tfull)
+		func(&full->adj, arg);
+
+	if (!subgrp->adj_compact_count)
+		return;
+
+	/* labeled-unicast adj-outs hang off the dests of the unicast table */
+	safi_rib = SUBGRP_SAFI(subgrp);
+	if (safi_rib == SAFI_LABELED_UNICAST)
+		safi_rib = SAFI_UNICAST;
+
+	bgp = SUBGRP_INST(subgrp);
+	table = bgp->rib[SUBGRP_AFI(subgrp)][safi_rib];
+
+	/* the walk holds a lock on dest, func may drop the adj-out's one */
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		RB_FOREACH_SAFE (adj, bgp_adj_out_rb, &dest->adj_out, tadj) {
+			if (adj->subgroup != subgrp ||
+			    CHECK_FLAG(adj->flags, BGP_ADJ_OUT_FULL))
+				continue;
+
+			func(adj, arg);
+		}
+	}
+}
+
+static void subgroup_clear_adj(struct bgp_adj_out *adj, void *arg)
+{
+	struct update_subgroup *subgrp = arg;
+
+	bgp_adj_out_remove_subgroup(adj->dest, adj, subgrp);
+}
+
 /*
  * Go through all the routes and clean up the adj/adv structures corresponding
  * to the subgroup.
  */
 void subgroup_clear_table(struct update_subgroup *subgrp)
 {
-	struct bgp_adj_out *aout, *taout;
-
-	SUBGRP_FOREACH_ADJ_SAFE (subgrp, aout, taout)
-		bgp_adj_out_remove_subgroup(aout->dest, aout, subgrp);
+	subgroup_adj_walk(subgrp, subgroup_clear_adj, subgrp);
 }
 
 /*
@@ -1114,7 +1217,7 @@ void subgroup_default_originate(struct update_subgroup *subgrp, bool withdraw)
 				       BGP_ADDPATH_TX_ID_FOR_DEFAULT_ORIGINATE);
 				if (adj != NULL) {
 					/* Clean up previous advertisement.  */
-					if (adj->adv)
+					if (bgp_adj_out_adv(adj))
 						bgp_advertise_clean_subgroup(
 							subgrp, adj);
 
@@ -0,0 +1,468 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP update-group packet format workers.
+ * Formats the UPDATE packets of independent subgroups on a pool of pthreads.
+ */
+
+/*
+ * Subgroups that get advertisements queued are put on a pending list.  When
+ * the main pthread is about to format a packet for a peer in
+ * bgp_generate_updgrp_packets(), it first hands every pending subgroup that
+ * has a member peer ready to send to the format workers, and joins in on the
+ * work itself:
+ *  - subgroups of the same update group share the update group's peer and
+ *    are always formatted by the same pthread, one after the other;
+ *  - a pthread formatting a subgroup only reads its advertisements and writes
+ *    into the subgroup's own work streams, marking what it used as formatted;
+ *  - the main pthread does nothing else until all workers are done, so the
+ *    peers, attributes and paths read meanwhile cannot change under them.
+ *
+ * The adj-out updates (attribute interning, scount, advertisement cleanup)
+ * and the queueing of the finished packets are then done in one batch per
+ * subgroup on the main pthread, by subgroup_packets_commit().  Whatever is
+ * not formatted here is left to the regular, inline path.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "frr_pthread.h"
+#include "memory.h"
+#include "monotime.h"
+#include "vty.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_updgrp_build.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_UPDGRP_BUILD_WORKER, "BGP format worker");
+DEFINE_MTYPE_STATIC(BGPD, BGP_UPDGRP_BUILD_JOB, "BGP format job");
+
+DECLARE_DLIST(bgp_updgrp_build_list, struct update_subgroup, build_item);
+
+struct bgp_updgrp_build_worker {
+	struct frr_pthread *fpt;
+	struct event *t_work;
+
+	/* statistics, written by the worker */
+	_Atomic uint64_t subgroups;
+	_Atomic uint64_t packets;
+	_Atomic uint64_t busy_usec;
+};
+
+/* Consecutive jobs for the subgroups of one update group */
+struct bgp_updgrp_build_unit {
+	unsigned int first;
+	unsigned int count;
+};
+
+static struct bgp_updgrp_build_info {
+	struct bgp_updgrp_build_worker *workers[BGP_UPDGRP_BUILD_WORKERS_MAX];
+	unsigned int count;
+
+	/* subgroups with queued advertisements */
+	struct bgp_updgrp_build_list_head pending;
+
+	/* the current run; set up before the workers are woken */
+	struct bgp_updgrp_build_job *jobs;
+	struct bgp_updgrp_build_unit *units;
+	unsigned int njobs;
+	unsigned int nunits;
+	unsigned int size;
+	_Atomic unsigned int next_unit;
+
+	/* protects running */
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int running;
+
+	/* statistics, written by the main pthread */
+	uint64_t runs;
+	uint64_t subgroups;
+	uint64_t packets;
+	uint64_t withdraws;
+	uint64_t updates;
+	uint64_t main_subgroups;
+	uint64_t wait_usec;
+} bub;
+
+void bgp_updgrp_build_job_consume(struct bgp_updgrp_build_job *job,
+				  struct bgp_advertise *adv)
+{
+	if (job->nupdates == job->updates_size) {
+		job->updates_size = MAX(64U, job->updates_size * 2);
+		job->updates = XREALLOC(MTYPE_BGP_UPDGRP_BUILD_JOB, job->updates,
+					job->updates_size *
+						sizeof(*job->updates));
+	}
+
+	job->updates[job->nupdates++] = adv;
+	adv->formatted = true;
+}
+
+void bgp_updgrp_build_schedule(struct update_subgroup *subgrp)
+{
+	if (!bub.count || bgp_updgrp_build_list_anywhere(subgrp))
+		return;
+
+	bgp_updgrp_build_list_add_tail(&bub.pending, subgrp);
+}
+
+void bgp_updgrp_build_cancel(struct update_subgroup *subgrp)
+{
+	if (bgp_updgrp_build_list_anywhere(subgrp))
+		bgp_updgrp_build_list_del(&bub.pending, subgrp);
+}
+
+/*
+ * Whether formatting for @subgrp now is what the inline path would do: some
+ * member peer has caught up with the packet queue and is free to send.
+ */
+static bool bgp_updgrp_build_ready(struct update_subgroup *subgrp)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	struct peer_connection *connection;
+	struct peer_af *paf;
+	struct peer *peer;
+
+	if (bgp->main_peers_update_hold || bgp_update_delay_active(bgp))
+		return false;
+
+	if (!subgroup_packets_format_deferrable(subgrp))
+		return false;
+
+	if (bpacket_queue_is_full(bgp, SUBGRP_PKTQ(subgrp)))
+		return false;
+
+	SUBGRP_FOREACH_PEER (subgrp, paf) {
+		peer = PAF_PEER(paf);
+		connection = peer->connection;
+
+		if (!peer_established(connection))
+			continue;
+		if (paf->next_pkt_to_send && paf->next_pkt_to_send->buffer)
+			continue;
+		if (event_is_scheduled(connection->t_routeadv) &&
+		    !CHECK_FLAG(peer->sflags, PEER_STATUS_COND_ADV_PENDING))
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
+static void bgp_updgrp_build_job_add(struct update_subgroup *subgrp)
+{
+	struct bgp_updgrp_build_job *job;
+	struct bpacket_queue *q = SUBGRP_PKTQ(subgrp);
+	unsigned int room;
+
+	if (bub.njobs == bub.size) {
+		bub.size = MAX(16U, bub.size * 2);
+		bub.jobs = XREALLOC(MTYPE_BGP_UPDGRP_BUILD_JOB, bub.jobs,
+				    bub.size * sizeof(*bub.jobs));
+		bub.units = XREALLOC(MTYPE_BGP_UPDGRP_BUILD_JOB, bub.units,
+				     bub.size * sizeof(*bub.units));
+	}
+
+	room = SUBGRP_INST(subgrp)->default_subgroup_pkt_queue_max -
+	       q->curr_count;
+
+	job = &bub.jobs[bub.njobs++];
+	memset(job, 0, sizeof(*job));
+	job->subgrp = subgrp;
+	job->max_pkts = MIN(room, BGP_UPDGRP_BUILD_PKTS_MAX);
+}
+
+static int bgp_updgrp_build_job_cmp(const void *a, const void *b)
+{
+	const struct bgp_updgrp_build_job *ja = a, *jb = b;
+	uint64_t ua = ja->subgrp->update_group->id;
+	uint64_t ub = jb->subgrp->update_group->id;
+
+	if (ua != ub)
+		return ua < ub ? -1 : 1;
+	if (ja->subgrp->id != jb->subgrp->id)
+		return ja->subgrp->id < jb->subgrp->id ? -1 : 1;
+	return 0;
+}
+
+static void bgp_updgrp_build_units_setup(void)
+{
+	struct bgp_updgrp_build_unit *unit = NULL;
+	struct update_group *updgrp = NULL;
+	unsigned int i;
+
+	qsort(bub.jobs, bub.njobs, sizeof(*bub.jobs), bgp_updgrp_build_job_cmp);
+
+	bub.nunits = 0;
+	for (i = 0; i < bub.njobs; i++) {
+		if (!unit || bub.jobs[i].subgrp->update_group != updgrp) {
+			updgrp = bub.jobs[i].subgrp->update_group;
+			unit = &bub.units[bub.nunits++];
+			unit->first = i;
+			unit->count = 0;
+		}
+		unit->count++;
+	}
+
+	atomic_store_explicit(&bub.next_unit, 0, memory_order_relaxed);
+}
+
+/* Format units until there are none left; any pthread. */
+static unsigned int bgp_updgrp_build_units(uint64_t *packets)
+{
+	struct bgp_updgrp_build_unit *unit;
+	struct bgp_updgrp_build_job *job;
+	unsigned int u, i, done = 0;
+
+	while ((u = atomic_fetch_add_explicit(&bub.next_unit, 1,
+					      memory_order_relaxed)) <
+	       bub.nunits) {
+		unit = &bub.units[u];
+
+		for (i = unit->first; i < unit->first + unit->count; i++) {
+			job = &bub.jobs[i];
+			subgroup_packets_format(job);
+			*packets += job->npkts;
+		}
+		done += unit->count;
+	}
+
+	return done;
+}
+
+/* Worker pthread: take part in the current run. */
+static void bgp_updgrp_build_work(struct event *event)
+{
+	struct bgp_updgrp_build_worker *w = EVENT_ARG(event);
+	struct timeval start;
+	uint64_t packets = 0;
+	unsigned int done;
+
+	monotime(&start);
+
+	done = bgp_updgrp_build_units(&packets);
+
+	atomic_fetch_add_explicit(&w->subgroups, done, memory_order_relaxed);
+	atomic_fetch_add_explicit(&w->packets, packets, memory_order_relaxed);
+	atomic_fetch_add_explicit(&w->busy_usec, monotime_since(&start, NULL),
+				  memory_order_relaxed);
+
+	frr_with_mutex (&bub.mtx) {
+		bub.running--;
+		pthread_cond_signal(&bub.cond);
+	}
+}
+
+void bgp_updgrp_build_run(void)
+{
+	struct update_subgroup *subgrp;
+	struct bgp_updgrp_build_job *job;
+	struct timeval start;
+	uint64_t packets = 0;
+	unsigned int i;
+
+	if (!bub.count || !bgp_updgrp_build_list_count(&bub.pending))
+		return;
+
+	if (bgp_in_graceful_restart())
+		return;
+
+	bub.njobs = 0;
+	frr_each_safe (bgp_updgrp_build_list, &bub.pending, subgrp) {
+		if (!subgroup_packets_to_build(subgrp)) {
+			bgp_updgrp_build_list_del(&bub.pending, subgrp);
+			continue;
+		}
+
+		if (bgp_updgrp_build_ready(subgrp))
+			bgp_updgrp_build_job_add(subgrp);
+	}
+
+	/* Not worth waking anyone up for, leave it to the inline path. */
+	if (bub.njobs < 2)
+		return;
+
+	bgp_updgrp_build_units_setup();
+
+	frr_with_mutex (&bub.mtx)
+		bub.running = bub.count;
+
+	for (i = 0; i < bub.count; i++)
+		event_add_event(bub.workers[i]->fpt->master,
+				bgp_updgrp_build_work, bub.workers[i], 0,
+				&bub.workers[i]->t_work);
+
+	bub.main_subgroups += bgp_updgrp_build_units(&packets);
+
+	monotime(&start);
+	frr_with_mutex (&bub.mtx) {
+		while (bub.running)
+			pthread_cond_wait(&bub.cond, &bub.mtx);
+	}
+	bub.wait_usec += monotime_since(&start, NULL);
+
+	/* Everything is back on the main pthread, apply it. */
+	for (i = 0; i < bub.njobs; i++) {
+		job = &bub.jobs[i];
+		subgrp = job->subgrp;
+
+		bub.packets += job->npkts;
+		bub.withdraws += job->nwithdraws;
+		bub.updates += job->nupdates;
+
+		subgroup_packets_commit(job);
+		XFREE(MTYPE_BGP_UPDGRP_BUILD_JOB, job->updates);
+
+		if (!subgroup_packets_to_build(subgrp))
+			bgp_updgrp_build_list_del(&bub.pending, subgrp);
+	}
+
+	bub.subgroups += bub.njobs;
+	bub.runs++;
+	bub.njobs = 0;
+}
+
+static struct bgp_updgrp_build_worker *bgp_updgrp_build_worker_start(unsigned int idx)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	struct bgp_updgrp_build_worker *w;
+	char name[32], os_name[OS_THREAD_NAMELEN];
+
+	snprintf(name, sizeof(name), "BGP format worker %u", idx);
+	snprintf(os_name, sizeof(os_name), "bgpd_fmt%u", idx);
+
+	w = XCALLOC(MTYPE_BGP_UPDGRP_BUILD_WORKER, sizeof(*w));
+
+	w->fpt = frr_pthread_new(&attr, name, os_name);
+	frr_pthread_run(w->fpt, NULL);
+	frr_pthread_wait_running(w->fpt);
+
+	return w;
+}
+
+static void bgp_updgrp_build_worker_stop(struct bgp_updgrp_build_worker *w)
+{
+	frr_pthread_stop(w->fpt, NULL);
+	frr_pthread_destroy(w->fpt);
+
+	XFREE(MTYPE_BGP_UPDGRP_BUILD_WORKER, w);
+}
+
+void bgp_updgrp_build_workers_set(unsigned int count)
+{
+	unsigned int i;
+
+	count = MIN(count, BGP_UPDGRP_BUILD_WORKERS_MAX);
+
+	if (count == bub.count)
+		return;
+
+	/* no run is in progress outside of bgp_updgrp_build_run() */
+	for (i = count; i < bub.count; i++) {
+		bgp_updgrp_build_worker_stop(bub.workers[i]);
+		bub.workers[i] = NULL;
+	}
+	for (i = bub.count; i < count; i++)
+		bub.workers[i] = bgp_updgrp_build_worker_start(i);
+	bub.count = count;
+
+	if (!count)
+		while (bgp_updgrp_build_list_pop(&bub.pending))
+			;
+}
+
+unsigned int bgp_updgrp_build_workers_get(void)
+{
+	return bub.count;
+}
+
+void bgp_updgrp_build_show(struct vty *vty, json_object *json)
+{
+	struct bgp_updgrp_build_worker *w;
+	json_object *json_workers = NULL, *json_worker;
+	unsigned int i;
+
+	if (json) {
+		json_object_int_add(json, "formatWorkers", bub.count);
+		json_object_int_add(json, "formatRuns", bub.runs);
+		json_object_int_add(json, "formatSubgroups", bub.subgroups);
+		json_object_int_add(json, "formatSubgroupsMain",
+				    bub.main_subgroups);
+		json_object_int_add(json, "formatPackets", bub.packets);
+		json_object_int_add(json, "formatWithdraws", bub.withdraws);
+		json_object_int_add(json, "formatUpdates", bub.updates);
+		json_object_int_add(json, "formatWaitUsec", bub.wait_usec);
+		json_object_int_add(json, "formatPending",
+				    bgp_updgrp_build_list_count(&bub.pending));
+		json_workers = json_object_new_array();
+		json_object_object_add(json, "formatWorkerStats", json_workers);
+	} else {
+		vty_out(vty, "UPDATE format workers: %u\n", bub.count);
+		vty_out(vty,
+			"  Runs: %" PRIu64 ", %" PRIu64 " subgroups (%" PRIu64
+			" on main), %zu pending\n",
+			bub.runs, bub.subgroups, bub.main_subgroups,
+			bgp_updgrp_build_list_count(&bub.pending));
+		vty_out(vty,
+			"  Packets: %" PRIu64 ", %" PRIu64 " withdrawn and %" PRIu64
+			" advertised prefixes\n",
+			bub.packets, bub.withdraws, bub.updates);
+		vty_out(vty, "  Main pthread waited %" PRIu64 " usec\n",
+			bub.wait_usec);
+	}
+
+	for (i = 0; i < bub.count; i++) {
+		w = bub.workers[i];
+
+		if (json) {
+			json_worker = json_object_new_object();
+			json_object_string_add(json_worker, "name", w->fpt->name);
+			json_object_int_add(json_worker, "subgroups",
+					    atomic_load_explicit(&w->subgroups,
+								 memory_order_relaxed));
+			json_object_int_add(json_worker, "packets",
+					    atomic_load_explicit(&w->packets,
+								 memory_order_relaxed));
+			json_object_int_add(json_worker, "busyUsec",
+					    atomic_load_explicit(&w->busy_usec,
+								 memory_order_relaxed));
+			json_object_array_add(json_workers, json_worker);
+			continue;
+		}
+
+		vty_out(vty,
+			"  %s: %" PRIu64 " subgroups, %" PRIu64
+			" packets, busy %" PRIu64 " usec\n",
+			w->fpt->name,
+			atomic_load_explicit(&w->subgroups, memory_order_relaxed),
+			atomic_load_explicit(&w->packets, memory_order_relaxed),
+			atomic_load_explicit(&w->busy_usec, memory_order_relaxed));
+	}
+}
+
+void bgp_updgrp_build_init(void)
+{
+	memset(&bub, 0, sizeof(bub));
+	bgp_updgrp_build_list_init(&bub.pending);
+	pthread_mutex_init(&bub.mtx, NULL);
+	pthread_cond_init(&bub.cond, NULL);
+}
+
+void bgp_updgrp_build_finish(void)
+{
+	bgp_updgrp_build_workers_set(0);
+	bgp_updgrp_build_list_fini(&bub.pending);
+	XFREE(MTYPE_BGP_UPDGRP_BUILD_JOB, bub.jobs);
+	XFREE(MTYPE_BGP_UPDGRP_BUILD_JOB, bub.units);
+	pthread_cond_destroy(&bub.cond);
+	pthread_mutex_destroy(&bub.mtx);
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* BGP update-group packet format workers.
+ * Formats the UPDATE packets of independent subgroups on a pool of pthreads.
+ */
+
+#ifndef _FRR_BGP_UPDGRP_BUILD_H
+#define _FRR_BGP_UPDGRP_BUILD_H
+
+#include "frr_pthread.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_updgrp.h"
+
+/* Upper bound for "bgp output-format-workers" */
+#define BGP_UPDGRP_BUILD_WORKERS_MAX 16
+
+/* Maximum number of packets formatted for one subgroup in a single run */
+#define BGP_UPDGRP_BUILD_PKTS_MAX 8
+
+struct bgp_updgrp_build_pkt {
+	struct stream *s;
+	/* unset for withdraw packets */
+	bool update;
+	struct bpacket_attr_vec_arr vecarr;
+};
+
+/*
+ * Formatting state of one subgroup.  While a run is in progress the job,
+ * the subgroup's advertisement FIFOs and its work streams belong to the
+ * pthread formatting it; everything else is only read.
+ */
+struct bgp_updgrp_build_job {
+	struct update_subgroup *subgrp;
+
+	/* room left in the subgroup's packet queue */
+	unsigned int max_pkts;
+
+	unsigned int npkts;
+	struct bgp_updgrp_build_pkt pkts[BGP_UPDGRP_BUILD_PKTS_MAX];
+
+	/* next candidates in sync->withdraw and sync->update */
+	struct bgp_advertise *withdraw_cursor;
+	struct bgp_advertise *update_cursor;
+
+	/* withdraws consumed, always from the head of sync->withdraw */
+	unsigned int nwithdraws;
+
+	/* updates consumed, marked as adv->formatted */
+	struct bgp_advertise **updates;
+	unsigned int nupdates;
+	unsigned int updates_size;
+
+	/* first advertisement of an attribute set too long to be sent */
+	struct bgp_advertise *flush;
+};
+
+/* Record @adv as formatted into the packet currently being built. */
+extern void bgp_updgrp_build_job_consume(struct bgp_updgrp_build_job *job,
+					 struct bgp_advertise *adv);
+
+/*
+ * Configure the number of format workers; 0 disables parallel formatting.
+ * Must be called from the main pthread.
+ */
+extern void bgp_updgrp_build_workers_set(unsigned int count);
+extern unsigned int bgp_updgrp_build_workers_get(void);
+
+/*
+ * Note that @subgrp has advertisements queued.  Called whenever one is
+ * added to one of its (empty or not) synchronization FIFOs.
+ */
+extern void bgp_updgrp_build_schedule(struct update_subgroup *subgrp);
+
+/* Forget about @subgrp, it is being deleted. */
+extern void bgp_updgrp_build_cancel(struct update_subgroup *subgrp);
+
+/*
+ * Format packets for all scheduled subgroups that have a member peer ready
+ * to send, in parallel, and queue them.  Called from the main pthread right
+ * before it would have formatted a packet itself.
+ */
+extern void bgp_updgrp_build_run(void);
+
+extern void bgp_updgrp_build_init(void);
+extern void bgp_updgrp_build_finish(void);
+
+extern void bgp_updgrp_build_show(struct vty *vty, json_object *json);
+
+#endif /* _FRR_BGP_UPDGRP_BUILD_H */
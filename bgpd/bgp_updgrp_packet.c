@@ -10,6 +10,7 @@
  */
 
 #include <zebra.h>
+#include <sys/uio.h>
 
 #include "prefix.h"
 #include "frrevent.h"
@@ -37,6 +38,7 @@
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_updgrp_build.h"
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_mplsvpn.h"
@@ -45,10 +47,57 @@
 #include "bgpd/bgp_trace.h"
 #include "bgpd/bgp_ls_nlri.h"
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_PACKET_BUF, "BGP shared packet data");
+DEFINE_MTYPE_STATIC(BGPD, BGP_PACKET_REF, "BGP shared packet reference");
+
 /********************
  * PRIVATE FUNCTIONS
  ********************/
 
+static void bpacket_buf_unref(struct bpacket_buf *buf)
+{
+	if (atomic_fetch_sub_explicit(&buf->refcnt, 1, memory_order_acq_rel) > 1)
+		return;
+
+	stream_free(buf->s);
+	XFREE(MTYPE_BGP_PACKET_BUF, buf);
+}
+
+/*
+ * Queue entry sharing @pkt, but for @frag_len bytes from @frag_off on which
+ * get their own copy.
+ */
+static struct bpacket_ref *bpacket_ref_new(struct bpacket *pkt,
+					   size_t frag_off, size_t frag_len)
+{
+	struct bpacket_ref *ref;
+	size_t size = stream_get_endp(pkt->buffer);
+
+	if (!pkt->shared) {
+		pkt->shared = XCALLOC(MTYPE_BGP_PACKET_BUF,
+				      sizeof(struct bpacket_buf));
+		pkt->shared->s = pkt->buffer;
+		atomic_store_explicit(&pkt->shared->refcnt, 1,
+				      memory_order_relaxed);
+	}
+
+	ref = XCALLOC(MTYPE_BGP_PACKET_REF, sizeof(struct bpacket_ref));
+	atomic_fetch_add_explicit(&pkt->shared->refcnt, 1,
+				  memory_order_relaxed);
+	ref->buf = pkt->shared;
+	ref->s.endp = size;
+
+	if (frag_len) {
+		ref->frag = stream_new(frag_len);
+		stream_put(ref->frag, STREAM_DATA(pkt->buffer) + frag_off,
+			   frag_len);
+		ref->frag_off = frag_off;
+	}
+
+	bgp_obuf_stats_add(frag_len, size - frag_len);
+	return ref;
+}
+
 /********************
  * PUBLIC FUNCTIONS
  ********************/
@@ -63,8 +112,11 @@ struct bpacket *bpacket_alloc(void)
 
 void bpacket_free(struct bpacket *pkt)
 {
-	if (pkt->buffer)
+	if (pkt->shared)
+		bpacket_buf_unref(pkt->shared);
+	else if (pkt->buffer)
 		stream_free(pkt->buffer);
+	pkt->shared = NULL;
 	pkt->buffer = NULL;
 	XFREE(MTYPE_BGP_PACKET, pkt);
 }
@@ -335,15 +387,32 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 					 struct peer_af *paf)
 {
 	struct stream *s = NULL;
+	struct bpacket_ref *ref = NULL;
 	bpacket_attr_vec *vec;
 	struct peer *peer;
 	struct bgp_filter *filter;
+	/* offset of the nexthop length in s */
+	size_t nh_off;
 
-	s = stream_dup(pkt->buffer);
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
 
+	if (!CHECK_FLAG(bm->flags, BM_FLAG_OUTPUT_ZERO_COPY)) {
+		s = stream_dup(pkt->buffer);
+		nh_off = vec->offset;
+		bgp_obuf_stats_add(stream_get_endp(s), 0);
+	} else if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED)) {
+		return &bpacket_ref_new(pkt, 0, 0)->s;
+	} else {
+		/* only the nexthop (and its length) may differ per peer */
+		ref = bpacket_ref_new(pkt, vec->offset,
+				      1 + stream_getc_from(pkt->buffer,
+							   vec->offset));
+		s = ref->frag;
+		nh_off = 0;
+	}
+
 	if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED))
 		return s;
 
@@ -351,7 +420,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 	afi_t nhafi;
 	int route_map_sets_nh;
 
-	nhlen = stream_getc_from(s, vec->offset);
+	nhlen = stream_getc_from(s, nh_off);
 	filter = &peer->filter[paf->afi][paf->safi];
 
 	if (peer_cap_enhe(peer, paf->afi, paf->safi))
@@ -362,7 +431,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 	if (nhafi == AFI_IP) {
 		struct in_addr v4nh, *mod_v4nh;
 		int nh_modified = 0;
-		size_t offset_nh = vec->offset + 1;
+		size_t offset_nh = nh_off + 1;
 
 		route_map_sets_nh =
 			(CHECK_FLAG(vec->flags,
@@ -384,7 +453,10 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
+			if (ref)
+				bpacket_ref_free(&ref->s);
+			else
+				stream_free(s);
 			return NULL;
 		}
 
@@ -447,8 +519,8 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		struct in6_addr v6nhglobal, *mod_v6nhg;
 		struct in6_addr v6nhlocal, *mod_v6nhl;
 		int gnh_modified, lnh_modified;
-		size_t offset_nhglobal = vec->offset + 1;
-		size_t offset_nhlocal = vec->offset + 1;
+		size_t offset_nhglobal = nh_off + 1;
+		size_t offset_nhlocal = nh_off + 1;
 		bool ll_nexthop_only = (nhlen == BGP_ATTR_NHLEN_IPV6_GLOBAL &&
 					PEER_HAS_LINK_LOCAL_CAPABILITY(peer));
 
@@ -490,7 +562,10 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP6): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
+			if (ref)
+				bpacket_ref_free(&ref->s);
+			else
+				stream_free(s);
 			return NULL;
 		}
 
@@ -596,7 +671,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		struct in_addr v4nh, *mod_v4nh;
 		int nh_modified = 0;
 
-		stream_get_from(&v4nh, s, vec->offset + 1, 4);
+		stream_get_from(&v4nh, s, nh_off + 1, 4);
 		mod_v4nh = &v4nh;
 
 		/* No route-map changes allowed for EVPN nexthops. */
@@ -606,7 +681,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		}
 
 		if (nh_modified)
-			stream_put_in_addr_at(s, vec->offset + 1, mod_v4nh);
+			stream_put_in_addr_at(s, nh_off + 1, mod_v4nh);
 
 		if (bgp_debug_update(peer, NULL, NULL, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64
@@ -615,7 +690,58 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				   PAF_SUBGRP(paf)->id, peer->host, mod_v4nh);
 	}
 
-	return s;
+	return ref ? &ref->s : s;
+}
+
+void bpacket_ref_free(struct stream *s)
+{
+	struct bpacket_ref *ref = container_of(s, struct bpacket_ref, s);
+
+	stream_free(ref->frag);
+	bpacket_buf_unref(ref->buf);
+	XFREE(MTYPE_BGP_PACKET_REF, ref);
+}
+
+/* Fill @iov with what is left to write of a bpacket_ref */
+unsigned int bpacket_ref_iov(struct stream *s, struct iovec *iov)
+{
+	struct bpacket_ref *ref = container_of(s, struct bpacket_ref, s);
+	uint8_t *data = STREAM_DATA(ref->buf->s);
+	size_t frag_len = ref->frag ? stream_get_endp(ref->frag) : 0;
+	size_t frag_end = ref->frag_off + frag_len;
+	struct iovec seg[BGP_OBUF_IOV_MAX] = {
+		{ data, ref->frag ? ref->frag_off : s->endp },
+		{ ref->frag ? STREAM_DATA(ref->frag) : NULL, frag_len },
+		{ data + frag_end, ref->frag ? s->endp - frag_end : 0 },
+	};
+	size_t skip = s->getp;
+	unsigned int i, n = 0;
+
+	for (i = 0; i < BGP_OBUF_IOV_MAX; i++) {
+		if (skip >= seg[i].iov_len) {
+			skip -= seg[i].iov_len;
+			continue;
+		}
+		iov[n].iov_base = (uint8_t *)seg[i].iov_base + skip;
+		iov[n].iov_len = seg[i].iov_len - skip;
+		skip = 0;
+		n++;
+	}
+	return n;
+}
+
+void bpacket_ref_forward(struct stream *s, size_t size)
+{
+	assert(s->getp + size <= s->endp);
+	s->getp += size;
+}
+
+uint8_t bpacket_ref_type(struct stream *s)
+{
+	struct bpacket_ref *ref = container_of(s, struct bpacket_ref, s);
+
+	/* the header is never rewritten */
+	return stream_getc_from(ref->buf->s, BGP_MARKER_SIZE + 2);
 }
 
 /*
@@ -655,11 +781,54 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
-/* Make BGP update packet.  */
-struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+/*
+ * Bring the adj-out of an advertisement that went into a packet in sync with
+ * it, and return the next advertisement with the same attributes.
+ */
+static struct bgp_advertise *subgroup_adv_sync(struct update_subgroup *subgrp,
+					       struct bgp_advertise *adv)
+{
+	struct bgp_adj_out *adj = adv->adj;
+
+	if (adj->attr)
+		bgp_attr_unintern(&adj->attr);
+	else
+		subgrp->scount++;
+
+	adj->attr = bgp_attr_intern(adv->baa->attr);
+	return bgp_advertise_clean_subgroup(subgrp, adj);
+}
+
+/*
+ * Deferred version of subgroup_adv_sync(): the advertisement stays queued
+ * until subgroup_packets_commit(), so step over it to the next one with the
+ * same attributes that has not been formatted yet.
+ */
+static struct bgp_advertise *subgroup_adv_defer(struct bgp_updgrp_build_job *job,
+						struct bgp_advertise *adv)
+{
+	struct bgp_advertise_attr *baa = adv->baa;
+
+	bgp_updgrp_build_job_consume(job, adv);
+
+	do
+		adv = bgp_advertise_attr_fifo_next(&baa->fifo, adv);
+	while (adv && adv->formatted);
+
+	return adv;
+}
+
+/*
+ * Format one UPDATE packet from the update FIFO.  Without @job the adj-outs
+ * are synced as the prefixes are consumed; with it, nothing but the subgroup's
+ * work streams and the advertisements' formatted flag is modified, so this may
+ * run outside the main pthread (see bgp_updgrp_build.c).
+ */
+static struct stream *
+subgroup_update_packet_build(struct update_subgroup *subgrp,
+			     struct bpacket_attr_vec_arr *vecarr,
+			     struct bgp_updgrp_build_job *job)
 {
-	struct bpacket_attr_vec_arr vecarr;
-	struct bpacket *pkt;
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
@@ -689,12 +858,6 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	struct bgp_ls_nlri *ls_nlri = NULL;
 	bool packet_is_upa = false;
 
-	if (!subgrp)
-		return NULL;
-
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
-
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
 	safi = SUBGRP_SAFI(subgrp);
@@ -703,12 +866,19 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	snlri = subgrp->scratch;
 	stream_reset(snlri);
 
-	bpacket_attr_vec_arr_reset(&vecarr);
+	bpacket_attr_vec_arr_reset(vecarr);
 
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+	if (job) {
+		adv = job->update_cursor;
+		while (adv && adv->formatted)
+			adv = bgp_adv_fifo_next(&subgrp->sync->update, adv);
+		job->update_cursor = adv;
+	} else
+		adv = bgp_adv_fifo_first(&subgrp->sync->update);
+
 	while (adv) {
 		const struct prefix *dest_p;
 
@@ -784,7 +954,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			/* 5: Encode all the attributes, except MP_REACH_NLRI
 			 * attr. */
 			total_attr_len = bgp_packet_attribute(NULL, peer, s, adv->baa->attr,
-							      &vecarr, NULL, afi, safi, from, NULL,
+							      vecarr, NULL, afi, safi, from, NULL,
 							      NULL, 0, dest->srv6_unicast, 0, 0,
 							      path, NULL, false);
 			space_remaining =
@@ -804,6 +974,10 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 					subgrp->update_group->id, subgrp->id);
 
 				/* Flush the FIFO update queue */
+				if (job) {
+					job->flush = adv;
+					return NULL;
+				}
 				while (adv) {
 					struct bgp_adj_out *curr_adj = adv->adj;
 
@@ -898,7 +1072,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 			if (stream_empty(snlri))
 				mpattrlen_pos = bgp_packet_mpattr_start(
-					snlri, peer, afi, safi, &vecarr,
+					snlri, peer, afi, safi, vecarr,
 					adv->baa->attr);
 
 			bgp_packet_mpattr_prefix(snlri, afi, safi, dest_p, prd, label_pnt,
@@ -945,13 +1119,10 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 		}
 
 		/* Synchnorize attribute.  */
-		if (adj->attr)
-			bgp_attr_unintern(&adj->attr);
+		if (job)
+			adv = subgroup_adv_defer(job, adv);
 		else
-			subgrp->scount++;
-
-		adj->attr = bgp_attr_intern(adv->baa->attr);
-		adv = bgp_advertise_clean_subgroup(subgrp, adj);
+			adv = subgroup_adv_sync(subgrp, adv);
 	}
 
 	if (!stream_empty(s)) {
@@ -965,7 +1136,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 		if (!stream_empty(snlri)) {
 			packet = stream_dupcat(s, snlri, mpattr_pos);
-			bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
+			bpacket_attr_vec_arr_update(vecarr, mpattr_pos);
 		} else
 			packet = stream_dup(s);
 		bgp_packet_set_size(packet);
@@ -977,14 +1148,41 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				(stream_get_endp(packet)
 				 - stream_get_getp(packet)),
 				peer->max_packet_size, num_pfx);
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
 		stream_reset(s);
 		stream_reset(snlri);
-		return pkt;
+		return packet;
 	}
 	return NULL;
 }
 
+/* Make BGP update packet.  */
+struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+{
+	struct bpacket_attr_vec_arr vecarr;
+	struct stream *packet;
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	packet = subgroup_update_packet_build(subgrp, &vecarr, NULL);
+	if (!packet)
+		return NULL;
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
+}
+
+static inline struct bgp_advertise *
+subgroup_withdraw_next(struct update_subgroup *subgrp,
+		       struct bgp_updgrp_build_job *job)
+{
+	if (job)
+		return job->withdraw_cursor;
+	return bgp_adv_fifo_first(&subgrp->sync->withdraw);
+}
+
 /* Make BGP withdraw packet.  */
 /* For ipv4 unicast:
    16-octet marker | 2-octet length | 1-octet type |
@@ -995,9 +1193,15 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
     2-octet withdrawn route length (=0) | 2-octet attrlen |
      mp_unreach attr type | attr len | afi | safi | withdrawn prefixes
 */
-struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
+/*
+ * As for subgroup_update_packet_build(), @job defers the adj-out removal to
+ * subgroup_packets_commit().
+ */
+static struct stream *
+subgroup_withdraw_packet_build(struct update_subgroup *subgrp,
+			       struct bgp_updgrp_build_job *job)
 {
-	struct bpacket *pkt;
+	struct stream *packet;
 	struct stream *s;
 	struct bgp_adj_out *adj;
 	struct bgp_advertise *adv;
@@ -1020,13 +1224,6 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 	const struct prefix_rd *prd = NULL;
 	struct bgp_ls_nlri *ls_nlri = NULL;
 
-
-	if (!subgrp)
-		return NULL;
-
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
-
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
 	safi = SUBGRP_SAFI(subgrp);
@@ -1035,7 +1232,7 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	while ((adv = bgp_adv_fifo_first(&subgrp->sync->withdraw)) != NULL) {
+	while ((adv = subgroup_withdraw_next(subgrp, job)) != NULL) {
 		const struct prefix *dest_p;
 
 		assert(adv->dest);
@@ -1174,6 +1371,13 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
+		if (job) {
+			job->nwithdraws++;
+			job->withdraw_cursor =
+				bgp_adv_fifo_next(&subgrp->sync->withdraw, adv);
+			continue;
+		}
+
 		subgrp->scount--;
 
 		bgp_adj_out_remove_subgroup(dest, adj, subgrp);
@@ -1204,15 +1408,120 @@ struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
 		frrtrace(4, frr_bgp, upd_send_withdraw_details, subgrp->update_group->id,
 			 subgrp->id, (stream_get_endp(s) - stream_get_getp(s)), num_pfx);
 
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), stream_dup(s),
-					NULL);
+		packet = stream_dup(s);
 		stream_reset(s);
-		return pkt;
+		return packet;
 	}
 
 	return NULL;
 }
 
+struct bpacket *subgroup_withdraw_packet(struct update_subgroup *subgrp)
+{
+	struct stream *packet;
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	packet = subgroup_withdraw_packet_build(subgrp, NULL);
+	if (!packet)
+		return NULL;
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, NULL);
+}
+
+/*
+ * Whether the packets of @subgrp may be formatted by subgroup_packets_format()
+ * outside the main pthread.  Labeled, VPN and BGP-LS families look up or
+ * allocate state per prefix while formatting and are left to the main
+ * pthread, as is everything while update debugging is on.
+ */
+bool subgroup_packets_format_deferrable(struct update_subgroup *subgrp)
+{
+	afi_t afi = SUBGRP_AFI(subgrp);
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (afi != AFI_IP && afi != AFI_IP6)
+		return false;
+	if (safi != SAFI_UNICAST && safi != SAFI_MULTICAST)
+		return false;
+
+	if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0) ||
+	    BGP_DEBUG(update, UPDATE_PREFIX) ||
+	    BGP_DEBUG(unreachability, UNREACHABILITY))
+		return false;
+
+	return true;
+}
+
+/*
+ * Format up to job->max_pkts packets for job->subgrp, withdraws first as
+ * bgp_generate_updgrp_packets() does.  May run on any pthread, provided the
+ * main pthread is not touching the subgroup meanwhile.
+ */
+void subgroup_packets_format(struct bgp_updgrp_build_job *job)
+{
+	struct update_subgroup *subgrp = job->subgrp;
+	struct bgp_updgrp_build_pkt *pkt;
+
+	job->withdraw_cursor = bgp_adv_fifo_first(&subgrp->sync->withdraw);
+	job->update_cursor = bgp_adv_fifo_first(&subgrp->sync->update);
+
+	while (job->npkts < job->max_pkts && job->withdraw_cursor) {
+		pkt = &job->pkts[job->npkts];
+		pkt->update = false;
+		pkt->s = subgroup_withdraw_packet_build(subgrp, job);
+		if (!pkt->s)
+			break;
+		job->npkts++;
+	}
+
+	while (job->npkts < job->max_pkts && !job->flush) {
+		pkt = &job->pkts[job->npkts];
+		pkt->update = true;
+		pkt->s = subgroup_update_packet_build(subgrp, &pkt->vecarr, job);
+		if (!pkt->s)
+			break;
+		job->npkts++;
+	}
+}
+
+/*
+ * Main pthread side of subgroup_packets_format(): sync the adj-outs of
+ * everything that was formatted and queue the packets.
+ */
+void subgroup_packets_commit(struct bgp_updgrp_build_job *job)
+{
+	struct update_subgroup *subgrp = job->subgrp;
+	struct bgp_advertise *adv;
+	struct bgp_updgrp_build_pkt *pkt;
+	unsigned int i;
+
+	for (i = 0; i < job->nwithdraws; i++) {
+		adv = bgp_adv_fifo_first(&subgrp->sync->withdraw);
+		subgrp->scount--;
+		bgp_adj_out_remove_subgroup(adv->dest, adv->adj, subgrp);
+	}
+
+	for (i = 0; i < job->nupdates; i++)
+		subgroup_adv_sync(subgrp, job->updates[i]);
+
+	/* Flush the attributes that did not fit, as the regular path does */
+	adv = job->flush;
+	while (adv)
+		adv = bgp_advertise_clean_subgroup(subgrp, adv->adj);
+
+	for (i = 0; i < job->npkts; i++) {
+		pkt = &job->pkts[i];
+		bpacket_queue_add(SUBGRP_PKTQ(subgrp), pkt->s,
+				  pkt->update ? &pkt->vecarr : NULL);
+		pkt->s = NULL;
+	}
+}
+
 void subgroup_default_update_packet(struct update_subgroup *subgrp,
 				    struct attr *attr, struct peer *from)
 {
@@ -48,6 +48,7 @@
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_open.h"
+#include "bgpd/bgp_reclaim.h"
 #include "bgpd/bgp_regex.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_mplsvpn.h"
@@ -59,6 +60,10 @@
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_updgrp_build.h"
+#include "bgpd/bgp_soft_reconfig.h"
+#include "bgpd/bgp_intern.h"
 #include "bgpd/bgp_evpn.h"
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_evpn_mh.h"
@@ -4537,6 +4542,26 @@ DEFPY (bgp_bestpath_use_imported_attrs,
 	return CMD_SUCCESS;
 }
 
+/* "bgp bestpath compact-selection" configuration. */
+DEFPY (bgp_bestpath_compact,
+       bgp_bestpath_compact_cmd,
+       "[no$no] bgp bestpath compact-selection",
+       NO_STR
+       BGP_STR
+       "Change the default bestpath selection\n"
+       "Compare paths using a compact snapshot of their attributes\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	/* Selection results are the same either way, nothing to recompute */
+	if (no)
+		UNSET_FLAG(bgp->flags, BGP_FLAG_BESTPATH_COMPACT);
+	else
+		SET_FLAG(bgp->flags, BGP_FLAG_BESTPATH_COMPACT);
+
+	return CMD_SUCCESS;
+}
+
 /* "bgp bestpath as-path confed" configuration.  */
 DEFUN (bgp_bestpath_aspath_confed,
        bgp_bestpath_aspath_confed_cmd,
@@ -13875,7 +13900,7 @@ DEFUN (show_bgp_memory,
        "Global BGP memory statistics\n")
 {
 	char memstrbuf[MTYPE_MEMSTR_LEN];
-	unsigned long count;
+	unsigned long count, paths, adj_ins;
 
 	/* RIB related usage stats */
 	count = mtype_stats_alloc(MTYPE_BGP_NODE);
@@ -13932,10 +13957,40 @@ DEFUN (show_bgp_memory,
 		vty_out(vty, "%ld Adj-In entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_adj_in)));
+	bgp_reclaim_pending(&paths, &adj_ins);
+	if (paths || adj_ins)
+		vty_out(vty,
+			"%lu BGP routes and %lu Adj-In entries waiting to be released\n",
+			paths, adj_ins);
 	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT)))
 		vty_out(vty, "%ld Adj-Out entries, using %s of memory\n", count,
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * sizeof(struct bgp_adj_out_full)));
+	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_COMPACT)))
+		vty_out(vty,
+			"%ld compact Adj-Out entries, using %s of memory\n",
+			count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_adj_out)));
+	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_EXT)))
+		vty_out(vty,
+			"%ld compact Adj-Out side entries, using %s of memory\n",
+			count,
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * sizeof(struct bgp_adj_out_ext)));
+	count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT) +
+		mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_COMPACT);
+	if (count) {
+		vty_out(vty, "Adj-Out model %s, entries would use %s",
+			CHECK_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT)
+				? "compact"
+				: "full",
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * sizeof(struct bgp_adj_out_full)));
+		vty_out(vty, " as full and %s as compact\n",
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * sizeof(struct bgp_adj_out)));
+	}
 
 	if ((count = mtype_stats_alloc(MTYPE_BGP_NEXTHOP_CACHE)))
 		vty_out(vty, "%ld Nexthop cache entries, using %s of memory\n",
@@ -14708,11 +14763,7 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 								      ->obuf
 								      ->count,
 							     memory_order_relaxed);
-				inq_count =
-					atomic_load_explicit(&peer->connection
-								      ->ibuf
-								      ->count,
-							     memory_order_relaxed);
+				inq_count = bgp_inq_count(peer->connection->ibuf);
 
 				json_object_int_add(
 					json_peer, "tableVersion",
@@ -14892,11 +14943,7 @@ static int bgp_show_summary(struct vty *vty, struct bgp *bgp, int afi, int safi,
 								      ->obuf
 								      ->count,
 							     memory_order_relaxed);
-				inq_count =
-					atomic_load_explicit(&peer->connection
-								      ->ibuf
-								      ->count,
-							     memory_order_relaxed);
+				inq_count = bgp_inq_count(peer->connection->ibuf);
 
 				vty_out(vty, "4");
 				vty_out(vty, ASN_FORMAT_SPACE(bgp->asnotation),
@@ -18003,8 +18050,7 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, uint16_t sh_flags, bo
 		atomic_size_t outq_count, inq_count;
 		outq_count = atomic_load_explicit(&p->connection->obuf->count,
 						  memory_order_relaxed);
-		inq_count = atomic_load_explicit(&p->connection->ibuf->count,
-						 memory_order_relaxed);
+		inq_count = bgp_inq_count(p->connection->ibuf);
 
 		json_object_int_add(json_stat, "depthInq",
 				    (unsigned long)inq_count);
@@ -18066,8 +18112,7 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, uint16_t sh_flags, bo
 			dynamic_cap_out, dynamic_cap_in;
 		outq_count = atomic_load_explicit(&p->connection->obuf->count,
 						  memory_order_relaxed);
-		inq_count = atomic_load_explicit(&p->connection->ibuf->count,
-						 memory_order_relaxed);
+		inq_count = bgp_inq_count(p->connection->ibuf);
 		open_out = atomic_load_explicit(&p->open_out,
 						memory_order_relaxed);
 		open_in =
@@ -18977,10 +19022,10 @@ DEFUN (show_ip_bgp_community_info,
 {
 	vty_out(vty, "Address Refcnt Community\n");
 
-	hash_iterate(community_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))community_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(community_hash(),
+			   (void (*)(struct hash_bucket *,
+				     void *))community_show_all_iterator,
+			   vty);
 
 	return CMD_SUCCESS;
 }
@@ -19006,10 +19051,10 @@ DEFUN (show_ip_bgp_lcommunity_info,
 {
 	vty_out(vty, "Address Refcnt Large-community\n");
 
-	hash_iterate(lcommunity_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))lcommunity_show_all_iterator,
-		     vty);
+	bgp_intern_iterate(lcommunity_hash(),
+			   (void (*)(struct hash_bucket *,
+				     void *))lcommunity_show_all_iterator,
+			   vty);
 
 	return CMD_SUCCESS;
 }
@@ -22280,6 +22325,27 @@ int bgp_config_write(struct vty *vty)
 	if (bm->outq_limit != BM_DEFAULT_Q_LIMIT)
 		vty_out(vty, "bgp output-queue-limit %u\n", bm->outq_limit);
 
+	if (bgp_parse_workers_get())
+		vty_out(vty, "bgp input-parse-workers %u\n",
+			bgp_parse_workers_get());
+
+	if (bgp_updgrp_build_workers_get())
+		vty_out(vty, "bgp output-format-workers %u\n",
+			bgp_updgrp_build_workers_get());
+
+	if (bgp_soft_reconfig_workers_get())
+		vty_out(vty, "bgp soft-reconfiguration-workers %u\n",
+			bgp_soft_reconfig_workers_get());
+
+	if (CHECK_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT))
+		vty_out(vty, "bgp adj-rib-out compact\n");
+
+	if (CHECK_FLAG(bm->flags, BM_FLAG_OUTPUT_ZERO_COPY))
+		vty_out(vty, "bgp output-zero-copy\n");
+
+	if (CHECK_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM))
+		vty_out(vty, "bgp deferred-reclaim\n");
+
 	vty_out(vty, "!\n");
 
 	/* BGP configuration. */
@@ -22630,6 +22696,8 @@ int bgp_config_write(struct vty *vty)
 			vty_out(vty, " bgp bestpath compare-routerid\n");
 		if (CHECK_FLAG(bgp->flags, BGP_FLAG_BESTPATH_USE_IMPORTED_ATTRS))
 			vty_out(vty, " bgp bestpath use-imported-attributes\n");
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_BESTPATH_COMPACT))
+			vty_out(vty, " bgp bestpath compact-selection\n");
 
 		if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_COMPARE_AIGP) != SAVE_BGP_COMPARE_AIGP)
 			vty_out(vty, " %sbgp bestpath aigp\n",
@@ -23240,6 +23308,152 @@ DEFPY (no_bgp_outq_limit,
 	return CMD_SUCCESS;
 }
 
+DEFPY (bgp_input_parse_workers,
+       bgp_input_parse_workers_cmd,
+       "bgp input-parse-workers (1-16)$workers",
+       BGP_STR
+       "Decode received UPDATE messages on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_parse_workers_set(workers);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_input_parse_workers,
+       no_bgp_input_parse_workers_cmd,
+       "no bgp input-parse-workers [(1-16)$workers]",
+       NO_STR
+       BGP_STR
+       "Decode received UPDATE messages on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_parse_workers_set(0);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_output_format_workers,
+       bgp_output_format_workers_cmd,
+       "bgp output-format-workers (1-16)$workers",
+       BGP_STR
+       "Format UPDATE messages of independent subgroups on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_updgrp_build_workers_set(workers);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_output_format_workers,
+       no_bgp_output_format_workers_cmd,
+       "no bgp output-format-workers [(1-16)$workers]",
+       NO_STR
+       BGP_STR
+       "Format UPDATE messages of independent subgroups on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_updgrp_build_workers_set(0);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_soft_reconfig_workers,
+       bgp_soft_reconfig_workers_cmd,
+       "bgp soft-reconfiguration-workers (1-16)$workers",
+       BGP_STR
+       "Evaluate inbound policy for soft reconfiguration on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_soft_reconfig_workers_set(workers);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (no_bgp_soft_reconfig_workers,
+       no_bgp_soft_reconfig_workers_cmd,
+       "no bgp soft-reconfiguration-workers [(1-16)$workers]",
+       NO_STR
+       BGP_STR
+       "Evaluate inbound policy for soft reconfiguration on a pool of worker threads\n"
+       "Number of worker threads\n")
+{
+	bgp_soft_reconfig_workers_set(0);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_adj_rib_out_compact,
+       bgp_adj_rib_out_compact_cmd,
+       "[no] bgp adj-rib-out compact",
+       NO_STR
+       BGP_STR
+       "Adj-RIB-Out configuration\n"
+       "Use the compact representation for new Adj-RIB-Out entries\n")
+{
+	if (no)
+		UNSET_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT);
+	else
+		SET_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_output_zero_copy,
+       bgp_output_zero_copy_cmd,
+       "[no] bgp output-zero-copy",
+       NO_STR
+       BGP_STR
+       "Share UPDATE messages between the output queues of a subgroup's peers\n")
+{
+	if (no)
+		UNSET_FLAG(bm->flags, BM_FLAG_OUTPUT_ZERO_COPY);
+	else
+		SET_FLAG(bm->flags, BM_FLAG_OUTPUT_ZERO_COPY);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (bgp_deferred_reclaim,
+       bgp_deferred_reclaim_cmd,
+       "[no] bgp deferred-reclaim",
+       NO_STR
+       BGP_STR
+       "Release removed routes and Adj-RIB-In entries in the background\n")
+{
+	if (no)
+		UNSET_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM);
+	else
+		SET_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (show_bgp_io,
+       show_bgp_io_cmd,
+       "show bgp io [json$uj]",
+       SHOW_STR
+       BGP_STR
+       "BGP input/output processing statistics\n"
+       JSON_STR)
+{
+	json_object *json = NULL;
+
+	if (uj)
+		json = json_object_new_object();
+
+	bgp_parse_show(vty, json);
+	bgp_io_show(vty, json);
+	bgp_updgrp_build_show(vty, json);
+	bgp_obuf_show(vty, json);
+	bgp_soft_reconfig_show(vty, json);
+
+	if (uj)
+		vty_json(vty, json);
+
+	return CMD_SUCCESS;
+}
+
 
 /* Initialization of BGP interface. */
 static void bgp_vty_if_init(void)
@@ -23434,6 +23648,17 @@ void bgp_vty_init(void)
 	install_element(CONFIG_NODE, &bgp_outq_limit_cmd);
 	install_element(CONFIG_NODE, &no_bgp_outq_limit_cmd);
 
+	install_element(CONFIG_NODE, &bgp_input_parse_workers_cmd);
+	install_element(CONFIG_NODE, &no_bgp_input_parse_workers_cmd);
+
+	install_element(CONFIG_NODE, &bgp_output_format_workers_cmd);
+	install_element(CONFIG_NODE, &no_bgp_output_format_workers_cmd);
+	install_element(CONFIG_NODE, &bgp_soft_reconfig_workers_cmd);
+	install_element(CONFIG_NODE, &no_bgp_soft_reconfig_workers_cmd);
+	install_element(CONFIG_NODE, &bgp_adj_rib_out_compact_cmd);
+	install_element(CONFIG_NODE, &bgp_output_zero_copy_cmd);
+	install_element(CONFIG_NODE, &bgp_deferred_reclaim_cmd);
+
 	/* "bgp local-mac" hidden commands. */
 	install_element(CONFIG_NODE, &bgp_local_mac_cmd);
 	install_element(CONFIG_NODE, &no_bgp_local_mac_cmd);
@@ -23710,6 +23935,9 @@ void bgp_vty_init(void)
 	/* "bgp bestpath use-imported-attributes" commands */
 	install_element(BGP_NODE, &bgp_bestpath_use_imported_attrs_cmd);
 
+	/* "bgp bestpath compact-selection" commands */
+	install_element(BGP_NODE, &bgp_bestpath_compact_cmd);
+
 	/* "bgp bestpath as-path confed" commands */
 	install_element(BGP_NODE, &bgp_bestpath_aspath_confed_cmd);
 	install_element(BGP_NODE, &no_bgp_bestpath_aspath_confed_cmd);
@@ -25074,6 +25302,7 @@ void bgp_vty_init(void)
 
 	/* Some overall BGP information */
 	install_element(VIEW_NODE, &show_bgp_router_cmd);
+	install_element(VIEW_NODE, &show_bgp_io_cmd);
 
 	/* "show bgp vrfs bestpath" command. */
 	install_element(VIEW_NODE, &show_bgp_vrf_bestpath_cmd);
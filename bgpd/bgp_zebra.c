@@ -1600,11 +1600,14 @@ static void bgp_debug_zebra_nh(struct zapi_route *api)
 	}
 }
 
-enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
-						   struct bgp_path_info *info, struct bgp *bgp)
+/*
+ * Fill @api with what zebra is told of @dest when @info is installed, or
+ * return false when zebra is not told anything.
+ */
+static bool bgp_zebra_announce_make(struct bgp_dest *dest, struct bgp_path_info *info,
+				    struct bgp *bgp, struct zapi_route *api)
 {
 	struct bgp_path_info *bpi_ultimate;
-	struct zapi_route api;
 	unsigned int valid_nh_count = 0;
 	bool allow_recursion = false;
 	uint8_t distance;
@@ -1619,17 +1622,17 @@ enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
 	if (table->safi == SAFI_FLOWSPEC) {
 		bgp_pbr_update_entry(bgp, p, info, table->afi, table->safi,
 				     true);
-		return ZCLIENT_SEND_SUCCESS;
+		return false;
 	}
 
-	zapi_route_init(&api);
+	zapi_route_init(api);
 
 	/* Make Zebra API structure. */
-	api.vrf_id = bgp->vrf_id;
-	api.type = ZEBRA_ROUTE_BGP;
-	api.safi = table->safi;
-	api.prefix = *p;
-	SET_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP);
+	api->vrf_id = bgp->vrf_id;
+	api->type = ZEBRA_ROUTE_BGP;
+	api->safi = table->safi;
+	api->prefix = *p;
+	SET_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP);
 
 	peer = info->peer;
 
@@ -1642,8 +1645,8 @@ enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
 
 	if (peer->sort == BGP_PEER_IBGP || peer->sort == BGP_PEER_CONFED
 	    || info->sub_type == BGP_ROUTE_AGGREGATE) {
-		SET_FLAG(api.flags, ZEBRA_FLAG_IBGP);
-		SET_FLAG(api.flags, ZEBRA_FLAG_ALLOW_RECURSION);
+		SET_FLAG(api->flags, ZEBRA_FLAG_IBGP);
+		SET_FLAG(api->flags, ZEBRA_FLAG_ALLOW_RECURSION);
 	}
 
 	if ((peer->sort == BGP_PEER_EBGP && peer->ttl != BGP_DEFAULT_TTL)
@@ -1653,24 +1656,24 @@ enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
 		allow_recursion = true;
 
 	if (info->attr->rmap_table_id) {
-		SET_FLAG(api.message, ZAPI_MESSAGE_TABLEID);
-		api.tableid = info->attr->rmap_table_id;
+		SET_FLAG(api->message, ZAPI_MESSAGE_TABLEID);
+		api->tableid = info->attr->rmap_table_id;
 	}
 
 	if (info->extra && info->extra->srte_color)
-		SET_FLAG(api.message, ZAPI_MESSAGE_SRTE);
+		SET_FLAG(api->message, ZAPI_MESSAGE_SRTE);
 
 	/* Metric is currently based on the best-path only */
 	metric = info->attr->med;
 
 	/* Determine if we're doing weighted ECMP or not */
 	do_wt_ecmp = bgp_path_info_mpath_chkwtd(bgp, dest);
-	bgp_zebra_announce_parse_nexthop(info, p, bgp, &api, &valid_nh_count, table->afi,
+	bgp_zebra_announce_parse_nexthop(info, p, bgp, api, &valid_nh_count, table->afi,
 					 table->safi, &nhg_id, &metric, &tag, &allow_recursion,
 					 do_wt_ecmp);
 
 	if (do_wt_ecmp == BGP_WECMP_BEHAVIOR_USE_RECURSIVE_VALUE)
-		SET_FLAG(api.flags, ZEBRA_FLAG_USE_RECURSIVE_WEIGHT);
+		SET_FLAG(api->flags, ZEBRA_FLAG_USE_RECURSIVE_WEIGHT);
 
 	if (CHECK_FLAG(bm->flags, BM_FLAG_SEND_EXTRA_DATA_TO_ZEBRA)) {
 		struct bgp_zebra_opaque bzo = {};
@@ -1693,14 +1696,14 @@ enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
 		strlcpy(bzo.selection_reason, reason,
 			sizeof(bzo.selection_reason));
 
-		SET_FLAG(api.message, ZAPI_MESSAGE_OPAQUE);
-		api.opaque.length = MIN(sizeof(struct bgp_zebra_opaque),
+		SET_FLAG(api->message, ZAPI_MESSAGE_OPAQUE);
+		api->opaque.length = MIN(sizeof(struct bgp_zebra_opaque),
 					ZAPI_MESSAGE_OPAQUE_LENGTH);
-		memcpy(api.opaque.data, &bzo, api.opaque.length);
+		memcpy(api->opaque.data, &bzo, api->opaque.length);
 	}
 
 	if (allow_recursion)
-		SET_FLAG(api.flags, ZEBRA_FLAG_ALLOW_RECURSION);
+		SET_FLAG(api->flags, ZEBRA_FLAG_ALLOW_RECURSION);
 
 	/*
 	 * When we create an aggregate route we must also
@@ -1708,44 +1711,74 @@ enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
 	 * what was written into api with a blackhole route
 	 */
 	if (info->sub_type == BGP_ROUTE_AGGREGATE)
-		zapi_route_set_blackhole(&api, BLACKHOLE_NULL);
+		zapi_route_set_blackhole(api, BLACKHOLE_NULL);
 	/* UPA routes with D-bit set get blackhole nexthop */
 	else if (CHECK_FLAG(info->flags, BGP_PATH_UPA) &&
 		 CHECK_FLAG(info->flags, BGP_PATH_UPA_DROP)) {
 		if (BGP_DEBUG(upa, UPA))
 			zlog_debug("UPA route %pFX: setting blackhole nexthop (D-bit=1)", p);
-		zapi_route_set_blackhole(&api, BLACKHOLE_NULL);
+		zapi_route_set_blackhole(api, BLACKHOLE_NULL);
 	} else
-		api.nexthop_num = valid_nh_count;
+		api->nexthop_num = valid_nh_count;
 
-	SET_FLAG(api.message, ZAPI_MESSAGE_METRIC);
-	api.metric = metric;
+	SET_FLAG(api->message, ZAPI_MESSAGE_METRIC);
+	api->metric = metric;
 
 	if (tag) {
-		SET_FLAG(api.message, ZAPI_MESSAGE_TAG);
-		api.tag = tag;
+		SET_FLAG(api->message, ZAPI_MESSAGE_TAG);
+		api->tag = tag;
 	}
 
 	distance = bgp_distance_apply(p, info, table->afi, table->safi, bgp);
 	if (distance) {
-		SET_FLAG(api.message, ZAPI_MESSAGE_DISTANCE);
-		api.distance = distance;
+		SET_FLAG(api->message, ZAPI_MESSAGE_DISTANCE);
+		api->distance = distance;
 	}
 
 	if (bgp_debug_zebra(p)) {
 		zlog_debug("Tx route add %s (table id %u) %pFX metric %u tag %" ROUTE_TAG_PRI
 			   " count %d nhg %d",
-			   bgp->name_pretty, api.tableid, &api.prefix,
-			   api.metric, api.tag, api.nexthop_num, nhg_id);
-		bgp_debug_zebra_nh(&api);
+			   bgp->name_pretty, api->tableid, &api->prefix,
+			   api->metric, api->tag, api->nexthop_num, nhg_id);
+		bgp_debug_zebra_nh(api);
 
 		zlog_debug("%s: %pFX: announcing to zebra (recursion %sset)",
 			   __func__, p, (allow_recursion ? "" : "NOT "));
 	}
 
+	return true;
+}
+
+enum zclient_send_status bgp_zebra_announce_actual(struct bgp_dest *dest,
+						   struct bgp_path_info *info, struct bgp *bgp)
+{
+	struct zapi_route api;
+
+	if (!bgp_zebra_announce_make(dest, info, bgp, &api))
+		return ZCLIENT_SEND_SUCCESS;
+
 	return zclient_route_send(ZEBRA_ROUTE_ADD, bgp_zclient, &api);
 }
 
+/*
+ * Announcements from the FIFO only differing by their prefix, as the routes
+ * of a full table learnt from the same peer mostly do, are sent together
+ * in ZEBRA_ROUTE_ADD_BULK messages.
+ */
+static struct zapi_route_bulk *bgp_zebra_bulk;
+
+static enum zclient_send_status bgp_zebra_announce_bulk(struct bgp_dest *dest,
+							struct bgp_path_info *info,
+							struct bgp *bgp)
+{
+	struct zapi_route api;
+
+	if (!bgp_zebra_announce_make(dest, info, bgp, &api))
+		return ZCLIENT_SEND_SUCCESS;
+
+	return zclient_route_bulk_add(bgp_zclient, bgp_zebra_bulk, &api);
+}
+
 
 /* Announce all routes of a table to zebra */
 void bgp_zebra_announce_table(struct bgp *bgp, afi_t afi, safi_t safi)
@@ -1937,9 +1970,9 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 									   dest),
 							   dest->za_bgp_pi);
 			else
-				status = bgp_zebra_announce_actual(dest,
-								   dest->za_bgp_pi,
-								   table->bgp);
+				status = bgp_zebra_announce_bulk(dest,
+								 dest->za_bgp_pi,
+								 table->bgp);
 			UNSET_FLAG(dest->flags, BGP_NODE_SCHEDULE_FOR_INSTALL);
 		} else {
 			if (is_evpn)
@@ -1980,6 +2013,12 @@ static void bgp_handle_route_announcements_to_zebra(struct event *e)
 		count++;
 	}
 
+	/* what is still pending goes into the buffer of the zclient anyway */
+	if (bgp_zebra_bulk &&
+	    zclient_route_bulk_flush(bgp_zclient, bgp_zebra_bulk) ==
+		    ZCLIENT_SEND_BUFFERED)
+		status = ZCLIENT_SEND_BUFFERED;
+
 	if (status != ZCLIENT_SEND_BUFFERED &&
 	    (zebra_announce_count(&bm->zebra_announce_early_head) ||
 	     zebra_announce_count(&bm->zebra_announce_head)))
@@ -4632,6 +4671,7 @@ void bgp_zebra_init(struct event_loop *master, unsigned short instance)
 	bgp_zclient->zebra_capabilities = bgp_zebra_capabilities;
 	bgp_zclient->nexthop_update = bgp_nexthop_update;
 	bgp_zclient->instance = instance;
+	bgp_zebra_bulk = zapi_route_bulk_new();
 
 	/* Initialize special zclient for synchronous message exchanges. */
 	bgp_zclient_sync = zclient_new(master, &zclient_options_sync, NULL, 0);
@@ -4653,6 +4693,7 @@ void bgp_zebra_destroy(void)
 	zclient_stop(bgp_zclient);
 	zclient_free(bgp_zclient);
 	bgp_zclient = NULL;
+	zapi_route_bulk_free(&bgp_zebra_bulk);
 
 	if (bgp_zclient_sync == NULL)
 		return;
@@ -44,6 +44,7 @@
 #include "bgpd/bgp_conditional_adv.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_regex.h"
+#include "bgpd/bgp_rmap_cache.h"
 #include "bgpd/bgp_clist.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_packet.h"
@@ -70,6 +71,9 @@
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_parse.h"
+#include "bgpd/bgp_updgrp_build.h"
+#include "bgpd/bgp_soft_reconfig.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_labelpool.h"
@@ -952,6 +956,7 @@ void bgp_default_local_preference_set(struct bgp *bgp, uint32_t local_pref)
 		return;
 
 	bgp->default_local_pref = local_pref;
+	bgp_rmap_cache_invalidate();
 }
 
 void bgp_default_local_preference_unset(struct bgp *bgp)
@@ -960,6 +965,7 @@ void bgp_default_local_preference_unset(struct bgp *bgp)
 		return;
 
 	bgp->default_local_pref = BGP_DEFAULT_LOCAL_PREF;
+	bgp_rmap_cache_invalidate();
 }
 
 /* Local preference configuration.  */
@@ -1331,12 +1337,10 @@ enum bgp_peer_sort peer_sort_lookup(struct peer *peer)
 void bgp_peer_connection_buffers_free(struct peer_connection *connection)
 {
 	frr_with_mutex (&connection->io_mtx) {
-		if (connection->ibuf) {
-			stream_fifo_free(connection->ibuf);
-			connection->ibuf = NULL;
-		}
+		bgp_inq_free(&connection->ibuf);
 
 		if (connection->obuf) {
+			bgp_obuf_clean(connection->obuf);
 			stream_fifo_free(connection->obuf);
 			connection->obuf = NULL;
 		}
@@ -1351,6 +1355,7 @@ void bgp_peer_connection_buffers_free(struct peer_connection *connection)
 		stream_free(connection->curr);
 		connection->curr = NULL;
 	}
+	bgp_parse_job_free(&connection->curr_job);
 }
 
 void bgp_peer_connection_free(struct peer_connection **connection)
@@ -1397,7 +1402,7 @@ struct peer_connection *bgp_peer_connection_new(struct peer *peer, const union s
 	connection->peer = peer;
 	connection->fd = -1;
 
-	connection->ibuf = stream_fifo_new();
+	connection->ibuf = bgp_inq_new();
 	connection->obuf = stream_fifo_new();
 	pthread_mutex_init(&connection->io_mtx, NULL);
 
@@ -1422,6 +1427,9 @@ static void peer_free(struct peer *peer)
 
 	QOBJ_UNREG(peer);
 
+	/* the address may be reused by another peer */
+	bgp_rmap_cache_invalidate();
+
 	/* this /ought/ to have been done already through bgp_stop earlier,
 	 * but just to be sure..
 	 */
@@ -4457,6 +4465,7 @@ int bgp_get(struct bgp **bgp_val, as_t *as, const char *name,
 	 */
 	bgp_handle_socket(bgp, vrf, VRF_UNKNOWN, true);
 	listnode_add(bm->bgp, bgp);
+	vpn_leak_rt_index_invalidate();
 
 	if (IS_BGP_INST_KNOWN_TO_ZEBRA(bgp)) {
 		if (BGP_DEBUG(zebra, ZEBRA))
@@ -4662,6 +4671,7 @@ int bgp_delete(struct bgp *bgp)
 	vpn_leak_prechange(BGP_VPN_POLICY_DIR_TOVPN, AFI_IP6, bgp_default, bgp);
 
 	bgp_vpn_leak_unimport(bgp);
+	vpn_leak_to_vrf_queue_flush(bgp);
 
 	/*
 	 * Release SRv6 SIDs, like it's done in `vpn_leak_postchange()`
@@ -4698,10 +4708,8 @@ int bgp_delete(struct bgp *bgp)
 
 	hook_call(bgp_inst_delete, bgp);
 
-	FOREACH_AFI_SAFI (afi, safi)
-		event_cancel(&bgp->t_revalidate[afi][safi]);
-
 	event_cancel(&bgp->t_condition_check);
+	bgp_conditional_adv_finish(bgp);
 	event_cancel(&bgp->t_startup);
 	event_cancel(&bgp->t_maxmed_onstartup);
 	event_cancel(&bgp->t_update_delay);
@@ -4949,6 +4957,7 @@ int bgp_delete(struct bgp *bgp)
 		 * still referencing the struct bgp.
 		 */
 		listnode_delete(bm->bgp, bgp);
+		vpn_leak_rt_index_invalidate();
 		/* Free interfaces in this instance. */
 		bgp_if_finish(bgp);
 	}
@@ -4982,6 +4991,7 @@ int bgp_delete(struct bgp *bgp)
 				ecommunity_free(
 					&bgp->vpn_policy[afi].rtlist[dir]);
 		}
+		vpn_leak_rt_index_invalidate();
 	}
 
 	/* Clean BGP address family parameters */
@@ -5099,6 +5109,8 @@ void bgp_free(struct bgp *bgp)
 	bgp_meta_queue_free(bgp->mq);
 	bgp->mq = NULL;
 
+	bgp_dest_ids_finish(bgp);
+
 	XFREE(MTYPE_BGP, bgp);
 }
 
@@ -9692,6 +9704,10 @@ static void bgp_pthreads_init(void)
 	};
 	bgp_pth_io = frr_pthread_new(&io, "BGP I/O thread", "bgpd_io");
 	bgp_pth_ka = frr_pthread_new(&ka, "BGP Keepalives thread", "bgpd_ka");
+
+	bgp_parse_init();
+	bgp_updgrp_build_init();
+	bgp_soft_reconfig_init();
 }
 
 void bgp_pthreads_run(void)
@@ -9706,6 +9722,9 @@ void bgp_pthreads_run(void)
 
 void bgp_pthreads_finish(void)
 {
+	bgp_parse_finish();
+	bgp_updgrp_build_finish();
+	bgp_soft_reconfig_finish();
 	frr_pthread_stop_all();
 }
 
@@ -132,6 +132,9 @@ extern struct frr_pthread *bgp_pth_ka;
 /* FIFO list for peer connections */
 PREDECL_LIST(peer_connection_fifo);
 
+/* Input queue from the I/O pthread to the main pthread, see bgp_io.c */
+struct bgp_inq;
+
 /* BGP master for system wide configurations and variables.  */
 struct bgp_master {
 	/* BGP instance list.  */
@@ -216,6 +219,9 @@ struct bgp_master {
 #define BM_FLAG_GR_COMPLETE		 (1 << 7)
 #define BM_FLAG_IPV6_NO_AUTO_RA		 (1 << 8)
 #define BM_FLAG_CONFIG_LOADED		 (1 << 9)
+#define BM_FLAG_ADJ_OUT_COMPACT		 (1 << 10)
+#define BM_FLAG_OUTPUT_ZERO_COPY	 (1 << 11)
+#define BM_FLAG_DEFERRED_RECLAIM	 (1 << 12)
 
 #define BM_FLAG_GR_CONFIGURED (BM_FLAG_GR_RESTARTER | BM_FLAG_GR_DISABLED)
 
@@ -697,7 +703,6 @@ struct bgp {
 	/* BGP update delay on startup */
 	struct event *t_update_delay;
 	struct event *t_establish_wait;
-	struct event *t_revalidate[AFI_MAX][SAFI_MAX];
 
 	uint8_t update_delay_over;
 	uint8_t main_zebra_update_hold;
@@ -783,6 +788,8 @@ struct bgp {
 #define BGP_FLAG_INSTANCE_HIDDEN	 (1ULL << 39)
 /* Prohibit BGP from enabling IPv6 RA on interfaces */
 #define BGP_FLAG_IPV6_NO_AUTO_RA	    (1ULL << 40)
+/* Run bestpath comparisons over a compact candidate array */
+#define BGP_FLAG_BESTPATH_COMPACT (1ULL << 41)
 #define BGP_FLAG_LINK_LOCAL_CAPABILITY	    (1ULL << 43)
 #define BGP_FLAG_VRF_MAY_LISTEN		    (1ULL << 44)
 #define BGP_FLAG_SOFT_VERSION_CAPABILITY_NEW (1ULL << 45)
@@ -978,6 +985,9 @@ struct bgp {
 
 	struct bgp_addpath_bgp_data tx_addpath;
 
+	/* bgp_dest IDs, created with the first dest of each AFI/SAFI */
+	struct id_alloc *dest_ids[AFI_MAX][SAFI_MAX];
+
 #ifdef ENABLE_BGP_VNC
 	struct rfapi_cfg *rfapi_cfg;
 	struct rfapi *rfapi;
@@ -1117,6 +1127,11 @@ struct bgp {
 	uint32_t condition_check_period;
 	uint32_t condition_filter_count;
 	struct event *t_condition_check;
+	/* what condition-maps look at in each table, and the check triggered
+	 * by changes there, see bgp_conditional_adv.c
+	 */
+	struct bgp_cond_adv_table *cond_adv[AFI_MAX][SAFI_MAX];
+	struct event *t_condition_trigger;
 
 	/* Advertisement delay (ms) for suppress-fib-pending */
 	uint16_t suppress_fib_adv_delay;
@@ -1545,8 +1560,8 @@ struct peer_connection {
 #define PEER_THREAD_READS_ON  (1U << 1)
 
 	/* Packet receive and send buffer. */
-	pthread_mutex_t io_mtx;	  // guards ibuf, obuf
-	struct stream_fifo *ibuf; // packets waiting to be processed
+	pthread_mutex_t io_mtx;	  // guards ibuf producer side, obuf
+	struct bgp_inq *ibuf;	  // packets waiting to be processed
 	struct stream_fifo *obuf; // packets waiting to be written
 
 	struct ringbuf *ibuf_work; // WiP buffer used by bgp_read() only
@@ -1589,6 +1604,9 @@ struct peer_connection {
 
 	struct stream *curr;
 
+	/* Parse worker job for curr */
+	struct bgp_parse_job *curr_job;
+
 	/*
 	 * Timestamp of the last outgoing messge to the peer.
 	 * This timestamp is written on multiple threads and read
@@ -2984,6 +3002,10 @@ extern enum asnotation_mode bgp_get_asnotation(struct bgp *bgp);
 extern void bgp_route_map_terminate(void);
 
 extern bool bgp_route_map_has_extcommunity_rt(const struct route_map *map);
+extern bool bgp_route_map_attr_only(struct route_map *map, int depth);
+extern bool bgp_route_map_prefix_lists(struct route_map *map,
+				       struct prefix_list **plists,
+				       unsigned int *nplists, unsigned int max);
 
 extern int peer_cmp(struct peer *p1, struct peer *p2);
 
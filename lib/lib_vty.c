@@ -81,6 +81,56 @@ static int show_memory_mallinfo(struct vty *vty)
 }
 #endif /* HAVE_MALLINFO */
 
+static int qmem_slab_walker(void *arg, const struct qmem_slab_stats *st)
+{
+	struct vty *vty = arg;
+	char size[32], buf[MTYPE_MEMSTR_LEN];
+	size_t in_use = st->used - st->cached;
+
+	if (st->size)
+		snprintf(size, sizeof(size), "%zu", st->size);
+	else
+		snprintf(size, sizeof(size), "large");
+
+	vty_out(vty, "  %-6s %8zu %10s %10zu %10zu %10zu %5zu%%\n", size,
+		st->slabs, mtype_memstr(buf, sizeof(buf), st->bytes),
+		st->objects, in_use, st->cached,
+		st->objects ? in_use * 100 / st->objects : 0);
+	return 0;
+}
+
+static int qmem_slab_walker_first(void *arg, const struct qmem_slab_stats *st)
+{
+	return 1;
+}
+
+static void show_memory_slabs(struct vty *vty)
+{
+	/* nothing for the daemons without slab mtypes */
+	if (!qmem_slab_walk(qmem_slab_walker_first, NULL))
+		return;
+
+	vty_out(vty, "Slab allocator statistics:\n");
+	vty_out(vty, "  %-6s %8s %10s %10s %10s %10s %6s\n", "Size", "Slabs",
+		"Bytes", "Objects", "In use", "Cached", "Used");
+	qmem_slab_walk(qmem_slab_walker, vty);
+}
+
+static int qmem_slab_walker_json(void *arg, const struct qmem_slab_stats *st)
+{
+	struct json_object *jslabs = arg;
+	struct json_object *jslab = json_object_new_object();
+
+	json_object_int_add(jslab, "size", st->size);
+	json_object_int_add(jslab, "slabs", st->slabs);
+	json_object_int_add(jslab, "bytes", st->bytes);
+	json_object_int_add(jslab, "objects", st->objects);
+	json_object_int_add(jslab, "inUse", st->used - st->cached);
+	json_object_int_add(jslab, "cached", st->cached);
+	json_object_array_add(jslabs, jslab);
+	return 0;
+}
+
 struct qmem_walk_json_arg {
 	struct json_object *json;
 	struct json_object *current_group;
@@ -174,6 +224,7 @@ DEFUN_NOSH (show_memory,
 	bool uj = use_json(argc, argv);
 	struct json_object *json = NULL;
 	struct qmem_walk_json_arg jarg;
+	struct json_object *jslabs;
 
 	if (uj) {
 		json = json_object_new_object();
@@ -182,11 +233,18 @@ DEFUN_NOSH (show_memory,
 		jarg.current_group = NULL;
 		qmem_walk(qmem_walker_json, &jarg);
 
+		if (qmem_slab_walk(qmem_slab_walker_first, NULL)) {
+			jslabs = json_object_new_array();
+			qmem_slab_walk(qmem_slab_walker_json, jslabs);
+			json_object_object_add(json, "slabAllocator", jslabs);
+		}
+
 		vty_json(vty, json);
 	} else {
 #ifdef HAVE_MALLINFO
 		show_memory_mallinfo(vty);
 #endif /* HAVE_MALLINFO */
+		show_memory_slabs(vty);
 
 		qmem_walk(qmem_walker, vty);
 	}
@@ -6,6 +6,7 @@
 #include <zebra.h>
 
 #include <stdlib.h>
+#include <sys/mman.h>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
@@ -18,6 +19,7 @@
 
 #include "memory.h"
 #include "log.h"
+#include "typesafe.h"
 #include "libfrr_trace.h"
 
 #if defined(HAVE_MALLOC_SIZE) && !defined(HAVE_MALLOC_USABLE_SIZE)
@@ -33,6 +35,443 @@ DEFINE_MTYPE(LIB, TMP, "Temporary memory");
 DEFINE_MTYPE(LIB, TMP_TTABLE, "Temporary memory for TTABLE");
 DEFINE_MTYPE(LIB, BITFIELD, "Bitfield memory");
 
+/*
+ * Slab allocator, for the mtypes defined with DEFINE_MTYPE_SLAB.
+ *
+ * Objects are rounded up to a size class and carved out of slabs that are
+ * aligned on their size, so that masking the address of an object gives its
+ * slab, and from there its size: objects have no header of their own.  Each
+ * pthread keeps a few free objects of each class, and only takes the lock of
+ * the class to move a batch of them from or to the slabs.  Slabs that empty
+ * are unmapped, but for a spare one per class.  Larger objects get a slab to
+ * themselves, which is fine as long as they are rare.
+ *
+ * Under AddressSanitizer everything comes from malloc, for it to check.
+ */
+#if defined(__SANITIZE_ADDRESS__)
+#define MEMSLAB_DISABLED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEMSLAB_DISABLED 1
+#endif
+#endif
+#ifndef MEMSLAB_DISABLED
+#define MEMSLAB_DISABLED 0
+#endif
+
+#define MEMSLAB_SIZE	(64 * 1024)
+#define MEMSLAB_GRAIN	16
+#define MEMSLAB_MAX	1024
+#define MEMSLAB_CLASSES (MEMSLAB_MAX / MEMSLAB_GRAIN)
+#define MEMSLAB_LARGE	MEMSLAB_CLASSES
+#define MEMSLAB_MAGIC	0x51ab51abU
+/* free objects a pthread keeps per class, and how many it moves at once */
+#define MEMSLAB_CACHE	64
+#define MEMSLAB_BATCH	(MEMSLAB_CACHE / 2)
+
+PREDECL_DLIST(memslabs);
+
+struct memslab_obj {
+	struct memslab_obj *next;
+};
+
+struct memslab {
+	uint32_t magic;
+	unsigned int class;
+	/* objects out of the slab, in use or in the cache of a pthread */
+	unsigned int used;
+	unsigned int capacity;
+	struct memslab_obj *free;
+	/* objects from here on were never handed out */
+	char *fresh;
+	/* size of the mapping */
+	size_t len;
+
+	struct memslabs_item itm;
+};
+
+DECLARE_DLIST(memslabs, struct memslab, itm);
+
+#define MEMSLAB_HDR ((sizeof(struct memslab) + 63) & ~(size_t)63)
+
+struct memslab_class {
+	pthread_mutex_t mtx;
+
+	/* slabs with objects left, and an empty one not to unmap yet */
+	struct memslabs_head partial;
+	struct memslab *spare;
+
+	size_t slabs;
+	size_t objects;
+	size_t used;
+};
+
+static struct memslab_class memslab_classes[MEMSLAB_CLASSES];
+static atomic_size_t memslab_large_count;
+static atomic_size_t memslab_large_bytes;
+
+PREDECL_DLIST(memslab_caches);
+
+struct memslab_cache {
+	struct memslab_obj *objs[MEMSLAB_CLASSES];
+	/* only written by the pthread, read for the statistics */
+	atomic_uint count[MEMSLAB_CLASSES];
+
+	struct memslab_caches_item itm;
+};
+
+DECLARE_DLIST(memslab_caches, struct memslab_cache, itm);
+
+static pthread_mutex_t memslab_caches_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct memslab_caches_head memslab_caches;
+static pthread_key_t memslab_cache_key;
+
+#ifdef __OpenBSD__
+static inline struct memslab_cache *memslab_cache_tls_get(void)
+{
+	return pthread_getspecific(memslab_cache_key);
+}
+
+static inline void memslab_cache_tls_set(struct memslab_cache *mc)
+{
+}
+#else
+# ifndef thread_local
+#  define thread_local __thread
+# endif
+
+static thread_local struct memslab_cache *memslab_cache_var
+	__attribute__((tls_model("initial-exec")));
+
+static inline struct memslab_cache *memslab_cache_tls_get(void)
+{
+	return memslab_cache_var;
+}
+
+static inline void memslab_cache_tls_set(struct memslab_cache *mc)
+{
+	memslab_cache_var = mc;
+}
+#endif
+
+static inline bool mt_slab(struct memtype *mt)
+{
+	return !MEMSLAB_DISABLED && mt->slab;
+}
+
+static inline size_t memslab_class_size(unsigned int class)
+{
+	return (class + 1) * MEMSLAB_GRAIN;
+}
+
+static inline struct memslab *memslab_of(void *ptr)
+{
+	struct memslab *slab;
+
+	slab = (struct memslab *)((uintptr_t)ptr & ~(uintptr_t)(MEMSLAB_SIZE - 1));
+	assert(slab->magic == MEMSLAB_MAGIC);
+	return slab;
+}
+
+static inline size_t memslab_usable_size(void *ptr)
+{
+	struct memslab *slab = memslab_of(ptr);
+
+	if (slab->class == MEMSLAB_LARGE)
+		return slab->len - MEMSLAB_HDR;
+	return memslab_class_size(slab->class);
+}
+
+static inline void memslab_cache_count(struct memslab_cache *mc,
+				       unsigned int class, int delta)
+{
+	unsigned int count;
+
+	count = atomic_load_explicit(&mc->count[class], memory_order_relaxed);
+	atomic_store_explicit(&mc->count[class], count + delta,
+			      memory_order_relaxed);
+}
+
+/* @len bytes, a multiple of MEMSLAB_SIZE, aligned on MEMSLAB_SIZE */
+static struct memslab *memslab_map(size_t len, const char *name)
+{
+	char *p, *aligned;
+	size_t lead;
+
+	p = mmap(NULL, len + MEMSLAB_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		memory_oom(len, name);
+
+	aligned = (char *)(((uintptr_t)p + MEMSLAB_SIZE - 1) &
+			   ~(uintptr_t)(MEMSLAB_SIZE - 1));
+	lead = aligned - p;
+	if (lead)
+		munmap(p, lead);
+	munmap(aligned + len, MEMSLAB_SIZE - lead);
+
+	return (struct memslab *)aligned;
+}
+
+/* with the lock of the class held */
+static struct memslab *memslab_new(unsigned int class, const char *name)
+{
+	struct memslab_class *cls = &memslab_classes[class];
+	struct memslab *slab;
+
+	slab = cls->spare;
+	cls->spare = NULL;
+	if (!slab) {
+		slab = memslab_map(MEMSLAB_SIZE, name);
+		cls->slabs++;
+		cls->objects += (MEMSLAB_SIZE - MEMSLAB_HDR) /
+				memslab_class_size(class);
+	}
+
+	slab->magic = MEMSLAB_MAGIC;
+	slab->class = class;
+	slab->used = 0;
+	slab->capacity = (MEMSLAB_SIZE - MEMSLAB_HDR) /
+			 memslab_class_size(class);
+	slab->free = NULL;
+	slab->fresh = (char *)slab + MEMSLAB_HDR;
+	slab->len = MEMSLAB_SIZE;
+
+	memslabs_add_head(&cls->partial, slab);
+	return slab;
+}
+
+static void memslab_refill(struct memslab_cache *mc, unsigned int class,
+			   const char *name)
+{
+	struct memslab_class *cls = &memslab_classes[class];
+	size_t size = memslab_class_size(class);
+	struct memslab_obj *obj;
+	struct memslab *slab;
+	unsigned int n;
+
+	pthread_mutex_lock(&cls->mtx);
+	for (n = 0; n < MEMSLAB_BATCH; n++) {
+		slab = memslabs_first(&cls->partial);
+		if (!slab)
+			slab = memslab_new(class, name);
+
+		if (slab->free) {
+			obj = slab->free;
+			slab->free = obj->next;
+		} else {
+			obj = (struct memslab_obj *)slab->fresh;
+			slab->fresh += size;
+		}
+		if (++slab->used == slab->capacity)
+			memslabs_del(&cls->partial, slab);
+
+		obj->next = mc->objs[class];
+		mc->objs[class] = obj;
+	}
+	cls->used += n;
+	pthread_mutex_unlock(&cls->mtx);
+
+	memslab_cache_count(mc, class, n);
+}
+
+/* Give up to @n of the objects a pthread keeps back to their slabs */
+static void memslab_flush(struct memslab_cache *mc, unsigned int class,
+			  unsigned int n)
+{
+	struct memslab_class *cls = &memslab_classes[class];
+	struct memslab_obj *obj;
+	struct memslab *slab;
+	unsigned int done = 0;
+
+	pthread_mutex_lock(&cls->mtx);
+	while (done < n && (obj = mc->objs[class])) {
+		mc->objs[class] = obj->next;
+		done++;
+
+		slab = memslab_of(obj);
+		if (slab->used-- == slab->capacity)
+			memslabs_add_head(&cls->partial, slab);
+		obj->next = slab->free;
+		slab->free = obj;
+
+		if (slab->used)
+			continue;
+
+		memslabs_del(&cls->partial, slab);
+		if (!cls->spare) {
+			cls->spare = slab;
+			continue;
+		}
+		cls->slabs--;
+		cls->objects -= slab->capacity;
+		munmap(slab, slab->len);
+	}
+	cls->used -= done;
+	pthread_mutex_unlock(&cls->mtx);
+
+	memslab_cache_count(mc, class, -(int)done);
+}
+
+static void memslab_cache_fini(void *arg)
+{
+	struct memslab_cache *mc = arg;
+	unsigned int class;
+
+	for (class = 0; class < MEMSLAB_CLASSES; class++)
+		memslab_flush(mc, class, UINT_MAX);
+
+	pthread_mutex_lock(&memslab_caches_mtx);
+	memslab_caches_del(&memslab_caches, mc);
+	pthread_mutex_unlock(&memslab_caches_mtx);
+
+	memslab_cache_tls_set(NULL);
+	free(mc);
+}
+
+static struct memslab_cache *memslab_cache_get(void)
+{
+	struct memslab_cache *mc = memslab_cache_tls_get();
+
+	if (__builtin_expect(mc != NULL, 1))
+		return mc;
+
+	mc = calloc(1, sizeof(*mc));
+	if (!mc)
+		memory_oom(sizeof(*mc), "slab cache");
+
+	pthread_mutex_lock(&memslab_caches_mtx);
+	memslab_caches_add_tail(&memslab_caches, mc);
+	pthread_mutex_unlock(&memslab_caches_mtx);
+
+	/* for the cache to be given back when the pthread exits */
+	pthread_setspecific(memslab_cache_key, mc);
+	memslab_cache_tls_set(mc);
+	return mc;
+}
+
+static void memslab_init(void) __attribute__((_CONSTRUCTOR(900)));
+static void memslab_init(void)
+{
+	unsigned int class;
+
+	for (class = 0; class < MEMSLAB_CLASSES; class++) {
+		pthread_mutex_init(&memslab_classes[class].mtx, NULL);
+		memslabs_init(&memslab_classes[class].partial);
+	}
+	memslab_caches_init(&memslab_caches);
+	pthread_key_create(&memslab_cache_key, memslab_cache_fini);
+}
+
+static void *memslab_alloc_large(size_t size, const char *name)
+{
+	struct memslab *slab;
+	size_t len;
+
+	len = (MEMSLAB_HDR + size + MEMSLAB_SIZE - 1) &
+	      ~(size_t)(MEMSLAB_SIZE - 1);
+	slab = memslab_map(len, name);
+	slab->magic = MEMSLAB_MAGIC;
+	slab->class = MEMSLAB_LARGE;
+	slab->used = slab->capacity = 1;
+	slab->len = len;
+
+	atomic_fetch_add_explicit(&memslab_large_count, 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&memslab_large_bytes, len,
+				  memory_order_relaxed);
+	return (char *)slab + MEMSLAB_HDR;
+}
+
+static void *memslab_alloc(struct memtype *mt, size_t size)
+{
+	struct memslab_cache *mc;
+	struct memslab_obj *obj;
+	unsigned int class;
+
+	if (size > MEMSLAB_MAX)
+		return memslab_alloc_large(size, mt->name);
+
+	class = size ? (size - 1) / MEMSLAB_GRAIN : 0;
+	mc = memslab_cache_get();
+	if (!mc->objs[class])
+		memslab_refill(mc, class, mt->name);
+
+	obj = mc->objs[class];
+	mc->objs[class] = obj->next;
+	memslab_cache_count(mc, class, -1);
+	return obj;
+}
+
+static void memslab_free(void *ptr)
+{
+	struct memslab *slab = memslab_of(ptr);
+	struct memslab_obj *obj = ptr;
+	struct memslab_cache *mc;
+	unsigned int class = slab->class;
+
+	if (class == MEMSLAB_LARGE) {
+		atomic_fetch_sub_explicit(&memslab_large_count, 1,
+					  memory_order_relaxed);
+		atomic_fetch_sub_explicit(&memslab_large_bytes, slab->len,
+					  memory_order_relaxed);
+		munmap(slab, slab->len);
+		return;
+	}
+
+	mc = memslab_cache_get();
+	if (atomic_load_explicit(&mc->count[class], memory_order_relaxed) >=
+	    MEMSLAB_CACHE)
+		memslab_flush(mc, class, MEMSLAB_BATCH);
+
+	obj->next = mc->objs[class];
+	mc->objs[class] = obj;
+	memslab_cache_count(mc, class, 1);
+}
+
+int qmem_slab_walk(qmem_slab_walk_fn *func, void *arg)
+{
+	struct qmem_slab_stats st;
+	struct memslab_class *cls;
+	struct memslab_cache *mc;
+	unsigned int class;
+	int rv;
+
+	for (class = 0; class < MEMSLAB_CLASSES; class++) {
+		cls = &memslab_classes[class];
+
+		memset(&st, 0, sizeof(st));
+		st.size = memslab_class_size(class);
+		pthread_mutex_lock(&cls->mtx);
+		st.slabs = cls->slabs;
+		st.objects = cls->objects;
+		st.used = cls->used;
+		pthread_mutex_unlock(&cls->mtx);
+		if (!st.slabs)
+			continue;
+		st.bytes = st.slabs * MEMSLAB_SIZE;
+
+		pthread_mutex_lock(&memslab_caches_mtx);
+		frr_each (memslab_caches, &memslab_caches, mc)
+			st.cached += atomic_load_explicit(&mc->count[class],
+							  memory_order_relaxed);
+		pthread_mutex_unlock(&memslab_caches_mtx);
+
+		if ((rv = func(arg, &st)))
+			return rv;
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.slabs = atomic_load_explicit(&memslab_large_count,
+					memory_order_relaxed);
+	st.bytes = atomic_load_explicit(&memslab_large_bytes,
+					memory_order_relaxed);
+	st.objects = st.used = st.slabs;
+	if (st.slabs)
+		return func(arg, &st);
+	return 0;
+}
+
 static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 {
 	size_t current;
@@ -58,7 +497,8 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 				      memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_slab(mt) ? memslab_usable_size(ptr)
+				      : malloc_usable_size(ptr);
 
 	current = mallocsz + atomic_fetch_add_explicit(&mt->total, mallocsz,
 						       memory_order_relaxed);
@@ -80,7 +520,8 @@ static inline void mt_count_free(struct memtype *mt, void *ptr)
 	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = mt_slab(mt) ? memslab_usable_size(ptr)
+				      : malloc_usable_size(ptr);
 
 	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
 #endif
@@ -103,16 +544,39 @@ static inline void *mt_checkalloc(struct memtype *mt, void *ptr, size_t size)
 
 void *qmalloc(struct memtype *mt, size_t size)
 {
+	if (mt_slab(mt))
+		return mt_checkalloc(mt, memslab_alloc(mt, size), size);
 	return mt_checkalloc(mt, malloc(size), size);
 }
 
 void *qcalloc(struct memtype *mt, size_t size)
 {
+	void *ptr;
+
+	if (mt_slab(mt)) {
+		ptr = memslab_alloc(mt, size);
+		memset(ptr, 0, size);
+		return mt_checkalloc(mt, ptr, size);
+	}
 	return mt_checkalloc(mt, calloc(size, 1), size);
 }
 
+static void *memslab_realloc(struct memtype *mt, void *ptr, size_t size)
+{
+	void *new = memslab_alloc(mt, size);
+
+	if (ptr) {
+		memcpy(new, ptr, MIN(size, memslab_usable_size(ptr)));
+		mt_count_free(mt, ptr);
+		memslab_free(ptr);
+	}
+	return mt_checkalloc(mt, new, size);
+}
+
 void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 {
+	if (mt_slab(mt))
+		return memslab_realloc(mt, ptr, size);
 	if (ptr)
 		mt_count_free(mt, ptr);
 	return mt_checkalloc(mt, ptr ? realloc(ptr, size) : malloc(size), size);
@@ -120,6 +584,12 @@ void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 
 void *qstrdup(struct memtype *mt, const char *str)
 {
+	size_t size;
+
+	if (str && mt_slab(mt)) {
+		size = strlen(str) + 1;
+		return memcpy(qmalloc(mt, size), str, size);
+	}
 	return str ? mt_checkalloc(mt, strdup(str), strlen(str) + 1) : NULL;
 }
 
@@ -131,9 +601,14 @@ void qcountfree(struct memtype *mt, void *ptr)
 
 void qfree(struct memtype *mt, void *ptr)
 {
-	if (ptr)
-		mt_count_free(mt, ptr);
-	free(ptr);
+	if (!ptr)
+		return;
+
+	mt_count_free(mt, ptr);
+	if (mt_slab(mt))
+		memslab_free(ptr);
+	else
+		free(ptr);
 }
 
 int qmem_walk(qmem_walk_fn *func, void *arg)
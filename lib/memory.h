@@ -25,6 +25,8 @@ struct memtype {
 	atomic_size_t size;
 	atomic_size_t total;
 	atomic_size_t max_size;
+	/* allocated from the slabs rather than malloc, see DEFINE_MTYPE_SLAB */
+	bool slab;
 };
 
 struct memgroup {
@@ -98,13 +100,14 @@ struct memgroup {
 	extern struct memtype MTYPE_##name[1]                                  \
 	/* end */
 
-#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+#define _DEFINE_MTYPE(group, mname, attr, desc, ...)                           \
 	attr struct memtype MTYPE_##mname[1] _DATA_SECTION("mtypes") = { {     \
 		.name = desc,                                                  \
 		.next = NULL,                                                  \
 		.n_alloc = 0,                                                  \
 		.size = 0,                                                     \
 		.ref = NULL,                                                   \
+		__VA_ARGS__                                                    \
 	} };                                                                   \
 	static void _mtinit_##mname(void) __attribute__((_CONSTRUCTOR(1001))); \
 	static void _mtinit_##mname(void)                                      \
@@ -124,6 +127,10 @@ struct memgroup {
 	}                                                                      \
 	MACRO_REQUIRE_SEMICOLON() /* end */
 
+#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+	_DEFINE_MTYPE(group, mname, attr, desc, )                              \
+	/* end */
+
 #define DEFINE_MTYPE(group, name, desc)                                        \
 	DEFINE_MTYPE_ATTR(group, name, , desc)                                 \
 	/* end */
@@ -132,6 +139,19 @@ struct memgroup {
 	DEFINE_MTYPE_ATTR(group, name, static, desc)                           \
 	/* end */
 
+/* For the small objects allocated and freed by the million: these come from
+ * slabs of objects of the same size class, through a cache per pthread, with
+ * no header per object.  As with any other mtype, memory must be freed with
+ * the mtype it was allocated with, and never with free().
+ */
+#define DEFINE_MTYPE_SLAB(group, name, desc)                                   \
+	_DEFINE_MTYPE(group, name, , desc, .slab = true)                       \
+	/* end */
+
+#define DEFINE_MTYPE_STATIC_SLAB(group, name, desc)                            \
+	_DEFINE_MTYPE(group, name, static, desc, .slab = true)                 \
+	/* end */
+
 /* clang-format on */
 
 DECLARE_MGROUP(LIB);
@@ -173,6 +193,24 @@ static inline size_t mtype_stats_alloc(struct memtype *mt)
  * last value from qmem_walk_fn. */
 typedef int qmem_walk_fn(void *arg, struct memgroup *mg, struct memtype *mt);
 extern int qmem_walk(qmem_walk_fn *func, void *arg);
+
+/* Slabs of one size class, or of objects too large for any (size == 0) */
+struct qmem_slab_stats {
+	size_t size;
+	size_t slabs;
+	size_t bytes;
+	/* objects the slabs have room for, out of them, and idle in the cache
+	 * of a pthread - so in use are used - cached
+	 */
+	size_t objects;
+	size_t used;
+	size_t cached;
+};
+
+/* Only calls for the size classes with slabs.  Same return value as above */
+typedef int qmem_slab_walk_fn(void *arg, const struct qmem_slab_stats *st);
+extern int qmem_slab_walk(qmem_slab_walk_fn *func, void *arg);
+
 extern int log_memstats(const char *daemon_name, bool enabled);
 
 extern FRR_NORETURN void memory_oom(size_t size, const char *name);
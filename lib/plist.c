@@ -767,11 +767,10 @@ static int prefix_list_entry_match(struct prefix_list_entry *pentry,
 	return 1;
 }
 
-enum prefix_list_type prefix_list_apply_ext(
-	struct prefix_list *plist,
-	const struct prefix_list_entry **which,
-	union prefixconstptr object,
-	bool address_mode)
+/* the entry that decides for @object, without counting a hit on it */
+static enum prefix_list_type
+prefix_list_match(struct prefix_list *plist, struct prefix_list_entry **which,
+		  union prefixconstptr object, bool address_mode)
 {
 	struct prefix_list_entry *pentry, *pbest = NULL;
 
@@ -781,17 +780,13 @@ enum prefix_list_type prefix_list_apply_ext(
 	size_t validbits = p->prefixlen;
 	struct pltrie_table *table;
 
-	if (plist == NULL) {
-		if (which)
-			*which = NULL;
+	*which = NULL;
+
+	if (plist == NULL)
 		return PREFIX_DENY;
-	}
 
-	if (plist->count == 0) {
-		if (which)
-			*which = NULL;
+	if (plist->count == 0)
 		return PREFIX_PERMIT;
-	}
 
 	depth = plist->master->trie_depth;
 	table = plist->trie;
@@ -827,20 +822,39 @@ enum prefix_list_type prefix_list_apply_ext(
 		break;
 	}
 
-	if (which) {
-		if (pbest)
-			*which = pbest;
-		else
-			*which = NULL;
-	}
+	*which = pbest;
 
 	if (pbest == NULL)
 		return PREFIX_DENY;
 
-	pbest->hitcnt++;
 	return pbest->type;
 }
 
+enum prefix_list_type prefix_list_apply_ext(
+	struct prefix_list *plist,
+	const struct prefix_list_entry **which,
+	union prefixconstptr object,
+	bool address_mode)
+{
+	struct prefix_list_entry *pbest;
+	enum prefix_list_type ret;
+
+	ret = prefix_list_match(plist, &pbest, object, address_mode);
+	if (which)
+		*which = pbest;
+	if (pbest)
+		atomic_fetch_add_explicit(&pbest->hitcnt, 1, memory_order_relaxed);
+	return ret;
+}
+
+enum prefix_list_type prefix_list_apply_nohit(struct prefix_list *plist,
+					      union prefixconstptr object)
+{
+	struct prefix_list_entry *pbest;
+
+	return prefix_list_match(plist, &pbest, object, false);
+}
+
 static void __attribute__((unused)) prefix_list_print(struct prefix_list *plist)
 {
 	struct prefix_list_entry *pentry;
@@ -1026,7 +1040,8 @@ static void vty_show_prefix_entry(struct vty *vty, json_object *json, afi_t afi,
 				    || dtype == sequential_display) {
 					json_object_int_add(json_entry,
 							    "hitCount",
-							    pentry->hitcnt);
+							    atomic_load_explicit(&pentry->hitcnt,
+										 memory_order_relaxed));
 					json_object_int_add(json_entry,
 							    "referenceCount",
 							    pentry->refcnt);
@@ -1058,7 +1073,9 @@ static void vty_show_prefix_entry(struct vty *vty, json_object *json, afi_t afi,
 				    || dtype == sequential_display)
 					vty_out(vty,
 						" (hit count: %ld, refcount: %ld)",
-						pentry->hitcnt, pentry->refcnt);
+						atomic_load_explicit(&pentry->hitcnt,
+								     memory_order_relaxed),
+						pentry->refcnt);
 
 				vty_out(vty, "\n");
 			}
@@ -1140,7 +1157,8 @@ static int vty_show_prefix_list_prefix(struct vty *vty, afi_t afi,
 
 		if (type == normal_display || type == first_match_display)
 			if (prefix_list_entry_match(pentry, &p, false)) {
-				pentry->hitcnt++;
+				atomic_fetch_add_explicit(&pentry->hitcnt, 1,
+							  memory_order_relaxed);
 				match = 1;
 			}
 
@@ -1170,7 +1188,9 @@ static int vty_show_prefix_list_prefix(struct vty *vty, afi_t afi,
 			if (type == normal_display
 			    || type == first_match_display)
 				vty_out(vty, " (hit count: %ld, refcount: %ld)",
-					pentry->hitcnt, pentry->refcnt);
+					atomic_load_explicit(&pentry->hitcnt,
+							     memory_order_relaxed),
+					pentry->refcnt);
 
 			vty_out(vty, "\n");
 
@@ -1198,7 +1218,8 @@ static int vty_clear_prefix_list(struct vty *vty, afi_t afi, const char *name,
 		frr_each (plist, &master->str, plist)
 			for (pentry = plist->head; pentry;
 			     pentry = pentry->next)
-				pentry->hitcnt = 0;
+				atomic_store_explicit(&pentry->hitcnt, 0,
+						      memory_order_relaxed);
 	} else {
 		plist = prefix_list_lookup(afi, name);
 		if (!plist) {
@@ -1218,9 +1239,11 @@ static int vty_clear_prefix_list(struct vty *vty, afi_t afi, const char *name,
 			if (prefix) {
 				if (pentry->prefix.family == p.family
 				    && prefix_match(&pentry->prefix, &p))
-					pentry->hitcnt = 0;
+					atomic_store_explicit(&pentry->hitcnt, 0,
+							      memory_order_relaxed);
 			} else
-				pentry->hitcnt = 0;
+				atomic_store_explicit(&pentry->hitcnt, 0,
+						      memory_order_relaxed);
 		}
 	}
 	return CMD_SUCCESS;
@@ -62,6 +62,14 @@ prefix_list_apply_ext(struct prefix_list *plist,
 #define prefix_list_apply(A, B) \
 	prefix_list_apply_ext((A), NULL, (B), false)
 
+/*
+ * Like prefix_list_apply(), but without counting a hit on the entry that
+ * matches, for callers that only check what the list would permit rather
+ * than apply it.
+ */
+extern enum prefix_list_type prefix_list_apply_nohit(struct prefix_list *plist,
+						     union prefixconstptr prefix);
+
 extern struct prefix_list *prefix_bgp_orf_lookup(afi_t afi, const char *name);
 extern struct stream *prefix_bgp_orf_entry(struct stream *s, struct prefix_list *plist,
 					   uint8_t init_flag, uint8_t permit_flag,
@@ -45,7 +45,8 @@ struct prefix_list_entry {
 	struct prefix prefix;
 
 	unsigned long refcnt;
-	unsigned long hitcnt;
+	/* also counted from other pthreads than the main one */
+	_Atomic unsigned long hitcnt;
 
 	struct prefix_list *pl;
 
@@ -20,6 +20,7 @@
 #include "table.h"
 #include "json.h"
 #include "jhash.h"
+#include "frr_pthread.h"
 
 #include "lib/routemap_clippy.c"
 
@@ -31,6 +32,7 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str");
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_PROG, "Route map program");
 
 DEFINE_QOBJ_TYPE(route_map_index);
 DEFINE_QOBJ_TYPE(route_map);
@@ -88,6 +90,7 @@ static void route_map_del_plist_entries(afi_t afi,
 
 static struct hash *route_map_get_dep_hash(route_map_event_t event);
 static void route_map_free_map(struct route_map *map);
+static void route_map_prog_free(struct route_map_prog *prog);
 
 struct route_map_match_set_hooks rmap_match_set_hook;
 
@@ -672,6 +675,7 @@ static struct route_map *route_map_add(const char *name)
 		route_map_free_map(exist);
 	}
 	hash_get(route_map_master_hash, map, hash_alloc_intern);
+	route_map_compiled_invalidate();
 
 	/* Add new entry to the head of the list to match how it is added in the
 	 * hash table. This is to ensure that if the same route-map has been
@@ -742,6 +746,7 @@ static void route_map_free_map(struct route_map *map)
 
 	route_table_finish(map->ipv4_prefix_table);
 	route_table_finish(map->ipv6_prefix_table);
+	route_map_prog_free(map->prog);
 
 	hash_release(route_map_master_hash, map);
 	XFREE(MTYPE_ROUTE_MAP_NAME, map->name);
@@ -763,6 +768,7 @@ void route_map_delete(struct route_map *map)
 	/* Clear all dependencies */
 	route_map_clear_all_references(name);
 	map->deleted = true;
+	route_map_compiled_invalidate();
 	/* Execute deletion hook. */
 	if (route_map_master.delete_hook) {
 		(*route_map_master.delete_hook)(name);
@@ -957,20 +963,34 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map,
 
 		json_rules = json_object_new_array();
 		json_object_int_add(json_rmap, "invoked",
-				    map->applied - map->applied_clear);
+				    atomic_load_explicit(&map->applied,
+							 memory_order_relaxed) -
+					    map->applied_clear);
 		json_object_boolean_add(json_rmap, "disabledOptimization",
 					map->optimization_disabled);
 		json_object_boolean_add(json_rmap, "processedChange",
 					map->to_be_processed);
 		json_object_object_add(json_rmap, "rules", json_rules);
-		json_object_int_add(json_rmap, "cpuTimeMS", map->cputime / 1000);
+		json_object_int_add(json_rmap, "cpuTimeMS",
+				    atomic_load_explicit(&map->cputime, memory_order_relaxed) /
+					    1000);
+		json_object_int_add(json_rmap, "cacheHits", map->cache_hits);
+		json_object_int_add(json_rmap, "cacheMisses", map->cache_misses);
 	} else {
 		vty_out(vty,
 			"route-map: %s Invoked: %" PRIu64
 			" (%zu milliseconds total) Optimization: %s Processed Change: %s\n",
-			map->name, map->applied - map->applied_clear, map->cputime / 1000,
+			map->name,
+			atomic_load_explicit(&map->applied, memory_order_relaxed) -
+				map->applied_clear,
+			atomic_load_explicit(&map->cputime, memory_order_relaxed) / 1000,
 			map->optimization_disabled ? "disabled" : "enabled",
 			map->to_be_processed ? "true" : "false");
+		if (map->cache_hits || map->cache_misses)
+			vty_out(vty,
+				" Results cache: %" PRIu64 " hits, %" PRIu64
+				" misses\n",
+				map->cache_hits, map->cache_misses);
 	}
 
 	for (index = map->head; index; index = index->next) {
@@ -988,9 +1008,13 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map,
 			json_object_string_add(json_rule, "type",
 					       route_map_type_str(index->type));
 			json_object_int_add(json_rule, "invoked",
-					    index->applied
-						    - index->applied_clear);
-			json_object_int_add(json_rule, "cpuTimeMS", index->cputime / 1000);
+					    atomic_load_explicit(&index->applied,
+								 memory_order_relaxed) -
+						    index->applied_clear);
+			json_object_int_add(json_rule, "cpuTimeMS",
+					    atomic_load_explicit(&index->cputime,
+								 memory_order_relaxed) /
+						    1000);
 
 			/* Description */
 			if (index->description)
@@ -1045,7 +1069,9 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map,
 			vty_out(vty,
 				" %s, sequence %d Invoked %" PRIu64 " (%zu milliseconds total)\n",
 				route_map_type_str(index->type), index->pref,
-				index->applied - index->applied_clear, index->cputime / 1000);
+				atomic_load_explicit(&index->applied, memory_order_relaxed) -
+					index->applied_clear,
+				atomic_load_explicit(&index->cputime, memory_order_relaxed) / 1000);
 
 			/* Description */
 			if (index->description)
@@ -1382,6 +1408,8 @@ static void route_map_rule_add(struct route_map_rule_list *list,
 	else
 		list->head = rule;
 	list->tail = rule;
+
+	route_map_compiled_invalidate();
 }
 
 /* Delete rule from rule list. */
@@ -1403,6 +1431,8 @@ static void route_map_rule_delete(struct route_map_rule_list *list,
 		list->head = rule->next;
 
 	XFREE(MTYPE_ROUTE_MAP_RULE, rule);
+
+	route_map_compiled_invalidate();
 }
 
 /* strcmp wrapper function which don't crush even argument is NULL. */
@@ -1821,42 +1851,25 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 	return ret;
 }
 
+/*
+ * The prefix tables only change with the route-map configuration, never
+ * while the route-map is applied, so no references are taken on the nodes.
+ * This keeps route_map_apply() free of writes to shared data other than
+ * statistics, for callers that apply route-maps from several pthreads.
+ */
 static struct list *route_map_get_index_list(struct route_node **rn,
 					     const struct prefix *prefix,
 					     struct route_table *table)
 {
-	struct route_node *tmp_rn = NULL;
-
-	if (!(*rn)) {
-		*rn = route_node_match(table, prefix);
-
-		if (!(*rn))
-			return NULL;
-
-		if ((*rn)->info)
-			return (struct list *)((*rn)->info);
-
-		/* If rn->info is NULL, get the parent.
-		 * Store the rn in tmp_rn and unlock it later.
-		 */
-		tmp_rn = *rn;
-	}
-
-	do {
+	if (!(*rn))
+		*rn = route_node_match_nolock(table, prefix);
+	else
 		*rn = (*rn)->parent;
-		if (tmp_rn)
-			route_unlock_node(tmp_rn);
-
-		if (!(*rn))
-			break;
 
-		if ((*rn)->info) {
-			route_lock_node(*rn);
-			return (struct list *)((*rn)->info);
-		}
-	} while (!(*rn)->info);
+	while (*rn && !(*rn)->info)
+		*rn = (*rn)->parent;
 
-	return NULL;
+	return *rn ? (struct list *)((*rn)->info) : NULL;
 }
 
 /*
@@ -1906,10 +1919,8 @@ route_map_get_index(struct route_map *map, const struct prefix *prefix,
 		head_index = (struct route_map_index *)(listgetdata(
 			listhead(candidate_rmap_list)));
 		if (best_index && head_index
-		    && (best_index->pref < head_index->pref)) {
-			route_unlock_node(rn);
+		    && (best_index->pref < head_index->pref))
 			continue;
-		}
 
 		for (ALL_LIST_ELEMENTS(candidate_rmap_list, ln, nn, index)) {
 			/* If the index is of seq higher than that in
@@ -1947,9 +1958,6 @@ route_map_get_index(struct route_map *map, const struct prefix *prefix,
 					*match_ret = ret;
 			}
 		}
-
-		route_unlock_node(rn);
-
 	} while (rn);
 
 	return best_index;
@@ -2375,6 +2383,8 @@ static void route_map_pfx_tbl_update(route_map_event_t event,
 	if (!index)
 		return;
 
+	route_map_compiled_invalidate();
+
 	if (event == RMAP_EVENT_INDEX_ADDED) {
 		route_map_pfx_table_add_default(AFI_IP, index);
 		route_map_pfx_table_add_default(AFI_IP6, index);
@@ -2504,6 +2514,8 @@ void route_map_notify_pentry_dependencies(const char *affected_name,
 	if (!affected_name || !pentry)
 		return;
 
+	route_map_compiled_invalidate();
+
 	upd8_hash = route_map_get_dep_hash(event);
 	if (!upd8_hash)
 		return;
@@ -2524,6 +2536,463 @@ void route_map_notify_pentry_dependencies(const char *affected_name,
 	}
 }
 
+/*
+ * Compiled route-maps.
+ *
+ * A route-map is turned into a flat array of clauses in sequence order, each
+ * one with its match and set rules laid out contiguously in a shared array of
+ * operations, and with "call" and "on-match goto" resolved to a route-map and
+ * to a clause position.  Rules implementing func_bind() have the list they
+ * name looked up once, here, rather than on every application.
+ *
+ * The prefix tables of the route-map are folded into a dispatch table: every
+ * node holds the positions of all the clauses that may match a prefix under
+ * it, its own candidates merged with those of its ancestors, so finding the
+ * best clause for a prefix takes a single longest-prefix-match lookup.
+ *
+ * Any configuration change that may affect a route-map - the route-map
+ * itself, a route-map it calls, or a list one of its rules refers to - bumps
+ * the generation, and the program is rebuilt when next applied.  Programs
+ * are only ever replaced with the configuration, never while route-maps are
+ * applied, which is what allows applying them from several pthreads.
+ */
+struct route_map_prog_op {
+	const struct route_map_rule_cmd *cmd;
+	void *value;
+	void *bound;
+};
+
+struct route_map_prog_clause {
+	struct route_map_index *index;
+	enum route_map_type type;
+	route_map_end_t exitpolicy;
+
+	/* position of the "on-match goto" target, nclauses if none */
+	unsigned int goto_pos;
+
+	/* "call" target; NULL if unset or if there is no such route-map */
+	struct route_map *nextrm;
+
+	unsigned int match_first, match_count;
+	unsigned int set_first, set_count;
+};
+
+/* positions of the candidate clauses of a dispatch table node, ascending */
+struct route_map_prog_cand {
+	unsigned int count;
+	unsigned int pos[];
+};
+
+struct route_map_prog {
+	unsigned int nclauses;
+	struct route_map_prog_clause *clauses;
+	struct route_map_prog_op *ops;
+
+	/* IPv4 and IPv6 dispatch tables */
+	struct route_table *dispatch[2];
+};
+
+static bool route_map_compiled = true;
+static atomic_uint_fast32_t route_map_prog_gen = 1;
+static pthread_mutex_t route_map_prog_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+void route_map_compiled_set(bool enable)
+{
+	route_map_compiled = enable;
+}
+
+bool route_map_compiled_get(void)
+{
+	return route_map_compiled;
+}
+
+void route_map_compiled_invalidate(void)
+{
+	atomic_fetch_add_explicit(&route_map_prog_gen, 1, memory_order_release);
+}
+
+uint32_t route_map_generation(void)
+{
+	return atomic_load_explicit(&route_map_prog_gen, memory_order_acquire);
+}
+
+struct route_map_prog_pos {
+	const struct route_map_index *index;
+	unsigned int pos;
+};
+
+static int route_map_prog_pos_cmp(const void *a, const void *b)
+{
+	const struct route_map_prog_pos *pa = a, *pb = b;
+
+	if (pa->index == pb->index)
+		return 0;
+	return pa->index < pb->index ? -1 : 1;
+}
+
+static int route_map_prog_uint_cmp(const void *a, const void *b)
+{
+	unsigned int ua = *(const unsigned int *)a;
+	unsigned int ub = *(const unsigned int *)b;
+
+	return ua < ub ? -1 : ua > ub;
+}
+
+static void route_map_prog_dispatch_build(struct route_map_prog *prog,
+					  struct route_table *dst,
+					  struct route_table *src,
+					  const struct route_map_prog_pos *bypos)
+{
+	struct route_map_prog_pos key, *found;
+	struct route_map_prog_cand *cand;
+	struct route_map_index *index;
+	struct route_node *rn, *up, *drn;
+	struct listnode *ln;
+	unsigned int *pos = NULL;
+	unsigned int count, size = 0, i, j;
+
+	for (rn = route_top(src); rn; rn = route_next(rn)) {
+		if (!rn->info)
+			continue;
+
+		count = 0;
+		for (up = rn; up; up = up->parent) {
+			if (!up->info)
+				continue;
+
+			for (ALL_LIST_ELEMENTS_RO((struct list *)up->info, ln,
+						  index)) {
+				key.index = index;
+				found = bsearch(&key, bypos, prog->nclauses,
+						sizeof(*bypos),
+						route_map_prog_pos_cmp);
+				if (!found)
+					continue;
+
+				if (count == size) {
+					size = MAX(16U, size * 2);
+					pos = XREALLOC(MTYPE_TMP, pos,
+						       size * sizeof(*pos));
+				}
+				pos[count++] = found->pos;
+			}
+		}
+
+		if (!count)
+			continue;
+
+		qsort(pos, count, sizeof(*pos), route_map_prog_uint_cmp);
+		for (i = 1, j = 1; i < count; i++)
+			if (pos[i] != pos[j - 1])
+				pos[j++] = pos[i];
+		count = j;
+
+		cand = XMALLOC(MTYPE_ROUTE_MAP_PROG,
+			       sizeof(*cand) + count * sizeof(cand->pos[0]));
+		cand->count = count;
+		memcpy(cand->pos, pos, count * sizeof(cand->pos[0]));
+
+		drn = route_node_get(dst, &rn->p);
+		route_node_set_info(drn, cand);
+	}
+
+	XFREE(MTYPE_TMP, pos);
+}
+
+static void route_map_prog_free(struct route_map_prog *prog)
+{
+	struct route_map_prog_cand *cand;
+	struct route_node *rn;
+	unsigned int afi;
+
+	if (!prog)
+		return;
+
+	for (afi = 0; afi < array_size(prog->dispatch); afi++) {
+		for (rn = route_top(prog->dispatch[afi]); rn;
+		     rn = route_next(rn)) {
+			cand = rn->info;
+			if (!cand)
+				continue;
+			route_node_set_info(rn, NULL);
+			XFREE(MTYPE_ROUTE_MAP_PROG, cand);
+		}
+		route_table_finish(prog->dispatch[afi]);
+	}
+
+	XFREE(MTYPE_ROUTE_MAP_PROG, prog->clauses);
+	XFREE(MTYPE_ROUTE_MAP_PROG, prog->ops);
+	XFREE(MTYPE_ROUTE_MAP_PROG, prog);
+}
+
+static void route_map_prog_ops_add(struct route_map_prog *prog,
+				   const struct route_map_rule_list *list,
+				   unsigned int *nops)
+{
+	struct route_map_prog_op *op;
+	struct route_map_rule *rule;
+
+	for (rule = list->head; rule; rule = rule->next) {
+		op = &prog->ops[(*nops)++];
+		op->cmd = rule->cmd;
+		op->value = rule->value;
+		if (rule->cmd->func_bind && rule->cmd->func_apply_bound)
+			op->bound = rule->cmd->func_bind(rule->value);
+	}
+}
+
+static struct route_map_prog *route_map_prog_build(struct route_map *map)
+{
+	struct route_map_prog_clause *clause;
+	struct route_map_prog_pos *bypos;
+	struct route_map_prog *prog;
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+	unsigned int nops = 0, pos, next;
+
+	prog = XCALLOC(MTYPE_ROUTE_MAP_PROG, sizeof(*prog));
+
+	for (index = map->head; index; index = index->next) {
+		prog->nclauses++;
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			nops++;
+		for (rule = index->set_list.head; rule; rule = rule->next)
+			nops++;
+	}
+
+	prog->clauses = XCALLOC(MTYPE_ROUTE_MAP_PROG,
+				prog->nclauses * sizeof(*prog->clauses));
+	prog->ops = XCALLOC(MTYPE_ROUTE_MAP_PROG,
+			    MAX(nops, 1U) * sizeof(*prog->ops));
+	bypos = XCALLOC(MTYPE_TMP, prog->nclauses * sizeof(*bypos));
+
+	nops = 0;
+	for (index = map->head, pos = 0; index; index = index->next, pos++) {
+		clause = &prog->clauses[pos];
+		clause->index = index;
+		clause->type = index->type;
+		clause->exitpolicy = index->exitpolicy;
+		if (index->nextrm)
+			clause->nextrm = route_map_lookup_by_name(index->nextrm);
+
+		clause->match_first = nops;
+		route_map_prog_ops_add(prog, &index->match_list, &nops);
+		clause->match_count = nops - clause->match_first;
+
+		clause->set_first = nops;
+		route_map_prog_ops_add(prog, &index->set_list, &nops);
+		clause->set_count = nops - clause->set_first;
+
+		bypos[pos].index = index;
+		bypos[pos].pos = pos;
+	}
+
+	/* "on-match goto" continues at the first clause at or after nextpref */
+	for (pos = 0; pos < prog->nclauses; pos++) {
+		clause = &prog->clauses[pos];
+		for (next = pos + 1; next < prog->nclauses; next++)
+			if (prog->clauses[next].index->pref >=
+			    clause->index->nextpref)
+				break;
+		clause->goto_pos = next;
+	}
+
+	qsort(bypos, prog->nclauses, sizeof(*bypos), route_map_prog_pos_cmp);
+
+	prog->dispatch[0] = route_table_init();
+	prog->dispatch[1] = route_table_init();
+	route_map_prog_dispatch_build(prog, prog->dispatch[0],
+				      map->ipv4_prefix_table, bypos);
+	route_map_prog_dispatch_build(prog, prog->dispatch[1],
+				      map->ipv6_prefix_table, bypos);
+
+	XFREE(MTYPE_TMP, bypos);
+	return prog;
+}
+
+static const struct route_map_prog *route_map_prog_get(struct route_map *map)
+{
+	uint_fast32_t gen;
+
+	gen = atomic_load_explicit(&route_map_prog_gen, memory_order_acquire);
+	if (atomic_load_explicit(&map->prog_gen, memory_order_acquire) == gen)
+		return map->prog;
+
+	frr_with_mutex (&route_map_prog_mtx) {
+		if (atomic_load_explicit(&map->prog_gen,
+					 memory_order_relaxed) != gen) {
+			route_map_prog_free(map->prog);
+			map->prog = route_map_prog_build(map);
+			atomic_store_explicit(&map->prog_gen, gen,
+					      memory_order_release);
+		}
+	}
+
+	return map->prog;
+}
+
+static inline enum route_map_cmd_result_t
+route_map_prog_op_apply(const struct route_map_prog_op *op,
+			const struct prefix *prefix, void *object)
+{
+	if (op->bound)
+		return op->cmd->func_apply_bound(op->value, op->bound, prefix,
+						 object);
+
+	return op->cmd->func_apply(op->value, prefix, object);
+}
+
+/* Same as route_map_apply_match(), on the clause's match operations. */
+static enum route_map_cmd_result_t
+route_map_prog_match(const struct route_map_prog *prog,
+		     const struct route_map_prog_clause *clause,
+		     const struct prefix *prefix, void *object)
+{
+	enum route_map_cmd_result_t ret = RMAP_MATCH;
+	const struct route_map_prog_op *op, *end;
+	bool is_matched = false;
+
+	op = &prog->ops[clause->match_first];
+	end = op + clause->match_count;
+
+	for (; op < end; op++) {
+		ret = route_map_prog_op_apply(op, prefix, object);
+
+		switch (ret) {
+		case RMAP_MATCH:
+			is_matched = true;
+			break;
+		case RMAP_NOMATCH:
+			return ret;
+		case RMAP_NOOP:
+			if (is_matched)
+				ret = RMAP_MATCH;
+			break;
+		case RMAP_OKAY:
+		case RMAP_ERROR:
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static route_map_result_t route_map_apply_int(struct route_map *map,
+					      const struct prefix *prefix,
+					      void *match_object,
+					      void *set_object, int *pref,
+					      int recursion);
+
+/*
+ * route_map_apply_int() for compiled route-maps; the same matrix applies.
+ * Per-sequence CPU time is not accounted here.
+ */
+static route_map_result_t
+route_map_prog_exec(const struct route_map_prog *prog,
+		    const struct prefix *prefix, void *match_object,
+		    void *set_object, int *pref, int recursion)
+{
+	const struct route_map_prog_clause *clause = NULL;
+	const struct route_map_prog_cand *cand = NULL;
+	const struct route_map_prog_op *op, *end;
+	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
+	route_map_result_t ret = RMAP_PERMITMATCH;
+	struct route_node *rn;
+	bool skip_match_clause = false;
+	unsigned int pos = 0, i;
+
+	if (prefix->family == AF_INET || prefix->family == AF_INET6) {
+		rn = route_node_match_nolock(
+			prog->dispatch[prefix->family == AF_INET6], prefix);
+		if (rn)
+			cand = rn->info;
+
+		/* the best clause is the first candidate that matches */
+		pos = prog->nclauses;
+		for (i = 0; cand && i < cand->count; i++) {
+			match_ret = route_map_prog_match(
+				prog, &prog->clauses[cand->pos[i]], prefix,
+				match_object);
+			if (match_ret == RMAP_MATCH) {
+				pos = cand->pos[i];
+				break;
+			}
+		}
+
+		if (pos == prog->nclauses) {
+			ret = RMAP_DENYMATCH;
+			goto done;
+		}
+
+		atomic_fetch_add_explicit(&prog->clauses[pos].index->applied, 1,
+					  memory_order_relaxed);
+		skip_match_clause = true;
+	}
+
+	for (; pos < prog->nclauses; pos++) {
+		clause = &prog->clauses[pos];
+
+		if (!skip_match_clause) {
+			atomic_fetch_add_explicit(&clause->index->applied, 1, memory_order_relaxed);
+			match_ret = route_map_prog_match(prog, clause, prefix,
+							 match_object);
+		} else
+			skip_match_clause = false;
+
+		if (match_ret == RMAP_NOMATCH) {
+			ret = RMAP_DENYMATCH;
+			continue;
+		}
+		if (match_ret != RMAP_MATCH)
+			continue;
+
+		if (clause->type == RMAP_DENY) {
+			ret = RMAP_DENYMATCH;
+			goto done;
+		}
+
+		ret = RMAP_PERMITMATCH;
+
+		op = &prog->ops[clause->set_first];
+		end = op + clause->set_count;
+		for (; op < end; op++)
+			(void)route_map_prog_op_apply(op, prefix, set_object);
+
+		if (clause->nextrm) {
+			ret = route_map_apply_int(clause->nextrm, prefix,
+						  match_object, set_object,
+						  NULL, recursion + 1);
+			if (ret == RMAP_DENYMATCH)
+				goto done;
+		}
+
+		switch (clause->exitpolicy) {
+		case RMAP_EXIT:
+			goto done;
+		case RMAP_NEXT:
+			continue;
+		case RMAP_GOTO:
+			if (clause->goto_pos == prog->nclauses) {
+				clause = &prog->clauses[prog->nclauses - 1];
+				goto done;
+			}
+			pos = clause->goto_pos - 1;
+			continue;
+		}
+	}
+	clause = NULL;
+
+done:
+	if (pref) {
+		if (clause && ret == RMAP_PERMITMATCH)
+			*pref = clause->index->pref;
+		else
+			*pref = 65536;
+	}
+
+	return ret;
+}
+
 /* Apply route map's each index to the object.
 
    The matrix for a route-map looks like this:
@@ -2570,12 +3039,12 @@ void route_map_notify_pentry_dependencies(const char *affected_name,
 
    We need to make sure our route-map processing matches the above
 */
-route_map_result_t route_map_apply_ext(struct route_map *map,
-				       const struct prefix *prefix,
-				       void *match_object, void *set_object,
-				       int *pref)
+static route_map_result_t route_map_apply_int(struct route_map *map,
+					      const struct prefix *prefix,
+					      void *match_object,
+					      void *set_object, int *pref,
+					      int recursion)
 {
-	static int recursion = 0;
 	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
 	route_map_result_t ret = RMAP_PERMITMATCH;
 	struct route_map_index *index = NULL;
@@ -2588,25 +3057,30 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 
 	if (recursion > RMAP_RECURSION_LIMIT) {
 		if (map)
-			map->applied++;
+			atomic_fetch_add_explicit(&map->applied, 1, memory_order_relaxed);
 
 		flog_warn(
 			EC_LIB_RMAP_RECURSION_LIMIT,
 			"route-map recursion limit (%d) reached, discarding route",
 			RMAP_RECURSION_LIMIT);
-		recursion = 0;
 		return RMAP_DENYMATCH;
 	}
 
 	if (map == NULL || map->head == NULL) {
 		if (map)
-			map->applied++;
+			atomic_fetch_add_explicit(&map->applied, 1, memory_order_relaxed);
 		ret = RMAP_DENYMATCH;
 		reason = route_map_action_map_null;
 		goto route_map_apply_end;
 	}
 
-	map->applied++;
+	atomic_fetch_add_explicit(&map->applied, 1, memory_order_relaxed);
+
+	/* detailed debugs are only available from the interpreter */
+	if (route_map_compiled && !map->optimization_disabled && !rmap_debug)
+		return route_map_prog_exec(route_map_prog_get(map), prefix,
+					   match_object, set_object, pref,
+					   recursion);
 
 	GETRUSAGE(&mbefore);
 	ibefore = mbefore;
@@ -2624,11 +3098,11 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 	}
 
 	if (index) {
-		index->applied++;
+		atomic_fetch_add_explicit(&index->applied, 1, memory_order_relaxed);
 
 		GETRUSAGE(&iafter);
 		event_consumed_time(&iafter, &ibefore, &cputime);
-		index->cputime += cputime;
+		atomic_fetch_add_explicit(&index->cputime, cputime, memory_order_relaxed);
 		ibefore = iafter;
 
 		if (unlikely(CHECK_FLAG(rmap_debug, DEBUG_ROUTEMAP)))
@@ -2656,7 +3130,7 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 
 	for (; index; index = index->next) {
 		if (!skip_match_clause) {
-			index->applied++;
+			atomic_fetch_add_explicit(&index->applied, 1, memory_order_relaxed);
 			/* Apply this index. */
 			match_ret = route_map_apply_match(&index->match_list,
 							  prefix, match_object);
@@ -2729,12 +3203,11 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 					if (nextrm) /* Target route-map found,
 						       jump to it */
 					{
-						recursion++;
-						ret = route_map_apply_ext(
+						ret = route_map_apply_int(
 							nextrm, prefix,
 							match_object,
-							set_object, NULL);
-						recursion--;
+							set_object, NULL,
+							recursion + 1);
 					}
 
 					/* If nextrm returned 'deny', finish. */
@@ -2777,7 +3250,7 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 		}
 		GETRUSAGE(&iafter);
 		event_consumed_time(&iafter, &ibefore, &cputime);
-		index->cputime += cputime;
+		atomic_fetch_add_explicit(&index->cputime, cputime, memory_order_relaxed);
 		ibefore = iafter;
 	}
 
@@ -2798,12 +3271,21 @@ route_map_apply_end:
 		GETRUSAGE(&mbefore);
 		GETRUSAGE(&mafter);
 		event_consumed_time(&mafter, &mbefore, &cputime);
-		map->cputime += cputime;
+		atomic_fetch_add_explicit(&map->cputime, cputime, memory_order_relaxed);
 	}
 
 	return (ret);
 }
 
+route_map_result_t route_map_apply_ext(struct route_map *map,
+				       const struct prefix *prefix,
+				       void *match_object, void *set_object,
+				       int *pref)
+{
+	return route_map_apply_int(map, prefix, match_object, set_object, pref,
+				   0);
+}
+
 void route_map_add_hook(void (*func)(const char *))
 {
 	route_map_master.add_hook = func;
@@ -3131,6 +3613,9 @@ void route_map_notify_dependencies(const char *affected_name,
 	if (!affected_name)
 		return;
 
+	/* a list a route-map refers to, or a route-map it calls, changed */
+	route_map_compiled_invalidate();
+
 	name = XSTRDUP(MTYPE_ROUTE_MAP_NAME, affected_name);
 
 	if ((upd8_hash = route_map_get_dep_hash(event)) == NULL) {
@@ -3157,11 +3642,15 @@ static void clear_route_map_helper(struct route_map *map)
 {
 	struct route_map_index *index;
 
-	map->applied_clear = map->applied;
-	map->cputime = 0;
+	map->applied_clear = atomic_load_explicit(&map->applied,
+						  memory_order_relaxed);
+	atomic_store_explicit(&map->cputime, 0, memory_order_relaxed);
+	map->cache_hits = 0;
+	map->cache_misses = 0;
 	for (index = map->head; index; index = index->next) {
-		index->applied_clear = index->applied;
-		index->cputime = 0;
+		index->applied_clear = atomic_load_explicit(&index->applied,
+							    memory_order_relaxed);
+		atomic_store_explicit(&index->cputime, 0, memory_order_relaxed);
 	}
 }
 
@@ -7,6 +7,7 @@
 #define _ZEBRA_ROUTEMAP_H
 
 #include "typesafe.h"
+#include "frratomic.h"
 #include "prefix.h"
 #include "memory.h"
 #include "qobj.h"
@@ -117,6 +118,17 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/*
+	 * Optional, used by compiled route-maps: resolve what the compiled
+	 * value refers to by name (a prefix-list, a community-list...) once,
+	 * and apply the rule with the result.  When func_bind() returns NULL,
+	 * func_apply() is used instead.
+	 */
+	void *(*func_bind)(void *val);
+	enum route_map_cmd_result_t (*func_apply_bound)(void *rule, void *bound,
+							const struct prefix *prefix,
+							void *object);
 };
 
 /* Route map apply error. */
@@ -184,10 +196,12 @@ struct route_map_index {
 	struct route_map_index *next;
 	struct route_map_index *prev;
 
-	/* Keep track how many times we've try to apply */
-	uint64_t applied;
+	/* Keep track how many times we've try to apply, also from other
+	 * pthreads than the main one, see route_map_apply_ext()
+	 */
+	_Atomic uint64_t applied;
 	uint64_t applied_clear;
-	size_t cputime;
+	_Atomic size_t cputime;
 
 	/* List of match/sets contexts. */
 	TAILQ_HEAD(, routemap_hook_context) rhclist;
@@ -220,9 +234,9 @@ struct route_map {
 	bool optimization_disabled;
 
 	/* How many times have we applied this route-map */
-	uint64_t applied;
+	_Atomic uint64_t applied;
 	uint64_t applied_clear;
-	size_t cputime;
+	_Atomic size_t cputime;
 
 	/* Counter to track active usage of this route-map */
 	uint16_t use_count;
@@ -233,6 +247,21 @@ struct route_map {
 	struct route_table *ipv4_prefix_table;
 	struct route_table *ipv6_prefix_table;
 
+	/* Compiled program, current while prog_gen matches the generation of
+	 * the route-map configuration.
+	 */
+	struct route_map_prog *prog;
+	atomic_uint_fast32_t prog_gen;
+
+	/* Results cache kept by the daemon, for route-maps whose result only
+	 * depends on the object they are applied to; cacheable is valid while
+	 * cache_gen matches route_map_generation().
+	 */
+	uint32_t cache_gen;
+	bool cacheable;
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+
 	QOBJ_FIELDS;
 };
 DECLARE_QOBJ_TYPE(route_map);
@@ -530,6 +559,22 @@ extern route_map_result_t route_map_apply_ext(struct route_map *map,
 #define route_map_apply(map, prefix, object)                                   \
 	route_map_apply_ext(map, prefix, object, object, NULL)
 
+/*
+ * Route-maps with the prefix-table optimization enabled are compiled into a
+ * flat program on first use, and recompiled after any configuration change
+ * that may affect them, which route_map_compiled_invalidate() signals.
+ * route_map_compiled_set(false) goes back to interpreting every route-map.
+ */
+extern void route_map_compiled_set(bool enable);
+extern bool route_map_compiled_get(void);
+extern void route_map_compiled_invalidate(void);
+
+/*
+ * Changes with any configuration change that may affect the result of a
+ * route-map, as signalled by route_map_compiled_invalidate().
+ */
+extern uint32_t route_map_generation(void);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
@@ -269,6 +269,7 @@ static int lib_route_map_entry_action_modify(struct nb_cb_modify_args *args)
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->type = yang_dnode_get_enum(args->dnode, NULL);
 		map = rmi->map;
+		route_map_compiled_invalidate();
 
 		/* Execute event hook. */
 		if (route_map_master.event_hook) {
@@ -316,6 +317,7 @@ static int lib_route_map_entry_call_modify(struct nb_cb_modify_args *args)
 			XFREE(MTYPE_ROUTE_MAP_NAME, rmi->nextrm);
 		}
 		rmi->nextrm = args->resource->ptr;
+		route_map_compiled_invalidate();
 		route_map_upd8_dependency(RMAP_EVENT_CALL_ADDED, rmi->nextrm,
 					  rmi->map->name);
 		break;
@@ -340,6 +342,7 @@ static int lib_route_map_entry_call_destroy(struct nb_cb_destroy_args *args)
 					  rmi->map->name);
 		XFREE(MTYPE_ROUTE_MAP_NAME, rmi->nextrm);
 		rmi->nextrm = NULL;
+		route_map_compiled_invalidate();
 		break;
 	}
 
@@ -396,6 +399,7 @@ lib_route_map_entry_exit_policy_modify(struct nb_cb_modify_args *args)
 			rmi->exitpolicy = RMAP_GOTO;
 			break;
 		}
+		route_map_compiled_invalidate();
 
 		/* Execute event hook. */
 		if (route_map_master.event_hook) {
@@ -435,6 +439,7 @@ static int lib_route_map_entry_goto_value_modify(struct nb_cb_modify_args *args)
 	case NB_EV_APPLY:
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->nextpref = yang_dnode_get_uint16(args->dnode, NULL);
+		route_map_compiled_invalidate();
 		break;
 	}
 
@@ -455,6 +460,7 @@ lib_route_map_entry_goto_value_destroy(struct nb_cb_destroy_args *args)
 	case NB_EV_APPLY:
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->nextpref = 0;
+		route_map_compiled_invalidate();
 		break;
 	}
 
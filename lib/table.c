@@ -218,9 +218,12 @@ static void set_link(struct route_node *node, struct route_node *new)
 	new->parent = node;
 }
 
-/* Find matched prefix. */
-struct route_node *route_node_match(struct route_table *table,
-				    union prefixconstptr pu)
+/*
+ * Find matched prefix, without taking a reference on the node.  Only for
+ * tables that cannot change while the node is used.
+ */
+struct route_node *route_node_match_nolock(struct route_table *table,
+					   union prefixconstptr pu)
 {
 	const struct prefix *p = pu.p;
 	struct route_node *node;
@@ -257,6 +260,15 @@ struct route_node *route_node_match(struct route_table *table,
 	}
 
 done:
+	return matched;
+}
+
+/* Find matched prefix. */
+struct route_node *route_node_match(struct route_table *table,
+				    union prefixconstptr pu)
+{
+	struct route_node *matched = route_node_match_nolock(table, pu);
+
 	/* If matched route found, return it. */
 	if (matched)
 		return route_lock_node(matched);
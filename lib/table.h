@@ -221,6 +221,8 @@ extern struct route_node *route_node_lookup_maynull(struct route_table *table,
 						    union prefixconstptr pu);
 extern struct route_node *route_node_match(struct route_table *table,
 					   union prefixconstptr pu);
+extern struct route_node *route_node_match_nolock(struct route_table *table,
+						  union prefixconstptr pu);
 
 extern unsigned long route_table_count(struct route_table *table);
 extern unsigned long route_table_info_count(struct route_table *table);
@@ -57,6 +57,8 @@ DEFINE_MTYPE_STATIC(LIB, VTY_OUT_BUF, "VTY output buffer");
 DEFINE_MTYPE_STATIC(LIB, VTY_HIST, "VTY history");
 DEFINE_MTYPE_STATIC(LIB, VTY_REGEX, "VTY filter regex");
 
+DEFINE_HOOK(vty_closing, (struct vty *vty), (vty));
+
 DECLARE_DLIST(vtys, struct vty, itm);
 
 /* Vty events */
@@ -157,6 +159,17 @@ void vty_resume_response(struct vty *vty, int ret)
 		zlog_err("mgmtd: unexpected resume while reading config file");
 }
 
+bool vty_out_pending(struct vty *vty)
+{
+	if (vty->type != VTY_SHELL_SERV || vty->status == VTY_CLOSE)
+		return false;
+
+	if (!event_is_scheduled(vty->t_write) && vtysh_flush(vty) < 0)
+		return false;
+
+	return !buffer_empty(vty->obuf);
+}
+
 void vty_frame(struct vty *vty, const char *format, ...)
 {
 	va_list args;
@@ -2442,6 +2455,8 @@ void vty_close(struct vty *vty)
 	if (vty_close_mgmt_cb)
 		vty_close_mgmt_cb(vty);
 
+	hook_call(vty_closing, vty);
+
 	/* Cancel threads.*/
 	event_cancel(&vty->t_read);
 	event_cancel(&vty->t_write);
@@ -13,6 +13,7 @@
 #include "sockunion.h"
 #include "qobj.h"
 #include "compiler.h"
+#include "hook.h"
 #include "northbound.h"
 #include "zlog_live.h"
 #include "libfrr.h"
@@ -438,6 +439,15 @@ static inline bool vty_is_closed(const struct vty *vty)
  */
 extern void vty_resume_response(struct vty *vty, int ret);
 
+/*
+ * For commands that returned CMD_SUSPEND: push buffered output to the
+ * client, returns true while some of it still waits for the socket.
+ */
+extern bool vty_out_pending(struct vty *vty);
+
+/* Called when a vty is about to be freed, e.g. to drop suspended commands. */
+DECLARE_HOOK(vty_closing, (struct vty *vty), (vty));
+
 /* --------------------------------------------------- */
 /* Callbacks for Mgmtd front-end CLI vty modifications */
 /* --------------------------------------------------- */
@@ -1424,15 +1424,9 @@ void zapi_nexthop_init(struct zapi_nexthop *znh)
 	memset(znh, 0, sizeof(struct zapi_nexthop));
 }
 
-int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+/* Route type, flags and SAFI */
+static int zapi_route_encode_head(struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-	int psize;
-
-	stream_reset(s);
-	zclient_create_header(s, cmd, api->vrf_id);
-
 	if (api->type >= ZEBRA_ROUTE_MAX) {
 		flog_err(EC_LIB_ZAPI_ENCODE,
 			 "%s: Specified route type (%u) is not a legal value",
@@ -1455,17 +1449,14 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	}
 	stream_putc(s, api->safi);
 
-	/* Put prefix information. */
-	stream_putc(s, api->prefix.family);
-	psize = PSIZE(api->prefix.prefixlen);
-	stream_putc(s, api->prefix.prefixlen);
-	stream_write(s, &api->prefix.u.prefix, psize);
+	return 0;
+}
 
-	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
-		psize = PSIZE(api->src_prefix.prefixlen);
-		stream_putc(s, api->src_prefix.prefixlen);
-		stream_write(s, (uint8_t *)&api->src_prefix.prefix, psize);
-	}
+/* Everything that follows the prefixes: nexthops and attributes */
+static int zapi_route_encode_attrs(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
 
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG))
 		stream_putl(s, api->nhgid);
@@ -1578,6 +1569,35 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 		stream_putw(s, api->opaque.length);
 		stream_write(s, api->opaque.data, api->opaque.length);
 	}
+
+	return 0;
+}
+
+int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+{
+	int psize;
+
+	stream_reset(s);
+	zclient_create_header(s, cmd, api->vrf_id);
+
+	if (zapi_route_encode_head(s, api) < 0)
+		return -1;
+
+	/* Put prefix information. */
+	stream_putc(s, api->prefix.family);
+	psize = PSIZE(api->prefix.prefixlen);
+	stream_putc(s, api->prefix.prefixlen);
+	stream_write(s, &api->prefix.u.prefix, psize);
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
+		psize = PSIZE(api->src_prefix.prefixlen);
+		stream_putc(s, api->src_prefix.prefixlen);
+		stream_write(s, (uint8_t *)&api->src_prefix.prefix, psize);
+	}
+
+	if (zapi_route_encode_attrs(s, api) < 0)
+		return -1;
+
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
@@ -1690,13 +1710,8 @@ stream_failure:
 	return ret;
 }
 
-int zapi_route_decode(struct stream *s, struct zapi_route *api)
+static int zapi_route_decode_head(struct stream *s, struct zapi_route *api)
 {
-	struct zapi_nexthop *api_nh;
-	int i;
-
-	zapi_route_init(api);
-
 	/* Type, flags, message. */
 	STREAM_GETC(s, api->type);
 	if (api->type >= ZEBRA_ROUTE_MAX) {
@@ -1717,8 +1732,14 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 		return -1;
 	}
 
-	/* Prefix. */
-	STREAM_GETC(s, api->prefix.family);
+	return 0;
+stream_failure:
+	return -1;
+}
+
+/* Length and bytes of a prefix whose family is already in @api */
+static int zapi_route_decode_prefix(struct stream *s, struct zapi_route *api)
+{
 	STREAM_GETC(s, api->prefix.prefixlen);
 	switch (api->prefix.family) {
 	case AF_INET:
@@ -1747,28 +1768,15 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 	}
 	STREAM_GET(&api->prefix.u.prefix, s, PSIZE(api->prefix.prefixlen));
 
-	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
-		api->src_prefix.family = AF_INET6;
-		STREAM_GETC(s, api->src_prefix.prefixlen);
-		if (api->src_prefix.prefixlen > IPV6_MAX_BITLEN) {
-			flog_err(
-				EC_LIB_ZAPI_ENCODE,
-				"%s: SRC Prefix prefixlen received: %d is too large",
-				__func__, api->src_prefix.prefixlen);
-			return -1;
-		}
-		STREAM_GET(&api->src_prefix.prefix, s,
-			   PSIZE(api->src_prefix.prefixlen));
+	return 0;
+stream_failure:
+	return -1;
+}
 
-		if (api->prefix.family != AF_INET6
-		    || api->src_prefix.prefixlen == 0) {
-			flog_err(
-				EC_LIB_ZAPI_ENCODE,
-				"%s: SRC prefix specified in some manner that makes no sense",
-				__func__);
-			return -1;
-		}
-	}
+static int zapi_route_decode_attrs(struct stream *s, struct zapi_route *api)
+{
+	struct zapi_nexthop *api_nh;
+	int i;
 
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG))
 		STREAM_GETL(s, api->nhgid);
@@ -1843,6 +1851,195 @@ stream_failure:
 	return -1;
 }
 
+int zapi_route_decode(struct stream *s, struct zapi_route *api)
+{
+	zapi_route_init(api);
+
+	if (zapi_route_decode_head(s, api) < 0)
+		return -1;
+
+	/* Prefix. */
+	STREAM_GETC(s, api->prefix.family);
+	if (zapi_route_decode_prefix(s, api) < 0)
+		return -1;
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
+		api->src_prefix.family = AF_INET6;
+		STREAM_GETC(s, api->src_prefix.prefixlen);
+		if (api->src_prefix.prefixlen > IPV6_MAX_BITLEN) {
+			flog_err(
+				EC_LIB_ZAPI_ENCODE,
+				"%s: SRC Prefix prefixlen received: %d is too large",
+				__func__, api->src_prefix.prefixlen);
+			return -1;
+		}
+		STREAM_GET(&api->src_prefix.prefix, s,
+			   PSIZE(api->src_prefix.prefixlen));
+
+		if (api->prefix.family != AF_INET6
+		    || api->src_prefix.prefixlen == 0) {
+			flog_err(
+				EC_LIB_ZAPI_ENCODE,
+				"%s: SRC prefix specified in some manner that makes no sense",
+				__func__);
+			return -1;
+		}
+	}
+
+	return zapi_route_decode_attrs(s, api);
+stream_failure:
+	return -1;
+}
+
+/*
+ * A ZEBRA_ROUTE_ADD_BULK message carries routes which only differ by their
+ * prefix: the type, flags and SAFI, the family, then the nexthops and the
+ * attributes are encoded once, as for ZEBRA_ROUTE_ADD, followed by the
+ * number of routes and the length and bytes of each prefix.  Routes with a
+ * source prefix are not batched.
+ */
+struct zapi_route_bulk *zapi_route_bulk_new(void)
+{
+	struct zapi_route_bulk *bulk;
+	size_t size = MAX(ZEBRA_MAX_PACKET_SIZ, sizeof(struct zapi_route));
+
+	bulk = XCALLOC(MTYPE_ZCLIENT, sizeof(*bulk));
+	bulk->tmpl = stream_new(size);
+	bulk->scratch = stream_new(size);
+	bulk->prefixes = stream_new(ZEBRA_MAX_PACKET_SIZ);
+
+	return bulk;
+}
+
+void zapi_route_bulk_free(struct zapi_route_bulk **bulk)
+{
+	if (!*bulk)
+		return;
+
+	stream_free((*bulk)->tmpl);
+	stream_free((*bulk)->scratch);
+	stream_free((*bulk)->prefixes);
+	XFREE(MTYPE_ZCLIENT, *bulk);
+}
+
+enum zclient_send_status zclient_route_bulk_flush(struct zclient *zclient,
+						  struct zapi_route_bulk *bulk)
+{
+	struct stream *s = zclient->obuf;
+
+	if (!bulk->count)
+		return ZCLIENT_SEND_SUCCESS;
+
+	stream_reset(s);
+	zclient_create_header(s, ZEBRA_ROUTE_ADD_BULK, bulk->vrf_id);
+	stream_put(s, STREAM_DATA(bulk->tmpl), stream_get_endp(bulk->tmpl));
+	stream_putw(s, bulk->count);
+	stream_put(s, STREAM_DATA(bulk->prefixes),
+		   stream_get_endp(bulk->prefixes));
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	bulk->count = 0;
+	stream_reset(bulk->prefixes);
+
+	return zclient_send_message(zclient);
+}
+
+/* Size of the bulk message with one more prefix of @psize bytes */
+static size_t zapi_route_bulk_size(struct zapi_route_bulk *bulk,
+				   struct stream *tmpl, size_t psize)
+{
+	return ZEBRA_HEADER_SIZE + stream_get_endp(tmpl) + 2 +
+	       stream_get_endp(bulk->prefixes) + 1 + psize;
+}
+
+enum zclient_send_status zclient_route_bulk_add(struct zclient *zclient,
+						struct zapi_route_bulk *bulk,
+						struct zapi_route *api)
+{
+	enum zclient_send_status ret = ZCLIENT_SEND_SUCCESS;
+	size_t psize = PSIZE(api->prefix.prefixlen);
+	struct stream *s = bulk->scratch;
+	struct stream *tmp;
+
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		goto single;
+
+	stream_reset(s);
+	if (zapi_route_encode_head(s, api) < 0)
+		return ZCLIENT_SEND_FAILURE;
+	stream_putc(s, api->prefix.family);
+	if (zapi_route_encode_attrs(s, api) < 0)
+		return ZCLIENT_SEND_FAILURE;
+
+	if (bulk->count &&
+	    (bulk->vrf_id != api->vrf_id ||
+	     stream_get_endp(s) != stream_get_endp(bulk->tmpl) ||
+	     memcmp(STREAM_DATA(s), STREAM_DATA(bulk->tmpl),
+		    stream_get_endp(s)) ||
+	     zapi_route_bulk_size(bulk, s, psize) > ZEBRA_MAX_PACKET_SIZ)) {
+		ret = zclient_route_bulk_flush(zclient, bulk);
+		if (ret == ZCLIENT_SEND_FAILURE)
+			return ret;
+	}
+
+	if (!bulk->count) {
+		/* too many nexthops to share the message with anything */
+		if (zapi_route_bulk_size(bulk, s, psize) > ZEBRA_MAX_PACKET_SIZ)
+			goto single;
+
+		tmp = bulk->tmpl;
+		bulk->tmpl = s;
+		bulk->scratch = tmp;
+		bulk->vrf_id = api->vrf_id;
+	}
+
+	stream_putc(bulk->prefixes, api->prefix.prefixlen);
+	stream_write(bulk->prefixes, &api->prefix.u.prefix, psize);
+	bulk->count++;
+
+	return ret;
+
+single:
+	ret = zclient_route_bulk_flush(zclient, bulk);
+	if (ret == ZCLIENT_SEND_FAILURE)
+		return ret;
+
+	return zclient_route_send(ZEBRA_ROUTE_ADD, zclient, api);
+}
+
+int zapi_route_bulk_decode(struct stream *s, struct zapi_route *api,
+			   uint16_t *count)
+{
+	zapi_route_init(api);
+
+	if (zapi_route_decode_head(s, api) < 0)
+		return -1;
+
+	STREAM_GETC(s, api->prefix.family);
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: SRC prefix specified in a bulk route message",
+			 __func__);
+		return -1;
+	}
+
+	if (zapi_route_decode_attrs(s, api) < 0)
+		return -1;
+
+	STREAM_GETW(s, *count);
+
+	return 0;
+stream_failure:
+	return -1;
+}
+
+int zapi_route_bulk_decode_prefix(struct stream *s, struct zapi_route *api)
+{
+	memset(&api->prefix.u, 0, sizeof(api->prefix.u));
+
+	return zapi_route_decode_prefix(s, api);
+}
+
 static void zapi_encode_prefix(struct stream *s, struct prefix *p,
 			       uint8_t family)
 {
@@ -238,6 +238,7 @@ typedef enum {
 	ZEBRA_TC_FILTER_DELETE,
 	ZEBRA_OPAQUE_NOTIFY,
 	ZEBRA_SRV6_SID_NOTIFY,
+	ZEBRA_ROUTE_ADD_BULK,
 } zebra_message_types_t;
 /* Zebra message types. Please update the corresponding
  * command_types array with any changes!
@@ -1195,6 +1196,41 @@ void zapi_nexthop_init(struct zapi_nexthop *znh);
 
 extern int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api);
 extern int zapi_route_decode(struct stream *s, struct zapi_route *api);
+
+/*
+ * Routes which only differ by their prefix, sent to zebra together in
+ * ZEBRA_ROUTE_ADD_BULK messages: zclient_route_bulk_add() queues a route
+ * behind the pending ones when it has the same nexthops and attributes, or
+ * sends them first.  The caller must zclient_route_bulk_flush() once done
+ * adding routes, and before sending anything else about them.
+ */
+struct zapi_route_bulk {
+	/* encoded route, without the prefix, shared by the pending routes */
+	struct stream *tmpl;
+	/* the same for the route being added */
+	struct stream *scratch;
+	/* prefixes of the pending routes */
+	struct stream *prefixes;
+	vrf_id_t vrf_id;
+	uint16_t count;
+};
+
+extern struct zapi_route_bulk *zapi_route_bulk_new(void);
+extern void zapi_route_bulk_free(struct zapi_route_bulk **bulk);
+extern enum zclient_send_status zclient_route_bulk_add(struct zclient *zclient,
+						       struct zapi_route_bulk *bulk,
+						       struct zapi_route *api);
+extern enum zclient_send_status
+zclient_route_bulk_flush(struct zclient *zclient, struct zapi_route_bulk *bulk);
+
+/*
+ * Decode what a ZEBRA_ROUTE_ADD_BULK message shares into @api and the
+ * number of routes into @count, then each prefix into @api->prefix.
+ */
+extern int zapi_route_bulk_decode(struct stream *s, struct zapi_route *api,
+				  uint16_t *count);
+extern int zapi_route_bulk_decode_prefix(struct stream *s,
+					 struct zapi_route *api);
 extern int zapi_nexthop_decode(struct stream *s, struct zapi_nexthop *api_nh,
 			       uint32_t api_flags, uint32_t api_message);
 bool zapi_nhg_notify_decode(struct stream *s, uint32_t *id,
@@ -34,6 +34,9 @@ struct sharp_routes {
 	uint32_t tableid;
 	bool stop_loop;
 
+	/* Send the routes in ZEBRA_ROUTE_ADD_BULK messages */
+	bool bulk;
+
 	uint8_t distance;
 
 	uint8_t inst;
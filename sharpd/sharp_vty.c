@@ -218,7 +218,7 @@ DEFPY (install_routes,
 	  <nexthop <A.B.C.D$nexthop4|X:X::X:X$nexthop6>|\
 	   nexthop-group NHGNAME$nexthop_group>\
 	  [backup$backup <A.B.C.D$backup_nexthop4|X:X::X:X$backup_nexthop6>] \
-	  (1-1000000)$routes [instance (0-255)$instance] [table (0-4294967295)$table_id] [distance (0-255)] [repeat (2-1000)$rpt] [opaque WORD] [no-recurse$norecurse]",
+	  (1-1000000)$routes [instance (0-255)$instance] [table (0-4294967295)$table_id] [distance (0-255)] [repeat (2-1000)$rpt] [opaque WORD] [no-recurse$norecurse] [bulk$bulk]",
        "Sharp routing Protocol\n"
        "install some routes\n"
        "Routes to install\n"
@@ -245,7 +245,8 @@ DEFPY (install_routes,
        "How many times to repeat this command\n"
        "What opaque data to send down\n"
        "The opaque data\n"
-       "No recursive nexthops\n")
+       "No recursive nexthops\n"
+       "Send routes sharing their nexthops in bulk messages\n")
 {
 	struct vrf *vrf;
 	struct prefix prefix;
@@ -258,6 +259,7 @@ DEFPY (install_routes,
 	sg.r.tableid = 0;
 	sg.r.tableid_set = false;
 	sg.r.stop_loop = false;
+	sg.r.bulk = !!bulk;
 	sg.r.distance = ZEBRA_SHARP_DISTANCE_DEFAULT;
 
 	if (rpt >= 2)
@@ -416,6 +418,7 @@ DEFPY (install_seg6_routes,
 	sg.r.total_routes = routes;
 	sg.r.installed_routes = 0;
 	sg.r.stop_loop = false;
+	sg.r.bulk = false;
 	sg.r.distance = ZEBRA_SHARP_DISTANCE_DEFAULT;
 
 	if (rpt >= 2)
@@ -511,6 +514,7 @@ DEFPY(install_seg6local_segs_routes, install_seg6local_segs_routes_cmd,
 	sg.r.total_routes = routes;
 	sg.r.installed_routes = 0;
 	sg.r.stop_loop = false;
+	sg.r.bulk = false;
 	sg.r.distance = ZEBRA_SHARP_DISTANCE_DEFAULT;
 
 	if (rpt >= 2)
@@ -648,6 +652,7 @@ DEFPY (install_seg6local_routes,
 	sg.r.total_routes = routes;
 	sg.r.installed_routes = 0;
 	sg.r.stop_loop = false;
+	sg.r.bulk = false;
 
 	if (rpt >= 2)
 		sg.r.repeat = rpt * 2;
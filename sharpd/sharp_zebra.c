@@ -227,6 +227,9 @@ struct buffer_delay {
 	char *opaque;
 } wb;
 
+/* routes pending for a ZEBRA_ROUTE_ADD_BULK message */
+static struct zapi_route_bulk *route_bulk;
+
 /*
  * route_add - Encodes a route to zebra
  *
@@ -306,6 +309,14 @@ static bool route_add(const struct prefix *p, vrf_id_t vrf_id, uint8_t instance,
 		memcpy(api.opaque.data, opaque, api.opaque.length);
 	}
 
+	if (sg.r.bulk) {
+		if (zclient_route_bulk_add(g_zclient, route_bulk, &api) ==
+		    ZCLIENT_SEND_BUFFERED)
+			return true;
+		else
+			return false;
+	}
+
 	if (zclient_route_send(ZEBRA_ROUTE_ADD, g_zclient, &api) ==
 	    ZCLIENT_SEND_BUFFERED)
 		return true;
@@ -383,9 +394,13 @@ static void sharp_install_routes_restart(struct prefix *p, uint32_t count, vrf_i
 			wb.distance = distance;
 			wb.restart = SHARP_INSTALL_ROUTES_RESTART;
 
-			return;
+			break;
 		}
 	}
+
+	/* what is pending only goes into the buffer of the zclient */
+	if (sg.r.bulk)
+		zclient_route_bulk_flush(g_zclient, route_bulk);
 }
 
 void sharp_install_routes_helper(struct prefix *p, vrf_id_t vrf_id, uint8_t instance,
@@ -1175,6 +1190,7 @@ void sharp_zebra_init(void)
 
 	g_zclient = zclient_new(master, &zclient_options_default, sharp_handlers,
 				array_size(sharp_handlers));
+	route_bulk = zapi_route_bulk_new();
 
 	zclient_init(g_zclient, ZEBRA_ROUTE_SHARP, 0, &sharp_privs);
 	g_zclient->zebra_connected = zebra_connected;
@@ -1194,4 +1210,5 @@ void sharp_zebra_terminate(void)
 
 	zclient_stop(g_zclient);
 	zclient_free(g_zclient);
+	zapi_route_bulk_free(&route_bulk);
 }
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares the memory used by the full and the compact
+ * adj-RIB-out representations, for a route server sending a full table to
+ * a number of subgroups, and checks that clearing the subgroups releases
+ * every entry, including for labeled-unicast subgroups, whose entries hang
+ * off the unicast table.
+ *
+ *   test_adj_out_mem [prefixes] [subgroups]
+ *
+ * Each model is measured in its own child process so that its RSS is not
+ * skewed by what the allocator kept from the other one.  The defaults are
+ * sized for "make check", pass a million prefixes for a full table.
+ */
+
+#include <zebra.h>
+
+#include <sys/wait.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "queue.h"
+#include "filter.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define ADJ_OUT_PREFIXES  100000
+#define ADJ_OUT_SUBGROUPS 8
+
+static struct bgp *bgp;
+static as_t asn = 100;
+
+static const struct {
+	const char *name;
+	bool compact;
+	safi_t safi;
+} models[] = {
+	{ "full", false, SAFI_UNICAST },
+	{ "compact", true, SAFI_UNICAST },
+	{ "labeled", true, SAFI_LABELED_UNICAST },
+};
+
+static unsigned long rss_kb(void)
+{
+	unsigned long size, resident = 0;
+	FILE *f;
+
+	f = fopen("/proc/self/statm", "r");
+	if (!f)
+		return 0;
+	if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void populate(struct bgp_table *table, unsigned int prefixes)
+{
+	struct prefix_ipv4 p = { .family = AF_INET, .prefixlen = 24 };
+	unsigned int i;
+
+	/* the lock taken by bgp_node_get() stands in for the path's */
+	for (i = 0; i < prefixes; i++) {
+		p.prefix.s_addr = htonl(0x01000000 + (i << 8));
+		bgp_node_get(table, (struct prefix *)&p);
+	}
+}
+
+static int run_model(const char *name, bool compact, safi_t safi,
+		     unsigned int prefixes, unsigned int nsubgrps)
+{
+	struct bgp_table *table = bgp->rib[AFI_IP][SAFI_UNICAST];
+	struct update_group updgrp = {
+		.bgp = bgp,
+		.afi = AFI_IP,
+		.safi = safi,
+	};
+	struct update_subgroup *subgrps;
+	unsigned long rss_base, rss_adj, entries, mtype_bytes;
+	struct bgp_dest *dest;
+	struct timeval tv;
+	int64_t alloc_usec, clear_usec;
+	unsigned int i;
+	int failed = 0;
+
+	if (compact)
+		SET_FLAG(bm->flags, BM_FLAG_ADJ_OUT_COMPACT);
+
+	populate(table, prefixes);
+
+	subgrps = calloc(nsubgrps, sizeof(*subgrps));
+	for (i = 0; i < nsubgrps; i++) {
+		subgrps[i].update_group = &updgrp;
+		TAILQ_INIT(&subgrps[i].adjq);
+	}
+
+	rss_base = rss_kb();
+	monotime(&tv);
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest))
+		for (i = 0; i < nsubgrps; i++)
+			bgp_adj_out_alloc(&subgrps[i], dest, 0);
+
+	alloc_usec = monotime_since(&tv, NULL);
+	rss_adj = rss_kb();
+
+	entries = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT) +
+		  mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_COMPACT);
+	mtype_bytes = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT) *
+			      sizeof(struct bgp_adj_out_full) +
+		      mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_COMPACT) *
+			      sizeof(struct bgp_adj_out) +
+		      mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_EXT) *
+			      sizeof(struct bgp_adj_out_ext);
+
+	monotime(&tv);
+	for (i = 0; i < nsubgrps; i++)
+		subgroup_clear_table(&subgrps[i]);
+	clear_usec = monotime_since(&tv, NULL);
+
+	printf("%-8s %u prefixes x %u subgroups: %lu entries, %lu kB allocated, RSS +%lu kB, alloc %lld ms, clear %lld ms\n",
+	       name, prefixes, nsubgrps, entries,
+	       mtype_bytes / 1024, rss_adj - rss_base,
+	       (long long)alloc_usec / 1000, (long long)clear_usec / 1000);
+
+	if (entries != (unsigned long)prefixes * nsubgrps) {
+		printf("failed: %lu entries allocated, expected %lu\n", entries,
+		       (unsigned long)prefixes * nsubgrps);
+		failed++;
+	}
+	for (i = 0; i < nsubgrps; i++) {
+		if (subgrps[i].adj_count || subgrps[i].adj_compact_count ||
+		    !TAILQ_EMPTY(&subgrps[i].adjq)) {
+			printf("failed: subgroup %u not empty after clear\n", i);
+			failed++;
+		}
+	}
+	if (mtype_stats_alloc(MTYPE_BGP_ADJ_OUT) ||
+	    mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_COMPACT) ||
+	    mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_EXT)) {
+		printf("failed: adj-out entries left after clear\n");
+		failed++;
+	}
+	if (!failed)
+		printf("OK\n");
+	fflush(stdout);
+
+	for (i = 0; i < nsubgrps; i++)
+		bgp_dest_bitmap_fini(&subgrps[i].adj_dests);
+	free(subgrps);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int prefixes = ADJ_OUT_PREFIXES;
+	unsigned int nsubgrps = ADJ_OUT_SUBGROUPS;
+	int failed = 0;
+	int status;
+	pid_t pid;
+
+	if (argc > 1)
+		prefixes = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		nsubgrps = strtoul(argv[2], NULL, 10);
+	if (!prefixes || !nsubgrps || prefixes > (1U << 24)) {
+		fprintf(stderr, "usage: %s [prefixes] [subgroups]\n", argv[0]);
+		return 1;
+	}
+
+	qobj_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test adj-out memory");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	for (unsigned int i = 0; i < array_size(models); i++) {
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0)
+			exit(run_model(models[i].name, models[i].compact,
+				       models[i].safi, prefixes, nsubgrps));
+
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status))
+			failed++;
+	}
+
+	return failed;
+}
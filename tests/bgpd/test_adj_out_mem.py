@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestAdjOutMem(frrtest.TestMultiOut):
+    program = "./test_adj_out_mem"
+
+
+TestAdjOutMem.okfail("full ")
+TestAdjOutMem.okfail("compact ")
+TestAdjOutMem.okfail("labeled ")
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures AS path parsing, interning and comparison at
+ * the scale of a full table: many routes sharing fewer distinct paths.
+ *
+ *   test_aspath_perf [routes] [paths]
+ */
+
+#include <zebra.h>
+
+#include "monotime.h"
+#include "privs.h"
+#include "memory.h"
+#include "stream.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master;
+
+#define ASPATH_ROUTES 1000000
+#define ASPATH_PATHS 300000
+
+/* Longest generated path: 8 ASNs in a sequence and a 4 ASN set */
+#define ASPATH_WIRE_MAX (2 + 8 * 4 + 2 + 4 * 4)
+
+enum aspath_phase {
+	PHASE_PARSE = 0,
+	PHASE_COMPARE,
+	PHASE_INSPECT,
+	PHASE_UNINTERN,
+	PHASE_MAX,
+};
+
+static const char *const phase_names[PHASE_MAX] = {
+	[PHASE_PARSE] = "parse + intern",
+	[PHASE_COMPARE] = "compare",
+	[PHASE_INSPECT] = "hops/first/last",
+	[PHASE_UNINTERN] = "unintern",
+};
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+	/* xorshift32, so that runs are reproducible */
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+/* Encode path @i in 4-byte ASN wire format, returning its length */
+static size_t make_path(uint8_t *buf, unsigned int i)
+{
+	unsigned int len, j;
+	size_t off = 0;
+	uint32_t asn;
+
+	rnd_state = i * 2654435761U + 1;
+	len = 1 + rnd() % 8;
+
+	buf[off++] = AS_SEQUENCE;
+	buf[off++] = len;
+	for (j = 0; j < len; j++) {
+		/* mostly 2-byte ASNs, and a distinct origin for each path */
+		asn = 1 + rnd() % 65000;
+		if (j == len - 1)
+			asn = 131072 + i;
+		asn = htonl(asn);
+		memcpy(buf + off, &asn, sizeof(asn));
+		off += sizeof(asn);
+	}
+
+	/* the occasional aggregate */
+	if (i % 100 == 0) {
+		buf[off++] = AS_SET;
+		buf[off++] = 4;
+		for (j = 0; j < 4; j++) {
+			asn = htonl(1 + rnd() % 65000);
+			memcpy(buf + off, &asn, sizeof(asn));
+			off += sizeof(asn);
+		}
+	}
+
+	return off;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int routes = ASPATH_ROUTES;
+	unsigned int paths = ASPATH_PATHS;
+	struct aspath **interned, *as;
+	struct stream *s;
+	struct timeval tv;
+	unsigned long count;
+	uint8_t buf[ASPATH_WIRE_MAX];
+	uint64_t sum = 0;
+	int64_t usec;
+	unsigned int i, mismatches = 0;
+	size_t len;
+	int failed = 0;
+
+	if (argc > 1)
+		routes = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		paths = strtoul(argv[2], NULL, 10);
+	if (!routes || !paths || paths > routes) {
+		fprintf(stderr, "usage: %s [routes] [paths <= routes]\n",
+			argv[0]);
+		return 1;
+	}
+
+	aspath_init();
+	interned = calloc(routes, sizeof(*interned));
+	s = stream_new(ASPATH_WIRE_MAX);
+
+	for (enum aspath_phase phase = 0; phase < PHASE_MAX; phase++) {
+		monotime(&tv);
+
+		for (i = 0; i < routes; i++) {
+			switch (phase) {
+			case PHASE_PARSE:
+				len = make_path(buf, i % paths);
+				stream_reset(s);
+				stream_put(s, buf, len);
+				interned[i] = aspath_parse(s, len, 1,
+							   ASNOTATION_PLAIN);
+				break;
+			case PHASE_COMPARE:
+				/* same path as the next route, or not */
+				as = interned[(i + 1) % routes];
+				if (aspath_cmp(interned[i], as) !=
+				    (interned[i] == as))
+					mismatches++;
+				break;
+			case PHASE_INSPECT:
+				as = interned[i];
+				sum += aspath_count_hops(as) +
+				       aspath_get_first_as(as) +
+				       aspath_get_last_as(as);
+				break;
+			case PHASE_UNINTERN:
+				aspath_unintern(&interned[i]);
+				break;
+			case PHASE_MAX:
+				break;
+			}
+		}
+
+		usec = monotime_since(&tv, NULL);
+		printf("%-16s %u routes, %u paths: %lld.%03lld ms (%.2f Mops/s)\n",
+		       phase_names[phase], routes, paths,
+		       (long long)usec / 1000, (long long)usec % 1000,
+		       usec ? (double)routes / usec : 0.0);
+
+		if (phase == PHASE_PARSE) {
+			for (i = 0; i < routes; i++)
+				if (!interned[i])
+					mismatches++;
+
+			count = aspath_count();
+			if (count != paths) {
+				printf("failed: %lu paths interned, expected %u\n",
+				       count, paths);
+				failed++;
+			}
+		}
+	}
+
+	/* keep the compiler from dropping the inspect phase */
+	printf("checksum %" PRIu64 "\n", sum);
+
+	if (mismatches) {
+		printf("failed: %u paths not parsed or compared wrongly\n",
+		       mismatches);
+		failed++;
+	}
+
+	count = aspath_count();
+	if (count) {
+		printf("failed: %lu paths left after unintern\n", count);
+		failed++;
+	}
+	fflush(stdout);
+
+	stream_free(s);
+	free(interned);
+	aspath_finish();
+
+	return failed;
+}
@@ -0,0 +1,12 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestAspathPerf(frrtest.TestMultiOut):
+    program = "./test_aspath_perf"
+
+
+TestAspathPerf.onesimple("parse + intern")
+TestAspathPerf.onesimple("compare")
+TestAspathPerf.onesimple("hops/first/last")
+TestAspathPerf.onesimple("unintern")
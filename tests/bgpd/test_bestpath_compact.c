@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Compact best-path selection equivalence tests.
+ *
+ * Checks that bgp_path_cand_cmp() agrees with bgp_path_info_cmp() on the
+ * result, the multipath equality and the selection reason, for randomly
+ * generated paths under the various "bgp bestpath" knobs.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+
+#include "tests/helpers/c/prng.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define NPEERS 8
+#define NPATHS 24
+#define ROUNDS 200
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 100;
+static struct bgp_dest *dest;
+static struct prng *prng;
+
+static struct peer *peers[NPEERS];
+
+static const char *const aspath_strs[] = {
+	"",
+	"200",
+	"300",
+	"200 300",
+	"300 200",
+	"200 300 400",
+	"200 {300,400}",
+	"(65001) 200",
+	"(65001 65002) 200",
+	"(65002) 300",
+	"(65001)",
+	"[65001 65002] 200",
+};
+#define NASPATHS array_size(aspath_strs)
+static struct aspath *aspaths[NASPATHS];
+
+static struct in_addr cluster_ids[2];
+static struct cluster_list clusters[3] = {
+	{ .length = 0 },
+	{ .length = 4, .list = cluster_ids },
+	{ .length = 8, .list = cluster_ids },
+};
+
+static struct community *llgr_stale;
+static struct bgp_labels label_valid;
+
+struct scenario {
+	const char *name;
+	uint64_t flags;
+	bool confederation;
+	/* also generate UPA, LLGR_STALE, stale paths */
+	bool special;
+	/* also generate paths that go through bgp_path_info_cmp() */
+	bool complex;
+};
+
+static const struct scenario scenarios[] = {
+	{ "default" },
+	{ "always-compare-med", BGP_FLAG_ALWAYS_COMPARE_MED },
+	{ "med-confed-missing-as-worst",
+	  BGP_FLAG_MED_CONFED | BGP_FLAG_MED_MISSING_AS_WORST },
+	{ "as-path-confed", BGP_FLAG_ASPATH_CONFED },
+	{ "as-path-ignore", BGP_FLAG_ASPATH_IGNORE },
+	{ "as-path-multipath-relax", BGP_FLAG_ASPATH_MULTIPATH_RELAX },
+	{ "peer-type-multipath-relax", BGP_FLAG_PEERTYPE_MULTIPATH_RELAX },
+	{ "compare-routerid", BGP_FLAG_COMPARE_ROUTER_ID },
+	{ "confederation", BGP_FLAG_PEERTYPE_MULTIPATH_RELAX, true },
+	{ "upa-llgr-stale", 0, false, true },
+	{ "fallback", BGP_FLAG_COMPARE_AIGP, false, true, true },
+	{},
+};
+
+static const uint64_t scenario_flags_mask =
+	BGP_FLAG_ALWAYS_COMPARE_MED | BGP_FLAG_MED_CONFED |
+	BGP_FLAG_MED_MISSING_AS_WORST | BGP_FLAG_ASPATH_CONFED |
+	BGP_FLAG_ASPATH_IGNORE | BGP_FLAG_ASPATH_MULTIPATH_RELAX |
+	BGP_FLAG_PEERTYPE_MULTIPATH_RELAX | BGP_FLAG_COMPARE_ROUTER_ID |
+	BGP_FLAG_COMPARE_AIGP;
+
+static unsigned int rnd(unsigned int n)
+{
+	return (unsigned int)prng_rand(prng) % n;
+}
+
+static void setup_peers(void)
+{
+	static const enum bgp_peer_sort sorts[NPEERS] = {
+		BGP_PEER_EBGP,	 BGP_PEER_EBGP,	  BGP_PEER_EBGP,
+		BGP_PEER_EBGP,	 BGP_PEER_IBGP,	  BGP_PEER_IBGP,
+		BGP_PEER_CONFED, BGP_PEER_CONFED,
+	};
+	static const as_t ases[NPEERS] = {
+		200, 200, 300, 400, 100, 100, 65001, 65002,
+	};
+	union sockunion su;
+	char addr[64];
+	int i;
+
+	for (i = 0; i < NPEERS; i++) {
+		/* mix of address families, last one has no su_remote */
+		if (i % 3 == 2)
+			snprintf(addr, sizeof(addr), "2001:db8::%d", 10 - i);
+		else
+			snprintf(addr, sizeof(addr), "192.0.2.%d", 10 - i);
+		str2sockunion(addr, &su);
+
+		peers[i] = peer_create_accept(bgp, &su);
+		peers[i]->host = XSTRDUP(MTYPE_BGP_PEER_HOST, addr);
+		peers[i]->connection->status = Established;
+		if (i != NPEERS - 1)
+			peers[i]->connection->su_remote = sockunion_dup(&su);
+
+		peers[i]->sort = sorts[i];
+		peers[i]->as = ases[i];
+		peers[i]->remote_id.s_addr = htonl(0x0a000000 + (i % 5));
+	}
+
+	/* one eBGP-OAD peer */
+	peers[3]->sub_sort = BGP_PEER_EBGP_OAD;
+}
+
+static void setup_attrs(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < NASPATHS; i++)
+		aspaths[i] = aspath_intern(
+			aspath_str2aspath(aspath_strs[i], ASNOTATION_PLAIN));
+
+	llgr_stale = community_new();
+	community_add_val(llgr_stale, COMMUNITY_LLGR_STALE);
+	llgr_stale = community_intern(llgr_stale);
+
+	label_valid.num_labels = 1;
+	bgp_set_valid_label(&label_valid.label[0]);
+}
+
+static void make_path(struct bgp_path_info *pi, struct attr *attr,
+		      struct bgp_path_info_extra *extra,
+		      const struct scenario *sc)
+{
+	memset(pi, 0, sizeof(*pi));
+	memset(attr, 0, sizeof(*attr));
+	memset(extra, 0, sizeof(*extra));
+
+	pi->net = dest;
+	pi->peer = peers[rnd(NPEERS)];
+	pi->attr = attr;
+	pi->type = ZEBRA_ROUTE_BGP;
+	pi->sub_type = BGP_ROUTE_NORMAL;
+
+	attr->weight = rnd(4) ? 0 : rnd(2) * 100;
+	if (rnd(2)) {
+		attr->local_pref = 100 + rnd(2) * 100;
+		bgp_attr_set(attr, BGP_ATTR_LOCAL_PREF);
+	}
+	if (rnd(3)) {
+		attr->med = rnd(3) * 10;
+		bgp_attr_set(attr, BGP_ATTR_MULTI_EXIT_DISC);
+	}
+	attr->origin = rnd(3);
+	attr->aspath = aspaths[rnd(NASPATHS)];
+	if (!rnd(4)) {
+		attr->originator_id.s_addr = htonl(0x0a000000 + rnd(5));
+		bgp_attr_set(attr, BGP_ATTR_ORIGINATOR_ID);
+	}
+	if (rnd(2))
+		bgp_attr_set_cluster(attr, &clusters[rnd(3)]);
+
+	if (rnd(4)) {
+		extra->igpmetric = rnd(3) * 10;
+		if (!rnd(4))
+			extra->labels = &label_valid;
+		pi->extra = extra;
+	}
+
+	if (!rnd(8))
+		SET_FLAG(pi->flags, BGP_PATH_SELECTED);
+
+	if (sc->special) {
+		if (!rnd(8))
+			SET_FLAG(pi->flags, BGP_PATH_UPA);
+		if (!rnd(8))
+			SET_FLAG(pi->flags, BGP_PATH_STALE);
+		if (!rnd(8))
+			bgp_attr_set_community(attr, llgr_stale);
+	}
+
+	if (sc->complex) {
+		if (!rnd(4))
+			pi->sub_type = BGP_ROUTE_STATIC;
+		/* AIGP total is then the IGP metric */
+		if (!rnd(4))
+			bgp_attr_set(attr, BGP_ATTR_AIGP);
+	}
+}
+
+static void run_scenario(const struct scenario *sc)
+{
+	struct bgp_path_info pis[NPATHS];
+	struct attr attrs[NPATHS];
+	struct bgp_path_info_extra extras[NPATHS];
+	struct bgp_path_cand cands[NPATHS];
+	struct bgp_maxpaths_cfg mpath_cfgs[2] = {};
+	struct bgp_maxpaths_cfg *mpath_cfg;
+	enum bgp_path_selection_reason reason1, reason2;
+	int ret1, ret2, eq1, eq2;
+	char pfx_buf[PREFIX2STR_BUFFER] = "";
+	unsigned int mismatches = 0;
+	int round, i, j, c;
+	int best1, best2;
+
+	printf("%s\n", sc->name);
+
+	bgp->flags = (bgp->flags & ~scenario_flags_mask) | sc->flags;
+	if (sc->confederation)
+		SET_FLAG(bgp->config, BGP_CONFIG_CONFEDERATION);
+	else
+		UNSET_FLAG(bgp->config, BGP_CONFIG_CONFEDERATION);
+
+	mpath_cfgs[0].same_clusterlen = true;
+
+	for (round = 0; round < ROUNDS; round++) {
+		for (i = 0; i < NPATHS; i++)
+			make_path(&pis[i], &attrs[i], &extras[i], sc);
+		for (i = 0; i < NPATHS; i++)
+			bgp_path_cand_fill(bgp, &cands[i], &pis[i], AFI_IP,
+					   SAFI_UNICAST);
+
+		for (c = 0; c < 3; c++) {
+			mpath_cfg = c < 2 ? &mpath_cfgs[c] : NULL;
+
+			for (i = 0; i < NPATHS; i++) {
+				for (j = 0; j < NPATHS; j++) {
+					if (i == j)
+						continue;
+
+					reason1 = reason2 =
+						bgp_path_selection_none;
+					ret1 = bgp_path_info_cmp(bgp, &pis[i],
+								 &pis[j], &eq1,
+								 mpath_cfg,
+								 false, pfx_buf,
+								 AFI_IP,
+								 SAFI_UNICAST,
+								 &reason1);
+					ret2 = bgp_path_cand_cmp(bgp, &cands[i],
+								 &cands[j],
+								 &eq2, mpath_cfg,
+								 AFI_IP,
+								 SAFI_UNICAST,
+								 &reason2);
+
+					if (ret1 == ret2 && eq1 == eq2 &&
+					    reason1 == reason2)
+						continue;
+
+					if (!mismatches)
+						printf("round %d paths %d/%d: ret %d/%d paths_eq %d/%d reason %d/%d\n",
+						       round, i, j, ret1, ret2,
+						       eq1, eq2, reason1,
+						       reason2);
+					mismatches++;
+				}
+			}
+
+			/* Same winner when scanning the whole set */
+			best1 = best2 = 0;
+			for (i = 1; i < NPATHS; i++) {
+				if (bgp_path_info_cmp(bgp, &pis[i],
+						      &pis[best1], &eq1,
+						      mpath_cfg, false, pfx_buf,
+						      AFI_IP, SAFI_UNICAST,
+						      &reason1))
+					best1 = i;
+				if (bgp_path_cand_cmp(bgp, &cands[i],
+						      &cands[best2], &eq2,
+						      mpath_cfg, AFI_IP,
+						      SAFI_UNICAST, &reason2))
+					best2 = i;
+			}
+			if (best1 != best2) {
+				if (!mismatches)
+					printf("round %d: selected %d/%d\n",
+					       round, best1, best2);
+				mismatches++;
+			}
+		}
+	}
+
+	if (mismatches) {
+		printf("%u mismatches\n", mismatches);
+		printf("failed\n");
+		failed++;
+	} else
+		printf("OK\n");
+}
+
+int main(void)
+{
+	struct prefix p;
+	int i;
+
+	qobj_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test bestpath compact");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	str2prefix("198.51.100.0/24", &p);
+	dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+
+	prng = prng_new(0);
+	setup_peers();
+	setup_attrs();
+
+	for (i = 0; scenarios[i].name; i++)
+		run_scenario(&scenarios[i]);
+
+	prng_free(prng);
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,19 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestBestpathCompact(frrtest.TestMultiOut):
+    program = "./test_bestpath_compact"
+
+
+TestBestpathCompact.okfail("default")
+TestBestpathCompact.okfail("always-compare-med")
+TestBestpathCompact.okfail("med-confed-missing-as-worst")
+TestBestpathCompact.okfail("as-path-confed")
+TestBestpathCompact.okfail("as-path-ignore")
+TestBestpathCompact.okfail("as-path-multipath-relax")
+TestBestpathCompact.okfail("peer-type-multipath-relax")
+TestBestpathCompact.okfail("compare-routerid")
+TestBestpathCompact.okfail("confederation")
+TestBestpathCompact.okfail("upa-llgr-stale")
+TestBestpathCompact.okfail("fallback")
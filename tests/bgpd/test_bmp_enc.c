@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * BMP Route Monitoring encoding test.
+ *
+ * Encodes the UPDATE of a Route Monitoring job for an IPv6 peer as it is
+ * done without the encoder pthread, on the peer itself, and as the encoder
+ * pthread does it, on the stand-in peer made up from what the job copied
+ * of the peer, and checks that both come out the same, with the link-local
+ * nexthop chosen when the peer negotiated the link-local capability.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+#include "sockunion.h"
+
+/* for bmp_encpeer_snap(), bmp_encpeer_standin() and bmp_encjob_encode() */
+#include "bgpd/bgp_bmp.c"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peer;
+static struct attr *attr;
+static struct in6_addr nh_global, nh_local;
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("2001:db8::2", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "2001:db8::2");
+	peer->as = 65001;
+	peer->sort = BGP_PEER_EBGP;
+	inet_pton(AF_INET6, "fe80::2", &peer->nexthop.v6_local);
+}
+
+static void setup_attr(void)
+{
+	struct attr tmp = {};
+
+	inet_pton(AF_INET6, "2001:db8::1", &nh_global);
+	inet_pton(AF_INET6, "fe80::1", &nh_local);
+
+	tmp.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&tmp, BGP_ATTR_ORIGIN);
+	tmp.aspath = aspath_empty(ASNOTATION_PLAIN);
+	tmp.mp_nexthop_len = BGP_ATTR_NHLEN_IPV6_GLOBAL;
+	tmp.mp_nexthop_global = nh_global;
+	tmp.mp_nexthop_local = nh_local;
+	attr = bgp_attr_intern(&tmp);
+}
+
+static struct bmp_encjob *make_job(void)
+{
+	struct bmp_encjob *job = XCALLOC(MTYPE_BMP_ENCJOB, sizeof(*job));
+
+	job->peer = peer;
+	bmp_encpeer_snap(&job->enc, peer, AFI_IP6, SAFI_UNICAST);
+	job->attr = bgp_attr_intern(attr);
+	str2prefix("2001:db8:1::/48", &job->p);
+	job->afi = AFI_IP6;
+	job->safi = SAFI_UNICAST;
+	return job;
+}
+
+/* whether the 16 byte nexthop of the UPDATE in @s is @nh */
+static bool has_nexthop(struct stream *s, const struct in6_addr *nh)
+{
+	size_t i;
+
+	for (i = BGP_HEADER_SIZE; i + 1 + IPV6_MAX_BYTELEN <= stream_get_endp(s);
+	     i++)
+		if (STREAM_DATA(s)[i] == IPV6_MAX_BYTELEN &&
+		    !memcmp(STREAM_DATA(s) + i + 1, nh, IPV6_MAX_BYTELEN))
+			return true;
+	return false;
+}
+
+static void check(const struct in6_addr *expect_nh)
+{
+	struct bmp_encjob *job = make_job();
+	struct stream *inline_msg;
+
+	bmp_encjob_encode(job, peer, NULL);
+	inline_msg = job->msg;
+	job->msg = NULL;
+
+	/* the peer changes after the job is queued */
+	peer->cap = 0;
+	memset(&peer->nexthop.v6_local, 0, sizeof(peer->nexthop.v6_local));
+
+	bmp_encjob_encode(job, bmp_encpeer_standin(job), NULL);
+
+	if (!inline_msg || !job->msg ||
+	    stream_get_endp(inline_msg) != stream_get_endp(job->msg) ||
+	    memcmp(STREAM_DATA(inline_msg), STREAM_DATA(job->msg),
+		   stream_get_endp(inline_msg))) {
+		printf("encoder pthread and inline UPDATEs differ\n");
+		failed++;
+	}
+	if (!inline_msg || !has_nexthop(inline_msg, expect_nh)) {
+		printf("wrong nexthop encoded\n");
+		failed++;
+	}
+
+	stream_free(inline_msg);
+	/* the job holds no lock on the peer here */
+	job->peer = NULL;
+	bmp_encjob_free(NULL, job);
+}
+
+int main(void)
+{
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test bmp enc");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+	setup_peer();
+	setup_attr();
+
+	printf("global nexthop\n");
+	before = failed;
+	check(&nh_global);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("link-local nexthop\n");
+	before = failed;
+	SET_FLAG(peer->flags, PEER_FLAG_CAPABILITY_LINK_LOCAL);
+	SET_FLAG(peer->cap, PEER_CAP_LINK_LOCAL_ADV | PEER_CAP_LINK_LOCAL_RCV);
+	inet_pton(AF_INET6, "fe80::2", &peer->nexthop.v6_local);
+	check(&nh_local);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
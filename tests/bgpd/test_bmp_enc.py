@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestBmpEnc(frrtest.TestMultiOut):
+    program = "./test_bmp_enc"
+
+
+TestBmpEnc.okfail("global nexthop")
+TestBmpEnc.okfail("link-local nexthop")
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Conditional advertisement prefix-list interest test.
+ *
+ * Checks which condition route-maps bgp_route_map_prefix_lists() finds to
+ * only permit prefixes of a few prefix-lists, so that conditional
+ * advertisement can track these prefixes rather than walk the table, and
+ * which ones may permit any prefix.  Also checks that looking at what the
+ * prefix-lists permit, as conditional advertisement does to track those
+ * prefixes, counts no hits on their entries.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+#include "plist.h"
+#include "plist_int.h"
+#include "routemap.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define MAX_PLISTS 4
+
+static int failed;
+static struct prefix_list *plist_v4, *plist_v6;
+
+static void add_plist_match(struct route_map *map, enum route_map_type type,
+			    int pref, const char *match, const char *plist)
+{
+	struct route_map_index *index = route_map_index_get(map, type, pref);
+
+	route_map_add_match(index, match, plist, RMAP_EVENT_PLIST_ADDED);
+}
+
+static void check_hits(const char *prefix, enum prefix_list_type expect,
+		       unsigned long expect_hits, struct prefix_list_entry *ple)
+{
+	unsigned long hits;
+	struct prefix p;
+
+	str2prefix(prefix, &p);
+	if (prefix_list_apply_nohit(plist_v4, &p) != expect) {
+		printf("%s: wrong type\n", prefix);
+		failed++;
+	}
+	hits = atomic_load_explicit(&ple->hitcnt, memory_order_relaxed);
+	if (hits != expect_hits) {
+		printf("%s: %lu hits, expected %lu\n", prefix, hits, expect_hits);
+		failed++;
+	}
+}
+
+static void check(const char *name, unsigned int max, bool expect_ret,
+		  unsigned int expect_n, struct prefix_list *expect0,
+		  struct prefix_list *expect1)
+{
+	struct prefix_list *plists[MAX_PLISTS];
+	unsigned int nplists = 0;
+	bool ret;
+
+	ret = bgp_route_map_prefix_lists(route_map_lookup_by_name(name), plists,
+					 &nplists, max);
+	if (ret != expect_ret) {
+		printf("%s: %s, expected %s\n", name, ret ? "true" : "false",
+		       expect_ret ? "true" : "false");
+		failed++;
+		return;
+	}
+	if (!ret)
+		return;
+
+	if (nplists != expect_n || (expect_n > 0 && plists[0] != expect0) ||
+	    (expect_n > 1 && plists[1] != expect1)) {
+		printf("%s: %u prefix-lists, expected %u\n", name, nplists,
+		       expect_n);
+		failed++;
+	}
+}
+
+int main(void)
+{
+	struct prefix_list_entry *ple;
+	struct route_map *map;
+	struct prefix p;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test cond adv plists");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	plist_v4 = prefix_list_get(AFI_IP, 0, "V4");
+	plist_v6 = prefix_list_get(AFI_IP6, 0, "V6");
+
+	printf("prefix-lists\n");
+	before = failed;
+	map = route_map_get("LISTS");
+	add_plist_match(map, RMAP_PERMIT, 10, "ip address prefix-list", "V4");
+	add_plist_match(map, RMAP_PERMIT, 20, "ipv6 address prefix-list", "V6");
+	/* the same list again only counts once */
+	add_plist_match(map, RMAP_PERMIT, 30, "ip address prefix-list", "V4");
+	/* deny entries permit nothing, whatever they match */
+	route_map_index_get(map, RMAP_DENY, 40);
+	check("LISTS", MAX_PLISTS, true, 2, plist_v4, plist_v6);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("missing list\n");
+	before = failed;
+	map = route_map_get("MISSING");
+	add_plist_match(map, RMAP_PERMIT, 10, "ip address prefix-list", "NONE");
+	add_plist_match(map, RMAP_PERMIT, 20, "ip address prefix-list", "V4");
+	check("MISSING", MAX_PLISTS, true, 1, plist_v4, NULL);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("any prefix\n");
+	before = failed;
+	map = route_map_get("ANY");
+	add_plist_match(map, RMAP_PERMIT, 10, "ip address prefix-list", "V4");
+	route_map_add_match(route_map_index_get(map, RMAP_PERMIT, 20), "metric",
+			    "3", RMAP_EVENT_MATCH_ADDED);
+	check("ANY", MAX_PLISTS, false, 0, NULL, NULL);
+	check("UNDEFINED", MAX_PLISTS, false, 0, NULL, NULL);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("too many lists\n");
+	before = failed;
+	check("LISTS", 1, false, 0, NULL, NULL);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("no hits\n");
+	before = failed;
+	ple = prefix_list_entry_new();
+	ple->pl = plist_v4;
+	ple->seq = 5;
+	ple->type = PREFIX_PERMIT;
+	str2prefix("10.0.0.0/8", &ple->prefix);
+	ple->le = IPV4_MAX_BITLEN;
+	prefix_list_entry_update_finish(ple);
+
+	check_hits("10.1.0.0/16", PREFIX_PERMIT, 0, ple);
+	check_hits("192.0.2.0/24", PREFIX_DENY, 0, ple);
+	/* applying the list still counts */
+	str2prefix("10.1.0.0/16", &p);
+	prefix_list_apply(plist_v4, &p);
+	check_hits("10.1.0.0/16", PREFIX_PERMIT, 1, ple);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
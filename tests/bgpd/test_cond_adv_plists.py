@@ -0,0 +1,13 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestCondAdvPlists(frrtest.TestMultiOut):
+    program = "./test_cond_adv_plists"
+
+
+TestCondAdvPlists.okfail("prefix-lists")
+TestCondAdvPlists.okfail("missing list")
+TestCondAdvPlists.okfail("any prefix")
+TestCondAdvPlists.okfail("too many lists")
+TestCondAdvPlists.okfail("no hits")
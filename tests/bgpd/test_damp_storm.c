@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures route flap dampening during a flap storm: a
+ * full table flapping until all of it is suppressed, then the reuse of the
+ * routes as their penalties decay, with the clock of the reuse wheel moved
+ * forward instead of waiting for it.  Checks that all routes are reused,
+ * no sooner than their penalty allows and within the max suppress time.
+ *
+ *   test_damp_storm [routes] [flaps]
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+/* for bgp_reuse_tick() and bgp_reuse_run_batch() */
+#include "bgpd/bgp_damp.c"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define DAMP_ROUTES 100000
+#define DAMP_FLAPS 10
+
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peer;
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("192.0.2.1", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "192.0.2.1");
+	peer->as = 65001;
+	peer->sort = BGP_PEER_EBGP;
+}
+
+static struct bgp_path_info *add_route(unsigned int i)
+{
+	struct prefix p = { .family = AF_INET, .prefixlen = IPV4_MAX_BITLEN };
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct attr attr = {}, *attr_new;
+
+	p.u.prefix4.s_addr = htonl(0x0a000000 + i);
+
+	attr.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&attr, BGP_ATTR_ORIGIN);
+	attr.nexthop.s_addr = htonl(0xc0000201);
+	bgp_attr_set(&attr, BGP_ATTR_NEXT_HOP);
+	attr_new = bgp_attr_intern(&attr);
+
+	dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer, attr_new,
+		       dest);
+	SET_FLAG(pi->flags, BGP_PATH_VALID);
+	bgp_path_info_add(dest, pi);
+	bgp_dest_unlock_node(dest);
+
+	return pi;
+}
+
+static size_t suppressed(struct bgp_damp_config *bdc)
+{
+	size_t count = bgp_damp_list_count(&bdc->reuse_ready);
+	unsigned int i;
+
+	for (i = 0; i < bdc->reuse_list_size; i++)
+		count += bgp_damp_list_count(&bdc->reuse_list[i]);
+
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int routes = DAMP_ROUTES, flaps = DAMP_FLAPS;
+	unsigned int i, f, ticks = 0, batches = 0, wrong = 0;
+	struct bgp_path_info **paths;
+	struct bgp_damp_config *bdc;
+	struct timeval tv;
+	time_t t_start, t_now, first = 0, last = 0;
+	int64_t usec, batch_usec, max_batch = 0, reuse_usec = 0;
+	size_t left, before;
+	int failed = 0;
+
+	if (argc > 1)
+		routes = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		flaps = strtoul(argv[2], NULL, 10);
+	/* a route must reach the suppress penalty */
+	if (!routes || flaps < 3) {
+		fprintf(stderr, "usage: %s [routes] [flaps >= 3]\n", argv[0]);
+		return 1;
+	}
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test damp storm");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+	setup_peer();
+
+	bgp_damp_enable(bgp, AFI_IP, SAFI_UNICAST, DEFAULT_HALF_LIFE * 60,
+			DEFAULT_REUSE, DEFAULT_SUPPRESS,
+			DEFAULT_HALF_LIFE * 60 * 4);
+	bdc = &bgp->damp[AFI_IP][SAFI_UNICAST];
+
+	paths = calloc(routes, sizeof(*paths));
+	for (i = 0; i < routes; i++)
+		paths[i] = add_route(i);
+
+	/* every route flaps in turn, as a table does behind a bad link */
+	t_start = monotime(&tv);
+	for (f = 0; f < flaps; f++)
+		for (i = 0; i < routes; i++) {
+			bgp_damp_withdraw(paths[i], paths[i]->net, AFI_IP,
+					  SAFI_UNICAST, 0);
+			bgp_damp_update(paths[i], paths[i]->net, AFI_IP,
+					SAFI_UNICAST);
+		}
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u routes x %u flaps: %lld.%03lld ms (%.2f flaps/us)\n",
+	       "flap storm", routes, flaps, (long long)usec / 1000,
+	       (long long)usec % 1000,
+	       usec ? (double)routes * flaps / usec : 0.0);
+
+	if (suppressed(bdc) != routes) {
+		printf("failed: %zu routes suppressed, expected %u\n",
+		       suppressed(bdc), routes);
+		failed++;
+	}
+
+	/* what the reuse timer and the batches it schedules do, over time */
+	t_now = t_start;
+	left = suppressed(bdc);
+	while (left && ticks < 2 * bdc->max_suppress_time / DELTA_REUSE) {
+		t_now += DELTA_REUSE;
+		ticks++;
+		bgp_reuse_tick(bdc, t_now);
+
+		do {
+			monotime(&tv);
+			before = bgp_damp_list_count(&bdc->reuse_ready);
+			bgp_reuse_run_batch(bdc, t_now);
+			batch_usec = monotime_since(&tv, NULL);
+			if (!before)
+				break;
+			batches++;
+			reuse_usec += batch_usec;
+			max_batch = MAX(max_batch, batch_usec);
+		} while (bgp_damp_list_count(&bdc->reuse_ready));
+
+		before = left;
+		left = suppressed(bdc);
+		if (left < before) {
+			if (!first)
+				first = t_now - t_start;
+			last = t_now - t_start;
+		}
+	}
+	printf("%-16s %u routes, %u ticks, %u batches: %lld.%03lld ms (longest batch %lld.%03lld ms)\n",
+	       "reuse", routes, ticks, batches, (long long)reuse_usec / 1000,
+	       (long long)reuse_usec % 1000, (long long)max_batch / 1000,
+	       (long long)max_batch % 1000);
+	printf("%-16s first after %llds, last after %llds\n", "reuse time",
+	       (long long)first, (long long)last);
+
+	for (i = 0; i < routes; i++)
+		if (CHECK_FLAG(paths[i]->flags, BGP_PATH_DAMPED))
+			wrong++;
+	if (left || wrong) {
+		printf("failed: %zu routes left suppressed, %u still damped\n",
+		       left, wrong);
+		failed++;
+	}
+
+	/* from the suppress penalty down to the reuse one takes over a half-life */
+	if (first < bdc->half_life ||
+	    last > bdc->max_suppress_time + 2 * DELTA_REUSE) {
+		printf("failed: reused from %llds to %llds, half-life %llds, max suppress %llds\n",
+		       (long long)first, (long long)last,
+		       (long long)bdc->half_life,
+		       (long long)bdc->max_suppress_time);
+		failed++;
+	}
+	fflush(stdout);
+
+	free(paths);
+
+	return failed;
+}
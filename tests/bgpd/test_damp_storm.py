@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestDampStorm(frrtest.TestMultiOut):
+    program = "./test_damp_storm"
+
+
+TestDampStorm.onesimple("flap storm")
+TestDampStorm.onesimple("reuse time")
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures how long installing the remote routes of many
+ * L2VNIs takes, as when zebra sends all the VNIs after a restart while the
+ * EVPN routes are already learnt, and checks that each VNI gets the routes
+ * carrying its route-target and only those.
+ *
+ *   test_evpn_vni_scale [vnis] [vteps]
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_evpn.h"
+#include "bgpd/bgp_evpn_private.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_rd.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_zebra.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define EVPN_VNIS 4096
+#define EVPN_VTEPS 4
+#define EVPN_AS 65000
+
+static struct bgp *bgp;
+static as_t asn = EVPN_AS;
+static struct peer *peer;
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("192.0.2.1", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "192.0.2.1");
+	peer->as = EVPN_AS;
+	peer->sort = BGP_PEER_IBGP;
+}
+
+/* IMET route of remote VTEP @vtep for @vni, carrying the VNI's auto RT */
+static void add_remote_route(vni_t vni, unsigned int vtep)
+{
+	struct ecommunity_val eval;
+	struct ecommunity *ecom;
+	struct prefix_evpn p;
+	struct prefix_rd prd = { .family = AF_UNSPEC, .prefixlen = 64 };
+	struct ipaddr ip = { .ipa_type = IPADDR_V4 };
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct attr attr = {}, *attr_new;
+
+	ip.ipaddr_v4.s_addr = htonl(0xc6120000 + vtep + 1);
+	build_evpn_type3_prefix(&p, &ip);
+
+	/* type 1 RD, VTEP:VNI */
+	prd.val[1] = RD_TYPE_IP;
+	memcpy(&prd.val[2], &ip.ipaddr_v4, IPV4_MAX_BYTELEN);
+	prd.val[6] = (vni >> 8) & 0xff;
+	prd.val[7] = vni & 0xff;
+
+	attr.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&attr, BGP_ATTR_ORIGIN);
+	attr.local_pref = BGP_DEFAULT_LOCAL_PREF;
+	bgp_attr_set(&attr, BGP_ATTR_LOCAL_PREF);
+	attr.nexthop = ip.ipaddr_v4;
+	attr.mp_nexthop_global_in = ip.ipaddr_v4;
+	attr.mp_nexthop_len = IPV4_MAX_BYTELEN;
+	bgp_attr_set_pmsi_tnl_type(&attr, PMSI_TNLTYPE_INGR_REPL);
+
+	ecom = ecommunity_new();
+	encode_route_target_as(EVPN_AS, vni, &eval, true);
+	ecommunity_add_val(ecom, &eval, false, false);
+	bgp_attr_set_ecommunity(&attr, ecom);
+
+	attr_new = bgp_attr_intern(&attr);
+	bgp_attr_flush(&attr);
+
+	dest = bgp_afi_node_get(bgp->rib[AFI_L2VPN][SAFI_EVPN], AFI_L2VPN,
+				SAFI_EVPN, (struct prefix *)&p, &prd);
+	pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer, attr_new,
+		       dest);
+	SET_FLAG(pi->flags, BGP_PATH_VALID);
+	bgp_path_info_add(dest, pi);
+	bgp_dest_unlock_node(dest);
+}
+
+static unsigned int count_imported(struct bgpevpn *vpn)
+{
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	unsigned int count = 0;
+
+	for (dest = bgp_table_top(vpn->ip_table); dest;
+	     dest = bgp_route_next(dest))
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+			if (pi->sub_type == BGP_ROUTE_IMPORTED)
+				count++;
+
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int vnis = EVPN_VNIS, vteps = EVPN_VTEPS;
+	unsigned int i, v, walks = 0, wrong = 0;
+	struct ipaddr originator = { .ipa_type = IPADDR_V4 };
+	struct in_addr mcast_grp = {};
+	struct bgpevpn *vpn;
+	struct timeval tv;
+	int64_t usec;
+	int failed = 0;
+
+	if (argc > 1)
+		vnis = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		vteps = strtoul(argv[2], NULL, 10);
+	if (!vnis || !vteps || vteps > 250) {
+		fprintf(stderr, "usage: %s [vnis] [vteps <= 250]\n", argv[0]);
+		return 1;
+	}
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test evpn vni scale");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+	bgp->router_id.s_addr = htonl(0xc0000201);
+	setup_peer();
+
+	/* the routes are there first, as after a zebra restart */
+	monotime(&tv);
+	for (v = 1; v <= vnis; v++)
+		for (i = 0; i < vteps; i++)
+			add_remote_route(v, i);
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u routes: %lld.%03lld ms\n", "learn", vnis * vteps,
+	       (long long)usec / 1000, (long long)usec % 1000);
+
+	originator.ipaddr_v4.s_addr = htonl(0xc0000201);
+	monotime(&tv);
+	for (v = 1; v <= vnis; v++)
+		bgp_evpn_local_vni_add(bgp, v, &originator, VRF_DEFAULT,
+				       mcast_grp, 0);
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u VNIs: %lld.%03lld ms\n", "add VNIs", vnis,
+	       (long long)usec / 1000, (long long)usec % 1000);
+
+	/* what the timer of bgp_evpn_l2vni_remote_route_processing() runs */
+	monotime(&tv);
+	while (zebra_l2_vni_count(&bm->zebra_l2_vni_head)) {
+		event_cancel(&bm->t_bgp_zebra_l2_vni);
+		bgp_zebra_process_remote_routes_for_l2vni(NULL);
+		walks++;
+	}
+	event_cancel(&bm->t_bgp_zebra_l2_vni);
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u VNIs, %u walks: %lld.%03lld ms (%.2f VNIs/ms)\n",
+	       "install remote", vnis, walks, (long long)usec / 1000,
+	       (long long)usec % 1000, usec ? (double)vnis * 1000 / usec : 0.0);
+
+	for (v = 1; v <= vnis; v++) {
+		vpn = bgp_evpn_lookup_vni(bgp, v);
+		if (!vpn || count_imported(vpn) != vteps)
+			wrong++;
+	}
+	if (wrong) {
+		printf("%-16s failed: %u VNIs without exactly %u remote routes\n",
+		       "import", wrong, vteps);
+		failed++;
+	} else
+		printf("%-16s OK\n", "import");
+	fflush(stdout);
+
+	return failed;
+}
@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestEvpnVniScale(frrtest.TestMultiOut):
+    program = "./test_evpn_vni_scale"
+
+
+TestEvpnVniScale.onesimple("add VNIs")
+TestEvpnVniScale.okfail("import")
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures intern/unintern throughput of the BGP
+ * attribute intern store, using communities as the interned value.  No
+ * community alias is configured, so interning them from several pthreads is
+ * fine here; bgpd itself only does so from the main pthread.
+ *
+ *   test_intern_perf [entries] [threads]
+ */
+
+#include <zebra.h>
+
+#include "frratomic.h"
+#include "monotime.h"
+#include "privs.h"
+#include "memory.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_community.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master;
+
+#define INTERN_ENTRIES 1000000
+#define INTERN_THREADS 4
+
+enum intern_phase {
+	PHASE_INTERN = 0,
+	PHASE_LOOKUP,
+	PHASE_UNINTERN,
+	PHASE_MAX,
+};
+
+static const char *const phase_names[PHASE_MAX] = {
+	[PHASE_INTERN] = "intern (new)",
+	[PHASE_LOOKUP] = "intern (existing)",
+	[PHASE_UNINTERN] = "unintern",
+};
+
+struct intern_thread {
+	pthread_t pt;
+	enum intern_phase phase;
+	unsigned int start, end;
+};
+
+static struct community **tmp_new, **tmp_dup, **interned;
+static _Atomic unsigned int mismatches;
+
+static struct community *make_community(unsigned int i)
+{
+	struct community *com = community_new();
+
+	community_add_val(com, (64512U << 16) | (i & 0xffff));
+	community_add_val(com, i);
+	return com;
+}
+
+static void *intern_thread_func(void *arg)
+{
+	struct intern_thread *thr = arg;
+	struct community *com;
+	unsigned int i;
+
+	for (i = thr->start; i < thr->end; i++) {
+		switch (thr->phase) {
+		case PHASE_INTERN:
+			interned[i] = community_intern(tmp_new[i]);
+			break;
+		case PHASE_LOOKUP:
+			com = community_intern(tmp_dup[i]);
+			if (com != interned[i])
+				atomic_fetch_add_explicit(&mismatches, 1,
+							  memory_order_relaxed);
+			break;
+		case PHASE_UNINTERN:
+			/* the first one only drops a reference */
+			com = interned[i];
+			community_unintern(&com);
+			community_unintern(&interned[i]);
+			break;
+		case PHASE_MAX:
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int64_t run_phase(struct intern_thread *thr, unsigned int nthreads,
+			 enum intern_phase phase)
+{
+	struct timeval tv;
+	unsigned int i;
+
+	monotime(&tv);
+
+	for (i = 0; i < nthreads; i++) {
+		thr[i].phase = phase;
+		pthread_create(&thr[i].pt, NULL, intern_thread_func, &thr[i]);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(thr[i].pt, NULL);
+
+	return monotime_since(&tv, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int entries = INTERN_ENTRIES;
+	unsigned int nthreads = INTERN_THREADS;
+	struct intern_thread *thr;
+	unsigned long count;
+	int64_t usec;
+	unsigned int i;
+	int failed = 0;
+
+	if (argc > 1)
+		entries = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		nthreads = strtoul(argv[2], NULL, 10);
+	if (!entries || !nthreads) {
+		fprintf(stderr, "usage: %s [entries] [threads]\n", argv[0]);
+		return 1;
+	}
+
+	community_init();
+
+	tmp_new = calloc(entries, sizeof(*tmp_new));
+	tmp_dup = calloc(entries, sizeof(*tmp_dup));
+	interned = calloc(entries, sizeof(*interned));
+	thr = calloc(nthreads, sizeof(*thr));
+
+	/* build all values up front so only the intern store is measured */
+	for (i = 0; i < entries; i++) {
+		tmp_new[i] = make_community(i);
+		tmp_dup[i] = make_community(i);
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		thr[i].start = (uint64_t)entries * i / nthreads;
+		thr[i].end = (uint64_t)entries * (i + 1) / nthreads;
+	}
+
+	for (enum intern_phase phase = 0; phase < PHASE_MAX; phase++) {
+		usec = run_phase(thr, nthreads, phase);
+
+		printf("%-18s %u entries, %u threads: %lld.%03lld ms (%.2f Mops/s)\n",
+		       phase_names[phase], entries, nthreads,
+		       (long long)usec / 1000, (long long)usec % 1000,
+		       usec ? (double)entries / usec : 0.0);
+
+		if (phase == PHASE_INTERN) {
+			count = community_count();
+			if (count != entries) {
+				printf("failed: %lu entries interned, expected %u\n",
+				       count, entries);
+				failed++;
+			}
+		}
+	}
+
+	if (mismatches) {
+		printf("failed: %u lookups returned a different entry\n",
+		       mismatches);
+		failed++;
+	}
+
+	count = community_count();
+	if (count) {
+		printf("failed: %lu entries left after unintern\n", count);
+		failed++;
+	}
+	fflush(stdout);
+
+	community_finish();
+	free(thr);
+	free(interned);
+	free(tmp_dup);
+	free(tmp_new);
+
+	return failed;
+}
@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Background nexthop evaluation test.
+ *
+ * Queues the evaluation of a nexthop with more paths than are evaluated in
+ * one go, and checks the walk over its paths when the path under the walk's
+ * cursor moves to another nexthop or is freed in between two batches, and
+ * when the nexthop itself is freed while queued.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+/* for the evaluation queue and bgp_nht_eval_run() */
+#include "bgpd/bgp_nht.c"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+/* two batches, the second one partial */
+#define NPATHS (BGP_NHT_EVAL_BATCH + BGP_NHT_EVAL_BATCH / 2)
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peer;
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("192.0.2.1", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "192.0.2.1");
+	peer->as = 65001;
+	peer->sort = BGP_PEER_EBGP;
+}
+
+static struct bgp_nexthop_cache *new_bnc(uint32_t addr)
+{
+	struct prefix p = { .family = AF_INET, .prefixlen = IPV4_MAX_BITLEN };
+	struct bgp_nexthop_cache *bnc;
+
+	p.u.prefix4.s_addr = htonl(addr);
+	bnc = bnc_new(&bgp->nexthop_cache_table[AFI_IP], &p, 0, 0);
+	bnc->bgp = bgp;
+	bnc->afi = AFI_IP;
+
+	return bnc;
+}
+
+/* a path not valid yet, so that evaluating it makes it valid */
+static void add_path(unsigned int i, struct bgp_nexthop_cache *bnc)
+{
+	struct prefix p = { .family = AF_INET, .prefixlen = IPV4_MAX_BITLEN };
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct attr attr = {}, *attr_new;
+
+	p.u.prefix4.s_addr = htonl(0x0a000000 + i);
+
+	attr.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&attr, BGP_ATTR_ORIGIN);
+	attr.nexthop = bnc->prefix.u.prefix4;
+	bgp_attr_set(&attr, BGP_ATTR_NEXT_HOP);
+	attr_new = bgp_attr_intern(&attr);
+
+	dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer, attr_new,
+		       dest);
+	bgp_path_info_add(dest, pi);
+	bgp_dest_unlock_node(dest);
+
+	path_nh_map(pi, bnc, true);
+}
+
+static unsigned int evaluated(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_path_info *pi;
+	unsigned int count = 0;
+
+	LIST_FOREACH (pi, &bnc->paths, nh_thread)
+		if (CHECK_FLAG(pi->flags, BGP_PATH_VALID))
+			count++;
+
+	return count;
+}
+
+static void reset(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_path_info *pi;
+
+	LIST_FOREACH (pi, &bnc->paths, nh_thread)
+		bgp_path_info_unset_flag(pi->net, pi, BGP_PATH_VALID);
+}
+
+/* what the event does */
+static void run_batch(void)
+{
+	event_cancel(&bne.t_eval);
+	bgp_nht_eval_run(NULL);
+}
+
+/* queue @bnc and evaluate a first batch of its paths */
+static void start(struct bgp_nexthop_cache *bnc)
+{
+	reset(bnc);
+	bnc->change_flags = BGP_NEXTHOP_CHANGED;
+	evaluate_paths(bnc);
+
+	if (!bgp_nht_eval_member(&bne.high, bnc) || evaluated(bnc)) {
+		printf("%u paths not queued for evaluation\n", bnc->path_count);
+		failed++;
+	}
+
+	run_batch();
+	if (evaluated(bnc) != BGP_NHT_EVAL_BATCH || !bnc->eval_next) {
+		printf("%u paths evaluated by the first batch\n",
+		       evaluated(bnc));
+		failed++;
+	}
+}
+
+static void finish(struct bgp_nexthop_cache *bnc)
+{
+	run_batch();
+
+	if (bgp_nht_eval_anywhere(bnc) || bne.t_eval) {
+		printf("evaluation still queued\n");
+		failed++;
+	}
+	if (evaluated(bnc) != bnc->path_count) {
+		printf("%u of %u paths evaluated\n", evaluated(bnc),
+		       bnc->path_count);
+		failed++;
+	}
+}
+
+int main(void)
+{
+	struct bgp_nexthop_cache *bnc, *other;
+	struct bgp_path_info *cursor, *next;
+	unsigned int i;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test nht eval");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+	setup_peer();
+
+	bnc = new_bnc(0xc6336401);
+	other = new_bnc(0xc6336402);
+	for (i = 0; i < NPATHS; i++)
+		add_path(i, bnc);
+
+	printf("cursor moved\n");
+	before = failed;
+	start(bnc);
+	cursor = bnc->eval_next;
+	next = LIST_NEXT(cursor, nh_thread);
+	path_nh_map(cursor, other, true);
+	if (bnc->eval_next != next) {
+		printf("cursor not moved on with its path\n");
+		failed++;
+	}
+	finish(bnc);
+	if (CHECK_FLAG(cursor->flags, BGP_PATH_VALID)) {
+		printf("moved path evaluated for its old nexthop\n");
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("cursor freed\n");
+	before = failed;
+	start(bnc);
+	cursor = bnc->eval_next;
+	next = LIST_NEXT(cursor, nh_thread);
+	bgp_path_info_reap(cursor->net, cursor);
+	if (bnc->eval_next != next) {
+		printf("cursor not moved on from the freed path\n");
+		failed++;
+	}
+	finish(bnc);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("nexthop freed\n");
+	before = failed;
+	start(bnc);
+	/* the nexthop goes away along with its last path */
+	for (i = bnc->path_count; i > 0; i--)
+		bgp_unlink_nexthop(LIST_FIRST(&bnc->paths));
+	if (bgp_nht_eval_count(&bne.high) || bgp_nht_eval_count(&bne.low) ||
+	    bne.t_eval) {
+		printf("freed nexthop still queued\n");
+		failed++;
+	}
+	run_batch();
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestNhtEval(frrtest.TestMultiOut):
+    program = "./test_nht_eval"
+
+
+TestNhtEval.okfail("cursor moved")
+TestNhtEval.okfail("cursor freed")
+TestNhtEval.okfail("nexthop freed")
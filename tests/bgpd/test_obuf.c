@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Output queue entry test.
+ *
+ * Queues a subgroup packet by reference, with and without a rewritten
+ * nexthop, and checks that writing it out in chunks of every size through
+ * the bgp_obuf_*() helpers, as bgp_write() does on partial writes, yields
+ * the bytes that a copy of the packet would.
+ */
+
+#include <zebra.h>
+
+#include "privs.h"
+#include "memory.h"
+#include "stream.h"
+
+/* for bpacket_ref_new() */
+#include "bgpd/bgp_updgrp_packet.c"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define PKT_SIZE 64
+/* nexthop length byte and IPv4 nexthop */
+#define NH_LEN	 5
+
+static int failed;
+
+static struct bpacket *make_pkt(void)
+{
+	struct bpacket *pkt = bpacket_alloc();
+	unsigned int i;
+
+	pkt->buffer = stream_new(PKT_SIZE);
+	for (i = 0; i < BGP_MARKER_SIZE; i++)
+		stream_putc(pkt->buffer, 0xff);
+	stream_putw(pkt->buffer, PKT_SIZE);
+	stream_putc(pkt->buffer, BGP_MSG_UPDATE);
+	while (stream_get_endp(pkt->buffer) < PKT_SIZE)
+		stream_putc(pkt->buffer, stream_get_endp(pkt->buffer));
+
+	return pkt;
+}
+
+/* a ref to @pkt with the nexthop at @nh_off rewritten, or none if 0 */
+static struct stream *make_ref(struct bpacket *pkt, size_t nh_off,
+			       uint8_t *expect)
+{
+	struct bpacket_ref *ref;
+
+	memcpy(expect, STREAM_DATA(pkt->buffer), PKT_SIZE);
+	if (!nh_off)
+		return &bpacket_ref_new(pkt, 0, 0)->s;
+
+	ref = bpacket_ref_new(pkt, nh_off, NH_LEN);
+	memset(STREAM_DATA(ref->frag) + 1, 0xc0, NH_LEN - 1);
+	memset(expect + nh_off + 1, 0xc0, NH_LEN - 1);
+
+	return &ref->s;
+}
+
+/* Write @s out @chunk bytes at a time, then free it */
+static void drain(struct stream *s, size_t chunk, const uint8_t *expect)
+{
+	uint8_t out[PKT_SIZE];
+	struct iovec iov[BGP_OBUF_IOV_MAX];
+	size_t written = 0, len, left;
+	unsigned int i, n;
+
+	if (bgp_obuf_type(s) != BGP_MSG_UPDATE) {
+		printf("type %u\n", bgp_obuf_type(s));
+		failed++;
+	}
+
+	while ((n = bgp_obuf_iov(s, iov)) != 0) {
+		left = 0;
+		for (i = 0; i < n; i++) {
+			if (!iov[i].iov_len)
+				break;
+			left += iov[i].iov_len;
+		}
+		if (i < n || left != PKT_SIZE - written) {
+			printf("chunk %zu: %u iovecs for %zu bytes after %zu\n",
+			       chunk, n, left, written);
+			failed++;
+			break;
+		}
+
+		/* what writev() would take of the iovecs */
+		left = MIN(chunk, left);
+		len = 0;
+		for (i = 0; i < n && len < left; i++) {
+			size_t seg = MIN(iov[i].iov_len, left - len);
+
+			memcpy(out + written + len, iov[i].iov_base, seg);
+			len += seg;
+		}
+		bgp_obuf_forward(s, len);
+		written += len;
+	}
+
+	if (written != PKT_SIZE || memcmp(out, expect, PKT_SIZE)) {
+		printf("chunk %zu: wrong %zu bytes written\n", chunk, written);
+		failed++;
+	}
+
+	bgp_obuf_free(s);
+}
+
+static void check_ref(size_t nh_off, unsigned int iovs)
+{
+	struct iovec iov[BGP_OBUF_IOV_MAX];
+	uint8_t expect[PKT_SIZE], orig[PKT_SIZE];
+	struct bpacket *pkt = make_pkt();
+	struct stream *s;
+	size_t chunk;
+
+	memcpy(orig, STREAM_DATA(pkt->buffer), PKT_SIZE);
+	s = make_ref(pkt, nh_off, expect);
+	if (bgp_obuf_iov(s, iov) != iovs ||
+	    iov[0].iov_base != STREAM_DATA(pkt->buffer)) {
+		printf("packet data not shared\n");
+		failed++;
+	}
+	bgp_obuf_free(s);
+
+	for (chunk = 1; chunk <= PKT_SIZE; chunk++)
+		drain(make_ref(pkt, nh_off, expect), chunk, expect);
+
+	if (pkt->buffer->getp ||
+	    memcmp(STREAM_DATA(pkt->buffer), orig, PKT_SIZE)) {
+		printf("shared packet modified\n");
+		failed++;
+	}
+
+	bpacket_free(pkt);
+}
+
+int main(void)
+{
+	uint8_t expect[PKT_SIZE];
+	struct bpacket *pkt;
+	struct stream *s;
+	size_t chunk;
+	int before;
+
+	printf("copy\n");
+	before = failed;
+	pkt = make_pkt();
+	memcpy(expect, STREAM_DATA(pkt->buffer), PKT_SIZE);
+	for (chunk = 1; chunk <= PKT_SIZE; chunk++)
+		drain(stream_dup(pkt->buffer), chunk, expect);
+	bpacket_free(pkt);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("shared\n");
+	before = failed;
+	check_ref(0, 1);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("nexthop rewritten\n");
+	before = failed;
+	check_ref(40, 3);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("nexthop at the end\n");
+	before = failed;
+	check_ref(PKT_SIZE - NH_LEN, 2);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("packet freed first\n");
+	before = failed;
+	pkt = make_pkt();
+	s = make_ref(pkt, 40, expect);
+	bpacket_free(pkt);
+	drain(s, 7, expect);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
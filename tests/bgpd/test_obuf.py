@@ -0,0 +1,13 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestObuf(frrtest.TestMultiOut):
+    program = "./test_obuf"
+
+
+TestObuf.okfail("copy")
+TestObuf.okfail("shared")
+TestObuf.okfail("nexthop rewritten")
+TestObuf.okfail("nexthop at the end")
+TestObuf.okfail("packet freed first")
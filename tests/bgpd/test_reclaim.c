@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Deferred reclaim test.
+ *
+ * Removes paths and Adj-RIB-In entries with "bgp deferred-reclaim" on, and
+ * checks that they keep their attribute and peer references while queued,
+ * that bgp_reclaim_finish() releases several batches of both at once and
+ * stops deferring, and that entries are released right away after that.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_reclaim.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+/* more than a batch of each, and not a multiple of it */
+#define NPATHS (2 * BGP_RECLAIM_BATCH + 1)
+#define NADJ_INS (BGP_RECLAIM_BATCH + 7)
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peer;
+static struct attr *attr;
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("192.0.2.1", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "192.0.2.1");
+	peer->as = 65001;
+	peer->sort = BGP_PEER_EBGP;
+}
+
+static void setup_attr(void)
+{
+	struct attr tmp = {};
+
+	tmp.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&tmp, BGP_ATTR_ORIGIN);
+	tmp.nexthop.s_addr = htonl(0xc0000201);
+	bgp_attr_set(&tmp, BGP_ATTR_NEXT_HOP);
+	attr = bgp_attr_intern(&tmp);
+}
+
+static struct bgp_dest *get_dest(unsigned int i)
+{
+	struct prefix p = { .family = AF_INET, .prefixlen = IPV4_MAX_BITLEN };
+
+	p.u.prefix4.s_addr = htonl(0x0a000000 + i);
+	return bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+}
+
+/* Add and remove a path, as bgp_process() does once it is withdrawn */
+static void add_remove_path(unsigned int i)
+{
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+
+	dest = get_dest(i);
+	pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer,
+		       bgp_attr_intern(attr), dest);
+	bgp_path_info_add(dest, pi);
+	bgp_dest_unlock_node(dest);
+
+	bgp_path_info_reap(dest, pi);
+}
+
+static void add_remove_adj_in(unsigned int i)
+{
+	struct bgp_dest *dest;
+
+	dest = get_dest(i);
+	bgp_adj_in_set(dest, peer, attr, 0, NULL);
+	bgp_adj_in_remove(&dest, dest->adj_in);
+	bgp_dest_unlock_node(dest);
+}
+
+static void check(unsigned long paths, unsigned long adj_ins, int peer_lock,
+		  unsigned long attr_refcnt)
+{
+	unsigned long pending_paths, pending_adj_ins;
+
+	bgp_reclaim_pending(&pending_paths, &pending_adj_ins);
+	if (pending_paths != paths || pending_adj_ins != adj_ins) {
+		printf("%lu paths, %lu Adj-RIB-In entries queued, expected %lu, %lu\n",
+		       pending_paths, pending_adj_ins, paths, adj_ins);
+		failed++;
+	}
+	if (peer->lock != peer_lock) {
+		printf("peer lock %d, expected %d\n", peer->lock, peer_lock);
+		failed++;
+	}
+	if (attr->refcnt != attr_refcnt) {
+		printf("attribute refcnt %lu, expected %lu\n", attr->refcnt,
+		       attr_refcnt);
+		failed++;
+	}
+}
+
+int main(void)
+{
+	unsigned long attr_refcnt;
+	unsigned int i;
+	int peer_lock;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test reclaim");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	setup_peer();
+	setup_attr();
+	peer_lock = peer->lock;
+	attr_refcnt = attr->refcnt;
+
+	printf("queued\n");
+	before = failed;
+	SET_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM);
+	for (i = 0; i < NPATHS; i++)
+		add_remove_path(i);
+	for (i = 0; i < NADJ_INS; i++)
+		add_remove_adj_in(i);
+	/* the queued entries still hold their references */
+	check(NPATHS, NADJ_INS, peer_lock + NPATHS + NADJ_INS,
+	      attr_refcnt + NPATHS + NADJ_INS);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("finish\n");
+	before = failed;
+	bgp_reclaim_finish();
+	check(0, 0, peer_lock, attr_refcnt);
+	if (CHECK_FLAG(bm->flags, BM_FLAG_DEFERRED_RECLAIM)) {
+		printf("still deferring\n");
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("after finish\n");
+	before = failed;
+	add_remove_path(0);
+	add_remove_adj_in(0);
+	check(0, 0, peer_lock, attr_refcnt);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	bgp_attr_unintern(&attr);
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
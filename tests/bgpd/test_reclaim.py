@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestReclaim(frrtest.TestMultiOut):
+    program = "./test_reclaim"
+
+
+TestReclaim.okfail("queued")
+TestReclaim.okfail("finish")
+TestReclaim.okfail("after finish")
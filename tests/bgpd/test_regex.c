@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * AS path and community regular expression test.
+ *
+ * Checks that bgp_regexec() and bgp_regexec_community(), which match simple
+ * expressions on the ASNs and community values and cache the results in
+ * interned attributes, agree with the regular expression on the string
+ * form of the attribute.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "queue.h"
+#include "filter.h"
+#include "frregex_real.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_regex.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+static int failed;
+
+static const char *const aspath_regexes[] = {
+	"", ".*", "^$", "_65000_", "^65000_", "_65000$", "^65000$",
+	"^65000_65001_", "_65001_65002$", "_65000", "65000", "^6500",
+	"_065000_", "_4200000000_", "_100_200_300_", "_65000:1_", "^[0-9]+$",
+	"_6500[0-9]_", NULL,
+};
+
+static const char *const aspaths[] = {
+	"", "65000", "165000", "650001", "65000 65001", "65001 65000",
+	"65000 65001 65002", "100 65000 65001 65002", "65000 65000 65000",
+	"100 200 300", "100 200 300 400", "4200000000 65000",
+	"65000 {65001,65002}", "(65000 65001) 65002", "{65000}",
+	"100 200 65000 {300}", NULL,
+};
+
+static const char *const community_regexes[] = {
+	"", ".*", "_65000:1_", "^65000:1_", "_65000:1$", "^65000:1$",
+	"_65000:1_65000:2_", "_65000:1", "65000:1", "^65000:1 65000:2$",
+	"_65000_", "_0:0_", "_65535:65281_", "_no-export_", "_6500[0-9]:1_",
+	NULL,
+};
+
+static const char *const communities[] = {
+	"65000:1", "65000:10", "165000:1", "65000:1 65000:2", "1:1 65000:1",
+	"65000:2 65000:1", "65000:1 no-export 65000:2", "0:0", "no-export",
+	"65000:1 65000:1 65000:2", NULL,
+};
+
+static void check(const char *what, const char *regstr, const char *str,
+		  int got)
+{
+	struct frregex *re = bgp_regcomp(regstr);
+	int expected = regexec(&re->real, str, 0, NULL, 0);
+
+	if ((got == 0) != (expected == 0)) {
+		printf("\"%s\" on %s \"%s\": %s, expected %s\n", regstr, what,
+		       str, got ? "no match" : "match",
+		       expected ? "no match" : "match");
+		failed++;
+	}
+	bgp_regex_free(re);
+}
+
+static int test_aspaths(void)
+{
+	struct frregex *re;
+	struct aspath *as;
+	int before = failed;
+	int i, j, pass;
+
+	for (i = 0; aspaths[i]; i++) {
+		as = aspath_intern(aspath_str2aspath(aspaths[i],
+						     ASNOTATION_PLAIN));
+
+		for (j = 0; aspath_regexes[j]; j++) {
+			re = bgp_regcomp(aspath_regexes[j]);
+
+			/* the second pass may be answered by the cache */
+			for (pass = 0; pass < 2; pass++)
+				check("AS path", aspath_regexes[j], as->str,
+				      bgp_regexec(re, as));
+			bgp_regex_free(re);
+		}
+
+		aspath_unintern(&as);
+	}
+
+	return failed - before;
+}
+
+static int test_communities(void)
+{
+	struct community *com;
+	struct frregex *re;
+	int before = failed;
+	int i, j, pass;
+
+	for (i = 0; communities[i]; i++) {
+		com = community_intern(community_str2com(communities[i]));
+
+		for (j = 0; community_regexes[j]; j++) {
+			re = bgp_regcomp(community_regexes[j]);
+
+			for (pass = 0; pass < 2; pass++)
+				check("communities", community_regexes[j],
+				      community_str(com, false, false),
+				      bgp_regexec_community(re, com));
+			bgp_regex_free(re);
+		}
+
+		community_unintern(&com);
+	}
+
+	return failed - before;
+}
+
+int main(void)
+{
+	qobj_init();
+	bgp_master_init(event_master_create(NULL), BGP_SOCKET_SNDBUF_SIZE,
+			list_new());
+	master = bm->master;
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	printf("aspath\n");
+	printf("%s\n", test_aspaths() ? "failed" : "OK");
+
+	printf("community\n");
+	printf("%s\n", test_communities() ? "failed" : "OK");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestRegex(frrtest.TestMultiOut):
+    program = "./test_regex"
+
+
+TestRegex.okfail("aspath")
+TestRegex.okfail("community")
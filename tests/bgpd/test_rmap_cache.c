@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Route-map results cache test.
+ *
+ * Applies outbound route-maps to many paths sharing a few sets of
+ * attributes, through the cache and directly, and checks that the results
+ * and attributes are the same, that the cache is used for route-maps which
+ * only look at the attributes, and not for the others.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_rmap_cache.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define NATTRS 16
+#define NPATHS 20000
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 100;
+static struct peer *peers[2];
+static struct attr *attrs[NATTRS];
+
+static void setup_route_maps(void)
+{
+	/* compiling "additive" writes into the argument */
+	char additive[] = "65000:1 additive";
+	struct route_map_index *index;
+	struct route_map *map;
+
+	map = route_map_get("EXPORT");
+	index = route_map_index_get(map, RMAP_DENY, 10);
+	route_map_add_match(index, "metric", "3", RMAP_EVENT_MATCH_ADDED);
+	index = route_map_index_get(map, RMAP_PERMIT, 20);
+	route_map_add_match(index, "local-preference", "200",
+			    RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "community", additive);
+	route_map_add_set(index, "as-path prepend", "65000 65000");
+	index = route_map_index_get(map, RMAP_PERMIT, 30);
+	route_map_add_set(index, "metric", "+10");
+
+	map = route_map_get("PREFIX");
+	index = route_map_index_get(map, RMAP_DENY, 10);
+	route_map_add_match(index, "ip address prefix-list", "NONE",
+			    RMAP_EVENT_PLIST_ADDED);
+	index = route_map_index_get(map, RMAP_PERMIT, 20);
+	route_map_add_set(index, "metric", "7");
+}
+
+static void setup_peers(void)
+{
+	union sockunion su;
+	char addr[64];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		snprintf(addr, sizeof(addr), "192.0.2.%d", i + 1);
+		str2sockunion(addr, &su);
+
+		peers[i] = peer_create_accept(bgp, &su);
+		peers[i]->host = XSTRDUP(MTYPE_BGP_PEER_HOST, addr);
+		peers[i]->as = 65001 + i;
+		peers[i]->sort = BGP_PEER_EBGP;
+	}
+}
+
+static void setup_attrs(void)
+{
+	struct attr attr;
+	char str[64];
+	int i;
+
+	for (i = 0; i < NATTRS; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.origin = BGP_ORIGIN_IGP;
+		bgp_attr_set(&attr, BGP_ATTR_ORIGIN);
+
+		snprintf(str, sizeof(str), "65002 %d", 64512 + i / 2);
+		attr.aspath = aspath_str2aspath(str, ASNOTATION_PLAIN);
+		bgp_attr_set(&attr, BGP_ATTR_AS_PATH);
+
+		attr.nexthop.s_addr = htonl(0xc0000202);
+		bgp_attr_set(&attr, BGP_ATTR_NEXT_HOP);
+		bgp_attr_set_med(&attr, i % 4);
+		attr.local_pref = i % 3 ? 100 : 200;
+		bgp_attr_set(&attr, BGP_ATTR_LOCAL_PREF);
+		if (i % 5)
+			bgp_attr_set_community(&attr,
+					       community_str2com("65002:5"));
+
+		attrs[i] = bgp_attr_intern(&attr);
+		bgp_attr_flush(&attr);
+	}
+}
+
+/* Apply @map to a copy of @in, returning the interned result. */
+static struct attr *run(struct route_map *map, const struct prefix *p,
+			struct attr *in, bool cached, route_map_result_t *ret)
+{
+	struct bgp_path_info_extra extra;
+	struct bgp_path_info path;
+	struct attr attr, *out;
+
+	bgp_attr_dup_into(&attr, in);
+	prep_for_rmap_apply(&path, &extra, NULL, NULL, peers[0], peers[1],
+			    &attr);
+
+	SET_FLAG(peers[0]->rmap_type, PEER_RMAP_TYPE_OUT);
+	if (cached)
+		*ret = bgp_rmap_cache_apply(map, p, &path, PEER_RMAP_TYPE_OUT);
+	else
+		*ret = route_map_apply(map, p, &path);
+	peers[0]->rmap_type = 0;
+
+	if (*ret == RMAP_DENYMATCH) {
+		bgp_attr_flush(&attr);
+		return NULL;
+	}
+
+	out = bgp_attr_intern(&attr);
+	bgp_attr_flush(&attr);
+	return out;
+}
+
+static void compare(const char *name)
+{
+	struct route_map *map = route_map_lookup_by_name(name);
+	struct prefix_ipv4 p = { .family = AF_INET, .prefixlen = 24 };
+	struct attr *direct, *cached;
+	route_map_result_t ret_direct, ret_cached;
+	unsigned int i;
+	bool differ = false;
+
+	for (i = 0; i < NPATHS; i++) {
+		p.prefix.s_addr = htonl(0x0a000000 + (i << 8));
+
+		direct = run(map, (struct prefix *)&p, attrs[i % NATTRS],
+			     false, &ret_direct);
+		cached = run(map, (struct prefix *)&p, attrs[i % NATTRS],
+			     true, &ret_cached);
+
+		if ((ret_direct != ret_cached || direct != cached) && !differ) {
+			printf("%s path %u: result %d, cached %d%s\n", name, i,
+			       ret_direct, ret_cached,
+			       direct != cached ? ", attributes differ" : "");
+			differ = true;
+		}
+
+		if (direct)
+			bgp_attr_unintern(&direct);
+		if (cached)
+			bgp_attr_unintern(&cached);
+	}
+
+	if (differ)
+		failed++;
+}
+
+int main(void)
+{
+	struct route_map *map;
+	struct route_map_index *index;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test rmap cache");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	bm->rmap_update_timer = 0;
+	setup_route_maps();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	setup_peers();
+	setup_attrs();
+
+	printf("cached\n");
+	before = failed;
+	compare("EXPORT");
+	map = route_map_lookup_by_name("EXPORT");
+	if (map->cache_hits < NPATHS / 2) {
+		printf("%" PRIu64 " hits, %" PRIu64 " misses\n",
+		       map->cache_hits, map->cache_misses);
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("uncacheable\n");
+	before = failed;
+	compare("PREFIX");
+	map = route_map_lookup_by_name("PREFIX");
+	if (map->cache_hits || map->cache_misses) {
+		printf("%" PRIu64 " hits, %" PRIu64 " misses\n",
+		       map->cache_hits, map->cache_misses);
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("reconfigured\n");
+	before = failed;
+	map = route_map_lookup_by_name("EXPORT");
+	index = route_map_index_get(map, RMAP_PERMIT, 30);
+	route_map_add_set(index, "local-preference", "50");
+	compare("EXPORT");
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	bgp_rmap_cache_finish();
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestRmapCache(frrtest.TestMultiOut):
+    program = "./test_rmap_cache"
+
+
+TestRmapCache.okfail("cached")
+TestRmapCache.okfail("uncacheable")
+TestRmapCache.okfail("reconfigured")
@@ -0,0 +1,235 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures origin validation against the RPKI ROA table
+ * bgpd keeps for the main pthread, at the scale of a full set of ROAs, and
+ * checks its results against a walk of all the ROAs, as well as what it
+ * reports as changed between two tables.
+ *
+ *   test_rpki_roa [roas] [validations]
+ */
+
+#include <zebra.h>
+
+#include "monotime.h"
+#include "privs.h"
+#include "memory.h"
+#include "prefix.h"
+
+#include "bgpd/bgp_rpki_roa.h"
+
+#include "tests/helpers/c/prng.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master;
+
+#define ROA_COUNT 100000
+#define ROA_VALIDATIONS 1000000
+#define ROA_CHECKS 1000
+#define ROA_CHANGES 100
+
+struct roa {
+	struct prefix p;
+	uint8_t max_len;
+	as_t asn;
+	const void *src;
+};
+
+/* two caches the ROAs come from */
+static const char sources[2];
+
+static struct prng *prng;
+
+static uint32_t rnd(void)
+{
+	/* prng_rand() only has 31 bits */
+	return ((uint32_t)prng_rand(prng) << 16) ^ (uint32_t)prng_rand(prng);
+}
+
+static void make_roa(struct roa *roa)
+{
+	unsigned int len = 8 + rnd() % 17;
+
+	memset(roa, 0, sizeof(*roa));
+	roa->p.family = AF_INET;
+	roa->p.prefixlen = len;
+	roa->p.u.prefix4.s_addr = htonl(rnd());
+	apply_mask(&roa->p);
+	roa->max_len = MIN(len + rnd() % 9, IPV4_MAX_BITLEN);
+	roa->asn = 1 + rnd() % 4000;
+	roa->src = &sources[rnd() % 2];
+}
+
+/* a route, mostly under a ROA, from its ASN or not */
+static void make_route(const struct roa *roas, unsigned int count,
+		       struct prefix *p, as_t *asn)
+{
+	const struct roa *roa = &roas[rnd() % count];
+	uint32_t addr;
+
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	if (rnd() % 8 == 0) {
+		p->prefixlen = 8 + rnd() % 25;
+		addr = rnd();
+	} else {
+		p->prefixlen = MIN(roa->p.prefixlen + rnd() % 12,
+				   IPV4_MAX_BITLEN);
+		addr = ntohl(roa->p.u.prefix4.s_addr) |
+		       (rnd() >> roa->p.prefixlen);
+	}
+	p->u.prefix4.s_addr = htonl(addr);
+	apply_mask(p);
+
+	*asn = rnd() % 2 ? roa->asn : 1 + rnd() % 4000;
+}
+
+/* RFC 6811, from all the ROAs */
+static enum rpki_states validate_all(const struct roa *roas,
+				     unsigned int count, const struct prefix *p,
+				     as_t asn)
+{
+	enum rpki_states state = RPKI_NOTFOUND;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (!roas[i].src || roas[i].p.prefixlen > p->prefixlen ||
+		    !prefix_match(&roas[i].p, p))
+			continue;
+		if (roas[i].asn == asn && p->prefixlen <= roas[i].max_len)
+			return RPKI_VALID;
+		state = RPKI_INVALID;
+	}
+
+	return state;
+}
+
+static void count_diff(const struct prefix *p, void *arg)
+{
+	(*(unsigned int *)arg)++;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = ROA_COUNT, validations = ROA_VALIDATIONS;
+	unsigned int i, j, added = 0, wrong = 0, diffs = 0, changed = 0;
+	unsigned int states[RPKI_INVALID + 1] = {};
+	struct bgp_rpki_roa_table *roas, *other;
+	enum rpki_states state;
+	struct roa *list;
+	struct prefix p;
+	struct timeval tv;
+	int64_t usec;
+	as_t asn;
+	int failed = 0;
+
+	if (argc > 1)
+		count = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		validations = strtoul(argv[2], NULL, 10);
+	if (count < ROA_CHANGES) {
+		fprintf(stderr, "usage: %s [roas >= %u] [validations]\n",
+			argv[0], ROA_CHANGES);
+		return 1;
+	}
+
+	prng = prng_new(1);
+	list = calloc(count, sizeof(*list));
+	for (i = 0; i < count; i++)
+		make_roa(&list[i]);
+
+	roas = bgp_rpki_roa_table_new();
+	monotime(&tv);
+	for (i = 0; i < count; i++) {
+		if (bgp_rpki_roa_add(roas, &list[i].p, list[i].max_len,
+				     list[i].asn, list[i].src))
+			added++;
+		else
+			/* the same ROA from the same cache, only there once */
+			list[i].src = NULL;
+	}
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u ROAs: %lld.%03lld ms\n", "add", count,
+	       (long long)usec / 1000, (long long)usec % 1000);
+
+	if (bgp_rpki_roa_count(roas) != added) {
+		printf("failed: %lu ROAs in the table, %u added\n",
+		       bgp_rpki_roa_count(roas), added);
+		failed++;
+	}
+
+	prng_free(prng);
+	prng = prng_new(2);
+	monotime(&tv);
+	for (i = 0; i < validations; i++) {
+		make_route(list, count, &p, &asn);
+		states[bgp_rpki_roa_validate(roas, &p, asn)]++;
+	}
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u routes: %lld.%03lld ms (%.2f Mops/s), %u valid, %u invalid, %u not found\n",
+	       "validate", validations, (long long)usec / 1000,
+	       (long long)usec % 1000, usec ? (double)validations / usec : 0.0,
+	       states[RPKI_VALID], states[RPKI_INVALID], states[RPKI_NOTFOUND]);
+
+	prng_free(prng);
+	prng = prng_new(3);
+	for (i = 0; i < ROA_CHECKS; i++) {
+		make_route(list, count, &p, &asn);
+		state = bgp_rpki_roa_validate(roas, &p, asn);
+		if (state != validate_all(list, count, &p, asn))
+			wrong++;
+	}
+	if (wrong) {
+		printf("failed: %u of %u routes validated wrongly\n", wrong,
+		       ROA_CHECKS);
+		failed++;
+	}
+
+	/* a copy missing some ROAs, and the prefixes it differs on */
+	other = bgp_rpki_roa_table_new();
+	for (i = ROA_CHANGES; i < count; i++)
+		if (list[i].src)
+			bgp_rpki_roa_add(other, &list[i].p, list[i].max_len,
+					 list[i].asn, list[i].src);
+	for (i = 0; i < ROA_CHANGES; i++) {
+		if (!list[i].src)
+			continue;
+		for (j = 0; j < i; j++)
+			if (list[j].src && prefix_same(&list[i].p, &list[j].p))
+				break;
+		if (j == i)
+			changed++;
+	}
+	bgp_rpki_roa_diff(roas, other, count_diff, &diffs);
+	if (diffs != changed) {
+		printf("failed: %u prefixes differ, expected %u\n", diffs,
+		       changed);
+		failed++;
+	}
+
+	monotime(&tv);
+	for (i = 0; i < count; i++)
+		if (list[i].src &&
+		    !bgp_rpki_roa_del(roas, &list[i].p, list[i].max_len,
+				      list[i].asn, list[i].src))
+			wrong++;
+	usec = monotime_since(&tv, NULL);
+	printf("%-16s %u ROAs: %lld.%03lld ms\n", "remove", added,
+	       (long long)usec / 1000, (long long)usec % 1000);
+
+	if (wrong || bgp_rpki_roa_count(roas) ||
+	    bgp_rpki_roa_del(roas, &list[0].p, list[0].max_len, list[0].asn,
+			     &sources[0])) {
+		printf("failed: %u ROAs not removed, %lu left\n", wrong,
+		       bgp_rpki_roa_count(roas));
+		failed++;
+	}
+	fflush(stdout);
+
+	bgp_rpki_roa_table_free(&roas);
+	bgp_rpki_roa_table_free(&other);
+	free(list);
+	prng_free(prng);
+
+	return failed;
+}
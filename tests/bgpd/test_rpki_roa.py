@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestRpkiRoa(frrtest.TestMultiOut):
+    program = "./test_rpki_roa"
+
+
+TestRpkiRoa.onesimple("add")
+TestRpkiRoa.onesimple("validate")
+TestRpkiRoa.onesimple("remove")
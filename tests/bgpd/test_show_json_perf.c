@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures "show bgp ipv4 unicast json" on a large table,
+ * as sent to vtysh: wall time, peak RSS growth, and the longest time the
+ * event loop was blocked, once for output produced in one go and once for
+ * output produced in chunks between which the command yields.
+ *
+ *   test_show_json_perf [prefixes]
+ *
+ * The vtysh end of the session is a socketpair read from the same event
+ * loop, so output that is not consumed while the command runs piles up in
+ * the vty buffer as it would with a real vtysh.  Each mode runs in its own
+ * child process.
+ */
+
+#include <zebra.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "command.h"
+#include "privs.h"
+#include "memory.h"
+#include "monotime.h"
+#include "network.h"
+#include "filter.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define SHOW_JSON_PREFIXES 100000
+
+static struct bgp *bgp;
+static as_t asn = 100;
+
+/* vtysh side of the session */
+static int vtysh_fd;
+static struct event *t_vtysh;
+static unsigned long long out_bytes;
+static char out_tail[256];
+static size_t out_tail_len;
+static bool out_done;
+
+static unsigned long status_kb(const char *field)
+{
+	char line[128];
+	unsigned long kb = 0;
+	size_t len = strlen(field);
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, field, len) && line[len] == ':') {
+			kb = strtoul(line + len + 1, NULL, 10);
+			break;
+		}
+	fclose(f);
+
+	return kb;
+}
+
+static void reset_peak_rss(void)
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+
+	if (!f)
+		return;
+	fputs("5", f);
+	fclose(f);
+}
+
+static void populate(unsigned int prefixes)
+{
+	struct bgp_table *table = bgp->rib[AFI_IP][SAFI_UNICAST];
+	struct prefix_ipv4 p = { .family = AF_INET, .prefixlen = 24 };
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct attr attr;
+	unsigned int i;
+
+	bgp_attr_default_set(&attr, bgp, BGP_ORIGIN_IGP);
+	attr.nexthop.s_addr = htonl(0xc0000201);
+	bgp_attr_set(&attr, BGP_ATTR_NEXT_HOP);
+
+	for (i = 0; i < prefixes; i++) {
+		p.prefix.s_addr = htonl(0x01000000 + (i << 8));
+		dest = bgp_node_get(table, (struct prefix *)&p);
+		pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, bgp->peer_self,
+			       bgp_attr_intern(&attr), dest);
+		SET_FLAG(pi->flags, BGP_PATH_VALID | BGP_PATH_SELECTED);
+		bgp_path_info_add(dest, pi);
+		bgp_dest_unlock_node(dest);
+	}
+}
+
+static void vtysh_read(struct event *event)
+{
+	char buf[65536];
+	ssize_t n;
+
+	n = read(vtysh_fd, buf, sizeof(buf));
+	if (n <= 0) {
+		if (n < 0 && ERRNO_IO_RETRY(errno)) {
+			event_add_read(master, vtysh_read, NULL, vtysh_fd, &t_vtysh);
+			return;
+		}
+		out_done = true;
+		return;
+	}
+
+	out_bytes += n;
+	if ((size_t)n >= sizeof(out_tail)) {
+		memcpy(out_tail, buf + n - sizeof(out_tail), sizeof(out_tail));
+		out_tail_len = sizeof(out_tail);
+	} else {
+		size_t keep = MIN(out_tail_len, sizeof(out_tail) - n);
+
+		memmove(out_tail, out_tail + out_tail_len - keep, keep);
+		memcpy(out_tail + keep, buf, n);
+		out_tail_len = keep + n;
+	}
+
+	/* the command's return code follows a 0 byte, which JSON never has */
+	if (memchr(buf, '\0', n)) {
+		out_done = true;
+		return;
+	}
+	event_add_read(master, vtysh_read, NULL, vtysh_fd, &t_vtysh);
+}
+
+static int run_mode(bool yield, unsigned int prefixes)
+{
+	unsigned long rss_base, rss_peak;
+	int64_t usec, stall, max_stall;
+	struct timeval tv, start;
+	struct event ev;
+	struct vty *vty;
+	char expect[64];
+	int sv[2];
+	int ret;
+
+	populate(prefixes);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		perror("socketpair");
+		return 1;
+	}
+	set_nonblocking(sv[0]);
+	set_nonblocking(sv[1]);
+	vtysh_fd = sv[1];
+
+	vty = vty_new();
+	vty->fd = vty->wfd = sv[0];
+	vty->node = ENABLE_NODE;
+	vty->vty_buf_threshold = 128 * 1024;
+
+	event_add_read(master, vtysh_read, NULL, vtysh_fd, &t_vtysh);
+
+	rss_base = status_kb("VmRSS");
+	reset_peak_rss();
+	monotime(&start);
+
+	/* do what vtysh_read() does, a file vty makes the command synchronous */
+	vty->type = yield ? VTY_SHELL_SERV : VTY_FILE;
+	ret = cmd_execute(vty, "show bgp ipv4 unicast json", NULL, 0);
+	vty->type = VTY_SHELL_SERV;
+	max_stall = monotime_since(&start, NULL);
+	if (ret != CMD_SUSPEND)
+		vty_resume_response(vty, ret);
+
+	while (!out_done && event_fetch(master, &ev)) {
+		monotime(&tv);
+		event_call(&ev);
+		stall = monotime_since(&tv, NULL);
+		if (stall > max_stall)
+			max_stall = stall;
+	}
+
+	usec = monotime_since(&start, NULL);
+	rss_peak = status_kb("VmHWM");
+
+	printf("%-6s %u prefixes: %llu bytes, %lld ms, longest event %lld ms, peak RSS +%lu kB\n",
+	       yield ? "yield" : "sync", prefixes, out_bytes, (long long)usec / 1000,
+	       (long long)max_stall / 1000, rss_peak > rss_base ? rss_peak - rss_base : 0);
+
+	snprintf(expect, sizeof(expect), "\"totalRoutes\": %u", prefixes);
+	if (!out_done || out_tail_len < 4 || out_tail[out_tail_len - 1] != CMD_SUCCESS ||
+	    !memmem(out_tail, out_tail_len, expect, strlen(expect))) {
+		printf("failed: output incomplete or not terminated\n");
+		return 1;
+	}
+	fflush(stdout);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int prefixes = SHOW_JSON_PREFIXES;
+	int failed = 0;
+	int status;
+	pid_t pid;
+
+	if (argc > 1)
+		prefixes = strtoul(argv[1], NULL, 10);
+	if (!prefixes || prefixes > (1U << 24)) {
+		fprintf(stderr, "usage: %s [prefixes]\n", argv[0]);
+		return 1;
+	}
+
+	qobj_init();
+	cmd_init(0);
+	master = event_master_create("test show json perf");
+	vty_init(master, false);
+	bgp_vty_init();
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+	bgp_route_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	for (int yield = 0; yield < 2; yield++) {
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0)
+			exit(run_mode(yield, prefixes));
+
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status))
+			failed++;
+	}
+
+	return failed;
+}
@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestShowJsonPerf(frrtest.TestMultiOut):
+    program = "./test_show_json_perf"
+
+
+TestShowJsonPerf.onesimple("sync ")
+TestShowJsonPerf.onesimple("yield ")
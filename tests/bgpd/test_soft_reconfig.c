@@ -0,0 +1,321 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Soft reconfiguration inbound equivalence test.
+ *
+ * Changes the inbound route-maps of peers with "soft-reconfiguration
+ * inbound", once with the policy evaluated inline and once on soft
+ * reconfiguration workers, and checks that the paths left in the RIB are
+ * the same.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+#include "lib/json.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_label.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_soft_reconfig.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define NPEERS	  4
+#define NPREFIXES 3000
+#define NWORKERS  4
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 100;
+static struct peer *peers[NPEERS];
+
+/* inbound route-map of each peer before and after the change */
+static const char *const policy_before[NPEERS] = {
+	"PERMIT", "PERMIT", "DENY-MED1", "PERMIT",
+};
+static const char *const policy_after[NPEERS] = {
+	"SET-LP", "DENY-MED1", "MISSING", "SET-MED",
+};
+
+struct snapshot {
+	char **lines;
+	unsigned int count;
+};
+
+static void setup_route_maps(void)
+{
+	/* compiling "additive" writes into the argument */
+	char additive[] = "65000:1 additive";
+	struct route_map_index *index;
+	struct route_map *map;
+
+	map = route_map_get("PERMIT");
+	route_map_index_get(map, RMAP_PERMIT, 10);
+
+	map = route_map_get("DENY-MED1");
+	index = route_map_index_get(map, RMAP_DENY, 10);
+	route_map_add_match(index, "metric", "1", RMAP_EVENT_MATCH_ADDED);
+	index = route_map_index_get(map, RMAP_PERMIT, 20);
+	route_map_add_set(index, "metric", "50");
+
+	map = route_map_get("SET-LP");
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	route_map_add_match(index, "metric", "1", RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "local-preference", "200");
+	index = route_map_index_get(map, RMAP_DENY, 20);
+	route_map_add_match(index, "metric", "2", RMAP_EVENT_MATCH_ADDED);
+	index = route_map_index_get(map, RMAP_PERMIT, 30);
+	route_map_add_set(index, "community", additive);
+
+	map = route_map_get("SET-MED");
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	route_map_add_set(index, "metric", "7");
+	route_map_add_set(index, "weight", "10");
+}
+
+static void setup_peers(void)
+{
+	union sockunion su;
+	char addr[64];
+	int i;
+
+	for (i = 0; i < NPEERS; i++) {
+		snprintf(addr, sizeof(addr), "192.0.2.%d", i + 1);
+		str2sockunion(addr, &su);
+
+		peers[i] = peer_create_accept(bgp, &su);
+		peers[i]->host = XSTRDUP(MTYPE_BGP_PEER_HOST, addr);
+		peers[i]->connection->status = Established;
+		peers[i]->connection->su_remote = sockunion_dup(&su);
+		peers[i]->as = asn;
+		peers[i]->sort = BGP_PEER_IBGP;
+		peers[i]->remote_id.s_addr = htonl(0x0a000001 + i);
+		peers[i]->afc[AFI_IP][SAFI_UNICAST] = 1;
+		SET_FLAG(peers[i]->af_flags[AFI_IP][SAFI_UNICAST],
+			 PEER_FLAG_SOFT_RECONFIG);
+	}
+}
+
+/* Every peer sends the same prefixes, with MEDs 0, 1 and 2. */
+static void populate(void)
+{
+	struct prefix_ipv4 p = { .family = AF_INET, .prefixlen = 24 };
+	struct attr attr;
+	unsigned int i;
+	int n;
+
+	for (n = 0; n < NPEERS; n++) {
+		for (i = 0; i < NPREFIXES; i++) {
+			bgp_attr_default_set(&attr, bgp, BGP_ORIGIN_IGP);
+			attr.nexthop.s_addr = htonl(0xc0000201 + n);
+			bgp_attr_set(&attr, BGP_ATTR_NEXT_HOP);
+			attr.med = i % 3;
+			bgp_attr_set(&attr, BGP_ATTR_MULTI_EXIT_DISC);
+
+			p.prefix.s_addr = htonl(0x0a000000 + (i << 8));
+			bgp_update(peers[n], (struct prefix *)&p, 0, &attr,
+				   AFI_IP, SAFI_UNICAST, ZEBRA_ROUTE_BGP,
+				   BGP_ROUTE_NORMAL, NULL, NULL, 0, 0, NULL,
+				   NULL);
+		}
+	}
+}
+
+/* Bind the route-maps, which starts soft reconfiguration, and let it run. */
+static void policy_apply(const char *const names[NPEERS])
+{
+	struct bgp_table *table = bgp->rib[AFI_IP][SAFI_UNICAST];
+	struct event ev;
+	int i;
+
+	for (i = 0; i < NPEERS; i++)
+		peer_route_map_set(peers[i], AFI_IP, SAFI_UNICAST, RMAP_IN,
+				   names[i], route_map_lookup_by_name(names[i]));
+
+	while (event_is_scheduled(table->soft_reconfig_thread) &&
+	       event_fetch(master, &ev))
+		event_call(&ev);
+}
+
+static int line_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void snapshot_take(struct snapshot *snap)
+{
+	struct bgp_table *table = bgp->rib[AFI_IP][SAFI_UNICAST];
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+	struct community *comm;
+	char pfx[PREFIX2STR_BUFFER];
+	char line[256];
+	unsigned int size = 0;
+
+	memset(snap, 0, sizeof(*snap));
+
+	for (dest = bgp_table_top(table); dest; dest = bgp_route_next(dest)) {
+		prefix2str(bgp_dest_get_prefix(dest), pfx, sizeof(pfx));
+
+		for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next) {
+			if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED))
+				continue;
+
+			comm = bgp_attr_get_community(pi->attr);
+			snprintf(line, sizeof(line),
+				 "%s %s lp %u med %u weight %u comm %s", pfx,
+				 pi->peer->host, pi->attr->local_pref,
+				 pi->attr->med, pi->attr->weight,
+				 comm ? community_str(comm, false, false) : "-");
+
+			if (snap->count == size) {
+				size = MAX(1024U, size * 2);
+				snap->lines = realloc(snap->lines,
+						      size * sizeof(char *));
+			}
+			snap->lines[snap->count++] = strdup(line);
+		}
+	}
+
+	qsort(snap->lines, snap->count, sizeof(char *), line_cmp);
+}
+
+static bool snapshot_equal(const struct snapshot *a, const struct snapshot *b,
+			   bool verbose)
+{
+	unsigned int i;
+
+	if (a->count != b->count) {
+		if (verbose)
+			printf("%u paths, expected %u\n", b->count, a->count);
+		return false;
+	}
+
+	for (i = 0; i < a->count; i++) {
+		if (strcmp(a->lines[i], b->lines[i])) {
+			if (verbose)
+				printf("got \"%s\", expected \"%s\"\n",
+				       b->lines[i], a->lines[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void snapshot_free(struct snapshot *snap)
+{
+	unsigned int i;
+
+	for (i = 0; i < snap->count; i++)
+		free(snap->lines[i]);
+	free(snap->lines);
+}
+
+static int64_t worker_routes(void)
+{
+	json_object *json = json_object_new_object();
+	json_object *val;
+	int64_t routes = 0;
+
+	bgp_soft_reconfig_show(NULL, json);
+	if (json_object_object_get_ex(json, "softReconfigRoutes", &val))
+		routes = json_object_get_int64(val);
+	json_object_free(json);
+
+	return routes;
+}
+
+int main(void)
+{
+	struct snapshot before, serial, parallel;
+	int64_t routes;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test soft reconfig");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_labels_init();
+	bgp_route_init();
+	bgp_route_map_init();
+	bgp_soft_reconfig_init();
+
+	/* process route-map changes right away, there is no peer yet */
+	bm->rmap_update_timer = 0;
+	setup_route_maps();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+
+	setup_peers();
+	policy_apply(policy_before);
+	populate();
+	snapshot_take(&before);
+
+	printf("serial\n");
+	policy_apply(policy_after);
+	snapshot_take(&serial);
+	if (snapshot_equal(&before, &serial, false)) {
+		printf("policy change had no effect\n");
+		printf("failed\n");
+		failed++;
+	} else
+		printf("OK\n");
+
+	printf("revert\n");
+	policy_apply(policy_before);
+	snapshot_take(&parallel);
+	if (!snapshot_equal(&before, &parallel, true)) {
+		printf("failed\n");
+		failed++;
+	} else
+		printf("OK\n");
+	snapshot_free(&parallel);
+
+	printf("parallel\n");
+	bgp_soft_reconfig_workers_set(NWORKERS);
+	routes = worker_routes();
+	policy_apply(policy_after);
+	snapshot_take(&parallel);
+	if (worker_routes() - routes < (int64_t)NPEERS * NPREFIXES) {
+		printf("%" PRId64 " routes evaluated by the workers\n",
+		       worker_routes() - routes);
+		printf("failed\n");
+		failed++;
+	} else if (!snapshot_equal(&serial, &parallel, true)) {
+		printf("failed\n");
+		failed++;
+	} else
+		printf("OK\n");
+
+	bgp_soft_reconfig_workers_set(0);
+	bgp_soft_reconfig_finish();
+
+	snapshot_free(&before);
+	snapshot_free(&serial);
+	snapshot_free(&parallel);
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestSoftReconfig(frrtest.TestMultiOut):
+    program = "./test_soft_reconfig"
+
+
+TestSoftReconfig.okfail("serial")
+TestSoftReconfig.okfail("revert")
+TestSoftReconfig.okfail("parallel")
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Update-group packet format workers test.
+ *
+ * Schedules subgroups of several update groups for formatting, and checks
+ * that each is pending once while workers are configured, that a run puts
+ * the subgroups of one update group into a single unit, so that they are
+ * formatted by the same pthread, and that no more packets are formatted
+ * for a subgroup than its packet queue has room for.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+
+/* for the pending list and the units of a run */
+#include "bgpd/bgp_updgrp_build.c"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+#define NUPDGRPS  3
+#define NSUBGRPS  7
+#define QUEUE_MAX 10
+
+static int failed;
+static struct bgp bgp;
+static struct update_group updgrps[NUPDGRPS];
+static struct update_subgroup subgrps[NSUBGRPS];
+
+/* subgroups handed out in no particular order */
+static void setup_subgroups(void)
+{
+	static const unsigned int updgrp_of[NSUBGRPS] = { 2, 0, 1, 0, 2, 1, 0 };
+	unsigned int i;
+
+	bgp.default_subgroup_pkt_queue_max = QUEUE_MAX;
+
+	for (i = 0; i < NUPDGRPS; i++) {
+		updgrps[i].bgp = &bgp;
+		updgrps[i].id = NUPDGRPS - i;
+	}
+	for (i = 0; i < NSUBGRPS; i++) {
+		subgrps[i].update_group = &updgrps[updgrp_of[i]];
+		subgrps[i].id = NSUBGRPS - i;
+	}
+
+	/* only a few packets short of a full queue */
+	subgrps[3].pkt_queue.curr_count = QUEUE_MAX - 3;
+}
+
+static void check_pending(size_t expect)
+{
+	size_t count = bgp_updgrp_build_list_count(&bub.pending);
+
+	if (count != expect) {
+		printf("%zu subgroups pending, expected %zu\n", count, expect);
+		failed++;
+	}
+}
+
+static void check_units(void)
+{
+	struct bgp_updgrp_build_job *job, *prev;
+	struct bgp_updgrp_build_unit *unit;
+	unsigned int u, i, njobs = 0;
+
+	if (bub.nunits != NUPDGRPS) {
+		printf("%u units for %u update groups\n", bub.nunits, NUPDGRPS);
+		failed++;
+		return;
+	}
+
+	for (u = 0; u < bub.nunits; u++) {
+		unit = &bub.units[u];
+		if (unit->first != njobs) {
+			printf("unit %u starts at job %u, expected %u\n", u,
+			       unit->first, njobs);
+			failed++;
+		}
+
+		for (i = unit->first; i < unit->first + unit->count; i++) {
+			job = &bub.jobs[i];
+			prev = i > unit->first ? &bub.jobs[i - 1] : NULL;
+
+			if (job->subgrp->update_group !=
+				    bub.jobs[unit->first].subgrp->update_group ||
+			    (prev && prev->subgrp->id >= job->subgrp->id)) {
+				printf("unit %u job %u: subgroup %" PRIu64
+				       " of update group %" PRIu64 "\n",
+				       u, i, job->subgrp->id,
+				       job->subgrp->update_group->id);
+				failed++;
+			}
+		}
+		njobs += unit->count;
+
+		if (u && bub.jobs[unit->first].subgrp->update_group->id <=
+				 bub.jobs[unit->first - 1]
+					 .subgrp->update_group->id) {
+			printf("unit %u out of order\n", u);
+			failed++;
+		}
+	}
+
+	if (njobs != bub.njobs) {
+		printf("%u of %u jobs in units\n", njobs, bub.njobs);
+		failed++;
+	}
+}
+
+int main(void)
+{
+	struct update_subgroup *subgrp;
+	struct bgp_updgrp_build_job *job;
+	unsigned int i, expect;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	bgp_updgrp_build_init();
+	setup_subgroups();
+
+	printf("schedule\n");
+	before = failed;
+	/* nothing to do without workers */
+	bgp_updgrp_build_schedule(&subgrps[0]);
+	check_pending(0);
+
+	bgp_updgrp_build_workers_set(2);
+	for (i = 0; i < NSUBGRPS; i++) {
+		bgp_updgrp_build_schedule(&subgrps[i]);
+		bgp_updgrp_build_schedule(&subgrps[i]);
+	}
+	check_pending(NSUBGRPS);
+
+	bgp_updgrp_build_cancel(&subgrps[0]);
+	bgp_updgrp_build_cancel(&subgrps[0]);
+	check_pending(NSUBGRPS - 1);
+	bgp_updgrp_build_schedule(&subgrps[0]);
+	check_pending(NSUBGRPS);
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("units\n");
+	before = failed;
+	bub.njobs = 0;
+	frr_each (bgp_updgrp_build_list, &bub.pending, subgrp)
+		bgp_updgrp_build_job_add(subgrp);
+	bgp_updgrp_build_units_setup();
+	check_units();
+
+	for (i = 0; i < bub.njobs; i++) {
+		job = &bub.jobs[i];
+		expect = job->subgrp == &subgrps[3] ? 3
+						    : BGP_UPDGRP_BUILD_PKTS_MAX;
+		if (job->max_pkts != expect) {
+			printf("subgroup %" PRIu64 ": %u packets at most, expected %u\n",
+			       job->subgrp->id, job->max_pkts, expect);
+			failed++;
+		}
+	}
+	bub.njobs = 0;
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("workers off\n");
+	before = failed;
+	bgp_updgrp_build_workers_set(0);
+	check_pending(0);
+	if (bgp_updgrp_build_workers_get()) {
+		printf("%u workers left\n", bgp_updgrp_build_workers_get());
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	bgp_updgrp_build_finish();
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
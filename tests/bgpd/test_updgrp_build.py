@@ -0,0 +1,11 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestUpdgrpBuild(frrtest.TestMultiOut):
+    program = "./test_updgrp_build"
+
+
+TestUpdgrpBuild.okfail("schedule")
+TestUpdgrpBuild.okfail("units")
+TestUpdgrpBuild.okfail("workers off")
@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * VPN to VRF leak queue test.
+ *
+ * Queues more than a batch of VPN paths for leaking, removes some of them
+ * while they are queued, and checks that the batches skip those, and that
+ * the queued paths hold their references until they are processed or the
+ * queue of their instance is flushed.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "frr_pthread.h"
+#include "routemap.h"
+#include "sockunion.h"
+
+/* for the leak queue and vpn_leak_to_vrf_process() */
+#include "bgpd/bgp_mplsvpn.c"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_vty.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct event_loop *master = NULL;
+
+/* two batches, the second one partial */
+#define NPATHS (VPN_LEAK_BATCH + 10)
+
+static int failed;
+static struct bgp *bgp;
+static as_t asn = 65000;
+static struct peer *peer;
+static struct attr *attr;
+static struct bgp_path_info *paths[NPATHS];
+
+static void setup_peer(void)
+{
+	union sockunion su;
+
+	str2sockunion("192.0.2.1", &su);
+	peer = peer_create_accept(bgp, &su);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST, "192.0.2.1");
+	peer->as = 65001;
+	peer->sort = BGP_PEER_EBGP;
+}
+
+/*
+ * The instance imports the route-target of the paths, without import being
+ * enabled, so that it is a leak target but leaking into it does nothing.
+ */
+static void setup_import(void)
+{
+	struct attr tmp = {};
+
+	bgp->vpn_policy[AFI_IP].rtlist[BGP_VPN_POLICY_DIR_FROMVPN] =
+		ecommunity_str2com("65000:1", ECOMMUNITY_ROUTE_TARGET, 0);
+	vpn_leak_rt_index_invalidate();
+
+	tmp.origin = BGP_ORIGIN_IGP;
+	bgp_attr_set(&tmp, BGP_ATTR_ORIGIN);
+	tmp.nexthop.s_addr = htonl(0xc0000201);
+	bgp_attr_set(&tmp, BGP_ATTR_NEXT_HOP);
+	bgp_attr_set_ecommunity(&tmp, ecommunity_str2com("65000:1",
+							 ECOMMUNITY_ROUTE_TARGET,
+							 0));
+	attr = bgp_attr_intern(&tmp);
+}
+
+static struct bgp_path_info *add_path(unsigned int i)
+{
+	struct prefix p = { .family = AF_INET, .prefixlen = IPV4_MAX_BITLEN };
+	struct bgp_path_info *pi;
+	struct bgp_dest *dest;
+
+	p.u.prefix4.s_addr = htonl(0x0a000000 + i);
+	dest = bgp_node_get(bgp->rib[AFI_IP][SAFI_UNICAST], &p);
+	pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, 0, peer,
+		       bgp_attr_intern(attr), dest);
+	bgp_path_info_add(dest, pi);
+	bgp_dest_unlock_node(dest);
+
+	return pi;
+}
+
+/* what the event does */
+static void run_batch(void)
+{
+	event_cancel(&vpn_leakq.t_process);
+	vpn_leak_to_vrf_process(NULL);
+}
+
+static void check(size_t depth, int peer_lock)
+{
+	if (vpn_leakq_count(&vpn_leakq.queue) != depth) {
+		printf("%zu paths queued, expected %zu\n",
+		       vpn_leakq_count(&vpn_leakq.queue), depth);
+		failed++;
+	}
+	if (!depth && vpn_leakq.t_process) {
+		printf("empty queue still scheduled\n");
+		failed++;
+	}
+	if (peer->lock != peer_lock) {
+		printf("peer lock %d, expected %d\n", peer->lock, peer_lock);
+		failed++;
+	}
+}
+
+static void check_paths(unsigned int from, unsigned int to, int path_lock)
+{
+	unsigned int i;
+
+	for (i = from; i < to; i++)
+		if (paths[i]->lock != path_lock) {
+			printf("path %u lock %d, expected %d\n", i,
+			       paths[i]->lock, path_lock);
+			failed++;
+			return;
+		}
+}
+
+int main(void)
+{
+	uint64_t processed, leaks;
+	int peer_lock, path_lock;
+	unsigned int i;
+	int before;
+
+	qobj_init();
+	frr_pthread_init();
+	cmd_init(0);
+	bgp_vty_init();
+	master = event_master_create("test vpn leak queue");
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	vrf_init(NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_route_init();
+	bgp_route_map_init();
+
+	if (bgp_get(&bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT, NULL,
+		    ASNOTATION_PLAIN) < 0)
+		return -1;
+	setup_peer();
+	setup_import();
+
+	for (i = 0; i < NPATHS; i++)
+		paths[i] = add_path(i);
+	peer_lock = peer->lock;
+	path_lock = paths[0]->lock;
+
+	printf("removed skipped\n");
+	before = failed;
+	processed = vpn_leakq.processed;
+	leaks = vpn_leakq.leaks;
+	for (i = 0; i < NPATHS; i++)
+		vpn_leak_to_vrf_update(bgp, paths[i], NULL, peer);
+	check(NPATHS, peer_lock + NPATHS);
+	check_paths(0, NPATHS, path_lock + 1);
+
+	/* withdrawn while queued, on both sides of the batch boundary */
+	for (i = 1; i < NPATHS; i += 2)
+		bgp_path_info_mark_for_delete(paths[i]->net, paths[i]);
+
+	run_batch();
+	check(NPATHS - VPN_LEAK_BATCH, peer_lock + NPATHS - VPN_LEAK_BATCH);
+	check_paths(0, VPN_LEAK_BATCH, path_lock);
+	check_paths(VPN_LEAK_BATCH, NPATHS, path_lock + 1);
+	if (!vpn_leakq.t_process) {
+		printf("second batch not scheduled\n");
+		failed++;
+	}
+	run_batch();
+	check(0, peer_lock);
+	check_paths(0, NPATHS, path_lock);
+
+	if (vpn_leakq.processed - processed != NPATHS ||
+	    vpn_leakq.leaks - leaks != NPATHS / 2) {
+		printf("%" PRIu64 " paths processed, %" PRIu64
+		       " leaked, expected %u, %u\n",
+		       vpn_leakq.processed - processed,
+		       vpn_leakq.leaks - leaks, NPATHS, NPATHS / 2);
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("instance flushed\n");
+	before = failed;
+	processed = vpn_leakq.processed;
+	for (i = 0; i < NPATHS; i++)
+		vpn_leak_to_vrf_update(bgp, paths[i], NULL, peer);
+	vpn_leak_to_vrf_queue_flush(bgp);
+	check(0, peer_lock);
+	check_paths(0, NPATHS, path_lock);
+	if (vpn_leakq.processed != processed) {
+		printf("flushed paths processed\n");
+		failed++;
+	}
+	printf("%s\n", failed == before ? "OK" : "failed");
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import frrtest
+
+
+class TestVpnLeakq(frrtest.TestMultiOut):
+    program = "./test_vpn_leakq"
+
+
+TestVpnLeakq.okfail("removed skipped")
+TestVpnLeakq.okfail("instance flushed")
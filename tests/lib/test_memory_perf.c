@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares allocating from malloc and from the slabs, at
+ * the sizes of the objects bgpd allocates the most, and checks that the slabs
+ * hand out distinct objects and account for all of them.
+ *
+ *   test_memory_perf [objects] [rounds]
+ *
+ * Objects are allocated all at once then freed in random order, freed and
+ * allocated again one at a time, and allocated by a pthread to be freed by
+ * another, as RCU does.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "memory.h"
+#include "monotime.h"
+#include "prng.h"
+
+DEFINE_MGROUP(TEST_MEMORY_PERF, "memory benchmark");
+DEFINE_MTYPE_STATIC(TEST_MEMORY_PERF, BENCH_MALLOC, "from malloc");
+DEFINE_MTYPE_STATIC_SLAB(TEST_MEMORY_PERF, BENCH_SLAB, "from slabs");
+
+#define BENCH_OBJECTS 1000000
+#define BENCH_ROUNDS  4
+
+/* bgp_adj_in, bgp_adj_out, bgp_path_info_extra, bgp_path_info */
+static const size_t sizes[] = { 56, 64, 88, 160 };
+
+struct bench {
+	struct memtype *mt;
+	size_t size;
+	unsigned int count;
+	void **objs;
+	unsigned int *order;
+	int failed;
+};
+
+static void bench_fill(struct bench *b, unsigned int i)
+{
+	b->objs[i] = XCALLOC(b->mt, b->size);
+	memset(b->objs[i], i & 0xff, b->size);
+}
+
+/* an object another one was carved over no longer holds its own byte */
+static void bench_free(struct bench *b, unsigned int i)
+{
+	const unsigned char *obj = b->objs[i];
+	size_t j;
+
+	for (j = 0; j < b->size; j++)
+		if (obj[j] != (i & 0xff)) {
+			b->failed++;
+			break;
+		}
+	XFREE(b->mt, b->objs[i]);
+}
+
+static int64_t bench_bulk(struct bench *b, unsigned int rounds)
+{
+	struct timeval tv;
+	unsigned int r, i;
+
+	monotime(&tv);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < b->count; i++)
+			bench_fill(b, i);
+		for (i = 0; i < b->count; i++)
+			bench_free(b, b->order[i]);
+	}
+	return monotime_since(&tv, NULL);
+}
+
+static int64_t bench_churn(struct bench *b, unsigned int rounds)
+{
+	struct timeval tv;
+	unsigned int r, i;
+
+	for (i = 0; i < b->count; i++)
+		bench_fill(b, i);
+
+	monotime(&tv);
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < b->count; i++) {
+			bench_free(b, b->order[i]);
+			bench_fill(b, b->order[i]);
+		}
+	return monotime_since(&tv, NULL);
+}
+
+static void *bench_alloc_thread(void *arg)
+{
+	struct bench *b = arg;
+	unsigned int i;
+
+	for (i = 0; i < b->count; i++)
+		bench_fill(b, i);
+	return NULL;
+}
+
+static int64_t bench_remote(struct bench *b, unsigned int rounds)
+{
+	struct timeval tv;
+	pthread_t thread;
+	unsigned int r, i;
+
+	monotime(&tv);
+	for (r = 0; r < rounds; r++) {
+		pthread_create(&thread, NULL, bench_alloc_thread, b);
+		pthread_join(thread, NULL);
+		for (i = 0; i < b->count; i++)
+			bench_free(b, b->order[i]);
+	}
+	return monotime_since(&tv, NULL);
+}
+
+static void bench_report(const char *name, struct bench *b, int64_t usec,
+			 unsigned int rounds)
+{
+	printf("%-8s %-12s %4zu bytes: %lld.%03lld ms (%.1f ns/object)\n", name,
+	       b->mt->name, b->size, (long long)usec / 1000,
+	       (long long)usec % 1000,
+	       (double)usec * 1000 / ((double)b->count * rounds));
+}
+
+static int slab_in_use(void *arg, const struct qmem_slab_stats *st)
+{
+	*(size_t *)arg += st->used - st->cached;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = BENCH_OBJECTS, rounds = BENCH_ROUNDS;
+	struct memtype *mts[] = { MTYPE_BENCH_MALLOC, MTYPE_BENCH_SLAB };
+	struct bench b = {};
+	struct prng *prng;
+	unsigned int i, j, k, tmp;
+	size_t in_use;
+	int failed = 0;
+
+	if (argc > 1)
+		count = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		rounds = strtoul(argv[2], NULL, 10);
+	if (!count || !rounds) {
+		fprintf(stderr, "usage: %s [objects] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	b.count = count;
+	b.objs = calloc(count, sizeof(*b.objs));
+	b.order = calloc(count, sizeof(*b.order));
+
+	prng = prng_new(0);
+	for (i = 0; i < count; i++)
+		b.order[i] = i;
+	for (i = count - 1; i > 0; i--) {
+		j = prng_rand(prng) % (i + 1);
+		tmp = b.order[i];
+		b.order[i] = b.order[j];
+		b.order[j] = tmp;
+	}
+	prng_free(prng);
+
+	for (i = 0; i < array_size(sizes); i++) {
+		b.size = sizes[i];
+		for (k = 0; k < array_size(mts); k++) {
+			b.mt = mts[k];
+			bench_report("bulk", &b, bench_bulk(&b, rounds), rounds);
+		}
+		for (k = 0; k < array_size(mts); k++) {
+			b.mt = mts[k];
+			bench_report("churn", &b, bench_churn(&b, rounds),
+				     rounds);
+			for (j = 0; j < count; j++)
+				bench_free(&b, j);
+		}
+		for (k = 0; k < array_size(mts); k++) {
+			b.mt = mts[k];
+			bench_report("remote", &b, bench_remote(&b, rounds),
+				     rounds);
+		}
+	}
+
+	if (b.failed) {
+		printf("failed: %d objects overwritten\n", b.failed);
+		failed++;
+	}
+
+	in_use = 0;
+	qmem_slab_walk(slab_in_use, &in_use);
+	if (mtype_stats_alloc(MTYPE_BENCH_MALLOC) ||
+	    mtype_stats_alloc(MTYPE_BENCH_SLAB) || in_use) {
+		printf("failed: %zu + %zu objects allocated, %zu in the slabs\n",
+		       mtype_stats_alloc(MTYPE_BENCH_MALLOC),
+		       mtype_stats_alloc(MTYPE_BENCH_SLAB), in_use);
+		failed++;
+	}
+
+	free(b.objs);
+	free(b.order);
+
+	return failed;
+}
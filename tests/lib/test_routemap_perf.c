@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares the throughput of interpreted and compiled
+ * route-maps, and checks that both give the same results.
+ *
+ *   test_routemap_perf [routes] [clauses]
+ *
+ * Two route-maps are measured: one where every clause matches a prefix-list,
+ * which is looked up through the prefix tables, and one where the clauses
+ * only match tags and are evaluated in sequence, ending with a call to the
+ * first one.
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "command.h"
+#include "memory.h"
+#include "monotime.h"
+#include "plist.h"
+#include "printfrr.h"
+#include "routemap.h"
+#include "prng.h"
+
+#define BENCH_ROUTES  200000
+#define BENCH_CLAUSES 500
+
+struct bench_route {
+	uint32_t tag;
+	uint32_t metric;
+};
+
+struct bench_result {
+	route_map_result_t ret;
+	uint32_t metric;
+};
+
+/* `match ip address prefix-list PLIST' */
+static enum route_map_cmd_result_t
+bench_match_plist_do(struct prefix_list *plist, const struct prefix *prefix)
+{
+	return prefix_list_apply(plist, prefix) == PREFIX_DENY ? RMAP_NOMATCH
+							       : RMAP_MATCH;
+}
+
+static enum route_map_cmd_result_t
+bench_match_plist(void *rule, const struct prefix *prefix, void *object)
+{
+	struct prefix_list *plist;
+
+	plist = prefix_list_lookup(AFI_IP, rule);
+	if (!plist)
+		return RMAP_NOMATCH;
+
+	return bench_match_plist_do(plist, prefix);
+}
+
+static void *bench_match_plist_bind(void *rule)
+{
+	return prefix_list_lookup(AFI_IP, rule);
+}
+
+static enum route_map_cmd_result_t
+bench_match_plist_bound(void *rule, void *bound, const struct prefix *prefix,
+			void *object)
+{
+	return bench_match_plist_do(bound, prefix);
+}
+
+static void *bench_str_compile(const char *arg)
+{
+	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+}
+
+static void bench_value_free(void *rule)
+{
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+}
+
+static const struct route_map_rule_cmd bench_match_plist_cmd = {
+	"ip address prefix-list",
+	bench_match_plist,
+	bench_str_compile,
+	bench_value_free,
+	NULL,
+	bench_match_plist_bind,
+	bench_match_plist_bound
+};
+
+/* `match tag TAG' and `set metric METRIC' */
+static void *bench_u32_compile(const char *arg)
+{
+	uint32_t *val = XMALLOC(MTYPE_ROUTE_MAP_COMPILED, sizeof(*val));
+
+	*val = strtoul(arg, NULL, 10);
+	return val;
+}
+
+static enum route_map_cmd_result_t
+bench_match_tag(void *rule, const struct prefix *prefix, void *object)
+{
+	struct bench_route *route = object;
+
+	return route->tag == *(uint32_t *)rule ? RMAP_MATCH : RMAP_NOMATCH;
+}
+
+static const struct route_map_rule_cmd bench_match_tag_cmd = {
+	"tag",
+	bench_match_tag,
+	bench_u32_compile,
+	bench_value_free
+};
+
+static enum route_map_cmd_result_t
+bench_set_metric(void *rule, const struct prefix *prefix, void *object)
+{
+	struct bench_route *route = object;
+
+	route->metric = *(uint32_t *)rule;
+	return RMAP_OKAY;
+}
+
+static const struct route_map_rule_cmd bench_set_metric_cmd = {
+	"metric",
+	bench_set_metric,
+	bench_u32_compile,
+	bench_value_free
+};
+
+static struct in_addr clause_block(unsigned int i)
+{
+	struct in_addr addr = { .s_addr = htonl(0x0a000000 + (i << 12)) };
+
+	return addr;
+}
+
+static void setup_prefix_lists(unsigned int nclauses)
+{
+	struct prefix_list_entry *ple;
+	struct prefix_list *plist;
+	char name[32];
+	unsigned int i;
+
+	for (i = 0; i < nclauses; i++) {
+		snprintf(name, sizeof(name), "PL%u", i);
+		plist = prefix_list_get(AFI_IP, 0, name);
+
+		ple = prefix_list_entry_new();
+		ple->pl = plist;
+		ple->seq = 5;
+		ple->type = PREFIX_PERMIT;
+		ple->prefix.family = AF_INET;
+		ple->prefix.prefixlen = 20;
+		ple->prefix.u.prefix4 = clause_block(i);
+		ple->le = 24;
+		prefix_list_entry_update_finish(ple);
+	}
+}
+
+static void setup_route_maps(unsigned int nclauses)
+{
+	struct route_map_index *index;
+	struct route_map *map;
+	char arg[32];
+	unsigned int i;
+
+	/* clause i: 10.x.y.0/20 le 24 and tag i % 3, every 7th one denies */
+	map = route_map_get("BENCH-PLIST");
+	for (i = 0; i < nclauses; i++) {
+		index = route_map_index_get(map,
+					    i % 7 == 6 ? RMAP_DENY : RMAP_PERMIT,
+					    (i + 1) * 10);
+		snprintf(arg, sizeof(arg), "PL%u", i);
+		route_map_add_match(index, "ip address prefix-list", arg,
+				    RMAP_EVENT_PLIST_ADDED);
+		snprintf(arg, sizeof(arg), "%u", i % 3);
+		route_map_add_match(index, "tag", arg, RMAP_EVENT_MATCH_ADDED);
+		snprintf(arg, sizeof(arg), "%u", i);
+		route_map_add_set(index, "metric", arg);
+	}
+
+	/* clause i: tag i, every 50th goes on, and a final call */
+	map = route_map_get("BENCH-SEQ");
+	for (i = 0; i < nclauses; i++) {
+		index = route_map_index_get(map,
+					    i % 7 == 6 ? RMAP_DENY : RMAP_PERMIT,
+					    (i + 1) * 10);
+		snprintf(arg, sizeof(arg), "%u", i);
+		route_map_add_match(index, "tag", arg, RMAP_EVENT_MATCH_ADDED);
+		route_map_add_set(index, "metric", arg);
+		if (i % 50 == 0)
+			index->exitpolicy = RMAP_NEXT;
+	}
+	index = route_map_index_get(map, RMAP_PERMIT, (nclauses + 1) * 10);
+	index->nextrm = XSTRDUP(MTYPE_ROUTE_MAP_NAME, "BENCH-PLIST");
+
+	/* the fields above were set behind the route-map code's back */
+	route_map_compiled_invalidate();
+}
+
+static int64_t run(struct route_map *map, const struct prefix_ipv4 *prefixes,
+		   const struct bench_route *routes,
+		   struct bench_result *results, unsigned int nroutes)
+{
+	struct bench_route route;
+	struct timeval tv;
+	unsigned int i;
+
+	monotime(&tv);
+	for (i = 0; i < nroutes; i++) {
+		route = routes[i];
+		results[i].ret = route_map_apply(map,
+						 (const struct prefix *)&prefixes[i],
+						 &route);
+		results[i].metric = route.metric;
+	}
+
+	return monotime_since(&tv, NULL);
+}
+
+static int bench(const char *name, unsigned int nroutes, unsigned int tags,
+		 unsigned int nclauses, struct prng *prng)
+{
+	struct route_map *map = route_map_lookup_by_name(name);
+	struct bench_result *interpreted, *compiled;
+	struct prefix_ipv4 *prefixes;
+	struct bench_route *routes;
+	int64_t usec_int, usec_comp;
+	unsigned int i, permitted = 0;
+	int failed = 0;
+
+	prefixes = calloc(nroutes, sizeof(*prefixes));
+	routes = calloc(nroutes, sizeof(*routes));
+	interpreted = calloc(nroutes, sizeof(*interpreted));
+	compiled = calloc(nroutes, sizeof(*compiled));
+
+	/* mostly inside the prefix-lists' blocks, some beyond */
+	for (i = 0; i < nroutes; i++) {
+		prefixes[i].family = AF_INET;
+		prefixes[i].prefixlen = 24;
+		prefixes[i].prefix.s_addr =
+			htonl(0x0a000000 +
+			      ((prng_rand(prng) % (nclauses * 18)) << 8));
+		routes[i].tag = prng_rand(prng) % tags;
+	}
+
+	route_map_compiled_set(false);
+	usec_int = run(map, prefixes, routes, interpreted, nroutes);
+	route_map_compiled_set(true);
+	usec_comp = run(map, prefixes, routes, compiled, nroutes);
+
+	for (i = 0; i < nroutes; i++) {
+		if (interpreted[i].ret == RMAP_PERMITMATCH)
+			permitted++;
+		if (interpreted[i].ret == compiled[i].ret &&
+		    interpreted[i].metric == compiled[i].metric)
+			continue;
+
+		if (!failed++)
+			printfrr("failed: %s %pI4 tag %u: interpreted %d metric %u, compiled %d metric %u\n",
+				 name, &prefixes[i].prefix, routes[i].tag,
+				 interpreted[i].ret, interpreted[i].metric,
+				 compiled[i].ret, compiled[i].metric);
+	}
+
+	printf("%-12s %u routes, %u clauses, %u permitted: interpreted %lld ms, compiled %lld ms\n",
+	       name, nroutes, nclauses, permitted, (long long)usec_int / 1000,
+	       (long long)usec_comp / 1000);
+
+	free(prefixes);
+	free(routes);
+	free(interpreted);
+	free(compiled);
+	return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int nroutes = BENCH_ROUTES;
+	unsigned int nclauses = BENCH_CLAUSES;
+	struct prng *prng;
+	int failed = 0;
+
+	if (argc > 1)
+		nroutes = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		nclauses = strtoul(argv[2], NULL, 10);
+	if (!nroutes || !nclauses || nclauses > 4000) {
+		fprintf(stderr, "usage: %s [routes] [clauses]\n", argv[0]);
+		return 1;
+	}
+
+	qobj_init();
+	cmd_init(0);
+	prefix_list_init();
+	route_map_init();
+	route_map_install_match(&bench_match_plist_cmd);
+	route_map_install_match(&bench_match_tag_cmd);
+	route_map_install_set(&bench_set_metric_cmd);
+
+	setup_prefix_lists(nclauses);
+	setup_route_maps(nclauses);
+
+	prng = prng_new(0);
+	failed += bench("BENCH-PLIST", nroutes, 3, nclauses, prng);
+	failed += bench("BENCH-SEQ", nroutes, nclauses + nclauses / 10,
+			nclauses, prng);
+	prng_free(prng);
+
+	route_map_finish();
+	prefix_list_reset();
+
+	printf("failures: %d\n", failed);
+	return failed;
+}
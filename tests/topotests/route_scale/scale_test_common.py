@@ -104,8 +104,15 @@ def scale_converge_protocols():
     assert success, "Connected routes are not properly installed:\n{}".format(result)
 
 
-def run_one_setup(r1, s):
-    "Run one ecmp config"
+def sharp_install_time(output):
+    "Seconds the last install or removal took, from 'sharp data route'"
+
+    m = re.search(r"Time: (\d+)\.(\d+)", output)
+    return int(m.group(1)) + int(m.group(2)) / 1000000.0
+
+
+def run_one_setup(r1, s, bulk=False):
+    "Run one ecmp config, returning the seconds the install took"
 
     # Extract params
     expected_installed = s["expect_in"]
@@ -127,8 +134,8 @@ def run_one_setup(r1, s):
 
     r1.vtysh_cmd(
         "sharp install route 1.0.0.0 \
-                  nexthop-group {} {}".format(
-            s["nhg"], count
+                  nexthop-group {} {}{}".format(
+            s["nhg"], count, " bulk" if bulk else ""
         ),
         isjson=False,
     )
@@ -142,6 +149,7 @@ def run_one_setup(r1, s):
     output = r1.vtysh_cmd("sharp data route", isjson=False)
     logger.info("{} routes X {} ecmp installed".format(count, s["ecmp"]))
     logger.info(output)
+    installed = sharp_install_time(output)
     r1.vtysh_cmd("sharp remove route 1.0.0.0 {}".format(count), isjson=False)
     test_func = partial(
         topotest.router_json_cmp, r1, "show ip route summary json", expected_removed
@@ -153,8 +161,10 @@ def run_one_setup(r1, s):
     logger.info("{} routes x {} ecmp removed".format(count, s["ecmp"]))
     logger.info(output)
 
+    return installed
+
 
-def route_install_helper(iter):
+def route_install_helper(iter, bulk=False):
     "Test route install for a variety of ecmp"
 
     tgen = get_topogen()
@@ -210,7 +220,7 @@ def route_install_helper(iter):
         if k not in d:
             d[k] = scale_defaults[k]
 
-    run_one_setup(r1, d)
+    return run_one_setup(r1, d, bulk)
 
 
 # Mem leak testcase
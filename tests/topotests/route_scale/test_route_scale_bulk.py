@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+# SPDX-License-Identifier: ISC
+
+#
+# test_route_scale_bulk.py
+#
+
+"""
+test_route_scale_bulk.py: Compare the routes per second zebra installs when
+sharpd sends one ZEBRA_ROUTE_ADD per route and when it sends the routes in
+ZEBRA_ROUTE_ADD_BULK messages.
+
+"""
+import os
+import sys
+import pytest
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+
+from lib.topolog import logger
+from scale_test_common import (
+    scale_build_common,
+    scale_setup_module,
+    route_install_helper,
+    scale_test_memory_leak,
+    scale_converge_protocols,
+    scale_teardown_module,
+)
+
+
+pytestmark = [pytest.mark.sharpd]
+
+ROUTES = 1000000
+
+
+def build(tgen):
+    scale_build_common(tgen)
+
+
+def setup_module(module):
+    scale_setup_module(module)
+
+
+def teardown_module(_mod):
+    scale_teardown_module(_mod)
+
+
+def test_converge_protocols():
+    scale_converge_protocols()
+
+
+def compare_install(iter):
+    single = route_install_helper(iter)
+    bulk = route_install_helper(iter, bulk=True)
+
+    logger.info(
+        "one message per route: {:.3f}s ({:.0f} routes/s), bulk: {:.3f}s ({:.0f} routes/s)".format(
+            single, ROUTES / single, bulk, ROUTES / bulk
+        )
+    )
+
+
+def test_route_install_bulk_1nh():
+    compare_install(0)
+
+
+def test_route_install_bulk_8nh():
+    compare_install(3)
+
+
+def test_memory_leak():
+    scale_test_memory_leak()
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
@@ -2146,6 +2146,25 @@ static void zread_nhg_add(ZAPI_HANDLER_ARGS)
 		client->nhg_add_cnt++;
 }
 
+static void zread_route_add_stats(struct zserv *client,
+				  const struct prefix *p, int ret)
+{
+	switch (p->family) {
+	case AF_INET:
+		if (ret == 0)
+			client->v4_route_add_cnt++;
+		else if (ret == 1)
+			client->v4_route_upd8_cnt++;
+		break;
+	case AF_INET6:
+		if (ret == 0)
+			client->v6_route_add_cnt++;
+		else if (ret == 1)
+			client->v6_route_upd8_cnt++;
+		break;
+	}
+}
+
 static void zread_route_add(ZAPI_HANDLER_ARGS)
 {
 	struct stream *s;
@@ -2283,20 +2302,114 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		zebra_nhg_backup_free(&bnhg);
 
 	/* Stats */
-	switch (api.prefix.family) {
-	case AF_INET:
-		if (ret == 0)
-			client->v4_route_add_cnt++;
-		else if (ret == 1)
-			client->v4_route_upd8_cnt++;
-		break;
-	case AF_INET6:
-		if (ret == 0)
-			client->v6_route_add_cnt++;
-		else if (ret == 1)
-			client->v6_route_upd8_cnt++;
-		break;
+	zread_route_add_stats(client, &api.prefix, ret);
+}
+
+/*
+ * Routes which share their nexthops and attributes: the nexthops are read
+ * once, then each route gets its own copy of the group as above.
+ */
+static void zread_route_add_bulk(ZAPI_HANDLER_ARGS)
+{
+	struct stream *s;
+	struct zapi_route api;
+	afi_t afi;
+	struct route_entry *re;
+	struct nexthop_group *ng = NULL;
+	struct nhg_backup_info *bnhg = NULL;
+	int ret;
+	vrf_id_t vrf_id;
+	struct nhg_hash_entry nhe, *n;
+	uint16_t count, i;
+
+	s = msg;
+	if (zapi_route_bulk_decode(s, &api, &count) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __func__);
+		return;
 	}
+
+	vrf_id = zvrf_id(zvrf);
+	afi = family2afi(api.prefix.family);
+
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: %u routes (%s:%u), msg flags=0x%x, flags=0x%x",
+			   __func__, count, zvrf_name(zvrf), api.tableid,
+			   (int)api.message, api.flags);
+
+	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NHG)
+	    && (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
+		|| api.nexthop_num == 0)) {
+		flog_warn(EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
+			  "%s: received %u routes without nexthops (%s:%u) from client %s",
+			  __func__, count, zvrf_name(zvrf), api.tableid,
+			  zebra_route_string(client->proto));
+		return;
+	}
+
+	if (api.safi != SAFI_UNICAST && api.safi != SAFI_MULTICAST) {
+		flog_warn(EC_LIB_ZAPI_MISSMATCH,
+			  "%s: Received safi: %d but we can only accept UNICAST or MULTICAST",
+			  __func__, api.safi);
+		return;
+	}
+
+	if (!api.nhgid
+	    && (!zapi_read_nexthops(client, &api.prefix, api.nexthops,
+				    api.flags, api.message, api.nexthop_num,
+				    api.backup_nexthop_num, &ng, NULL)
+		|| !zapi_read_nexthops(client, &api.prefix, api.backup_nexthops,
+				       api.flags, api.message,
+				       api.backup_nexthop_num,
+				       api.backup_nexthop_num, NULL, &bnhg))) {
+		nexthop_group_delete(&ng);
+		zebra_nhg_backup_free(&bnhg);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (zapi_route_bulk_decode_prefix(s, &api) < 0) {
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: Unable to decode prefix %u of %u",
+					   __func__, i + 1, count);
+			break;
+		}
+
+		re = zebra_rib_route_entry_new(
+			vrf_id, api.type, api.instance, api.flags, api.nhgid,
+			api.tableid ? api.tableid : zvrf->table_id, api.metric,
+			api.mtu, api.distance, api.tag);
+
+		if (CHECK_FLAG(api.message, ZAPI_MESSAGE_OPAQUE)) {
+			re->opaque = XMALLOC(MTYPE_RE_OPAQUE,
+					     sizeof(struct re_opaque) +
+						     api.opaque.length);
+			re->opaque->length = api.opaque.length;
+			memcpy(re->opaque->data, api.opaque.data,
+			       re->opaque->length);
+		}
+
+		n = NULL;
+		if (!re->nhe_id) {
+			zebra_nhe_init(&nhe, afi, ng->nexthop);
+			nhe.nhg.nexthop = ng->nexthop;
+			nhe.backup_info = bnhg;
+			n = zebra_nhe_copy(&nhe, 0);
+		}
+		ret = rib_add_multipath_nhe(afi, api.safi, &api.prefix, NULL,
+					    re, n, false, true);
+		if (ret == -1) {
+			client->error_cnt++;
+			zebra_rib_route_entry_free(re);
+		}
+
+		zread_route_add_stats(client, &api.prefix, ret);
+	}
+
+	nexthop_group_delete(&ng);
+	if (bnhg)
+		zebra_nhg_backup_free(&bnhg);
 }
 
 void zapi_re_opaque_free(struct route_entry *re)
@@ -4138,6 +4251,7 @@ void (*const zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_INTERFACE_DELETE] = zread_interface_delete,
 	[ZEBRA_INTERFACE_SET_PROTODOWN] = zread_interface_set_protodown,
 	[ZEBRA_ROUTE_ADD] = zread_route_add,
+	[ZEBRA_ROUTE_ADD_BULK] = zread_route_add_bulk,
 	[ZEBRA_ROUTE_DELETE] = zread_route_del,
 	[ZEBRA_REDISTRIBUTE_ADD] = zebra_redistribute_add,
 	[ZEBRA_REDISTRIBUTE_DELETE] = zebra_redistribute_delete,